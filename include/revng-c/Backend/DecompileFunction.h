@@ -4,11 +4,17 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <string>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
 #include "revng/Model/Binary.h"
 #include "revng/Pipes/StringMap.h"
+#include "revng/Support/MetaAddress.h"
 
 #include "revng-c/Backend/DecompilePipe.h"
 
@@ -16,7 +22,44 @@ namespace detail {
 using Container = revng::pipes::DecompileStringMap;
 }
 
+/// Callback receiving the C code of each function, along with its entry
+using DecompiledFunctionSink = llvm::function_ref<void(const MetaAddress &,
+                                                       std::string &&)>;
+
+/// Decompile all the isolated functions in \a M, handing their C code over to
+/// \a Sink in order of entry address, as soon as each of them is ready.
+///
+/// If \a Targets is not empty, only the functions with an entry in \a Targets
+/// are decompiled, the others are not even restructured.
+void decompile(FunctionMetadataCache &Cache,
+               llvm::Module &M,
+               const model::Binary &Model,
+               DecompiledFunctionSink Sink,
+               const std::set<MetaAddress> &Targets = {});
+
+/// Decompile all the isolated functions in \a M, writing their C code to \a Out
+/// in order of entry address, each followed by a newline.
+///
+/// Unless functions are emitted in parallel or cached, the C code is written
+/// directly to \a Out, without ever holding a whole function in memory.
 void decompile(FunctionMetadataCache &Cache,
                llvm::Module &M,
                const model::Binary &Model,
-               detail::Container &DecompiledFunctions);
+               llvm::raw_ostream &Out,
+               const std::set<MetaAddress> &Targets = {});
+
+void decompile(FunctionMetadataCache &Cache,
+               llvm::Module &M,
+               const model::Binary &Model,
+               detail::Container &DecompiledFunctions,
+               const std::set<MetaAddress> &Targets = {});
+
+/// Decompile the direct callers and callees of the functions with an entry in
+/// \a Around into the cache enabled by -decompile-cache-dir or
+/// -decompile-memory-cache-mb, so that the requests that are likely to come
+/// next are served from it. Does nothing if no cache is enabled.
+///
+/// \a M is not modified: the functions are restructured in a copy of it.
+void prefetchCallNeighbors(llvm::Module &M,
+                           const model::Binary &Model,
+                           const std::set<MetaAddress> &Around);
@@ -5,6 +5,7 @@
 //
 
 #include <array>
+#include <set>
 #include <string>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -15,6 +16,7 @@
 #include "revng/Pipes/FileContainer.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/StringMap.h"
+#include "revng/Support/MetaAddress.h"
 
 #include "revng-c/Pipes/Kinds.h"
 
@@ -28,6 +30,11 @@ using DecompileStringMap = FunctionStringMap<&kinds::Decompiled,
                                              DecompileMime,
                                              DecompileExtension>;
 
+/// Return the entry addresses of the functions the pipeline is asking to
+/// decompile, i.e., the ones with kind StackAccessesSegregated in
+/// \a IRContainer.
+std::set<MetaAddress> getFunctionsToDecompile(pipeline::LLVMContainer &IR);
+
 class Decompile {
 public:
   static constexpr auto Name = "decompile";
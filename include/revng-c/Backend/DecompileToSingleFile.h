@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/Pipes/StringMap.h"
@@ -16,7 +20,26 @@ namespace detail {
 using DecompiledStringMap = revng::pipes::DecompileStringMap;
 }
 
+/// Print the includes that the decompiled C code depends upon
+void printSingleCFileIncludes(llvm::raw_ostream &Out, ptml::PTMLCBuilder &B);
+
 void printSingleCFile(llvm::raw_ostream &Out,
                       ptml::PTMLCBuilder &B,
                       const detail::DecompiledStringMap &Functions,
                       const std::set<MetaAddress> &Targets);
+
+/// Split \a Functions into at most \a ShardCount groups of similar total size
+/// of C code, so that each group can be printed as its own translation unit.
+///
+/// \return the entries of the functions of each group, sorted by address. The
+///         result only depends on the content of \a Functions.
+std::vector<std::vector<MetaAddress>>
+partitionCFunctions(const detail::DecompiledStringMap &Functions,
+                    unsigned ShardCount);
+
+/// Print a translation unit with the includes and the bodies of the functions
+/// in \a Shard
+void printCFileShard(llvm::raw_ostream &Out,
+                     ptml::PTMLCBuilder &B,
+                     const detail::DecompiledStringMap &Functions,
+                     llvm::ArrayRef<MetaAddress> Shard);
@@ -12,6 +12,7 @@
 
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/Contract.h"
+#include "revng/Pipes/FileContainer.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/StringBufferContainer.h"
 #include "revng/Pipes/StringMap.h"
@@ -29,6 +30,14 @@ using DecompiledFileContainer = StringBufferContainer<&kinds::DecompiledToC,
                                                       DecompiledMIMEType,
                                                       DecompiledSuffix>;
 
+inline constexpr char DirectlyDecompiledName[] = "directly-decompiled-c-code";
+/// Backed by a file, so that the C code is written to disk as it's emitted
+using DirectlyDecompiledFileContainer = FileContainer<
+  &kinds::DirectlyDecompiledToC,
+  DirectlyDecompiledName,
+  DecompiledMIMEType,
+  DecompiledSuffix>;
+
 class DecompileToSingleFile {
 public:
   static constexpr auto Name = "decompile-to-single-file";
@@ -53,4 +62,34 @@ public:
              llvm::ArrayRef<std::string> ContainerNames) const;
 };
 
+/// Decompile all the isolated functions straight into a single C file,
+/// writing each of them as soon as it's ready, in order of entry address.
+/// Unlike decompile followed by decompile-to-single-file, the C code goes
+/// straight to the file backing the output container, hence only the C code of
+/// the functions being decompiled is held in memory, rather than the one of the
+/// whole program, twice.
+class DecompileDirectlyToSingleFile {
+public:
+  static constexpr auto Name = "decompile-directly-to-single-file";
+
+  std::array<pipeline::ContractGroup, 1> getContract() const {
+    using namespace pipeline;
+    using namespace revng::kinds;
+
+    return { ContractGroup({ Contract(StackAccessesSegregated,
+                                      0,
+                                      DirectlyDecompiledToC,
+                                      1,
+                                      InputPreservation::Preserve) }) };
+  }
+
+  void run(const pipeline::ExecutionContext &Ctx,
+           pipeline::LLVMContainer &IRContainer,
+           DirectlyDecompiledFileContainer &OutCFile);
+
+  void print(const pipeline::Context &Ctx,
+             llvm::raw_ostream &OS,
+             llvm::ArrayRef<std::string> ContainerNames) const;
+};
+
 } // end namespace revng::pipes
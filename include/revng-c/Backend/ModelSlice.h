@@ -0,0 +1,42 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
+#include "revng/TupleTree/TupleTree.h"
+
+namespace llvm {
+class Function;
+} // namespace llvm
+
+/// Extracts, for isolated functions, the slice of a model their C code depends
+/// upon: the function itself, its callees, the segments, the dynamic functions
+/// and all the types reachable from them.
+///
+/// A slice is a valid model on its own, hence the C code of a function can be
+/// obtained from its IR and its slice alone, e.g., with
+/// `revng decompile -m <slice>.yml`, without loading the whole model.
+///
+/// The model is serialized once, when the slicer is built, so that extracting
+/// the slices of many functions doesn't serialize it again for each of them.
+class ModelSlicer {
+private:
+  FunctionMetadataCache &Cache;
+  const model::Binary &Model;
+  std::string SerializedModel;
+
+public:
+  ModelSlicer(FunctionMetadataCache &Cache, const model::Binary &Model);
+
+public:
+  /// \return the slice of the model the C code of \a F depends upon
+  TupleTree<model::Binary> slice(const llvm::Function &F) const;
+
+  /// \return the YAML serialization of slice(F)
+  std::string serializeSlice(const llvm::Function &F) const;
+};
@@ -12,6 +12,7 @@
 #include <optional>
 #include <set>
 
+#include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
@@ -25,6 +26,13 @@ namespace llvm {
 class Value;
 } // end namespace llvm
 
+namespace dla {
+class LayoutTypePtr;
+} // end namespace dla
+
+template<>
+struct llvm::DenseMapInfo<dla::LayoutTypePtr>;
+
 namespace dla {
 
 /// A representation of a pointer to a type.
@@ -32,6 +40,8 @@ class LayoutTypePtr {
   const llvm::Value *V;
   unsigned FieldIdx;
 
+  friend struct llvm::DenseMapInfo<LayoutTypePtr>;
+
 public:
   static constexpr unsigned fieldNumNone = std::numeric_limits<unsigned>::max();
 
@@ -60,3 +70,26 @@ public:
 using LayoutTypePtrVect = std::vector<LayoutTypePtr>;
 
 } // end namespace dla
+
+template<>
+struct llvm::DenseMapInfo<dla::LayoutTypePtr> {
+  using ValueInfo = DenseMapInfo<const llvm::Value *>;
+
+  static dla::LayoutTypePtr getEmptyKey() {
+    return dla::LayoutTypePtr(ValueInfo::getEmptyKey());
+  }
+
+  static dla::LayoutTypePtr getTombstoneKey() {
+    return dla::LayoutTypePtr(ValueInfo::getTombstoneKey());
+  }
+
+  static unsigned getHashValue(const dla::LayoutTypePtr &Ptr) {
+    unsigned FieldHash = DenseMapInfo<unsigned>::getHashValue(Ptr.FieldIdx);
+    return detail::combineHashValue(ValueInfo::getHashValue(Ptr.V), FieldHash);
+  }
+
+  static bool isEqual(const dla::LayoutTypePtr &LHS,
+                      const dla::LayoutTypePtr &RHS) {
+    return LHS == RHS;
+  }
+};
@@ -4,22 +4,31 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+#include <atomic>
 #include <compare>
 #include <cstddef>
 #include <functional>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/IntEqClasses.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/iterator.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -116,9 +125,22 @@ public:
 protected:
   const LinkKind Kind;
   OffsetExpression OE;
+  // Precomputed, so that looking up a tag in the pool costs a single probe
+  size_t Hash;
 
   explicit TypeLinkTag(LinkKind K, OffsetExpression &&O) :
-    Kind(K), OE(std::move(O)) {}
+    Kind(K), OE(std::move(O)), Hash(computeHash()) {}
+
+  size_t computeHash() const {
+    llvm::hash_code Result = llvm::hash_combine(Kind, OE.Offset);
+    for (uint64_t Stride : OE.Strides)
+      Result = llvm::hash_combine(Result, Stride);
+    for (const std::optional<uint64_t> &TripCount : OE.TripCounts)
+      Result = llvm::hash_combine(Result,
+                                  TripCount.has_value(),
+                                  TripCount.value_or(0));
+    return Result;
+  }
 
   // TODO: potentially we are interested in marking TypeLinkTags with some info
   // that allows us to track which step on the type system has created them.
@@ -151,6 +173,14 @@ public:
 
   std::strong_ordering operator<=>(const TypeLinkTag &Other) const = default;
 
+  bool operator==(const TypeLinkTag &Other) const {
+    return Hash == Other.Hash and Kind == Other.Kind and OE == Other.OE;
+  }
+
+  struct Hasher {
+    size_t operator()(const TypeLinkTag &T) const { return T.Hash; }
+  };
+
   friend void
   writeToLog(Logger<true> &L, const dla::TypeLinkTag &T, int /* Ignore */);
 
@@ -158,6 +188,107 @@ public:
 
 class LayoutTypeSystem;
 
+/// Pool recycling the memory of the tree nodes of the neighbor sets of all the
+/// LayoutTypeSystemNodes in a LayoutTypeSystem.
+///
+/// The type system can have millions of edges, which are continuously added,
+/// moved and removed by the Steps: serving them from slabs and free lists
+/// avoids going through malloc at each change, and keeps the sets compact.
+///
+/// Steps running concurrently on different views of the same type system (see
+/// LayoutTypeSystem::splitIntoViews) share the pool, so it's split in shards,
+/// each with its own lock, and each thread draws from its own shard.
+class LinkNodePool {
+private:
+  struct alignas(64) Shard {
+    std::mutex Mutex;
+    llvm::BumpPtrAllocator Slabs;
+    /// For each size, the head of a list of free blocks, each one pointing to
+    /// the next with its first bytes
+    llvm::SmallDenseMap<size_t, void *, 2> FreeLists;
+  };
+
+  static constexpr unsigned NumShards = 16;
+  std::array<Shard, NumShards> Shards;
+
+public:
+  LinkNodePool() = default;
+  LinkNodePool(const LinkNodePool &) = delete;
+  LinkNodePool &operator=(const LinkNodePool &) = delete;
+
+public:
+  void *allocate(size_t Size) {
+    revng_assert(Size >= sizeof(void *));
+    Shard &S = getShard();
+    std::lock_guard Lock(S.Mutex);
+    void *&Head = S.FreeLists[Size];
+    if (Head == nullptr)
+      return S.Slabs.Allocate(Size, llvm::Align(alignof(std::max_align_t)));
+
+    void *Result = Head;
+    Head = *static_cast<void **>(Head);
+    return Result;
+  }
+
+  /// Blocks can be handed back to a shard different from the one they were
+  /// drawn from: all of them are released along with the pool.
+  void deallocate(void *Pointer, size_t Size) {
+    Shard &S = getShard();
+    std::lock_guard Lock(S.Mutex);
+    void *&Head = S.FreeLists[Size];
+    *static_cast<void **>(Pointer) = Head;
+    Head = Pointer;
+  }
+
+private:
+  Shard &getShard() {
+    static std::atomic<unsigned> NextIndex = 0;
+    thread_local unsigned Index = NextIndex++ % NumShards;
+    return Shards[Index];
+  }
+};
+
+/// Allocator for the neighbor sets, drawing single nodes from a LinkNodePool.
+///
+/// All the sets of a LayoutTypeSystem share the same pool, hence their
+/// allocators compare equal, and nodes can be extracted from one set and
+/// inserted into another.
+template<typename T>
+class LinkNodeAllocator {
+public:
+  using value_type = T;
+
+private:
+  template<typename U>
+  friend class LinkNodeAllocator;
+
+  LinkNodePool *Pool;
+
+public:
+  explicit LinkNodeAllocator(LinkNodePool &Pool) : Pool(&Pool) {}
+
+  template<typename U>
+  LinkNodeAllocator(const LinkNodeAllocator<U> &Other) : Pool(Other.Pool) {}
+
+public:
+  T *allocate(size_t N) {
+    if (N != 1)
+      return std::allocator<T>().allocate(N);
+    return static_cast<T *>(Pool->allocate(sizeof(T)));
+  }
+
+  void deallocate(T *Pointer, size_t N) {
+    if (N != 1)
+      return std::allocator<T>().deallocate(Pointer, N);
+    Pool->deallocate(Pointer, sizeof(T));
+  }
+
+  template<typename U>
+  bool operator==(const LinkNodeAllocator<U> &Other) const {
+    return Pool == Other.Pool;
+  }
+};
+
 enum InterferingChildrenInfo {
   Unknown = 0,
   AllChildrenAreInterfering,
@@ -200,15 +331,22 @@ struct LayoutTypeSystemNode {
     }
   };
 
-  using NeighborsSet = std::set<Link, NeighborLinkComparison>;
+  using NeighborsSet = std::set<Link,
+                                NeighborLinkComparison,
+                                LinkNodeAllocator<Link>>;
   using NeighborIterator = NeighborsSet::iterator;
-  NeighborsSet Successors{};
-  NeighborsSet Predecessors{};
+  NeighborsSet Successors;
+  NeighborsSet Predecessors;
   uint64_t Size{};
   InterferingChildrenInfo InterferingInfo{ Unknown };
   bool NonScalar{ false };
+  // Position in the LayoutTypeSystemNodeTable holding this node
+  size_t TableIndex = 0;
 
-  LayoutTypeSystemNode(uint64_t I) : ID(I) {}
+  LayoutTypeSystemNode(uint64_t I, LinkNodePool &Pool) :
+    ID(I),
+    Successors(NeighborLinkComparison(), LinkNodeAllocator<Link>(Pool)),
+    Predecessors(NeighborLinkComparison(), LinkNodeAllocator<Link>(Pool)) {}
 
 public:
   // This method should never be called, but it's necessary to be able to use
@@ -225,6 +363,143 @@ public:
   }
 };
 
+/// The nodes of a LayoutTypeSystem, in increasing order of ID.
+///
+/// Each node knows its position in the table, so checking if it belongs to the
+/// table and removing it take constant time. Removed nodes leave a hole, until
+/// the table is compacted. Iterators are positions in the table, hence they
+/// stay valid when nodes are added, and don't visit the new ones.
+class LayoutTypeSystemNodeTable {
+private:
+  using Node = LayoutTypeSystemNode;
+
+  std::vector<Node *> Slots;
+  size_t NumNodes = 0;
+
+public:
+  /// Slot index of the nodes that have been removed from the table
+  static constexpr size_t Removed = std::numeric_limits<size_t>::max();
+
+  class const_iterator
+    : public llvm::iterator_facade_base<const_iterator,
+                                        std::forward_iterator_tag,
+                                        Node *,
+                                        std::ptrdiff_t,
+                                        Node **,
+                                        Node *> {
+  private:
+    const std::vector<Node *> *Slots = nullptr;
+    size_t Index = 0;
+    size_t Limit = 0;
+
+  public:
+    const_iterator() = default;
+    const_iterator(const std::vector<Node *> &Slots,
+                   size_t Index,
+                   size_t Limit) :
+      Slots(&Slots), Index(Index), Limit(Limit) {
+      skipHoles();
+    }
+
+    bool operator==(const const_iterator &Other) const {
+      return Index == Other.Index;
+    }
+
+    Node *operator*() const { return (*Slots)[Index]; }
+
+    const_iterator &operator++() {
+      ++Index;
+      skipHoles();
+      return *this;
+    }
+
+  private:
+    void skipHoles() {
+      while (Index < Limit and (*Slots)[Index] == nullptr)
+        ++Index;
+    }
+  };
+
+public:
+  const_iterator begin() const { return { Slots, 0, Slots.size() }; }
+  const_iterator end() const { return { Slots, Slots.size(), Slots.size() }; }
+
+  size_t size() const { return NumNodes; }
+  bool empty() const { return NumNodes == 0; }
+
+  bool contains(const Node *N) const {
+    return N->TableIndex < Slots.size() and Slots[N->TableIndex] == N;
+  }
+
+  /// \return the node in slot \a Index, or nullptr if it has been removed
+  Node *getSlot(size_t Index) const {
+    return Index < Slots.size() ? Slots[Index] : nullptr;
+  }
+
+  /// Adds \a N, which must have an ID larger than all the nodes in the table
+  void insert(Node *N) {
+    revng_assert(Slots.empty() or Slots.back() == nullptr
+                 or Slots.back()->ID < N->ID);
+    N->TableIndex = Slots.size();
+    Slots.push_back(N);
+    ++NumNodes;
+  }
+
+  void erase(Node *N) {
+    revng_assert(contains(N));
+    Slots[N->TableIndex] = nullptr;
+    N->TableIndex = Removed;
+    --NumNodes;
+  }
+
+  void clear() {
+    Slots.clear();
+    NumNodes = 0;
+  }
+
+  /// Moves all the nodes of \a Other at the end of this table. The nodes are
+  /// not in order of ID anymore, until sortByID is called.
+  void append(LayoutTypeSystemNodeTable &Other) {
+    for (Node *N : Other) {
+      N->TableIndex = Slots.size();
+      Slots.push_back(N);
+    }
+    NumNodes += Other.size();
+    Other.clear();
+  }
+
+  /// Sorts the nodes by ID, removing the holes
+  void sortByID() {
+    llvm::erase_value(Slots, nullptr);
+    llvm::sort(Slots, [](const Node *LHS, const Node *RHS) {
+      return LHS->ID < RHS->ID;
+    });
+    for (size_t I = 0; I < Slots.size(); ++I)
+      Slots[I]->TableIndex = I;
+  }
+
+  /// Removes the holes, if they are more than the nodes.
+  ///
+  /// \return for each old slot, the new one, or Removed for holes. Empty if
+  ///         nothing has been moved.
+  std::vector<size_t> compact() {
+    if (Slots.size() - NumNodes <= NumNodes)
+      return {};
+
+    std::vector<size_t> NewIndex(Slots.size(), Removed);
+    size_t Next = 0;
+    for (size_t I = 0; I < Slots.size(); ++I) {
+      if (Slots[I] == nullptr)
+        continue;
+      NewIndex[I] = Next;
+      Slots[I]->TableIndex = Next;
+      Slots[Next++] = Slots[I];
+    }
+    Slots.resize(Next);
+    return NewIndex;
+  }
+};
+
 /// This class handles equivalence classes between indexes of vectors
 class VectEqClasses : public llvm::IntEqClasses {
 private:
@@ -232,6 +507,12 @@ private:
   std::optional<unsigned> RemovedID = {};
   unsigned NElems = 0;
 
+  /// The elements of each class, grouped by class ID, only while compressed.
+  /// The elements of class C are in Members[MembersBegin[C]] up to
+  /// Members[MembersBegin[C + 1]].
+  std::vector<unsigned> MembersBegin;
+  std::vector<unsigned> Members;
+
 private:
   /// Used internally, operator[] is removed for this class
   unsigned lookupEqClass(unsigned ID) const {
@@ -251,6 +532,15 @@ public:
   /// Get the total number of elements added
   unsigned getNumElements() const { return NElems; }
 
+  /// Get an element of the class of removed elements, if any
+  std::optional<unsigned> getRemovedID() const { return RemovedID; }
+
+  /// Compress the equivalence classes and index the elements of each class
+  void compress();
+
+  /// Revert to the uncompressed representation, dropping the index
+  void uncompress();
+
 public:
   /// You can't access the Eq Classes directly, some might be deleted
   unsigned operator[](unsigned) const = delete;
@@ -260,7 +550,8 @@ public:
   std::optional<unsigned> getEqClassID(const unsigned ID) const;
 
   /// Get all the elements that are in the same equivalence class of \a ID
-  ///\note Expensive: performs a linear scan of all the elements
+  ///\note On uncompressed classes this performs a linear scan of all the
+  ///      elements, otherwise it's proportional to the size of the class
   std::vector<unsigned> computeEqClass(const unsigned ID) const;
 
   /// Check if \a ID1 and \a ID2 have the same equivalence class
@@ -287,13 +578,29 @@ public:
 
   LayoutTypeSystem() : DebugPrinter(new TSDebugPrinter) {}
 
-  ~LayoutTypeSystem() {
-    for (auto *Layout : Layouts) {
-      Layout->~LayoutTypeSystemNode();
-      NodeAllocator.Deallocate(Layout);
-    }
-    Layouts.clear();
-  }
+  /// Destroys all the nodes or, if this is a view, hands them back to the
+  /// parent.
+  ~LayoutTypeSystem();
+
+private:
+  /// \param Nodes must be sorted by ID
+  LayoutTypeSystem(LayoutTypeSystem &Parent,
+                   llvm::ArrayRef<LayoutTypeSystemNode *> Nodes);
+
+public:
+  /// Moves the nodes into at most \a MaxViews views, each made of whole weakly
+  /// connected components, with roughly the same number of nodes.
+  ///
+  /// Steps only ever look at the neighbors of the nodes they process, so they
+  /// can run concurrently on distinct views. The state shared by the views
+  /// (node IDs, equivalence classes, link tags and the memory of the nodes) is
+  /// kept in this LayoutTypeSystem, and only accessed under a lock.
+  /// This LayoutTypeSystem is empty until all the views are destroyed, at which
+  /// point it gets back all their nodes.
+  std::vector<std::unique_ptr<LayoutTypeSystem>>
+  splitIntoViews(unsigned MaxViews);
+
+  bool isView() const { return Parent != nullptr; }
 
 public:
   LayoutTypeSystemNode *createArtificialLayoutType();
@@ -310,11 +617,18 @@ protected:
       return std::make_pair(nullptr, false);
     revng_assert(Layouts.contains(Src));
     revng_assert(Layouts.contains(Tgt));
-    auto It = LinkTags.insert(std::forward<TagT>(Tag)).first;
-    revng_assert(It != LinkTags.end());
-    const TypeLinkTag *T = &*It;
+    const TypeLinkTag *T = nullptr;
+    {
+      LayoutTypeSystem &Owner = getOwner();
+      std::lock_guard Lock(Owner.SharedStateMutex);
+      auto It = Owner.LinkTags.insert(std::forward<TagT>(Tag)).first;
+      revng_assert(It != Owner.LinkTags.end());
+      T = &*It;
+    }
     bool New = Src->Successors.insert(std::make_pair(Tgt, T)).second;
     New |= Tgt->Predecessors.insert(std::make_pair(Src, T)).second;
+    if (New)
+      recordNewEdge(Src);
     return std::make_pair(T, New);
   }
 
@@ -335,11 +649,11 @@ public:
                   OffsetExpressionT &&OE) {
     using OET = OffsetExpressionT;
 
-    // HACK: If the offset is greater than 64K, avoid adding the link. This
-    // avoids creating gigantic structs with a big leading padding in cases in
-    // which the DLA was not able to recognize a constant as the base address.
+    // HACK: If the offset is too large, avoid adding the link. This avoids
+    // creating gigantic structs with a big leading padding in cases in which
+    // the DLA was not able to recognize a constant as the base address.
     // In the future, this should be handled through segments.
-    if (OE.Offset > 0xFFFF)
+    if (not isInstanceOffsetAllowed(OE.Offset))
       return std::make_pair(nullptr, false);
 
     return addLink(Src,
@@ -347,6 +661,15 @@ public:
                    dla::TypeLinkTag::instanceTag(std::forward<OET>(OE)));
   }
 
+private:
+  /// \return false if instance links at \a Offset must be dropped, see
+  ///         -dla-max-instance-offset
+  static bool isInstanceOffsetAllowed(uint64_t Offset);
+
+public:
+  /// \return the value of -dla-max-instance-offset
+  static uint64_t getMaxInstanceOffset();
+
   std::pair<const TypeLinkTag *, bool>
   addPointerLink(LayoutTypeSystemNode *Src, LayoutTypeSystemNode *Tgt) {
     return addLink(Src, Tgt, dla::TypeLinkTag::pointerTag());
@@ -360,12 +683,47 @@ public:
     dumpDotOnFile(FName.c_str(), ShowCollapsed);
   }
 
+  /// Writes a compact binary snapshot of the nodes, the edges and the
+  /// equivalence classes, that can be loaded back with readSnapshot.
+  ///
+  /// Snapshots allow to capture a graph once and replay Steps on it offline.
+  /// The equivalence classes must not be compressed.
+  void writeSnapshot(llvm::raw_ostream &OS) const;
+
+  void dumpSnapshotOnFile(const std::string &FName) const debug_function;
+
+  /// Loads a snapshot written by writeSnapshot into this LayoutTypeSystem,
+  /// which must be empty.
+  ///\return false if \a Buffer is not a valid snapshot, in which case this
+  ///        LayoutTypeSystem is left in an unspecified state.
+  bool readSnapshot(llvm::StringRef Buffer);
+
   auto getNumLayouts() const { return Layouts.size(); }
 
+  /// Counts the edges, going through all the nodes
+  size_t countEdges() const;
+
+  /// The number of calls to mergeNodes done on this LayoutTypeSystem
+  uint64_t getNumMergeNodesCalls() const { return NumMergeNodesCalls; }
+
+  /// The number of calls to removeNode done on this LayoutTypeSystem
+  uint64_t getNumRemoveNodeCalls() const { return NumRemoveNodeCalls; }
+
+  /// The nodes, in increasing order of ID
   auto getLayoutsRange() const {
     return llvm::make_range(Layouts.begin(), Layouts.end());
   }
 
+  /// Removes the holes left in the node table by merged and removed nodes, if
+  /// they are many. Must not be called while iterating over the nodes.
+  void compactNodes();
+
+  /// Makes the memory of the nodes destroyed in this LayoutTypeSystem (or
+  /// view) available to new nodes. Must only be called when nobody holds
+  /// pointers to destroyed nodes, e.g. between two steps, since new nodes
+  /// would have the same address.
+  void recycleDestroyedNodes();
+
 public:
   void mergeNodes(llvm::ArrayRef<LayoutTypeSystemNode *> ToMerge);
 
@@ -386,16 +744,78 @@ public:
 
   void dropOutgoingEdges(LayoutTypeSystemNode *N);
 
+public:
+  /// Returns the nodes from which a new edge can be reached since the previous
+  /// call with the same \a Consumer.
+  ///
+  /// Edges are added to the journal when they are created via addLink, when
+  /// they are moved, and when nodes are merged. For each new edge, only its
+  /// source is recorded, since every cycle through the edge goes through it.
+  /// On the first call with a given \a Consumer, when there's no journal yet,
+  /// returns std::nullopt, meaning that all the nodes must be considered.
+  std::optional<std::vector<LayoutTypeSystemNode *>>
+  takeNodesWithNewEdges(const void *Consumer);
+
+  /// Make the following verifications check the sources of the edges added
+  /// from now on, besides the sampled nodes, instead of the ones added since
+  /// the previous call. The StepManager calls it before each step.
+  void startVerificationRound();
+
+  void recordNewEdge(LayoutTypeSystemNode *Src) {
+    if (not JournalCursors.empty())
+      NewEdgesJournal.push_back(Src->TableIndex);
+  }
+
+  void clearJournal() {
+    NewEdgesJournal.clear();
+    JournalCursors.clear();
+  }
+
 private:
+  // The LayoutTypeSystem this is a view of, if any
+  LayoutTypeSystem *Parent = nullptr;
+
+  // The state below is shared by all the views of a LayoutTypeSystem, and only
+  // the one of the root is used. This mutex protects it while views exist.
+  std::mutex SharedStateMutex;
+
+  LayoutTypeSystem &getOwner() { return isView() ? *Parent : *this; }
+  const LayoutTypeSystem &getOwner() const {
+    return isView() ? *Parent : *this;
+  }
+
   uint64_t NID = 0ULL;
 
+  // Holds the tree nodes of the neighbor sets of all the LayoutTypeSystemNode.
+  // It must be destroyed after them.
+  LinkNodePool LinkPool;
+
   // Holds all the LayoutTypeSystemNode
   llvm::BumpPtrAllocator NodeAllocator = {};
-  std::set<LayoutTypeSystemNode *> Layouts = {};
+  // Memory of destroyed nodes in NodeAllocator, reused by new nodes
+  std::vector<void *> FreeNodes = {};
+  // The nodes of this LayoutTypeSystem, or of this view
+  LayoutTypeSystemNodeTable Layouts = {};
+  // Memory of the nodes destroyed here, not yet moved to FreeNodes
+  std::vector<void *> DestroyedNodes = {};
+  // The number of views of this LayoutTypeSystem that are alive
+  unsigned NumViews = 0;
+
+  uint64_t NumMergeNodesCalls = 0;
+  uint64_t NumRemoveNodeCalls = 0;
+
+  // The slots in Layouts of the sources of the new edges, only recorded while
+  // there are consumers. Slots might be empty, if the nodes have been merged or
+  // removed since then.
+  std::vector<size_t> NewEdgesJournal = {};
+  // For each consumer, the first entry of the journal it hasn't seen. The
+  // verify methods register theirs while reading it, see getNodesToVerify.
+  mutable llvm::SmallDenseMap<const void *, size_t, 4> JournalCursors = {};
 
   // Holds the link tags, so that they can be deduplicated and referred to using
-  // TypeLinkTag * in the links inside LayoutTypeSystemNode
-  std::set<TypeLinkTag> LinkTags = {};
+  // TypeLinkTag * in the links inside LayoutTypeSystemNode. Two links have the
+  // same tag if and only if they point to the same TypeLinkTag.
+  std::unordered_set<TypeLinkTag, TypeLinkTag::Hasher> LinkTags = {};
 
 public:
   // Checks that is valid, and returns true if it is, false otherwise
@@ -415,6 +835,14 @@ public:
   // Checks that no union node has only one child
   bool verifyUnions() const;
 
+private:
+  // The nodes checked by the verify methods: all of them, or a sample
+  // according to -dla-verify-sample-percent
+  std::vector<LayoutTypeSystemNode *> getNodesToVerify() const;
+
+  // Number of verifications so far, so that each one samples different nodes
+  mutable uint64_t NumVerifications = 0;
+
 private:
   // Equivalence classes between nodes. Each node is identified by an ID.
   VectEqClasses EqClasses;
@@ -422,10 +850,10 @@ private:
   std::unique_ptr<TSDebugPrinter> DebugPrinter;
 
 public:
-  unsigned getNID() const { return NID; }
+  unsigned getNID() const { return getOwner().NID; }
 
-  VectEqClasses &getEqClasses() { return EqClasses; }
-  const VectEqClasses &getEqClasses() const { return EqClasses; }
+  VectEqClasses &getEqClasses() { return getOwner().EqClasses; }
+  const VectEqClasses &getEqClasses() const { return getOwner().EqClasses; }
 
   void setDebugPrinter(std::unique_ptr<TSDebugPrinter> &&Printer) {
     DebugPrinter = std::move(Printer);
@@ -571,7 +999,7 @@ struct llvm::GraphTraits<const dla::LayoutTypeSystem *>
   : public llvm::GraphTraits<const dla::LayoutTypeSystemNode *> {
 
 public:
-  using nodes_iterator = std::set<dla::LayoutTypeSystemNode *>::iterator;
+  using nodes_iterator = dla::LayoutTypeSystemNodeTable::const_iterator;
 
   static NodeRef getEntryNode(const dla::LayoutTypeSystem *) { return nullptr; }
 
@@ -593,7 +1021,7 @@ struct llvm::GraphTraits<dla::LayoutTypeSystem *>
   : public llvm::GraphTraits<dla::LayoutTypeSystemNode *> {
 
 public:
-  using nodes_iterator = std::set<dla::LayoutTypeSystemNode *>::iterator;
+  using nodes_iterator = dla::LayoutTypeSystemNodeTable::const_iterator;
 
   static NodeRef getEntryNode(const dla::LayoutTypeSystem *) { return nullptr; }
 
@@ -4,7 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+
 #include "revng/Model/Binary.h"
 
 std::string dumpModelTypeDefinition(const model::Binary &Model,
                                     model::Type::Key Key);
+
+/// Print the definitions of all the types in \a Keys, using \a NumThreads
+/// threads. The I-th element of the result is the definition of Keys[I].
+std::vector<std::string>
+dumpModelTypeDefinitions(const model::Binary &Model,
+                         llvm::ArrayRef<model::Type::Key> Keys,
+                         unsigned NumThreads);
@@ -65,4 +65,11 @@ inline pipeline::SingleElementKind DecompiledToC("decompiled-to-c",
                                                  fat(ranks::Function),
                                                  { &ModelHeader });
 
+inline pipeline::SingleElementKind
+  DirectlyDecompiledToC("directly-decompiled-to-c",
+                        Binary,
+                        ranks::Binary,
+                        fat(ranks::Function),
+                        { &ModelHeader });
+
 } // namespace revng::kinds
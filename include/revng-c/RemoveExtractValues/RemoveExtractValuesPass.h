@@ -4,15 +4,32 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <memory>
+
 #include "llvm/Pass.h"
 
+#include "revng/Support/OpaqueFunctionsPool.h"
+
+#include "revng-c/Support/FunctionTags.h"
+
 class RemoveExtractValues : public llvm::FunctionPass {
 public:
   static char ID;
 
+private:
+  // Initializing the pool scans all the functions of the module, hence it's
+  // done once, the first time a function with extractvalues is found, and
+  // shared among all the functions.
+  std::unique_ptr<OpaqueFunctionsPool<TypePair>> OpaqueEVPool;
+
 public:
   RemoveExtractValues() : llvm::FunctionPass(ID) {}
 
+  bool doFinalization(llvm::Module &) override {
+    OpaqueEVPool.reset();
+    return false;
+  }
+
   bool runOnFunction(llvm::Function &) override;
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
 };
@@ -6,6 +6,7 @@
 
 #include <cstdlib>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -44,11 +45,11 @@ public:
     DK_Exit,
   };
 
-  using ASTNodeMap = std::map<ASTNode *, ASTNode *>;
+  using ASTNodeMap = llvm::DenseMap<ASTNode *, ASTNode *>;
   // Steal the `BasicBlockNodeBB` definition from the external namespace
   using BasicBlockNodeBB = ::BasicBlockNodeBB;
   using BBNodeMap = std::map<BasicBlockNodeBB *, BasicBlockNodeBB *>;
-  using ExprNodeMap = std::map<ExprNode *, ExprNode *>;
+  using ExprNodeMap = llvm::DenseMap<ExprNode *, ExprNode *>;
 
 private:
   const NodeKind Kind;
@@ -68,6 +69,14 @@ protected:
   ASTNode(NodeKind K, const std::string &Name, llvm::BasicBlock *BB) :
     Kind(K), BB(BB), Name(Name) {}
 
+  /// \return the node that takes the place of \a Old in \a SubstitutionMap
+  static ASTNode *getSubstitute(const ASTNodeMap &SubstitutionMap,
+                                ASTNode *Old) {
+    auto It = SubstitutionMap.find(Old);
+    revng_assert(It != SubstitutionMap.end());
+    return It->second;
+  }
+
 public:
   ASTNode(NodeKind K, BasicBlockNodeBB *CFGNode, ASTNode *Successor = nullptr) :
     Kind(K),
@@ -357,7 +366,8 @@ class SequenceNode : public ASTNode {
   friend class ASTNode;
 
 public:
-  using links_container = std::vector<ASTNode *>;
+  // Most sequences are short, so we keep them inline
+  using links_container = llvm::SmallVector<ASTNode *, 4>;
   using links_iterator = typename links_container::iterator;
   using links_range = llvm::iterator_range<links_iterator>;
   using const_links_iterator = typename links_container::const_iterator;
@@ -745,7 +755,7 @@ inline ASTNode *ASTNode::Clone() const {
 
 inline void ASTNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
   if (Successor)
-    Successor = SubstitutionMap.at(Successor);
+    Successor = getSubstitute(SubstitutionMap, Successor);
 
   switch (getKind()) {
   case ASTNode::NK_If: {
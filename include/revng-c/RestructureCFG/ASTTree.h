@@ -8,6 +8,7 @@
 #include <type_traits>
 
 #include "revng-c/RestructureCFG/ASTNode.h"
+#include "revng-c/RestructureCFG/GraphSnapshot.h"
 
 // Forward declarations.
 class ASTNode;
@@ -62,11 +63,14 @@ public:
 
 private:
   links_container ASTNodeList = {};
-  std::map<BasicBlockNodeBB *, ASTNode *> BBASTMap = {};
-  std::map<ASTNode *, BasicBlockNodeBB *> ASTBBMap = {};
+  llvm::DenseMap<BasicBlockNodeBB *, ASTNode *> BBASTMap = {};
+  llvm::DenseMap<ASTNode *, BasicBlockNodeBB *> ASTBBMap = {};
   ASTNode *RootNode = nullptr;
   unsigned IDCounter = 0;
   links_container_expr CondExprList = {};
+  // `AtomicNode`s are never modified, hence there's a single one for each
+  // `BasicBlock`, shared among all the conditions using it
+  llvm::DenseMap<llvm::BasicBlock *, AtomicNode *> AtomicExprs = {};
 
 public:
   ASTTree() = default;
@@ -113,6 +117,11 @@ public:
 
   ASTNode *copyASTNodesFrom(ASTTree &OldAST);
 
+  /// Move all the nodes of \a OldAST into this AST, without copying them.
+  ///
+  /// \return the root of \a OldAST, which is left empty.
+  ASTNode *spliceASTNodesFrom(ASTTree &&OldAST);
+
   /// Dump a GraphViz file on a file using an absolute path
   debug_function void dumpASTOnFile(const std::string &FileName) const;
 
@@ -121,10 +130,17 @@ public:
     return dumpASTOnFile(std::string(FName));
   }
 
-  /// Dump a GraphViz file on a file representing this function
+  /// Take a compact binary snapshot of the GHAST
+  GraphSnapshot snapshot() const;
+
+  /// Dump a GraphViz file, or a GraphSnapshot if -restructure-binary-snapshots
+  /// is passed, on a file representing this function
   debug_function void dumpASTOnFile(const std::string &FunctionName,
                                     const std::string &FolderName,
                                     const std::string &FileName) const;
 
   ExprNode *addCondExpr(expr_unique_ptr &&Expr);
+
+  /// \return the `AtomicNode` of \a BB, creating it if it doesn't exist yet
+  AtomicNode *getAtomicExpr(llvm::BasicBlock *BB);
 };
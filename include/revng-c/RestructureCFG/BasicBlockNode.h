@@ -8,6 +8,7 @@
 #include <map>
 #include <set>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallString.h"
@@ -24,10 +25,10 @@ class RegionCFG;
 /// Graph Node, representing a basic block
 template<class NodeT>
 class BasicBlockNode {
-protected:
-  using BasicBlockNodeMap = std::map<BasicBlockNode *, BasicBlockNode *>;
-
 public:
+  /// Maps nodes to the ones taking their place, see updatePointers
+  using SubstitutionMap = llvm::DenseMap<BasicBlockNode *, BasicBlockNode *>;
+
   enum class Type {
     Code,
     Empty,
@@ -269,7 +270,7 @@ public:
 
   node_edgeinfo_pair &getPredecessorEdge(BasicBlockNode *Predecessor);
 
-  void updatePointers(const BasicBlockNodeMap &SubstitutionMap);
+  void updatePointers(const SubstitutionMap &SubMap);
 
   size_t successor_size() const { return Successors.size(); }
 
@@ -184,31 +184,33 @@ BasicBlockNode<NodeT>::getPredecessorEdge(BasicBlockNodeT *Pred) {
 }
 
 template<class NodeT>
-using BBNodeMap = typename BasicBlockNode<NodeT>::BBNodeMap;
+using SubstitutionMap = typename BasicBlockNode<NodeT>::SubstitutionMap;
 
 template<class NodeT>
 using links_container = typename BasicBlockNode<NodeT>::links_container;
 
 template<class NodeT>
-inline void handleNeighbors(const BBNodeMap<NodeT> &SubMap,
+inline void handleNeighbors(const SubstitutionMap<NodeT> &SubMap,
                             links_container<NodeT> &Neighbors) {
-
-  Neighbors.erase(std::remove_if(Neighbors.begin(),
-                                 Neighbors.end(),
-                                 [&SubMap](const auto &LabeledNode) {
-                                   return !SubMap.contains(LabeledNode.first);
-                                 }),
-                  Neighbors.end());
-
-  for (auto &NeighborLabelPair : Neighbors) {
-    auto &Neighbor = NeighborLabelPair.first;
-    revng_assert(SubMap.contains(Neighbor));
-    Neighbor = SubMap.at(Neighbor);
+  // Drop the neighbors without a substitute and replace the others, looking
+  // each of them up only once
+  size_t Kept = 0;
+  for (size_t I = 0; I < Neighbors.size(); ++I) {
+    auto It = SubMap.find(Neighbors[I].first);
+    if (It == SubMap.end())
+      continue;
+
+    if (Kept != I)
+      Neighbors[Kept] = std::move(Neighbors[I]);
+    Neighbors[Kept].first = It->second;
+    ++Kept;
   }
+  Neighbors.truncate(Kept);
 }
 
 template<class NodeT>
-inline void BasicBlockNode<NodeT>::updatePointers(const BBNodeMap &SubMap) {
+inline void
+BasicBlockNode<NodeT>::updatePointers(const SubstitutionMap &SubMap) {
   handleNeighbors<NodeT>(SubMap, Predecessors);
   handleNeighbors<NodeT>(SubMap, Successors);
 }
@@ -11,6 +11,14 @@ class Function;
 } // end namespace llvm
 
 class ASTTree;
+struct RestructureBudget;
 
-extern void
-beautifyAST(const model::Binary &Model, llvm::Function &F, ASTTree &CombedAST);
+/// Beautify \a CombedAST.
+///
+/// \return false if \a Budget has been exhausted before any change was done to
+///         the IR of \a F, in which case \a CombedAST must be discarded.
+///         Once the IR is changed, beautification always runs to completion.
+extern bool beautifyAST(const model::Binary &Model,
+                        llvm::Function &F,
+                        ASTTree &CombedAST,
+                        const RestructureBudget *Budget = nullptr);
@@ -33,6 +33,7 @@
 #include "revng-c/RestructureCFG/BasicBlockNodeBB.h"
 #include "revng-c/RestructureCFG/MetaRegionBB.h"
 #include "revng-c/RestructureCFG/RegionCFGTree.h"
+#include "revng-c/RestructureCFG/RestructureCFG.h"
 #include "revng-c/RestructureCFG/Utils.h"
 
 #include "BasicBlockNode.h"
@@ -444,10 +445,13 @@ createSwitchTile(RegionCFG<NodeT> &Graph,
   return Tile;
 }
 
-inline void
+/// \return false if \a Budget has been exhausted, in which case \a AST and
+///         \a CollapsedMap must be discarded
+inline bool
 generateAst(RegionCFG<llvm::BasicBlock *> &Region,
             ASTTree &AST,
-            std::map<RegionCFG<llvm::BasicBlock *> *, ASTTree> &CollapsedMap) {
+            std::map<RegionCFG<llvm::BasicBlock *> *, ASTTree> &CollapsedMap,
+            const RestructureBudget &Budget) {
   // Define some using used in all the function body.
   using NodeT = llvm::BasicBlock *;
   using BasicBlockNodeT = typename RegionCFG<NodeT>::BasicBlockNodeT;
@@ -456,13 +460,12 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
   std::string RegionName = Region.getRegionName();
   std::string FunctionName = Region.getFunctionName();
 
-  Region.markUnreachableAsInlined();
-
-  // Invoke the weave function.
-  Region.weave();
-
-  // Invoke the inflate function.
-  Region.inflate();
+  // Invoke the weave and inflate functions, unless restructureCFG already did
+  // it in parallel.
+  Region.weaveAndInflate(&Budget);
+  InflatedNodesCounter += Region.size();
+  if (Budget.isExhausted())
+    return false;
 
   // After we are done with the combing, we need to pre-compute the weight of
   // the current RegionCFG, so that during the untangle phase of other
@@ -485,6 +488,14 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
   for (auto *N : post_order(&Region))
     PONodes.push_back(N);
 
+  // A collapsed region is the body of the collapsed nodes of this region only,
+  // more than one if the collapsed node has been duplicated. Its AST is copied
+  // for all of them but the last one, which takes the nodes of the AST over.
+  std::map<RegionCFG<NodeT> *, unsigned> PendingUses;
+  for (BasicBlockNode<NodeT> *Node : PONodes)
+    if (Node->isCollapsed())
+      ++PendingUses[Node->getCollapsedCFG()];
+
   CFGDumper Dumper(Region, FunctionName, RegionName, "tile");
 
   for (BasicBlockNode<NodeT> *Node : PONodes) {
@@ -516,10 +527,15 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
       // Call recursively the generation of the AST for the collapsed node.
       const auto &[It, New] = CollapsedMap.insert({ BodyGraph, ASTTree() });
       ASTTree &CollapsedAST = It->second;
-      if (New)
-        generateAst(*BodyGraph, CollapsedAST, CollapsedMap);
+      if (New
+          and not generateAst(*BodyGraph, CollapsedAST, CollapsedMap, Budget))
+        return false;
 
-      ASTNode *Body = AST.copyASTNodesFrom(CollapsedAST);
+      ASTNode *Body = nullptr;
+      if (--PendingUses.at(BodyGraph) == 0)
+        Body = AST.spliceASTNodesFrom(std::move(CollapsedAST));
+      else
+        Body = AST.copyASTNodesFrom(CollapsedAST);
 
       switch (Successors.size()) {
 
@@ -782,11 +798,7 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
                      false);
 
           // Build the `IfNode`.
-          using UniqueExpr = ASTTree::expr_unique_ptr;
-          using ExprDestruct = ASTTree::expr_destructor;
-          auto *OriginalNode = Node->getOriginalNode();
-          UniqueExpr CondExpr(new AtomicNode(OriginalNode), ExprDestruct());
-          ExprNode *Condition = AST.addCondExpr(std::move(CondExpr));
+          ExprNode *Condition = AST.getAtomicExpr(Node->getOriginalNode());
 
           // Insert the postdominator if the current tile actually has it.
           ASTObject.reset(new IfNode(Node, Condition, Then, Else, nullptr));
@@ -854,11 +866,7 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
           }
 
           // Build the `IfNode`.
-          using UniqueExpr = ASTTree::expr_unique_ptr;
-          using ExprDestruct = ASTTree::expr_destructor;
-          auto *OriginalNode = Node->getOriginalNode();
-          UniqueExpr CondExpr(new AtomicNode(OriginalNode), ExprDestruct());
-          ExprNode *Condition = AST.addCondExpr(std::move(CondExpr));
+          ExprNode *Condition = AST.getAtomicExpr(Node->getOriginalNode());
 
           // Insert the postdominator if the current tile actually has it.
           ASTNode *PostDom = nullptr;
@@ -906,11 +914,7 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
           }
 
           // Build the `IfNode`.
-          using UniqueExpr = ASTTree::expr_unique_ptr;
-          using ExprDestruct = ASTTree::expr_destructor;
-          auto *OriginalNode = Node->getOriginalNode();
-          UniqueExpr CondExpr(new AtomicNode(OriginalNode), ExprDestruct());
-          ExprNode *Condition = AST.addCondExpr(std::move(CondExpr));
+          ExprNode *Condition = AST.getAtomicExpr(Node->getOriginalNode());
           ASTObject.reset(new IfNode(Node, Condition, Then, Else, PostDom));
 
           if (PostDomBB) {
@@ -1000,6 +1004,7 @@ generateAst(RegionCFG<llvm::BasicBlock *> &Region,
   revng_assert(Root);
   ASTNode *RootNode = AST.findASTNode(Root);
   AST.setRoot(RootNode);
+  return true;
 }
 
 inline void normalize(ASTTree &AST, const llvm::Function &F) {
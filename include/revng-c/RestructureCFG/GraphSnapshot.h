@@ -0,0 +1,77 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// Compact binary snapshot of a RegionCFG or of a GHAST, written in place of
+/// the GraphViz files of the restructuring debug dumps when
+/// -restructure-binary-snapshots is passed.
+///
+/// Snapshots are much cheaper to write than dot files for large functions, and
+/// can be loaded back with read, e.g., to be inspected offline or converted to
+/// dot only when needed.
+struct GraphSnapshot {
+public:
+  enum class GraphKind : uint8_t {
+    RegionCFG,
+    GHAST
+  };
+
+  /// The role of an edge of a GHAST snapshot
+  enum class ASTEdgeKind : uint8_t {
+    Then,
+    Else,
+    Body,
+    Element,
+    Case,
+    Default,
+    Successor
+  };
+
+  struct Edge {
+    uint64_t Target = 0;
+    /// Whether the edge is inlined for a RegionCFG, an ASTEdgeKind for a GHAST
+    uint8_t Label = 0;
+  };
+
+  struct Node {
+    uint64_t ID = 0;
+    /// The BasicBlockNode::Type for a RegionCFG, the ASTNode::NodeKind for a
+    /// GHAST
+    uint8_t Kind = 0;
+    std::string Name;
+    llvm::SmallVector<Edge, 2> Edges;
+  };
+
+public:
+  GraphKind Kind = GraphKind::RegionCFG;
+  /// The ID of the entry node, or of the root of the GHAST
+  uint64_t Entry = 0;
+  std::vector<Node> Nodes;
+
+public:
+  void write(llvm::raw_ostream &OS) const;
+
+  void writeToFile(const std::string &FileName) const;
+
+  static llvm::Expected<GraphSnapshot> read(llvm::StringRef Buffer);
+
+  static llvm::Expected<GraphSnapshot> readFromFile(llvm::StringRef FileName);
+
+  /// Dump a GraphViz representing the snapshot on \a OS
+  void dumpDot(llvm::raw_ostream &OS) const;
+};
+
+/// \return true if the restructuring debug dumps have to be written as
+///         GraphSnapshots rather than as GraphViz files.
+bool dumpBinarySnapshots();
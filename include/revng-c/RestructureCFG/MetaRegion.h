@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/iterator_range.h"
 
@@ -18,6 +19,11 @@ template<class NodeT>
 class BasicBlockNode;
 
 /// The MetaRegion class, a wrapper for a set of nodes.
+///
+/// Along with the ordered set of nodes, it keeps a bitvector indexed by the ID
+/// of the nodes, which are unique within their RegionCFG. When two MetaRegions
+/// have all their nodes in the same RegionCFG, the set operations between them
+/// work on the bitvectors, a word at a time.
 template<class NodeT>
 class MetaRegion {
 
@@ -25,7 +31,6 @@ public:
   using BasicBlockNodeT = typename BasicBlockNode<NodeT>::BasicBlockNodeT;
   using BasicBlockNodeTSet = std::set<BasicBlockNodeT *>;
   using BasicBlockNodeTVect = std::vector<BasicBlockNodeT *>;
-  using BasicBlockNodeTUPVect = std::vector<std::unique_ptr<BasicBlockNodeT>>;
   using EdgeDescriptor = typename BasicBlockNode<NodeT>::EdgeDescriptor;
 
   using links_container = std::set<BasicBlockNodeT *>;
@@ -47,13 +52,23 @@ private:
   MetaRegion<NodeT> *ParentRegion;
   bool IsSCS;
 
+  /// The RegionCFG all the nodes belong to, nullptr if they belong to more
+  /// than one
+  RegionCFG<NodeT> *Graph = nullptr;
+
+  /// The IDs of the nodes, meaningful only if Graph is not nullptr
+  llvm::BitVector Members;
+
 public:
-  MetaRegion(int Index, BasicBlockNodeTSet &Nodes, bool IsSCS = false) :
-    Index(Index), Nodes(Nodes), ParentRegion(nullptr), IsSCS(IsSCS) {}
+  MetaRegion(int Index, const BasicBlockNodeTSet &Nodes, bool IsSCS = false) :
+    Index(Index), ParentRegion(nullptr), IsSCS(IsSCS) {
+    for (BasicBlockNodeT *Node : Nodes)
+      addNode(Node);
+  }
 
   int getIndex() const { return Index; }
 
-  void replaceNodes(BasicBlockNodeTUPVect &NewNodes);
+  void replaceNodes(const BasicBlockNodeTVect &NewNodes);
 
   void updateNodes(const BasicBlockNodeTSet &Removal,
                    BasicBlockNodeT *Collapsed,
@@ -65,8 +80,6 @@ public:
 
   MetaRegion *getParent() const { return ParentRegion; }
 
-  std::set<BasicBlockNode<NodeT> *> &getNodes() { return Nodes; }
-
   const std::set<BasicBlockNode<NodeT> *> &getNodes() const { return Nodes; }
 
   size_t nodes_size() const { return Nodes.size(); }
@@ -91,10 +104,7 @@ public:
 
   bool nodesEquality(MetaRegion<NodeT> &Other) const;
 
-  void mergeWith(MetaRegion<NodeT> &Other) {
-    BasicBlockNodeTSet &OtherNodes = Other.getNodes();
-    Nodes.insert(OtherNodes.begin(), OtherNodes.end());
-  }
+  void mergeWith(MetaRegion<NodeT> &Other);
 
   bool isSCS() const { return IsSCS; }
 
@@ -102,7 +112,19 @@ public:
     return Nodes.contains(Node);
   }
 
-  void insertNode(BasicBlockNodeT *NewNode) { Nodes.insert(NewNode); }
+  void insertNode(BasicBlockNodeT *NewNode) { addNode(NewNode); }
+
+  void removeNode(BasicBlockNodeT *Node) { eraseNode(Node); }
 
-  void removeNode(BasicBlockNodeT *Node) { Nodes.erase(Node); }
+private:
+  void addNode(BasicBlockNodeT *Node);
+
+  void eraseNode(BasicBlockNodeT *Node);
+
+  /// Recompute Graph and Members from scratch
+  void rebuildMembers();
+
+  bool inSameGraphAs(const MetaRegion<NodeT> &Other) const {
+    return Graph != nullptr and Graph == Other.Graph;
+  }
 };
@@ -15,10 +15,58 @@
 #include "revng-c/RestructureCFG/MetaRegion.h"
 
 template<class NodeT>
-void MetaRegion<NodeT>::replaceNodes(BasicBlockNodeTUPVect &N) {
-  Nodes.erase(Nodes.begin(), Nodes.end());
-  for (std::unique_ptr<BasicBlockNodeT> &Node : N)
-    Nodes.insert(Node.get());
+void MetaRegion<NodeT>::addNode(BasicBlockNodeT *Node) {
+  if (not Nodes.insert(Node).second)
+    return;
+
+  if (Nodes.size() == 1) {
+    Graph = Node->getParent();
+    Members.clear();
+  } else if (Node->getParent() != Graph) {
+    Graph = nullptr;
+  }
+
+  if (Graph != nullptr) {
+    unsigned ID = Node->getID();
+    if (ID >= Members.size())
+      Members.resize(ID + 1);
+    Members.set(ID);
+  }
+}
+
+template<class NodeT>
+void MetaRegion<NodeT>::eraseNode(BasicBlockNodeT *Node) {
+  if (Nodes.erase(Node) == 0)
+    return;
+
+  if (Graph != nullptr)
+    Members.reset(Node->getID());
+}
+
+template<class NodeT>
+void MetaRegion<NodeT>::rebuildMembers() {
+  links_container OldNodes;
+  std::swap(OldNodes, Nodes);
+  for (BasicBlockNodeT *Node : OldNodes)
+    addNode(Node);
+}
+
+template<class NodeT>
+void MetaRegion<NodeT>::replaceNodes(const BasicBlockNodeTVect &N) {
+  Nodes.clear();
+  for (BasicBlockNodeT *Node : N)
+    addNode(Node);
+}
+
+template<class NodeT>
+void MetaRegion<NodeT>::mergeWith(MetaRegion<NodeT> &Other) {
+  bool SameGraph = inSameGraphAs(Other);
+  const BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  Nodes.insert(OtherNodes.begin(), OtherNodes.end());
+  if (SameGraph)
+    Members |= Other.Members;
+  else
+    rebuildMembers();
 }
 
 template<class NodeT>
@@ -30,25 +78,26 @@ void MetaRegion<NodeT>::updateNodes(const BasicBlockNodeTSet &ToRemove,
                                       &DeduplicatedDummies) {
   // Remove the old SCS nodes
   for (BasicBlockNodeT *Node : ToRemove)
-    Nodes.erase(Node);
+    eraseNode(Node);
 
   // Add the collapsed node.
   revng_assert(nullptr != Collapsed);
-  Nodes.insert(Collapsed);
+  addNode(Collapsed);
 
   // Add the exit dispatcher if present
   if (ExitDispatcher)
-    Nodes.insert(ExitDispatcher);
+    addNode(ExitDispatcher);
 
   // Add the set nodes that come from outside if present
   revng_assert(not llvm::any_of(DefaultEntrySet, [this](BasicBlockNodeT *B) {
     return this->containsNode(B);
   }));
-  Nodes.insert(DefaultEntrySet.begin(), DefaultEntrySet.end());
+  for (BasicBlockNodeT *Node : DefaultEntrySet)
+    addNode(Node);
 
   // Remove deduplicated dummy nodes created during the exit dispatcher building
   for (BasicBlockNodeT *Node : DeduplicatedDummies)
-    Nodes.erase(Node);
+    eraseNode(Node);
 }
 
 template<class NodeT>
@@ -101,7 +150,10 @@ std::set<EdgeDescriptor<NodeT>> MetaRegion<NodeT>::getInEdges() {
 
 template<class NodeT>
 bool MetaRegion<NodeT>::intersectsWith(MetaRegion<NodeT> &Other) const {
-  BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  if (inSameGraphAs(Other))
+    return Members.anyCommon(Other.Members);
+
+  const BasicBlockNodeTSet &OtherNodes = Other.getNodes();
 
   auto NodesIt = Nodes.begin();
   auto NodesEnd = Nodes.end();
@@ -125,7 +177,13 @@ bool MetaRegion<NodeT>::intersectsWith(MetaRegion<NodeT> &Other) const {
 
 template<class NodeT>
 bool MetaRegion<NodeT>::isSubSet(MetaRegion<NodeT> &Other) const {
-  BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  const BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  if (Nodes.size() > OtherNodes.size())
+    return false;
+
+  if (inSameGraphAs(Other))
+    return not Members.test(Other.Members);
+
   return std::includes(OtherNodes.begin(),
                        OtherNodes.end(),
                        Nodes.begin(),
@@ -134,7 +192,13 @@ bool MetaRegion<NodeT>::isSubSet(MetaRegion<NodeT> &Other) const {
 
 template<class NodeT>
 bool MetaRegion<NodeT>::isSuperSet(MetaRegion<NodeT> &Other) const {
-  BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  const BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  if (Nodes.size() < OtherNodes.size())
+    return false;
+
+  if (inSameGraphAs(Other))
+    return not Other.Members.test(Members);
+
   return std::includes(Nodes.begin(),
                        Nodes.end(),
                        OtherNodes.begin(),
@@ -143,6 +207,13 @@ bool MetaRegion<NodeT>::isSuperSet(MetaRegion<NodeT> &Other) const {
 
 template<class NodeT>
 bool MetaRegion<NodeT>::nodesEquality(MetaRegion<NodeT> &Other) const {
-  BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  const BasicBlockNodeTSet &OtherNodes = Other.getNodes();
+  if (Nodes.size() != OtherNodes.size())
+    return false;
+
+  // Same size and one included in the other
+  if (inSameGraphAs(Other))
+    return not Members.test(Other.Members);
+
   return Nodes == OtherNodes;
 }
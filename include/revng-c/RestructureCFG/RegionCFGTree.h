@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <cstdlib>
 #include <set>
 
@@ -11,6 +12,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
 
@@ -19,11 +21,15 @@
 
 #include "revng-c/RestructureCFG/ASTTree.h"
 #include "revng-c/RestructureCFG/BasicBlockNodeBB.h"
+#include "revng-c/RestructureCFG/GraphSnapshot.h"
 #include "revng-c/RestructureCFG/Utils.h"
+#include "revng-c/Support/TraceSpan.h"
 
 template<class NodeT>
 class MetaRegion;
 
+struct RestructureBudget;
+
 template<typename NodeT>
 inline bool InlineFilter(const typename llvm::GraphTraits<NodeT>::EdgeRef &E) {
   return !E.second.Inlined;
@@ -47,18 +53,15 @@ template<class NodeT = llvm::BasicBlock *>
 class RegionCFG {
 
   using BBNodeT = BasicBlockNode<NodeT>;
-  using BBNodeTUniquePtr = typename std::unique_ptr<BBNodeT>;
-  using getPointerT = BBNodeT *(*) (BBNodeTUniquePtr &);
-  using getConstPointerT = const BBNodeT *(*) (const BBNodeTUniquePtr &);
+  using getPointerT = BBNodeT *(*) (BBNodeT *&);
+  using getConstPointerT = const BBNodeT *(*) (BBNodeT *const &);
 
-  static BBNodeT *getPointer(BBNodeTUniquePtr &Original) {
-    return Original.get();
-  }
+  static BBNodeT *getPointer(BBNodeT *&Original) { return Original; }
 
   static_assert(std::is_same_v<decltype(&getPointer), getPointerT>);
 
-  static const BBNodeT *getConstPointer(const BBNodeTUniquePtr &Original) {
-    return Original.get();
+  static const BBNodeT *getConstPointer(BBNodeT *const &Original) {
+    return Original;
   }
 
   static_assert(std::is_same_v<decltype(&getConstPointer), getConstPointerT>);
@@ -68,13 +71,13 @@ public:
   using BasicBlockNodeType = typename BasicBlockNodeT::Type;
   using BasicBlockNodeTSet = std::set<BasicBlockNodeT *>;
   using BasicBlockNodeTVect = std::vector<BasicBlockNodeT *>;
-  using BasicBlockNodeTUPVect = std::vector<std::unique_ptr<BasicBlockNodeT>>;
   using BBNodeMap = typename BBNodeT::BBNodeMap;
+  using SubstitutionMap = typename BBNodeT::SubstitutionMap;
   using RegionCFGT = typename BBNodeT::RegionCFGT;
 
   using EdgeDescriptor = typename BBNodeT::EdgeDescriptor;
 
-  using links_container = std::vector<BBNodeTUniquePtr>;
+  using links_container = std::vector<BBNodeT *>;
   using internal_iterator = typename links_container::iterator;
   using internal_const_iterator = typename links_container::const_iterator;
   using links_iterator = llvm::mapped_iterator<internal_iterator, getPointerT>;
@@ -97,27 +100,21 @@ public:
     WeightNotComputed = std::numeric_limits<size_t>::max();
 
 private:
-  /// Storage for basic block nodes, associated to their original counterpart
-  links_container BlockNodes;
-
-  /// Quarantine for dead nodes.
+  /// Monotonic arena owning all the basic block nodes ever created in this
+  /// RegionCFG, including the removed ones.
   //  When nodes are removed from RegionCFG, they are not really freed, but they
-  //  are held here until the RegionCFG itself goes out of scope.
+  //  stay in the arena until the RegionCFG itself goes out of scope.
   //  This is unfortunately necessary now, since the CFG restructuring algorithm
   //  uses maps and sets (e.g. Backedges.) that are indexed using a
-  //  BasicBlockNodeT *.
-  //  If we don't hold the removed nodes in quarantine, the system allocator can
-  //  reuse the blocks, allocating new nodes at the same address, and causing
-  //  false-positive hits in some of the mentioned maps. This was the most
-  //  straightforward solution for now.
+  //  BasicBlockNodeT *, and some of them (e.g. the nodes of the MetaRegions)
+  //  still refer to removed nodes for a while.
+  //  If we freed the removed nodes, the system allocator could reuse the
+  //  blocks, allocating new nodes at the same address, and causing
+  //  false-positive hits in some of the mentioned maps. The arena never reuses
+  //  addresses, and it saves a heap allocation and a owning pointer per node,
+  //  which matters when inflate() duplicates many nodes.
   //
   //  Other solutions we have considered:
-  //    - use a special monotonic allocator for BasicBlockNodes
-  //      - this should work, but in principle it gives the same results as the
-  //        current solution, with more boilerplate. Also, at the moment
-  //        std::unique_ptr is not allocator aware, so we would need to change
-  //        BlockNodes to not use them, and this would require even more
-  //        boilerplate.
   //    - change the API for RegionCFG::removeNode, to take as arguments the
   //      reference to the data structure and maps that must be updated, so that
   //      when we remove the node from RegionCFG we also clear it from the maps.
@@ -125,7 +122,10 @@ private:
   //      API, it requirese coupling the RegionCFG API with internal details,
   //      and in the future it would need to be updated for every new map that
   //      must be updated on removal of a node.
-  links_container DeadNodesQuarantine;
+  llvm::SpecificBumpPtrAllocator<BBNodeT> NodeAllocator;
+
+  /// The live basic block nodes, associated to their original counterpart
+  links_container BlockNodes;
 
   /// Pointer to the entry basic block of this function
   BasicBlockNodeT *EntryNode;
@@ -138,6 +138,15 @@ private:
   FPostDomTree IFPDT;
 
 private:
+  /// Construct a new node in NodeAllocator, and add it to the live nodes
+  template<typename... ArgsT>
+  BBNodeT *createNode(ArgsT &&...Args) {
+    BBNodeT *Storage = NodeAllocator.Allocate();
+    auto *New = new (Storage) BBNodeT(std::forward<ArgsT>(Args)...);
+    BlockNodes.push_back(New);
+    return New;
+  }
+
   template<typename GraphNodeT>
   void addSuccessorEdges(GraphNodeT N,
                          const std::map<GraphNodeT, BBNodeT *> &NodeMap) {
@@ -261,8 +270,7 @@ public:
   BBNodeT *addNode(NodeT Node) { return addNode(Node, Node->getName()); }
 
   BBNodeT *createCollapsedNode(RegionCFG *Collapsed) {
-    BlockNodes.emplace_back(std::make_unique<BasicBlockNodeT>(this, Collapsed));
-    return BlockNodes.back().get();
+    return createNode(this, Collapsed);
   }
 
   BBNodeT *addArtificialNode(llvm::StringRef Name = "dummy",
@@ -270,8 +278,7 @@ public:
     revng_assert(T == BasicBlockNodeType::Empty
                  or T == BasicBlockNodeType::Break
                  or T == BasicBlockNodeType::Continue);
-    BlockNodes.emplace_back(std::make_unique<BasicBlockNodeT>(this, Name, T));
-    return BlockNodes.back().get();
+    return createNode(this, Name, T);
   }
 
   BBNodeT *addContinue() {
@@ -283,9 +290,7 @@ public:
   }
 
   BBNodeT *addDispatcher(llvm::StringRef Name, BasicBlockNodeT::Type T) {
-    using BBNodeT = BasicBlockNodeT;
-    auto D = std::make_unique<BBNodeT>(this, Name, T);
-    return BlockNodes.emplace_back(std::move(D)).get();
+    return createNode(this, Name, T);
   }
 
   BBNodeT *addEntryDispatcher() {
@@ -301,13 +306,10 @@ public:
   BBNodeT *addSetStateNode(unsigned StateVariableValue,
                            llvm::StringRef TargetName,
                            BasicBlockNodeT::Type T) {
-    using BBNodeT = BasicBlockNodeT;
     std::string IdStr = std::to_string(StateVariableValue);
     std::string Name = "set idx " + IdStr + " (desired target) "
                        + TargetName.str();
-    auto Tmp = std::make_unique<BBNodeT>(this, Name, T, StateVariableValue);
-    BlockNodes.emplace_back(std::move(Tmp));
-    return BlockNodes.back().get();
+    return createNode(this, Name, T, StateVariableValue);
   }
 
   BBNodeT *addEntrySetStateNode(unsigned StateVariableValue,
@@ -324,18 +326,16 @@ public:
 
   BBNodeT *addTile() {
     using Type = typename BasicBlockNodeT::Type;
-    auto Tmp = std::make_unique<BBNodeT>(this, "tile", Type::Tile);
-    BlockNodes.emplace_back(std::move(Tmp));
-    return BlockNodes.back().get();
+    return createNode(this, "tile", Type::Tile);
   }
 
   BBNodeT *cloneNode(BasicBlockNodeT &OriginalNode);
 
   void removeNode(BasicBlockNodeT *Node);
 
-  void insertBulkNodes(BasicBlockNodeTSet &Nodes,
+  void insertBulkNodes(const BasicBlockNodeTSet &Nodes,
                        BasicBlockNodeT *Head,
-                       BBNodeMap &SubstitutionMap,
+                       SubstitutionMap &SubMap,
                        std::set<EdgeDescriptor> &Out,
                        llvm::SmallVector<EdgeDescriptor> &ContinueBackedges);
 
@@ -343,7 +343,7 @@ public:
 
   BBNodeT &front() const { return *EntryNode; }
 
-  std::vector<BBNodeTUniquePtr> &getNodes() { return BlockNodes; }
+  links_container &getNodes() { return BlockNodes; }
 
 public:
   /// Dump a GraphViz representing this function on any stream
@@ -358,7 +358,11 @@ public:
     return dumpCFGOnFile(std::string(FName));
   }
 
-  /// Dump a GraphViz file on a file representing this function
+  /// Take a compact binary snapshot of the graph
+  GraphSnapshot snapshot() const;
+
+  /// Dump a GraphViz file, or a GraphSnapshot if -restructure-binary-snapshots
+  /// is passed, on a file representing this function
   void dumpCFGOnFile(const std::string &FunctionName,
                      const std::string &FolderName,
                      const std::string &FileName) const;
@@ -372,10 +376,15 @@ public:
   BBNodeT *cloneUntilExit(BBNodeT *Node, BBNodeT *Sink);
 
   /// Apply the untangle preprocessing pass.
-  void untangle();
+  ///
+  /// If \a Budget is exhausted, the remaining conditionals are not untangled.
+  void untangle(const RestructureBudget *Budget = nullptr);
 
   /// Apply comb to the region.
-  void inflate();
+  ///
+  /// If \a Budget is exhausted while duplicating nodes, combing is abandoned
+  /// halfway, and the region must be discarded.
+  void inflate(const RestructureBudget *Budget = nullptr);
 
   void removeNotReachables();
 
@@ -389,6 +398,19 @@ public:
 
   void markUnreachableAsInlined();
 
+  /// Run markUnreachableAsInlined(), weave() and inflate(), unless it has
+  /// already been done
+  void weaveAndInflate(const RestructureBudget *Budget = nullptr) {
+    if (not ToInflate)
+      return;
+
+    TraceSpan Span("weaveAndInflate", "restructure", FunctionName);
+    markUnreachableAsInlined();
+    weave();
+    inflate(Budget);
+    ToInflate = false;
+  }
+
   void computeUntangleWeight() {
     if (UntangleWeight == WeightNotComputed) {
       UntangleWeight = 0;
@@ -444,7 +466,15 @@ struct GraphTraits<Inverse<RegionCFG<NodeT> *>>
 
 } // namespace llvm
 
-extern unsigned DuplicationCounter;
+// The following counters are atomic since the regions of a function can be
+// inflated in parallel
+extern std::atomic<unsigned> DuplicationCounter;
+
+extern std::atomic<unsigned> UntangleTentativeCounter;
+extern std::atomic<unsigned> UntanglePerformedCounter;
+
+/// Sum of the sizes of all the RegionCFGs of a function, right after inflate
+extern std::atomic<unsigned> InflatedNodesCounter;
 
-extern unsigned UntangleTentativeCounter;
-extern unsigned UntanglePerformedCounter;
+/// Sum of the weights of all the nodes duplicated by inflate in a function
+extern std::atomic<unsigned> DuplicatedWeightCounter;
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <iterator>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/PostOrderIterator.h"
@@ -32,6 +33,7 @@
 #include "revng-c/RestructureCFG/BasicBlockNodeBB.h"
 #include "revng-c/RestructureCFG/MetaRegionBB.h"
 #include "revng-c/RestructureCFG/RegionCFGTree.h"
+#include "revng-c/RestructureCFG/RestructureCFG.h"
 #include "revng-c/RestructureCFG/Utils.h"
 
 template<typename IterT>
@@ -91,9 +93,7 @@ inline std::string RegionCFG<NodeT>::getRegionName() const {
 template<class NodeT>
 inline BasicBlockNode<NodeT> *
 RegionCFG<NodeT>::addNode(NodeT Node, llvm::StringRef Name) {
-  using BBNodeT = BasicBlockNodeT;
-  BlockNodes.emplace_back(std::make_unique<BBNodeT>(this, Node, Name));
-  BasicBlockNodeT *Result = BlockNodes.back().get();
+  BasicBlockNodeT *Result = createNode(this, Node, Name);
   revng_log(CombLogger,
             "Building " << Name << " at address: " << Result << "\n");
   return Result;
@@ -102,9 +102,7 @@ RegionCFG<NodeT>::addNode(NodeT Node, llvm::StringRef Name) {
 template<class NodeT>
 inline BasicBlockNode<NodeT> *
 RegionCFG<NodeT>::cloneNode(BasicBlockNodeT &OriginalNode) {
-  using BBNodeT = BasicBlockNodeT;
-  BlockNodes.emplace_back(std::make_unique<BBNodeT>(OriginalNode, this));
-  BasicBlockNodeT *New = BlockNodes.back().get();
+  BasicBlockNodeT *New = createNode(OriginalNode, this);
   New->setName(OriginalNode.getName().str() + " cloned");
   New->setWeaved(OriginalNode.isWeaved());
   return New;
@@ -121,13 +119,10 @@ inline void RegionCFG<NodeT>::removeNode(BasicBlockNodeT *Node) {
   for (BasicBlockNodeT *Successor : Node->successors())
     Successor->removePredecessor(Node);
 
-  for (auto It = BlockNodes.begin(); It != BlockNodes.end(); It++) {
-    if ((*It).get() == Node) {
-      DeadNodesQuarantine.push_back(std::move(*It));
-      BlockNodes.erase(It);
-      break;
-    }
-  }
+  // The node itself stays alive in NodeAllocator, see its comment
+  auto It = llvm::find(BlockNodes, Node);
+  if (It != BlockNodes.end())
+    BlockNodes.erase(It);
 }
 
 template<class NodeT>
@@ -142,17 +137,16 @@ inline void copyNeighbors(BBNodeT<NodeT> *Dst, BBNodeT<NodeT> *Src) {
 }
 
 template<class NodeT>
-inline void RegionCFG<NodeT>::insertBulkNodes(BasicBlockNodeTSet &Nodes,
+inline void RegionCFG<NodeT>::insertBulkNodes(const BasicBlockNodeTSet &Nodes,
                                               BasicBlockNodeT *Head,
-                                              BBNodeMap &SubMap,
+                                              SubstitutionMap &SubMap,
                                               std::set<EdgeDescriptor> &Out,
                                               llvm::SmallVector<EdgeDescriptor>
                                                 &ContinueBackedges) {
   revng_assert(BlockNodes.empty());
 
   for (BasicBlockNodeT *Node : Nodes) {
-    BlockNodes.emplace_back(std::make_unique<BasicBlockNodeT>(*Node, this));
-    BasicBlockNodeT *New = BlockNodes.back().get();
+    BasicBlockNodeT *New = createNode(*Node, this);
     SubMap[Node] = New;
 
     // The copy constructor used above does not bring along the successors and
@@ -171,7 +165,7 @@ inline void RegionCFG<NodeT>::insertBulkNodes(BasicBlockNodeTSet &Nodes,
   // successors (e.g., then and else, if then goes to a break).
   // In addition, since multiple break can go to the same successors, we keep a
   // mapping of successor -> corresponding break, so that we can reuse it.
-  BBNodeMap BreakMap;
+  SubstitutionMap BreakMap;
   for (EdgeDescriptor Edge : Out) {
 
     // Check if we already have a break for each outgoing edge, or create it.
@@ -203,7 +197,7 @@ inline void RegionCFG<NodeT>::insertBulkNodes(BasicBlockNodeTSet &Nodes,
   EntryNode = SubMap[Head];
   revng_assert(EntryNode != nullptr);
   // Fix the hack above
-  for (BBNodeTUniquePtr &Node : BlockNodes)
+  for (BasicBlockNodeT *Node : BlockNodes)
     Node->updatePointers(SubMap);
 
   // Connect all the `ContinueBackedges` to `continue` nodes
@@ -246,8 +240,8 @@ template<typename StreamT>
 inline void RegionCFG<NodeT>::dumpDot(StreamT &S) const {
   S << "digraph CFGFunction {\n";
 
-  for (const std::unique_ptr<BasicBlockNode<NodeT>> &BB : BlockNodes) {
-    streamNode(S, BB.get());
+  for (const BasicBlockNode<NodeT> *BB : BlockNodes) {
+    streamNode(S, BB);
     unsigned Counter = 0;
     for (const auto &[Successor, EdgeInfo] : BB->labeled_successors()) {
       unsigned PredID = BB->getID();
@@ -264,6 +258,23 @@ inline void RegionCFG<NodeT>::dumpDot(StreamT &S) const {
   S << "}\n";
 }
 
+template<class NodeT>
+inline GraphSnapshot RegionCFG<NodeT>::snapshot() const {
+  GraphSnapshot Result;
+  Result.Kind = GraphSnapshot::GraphKind::RegionCFG;
+  Result.Entry = EntryNode->getID();
+  Result.Nodes.reserve(BlockNodes.size());
+  for (const BasicBlockNode<NodeT> *BB : BlockNodes) {
+    GraphSnapshot::Node &Node = Result.Nodes.emplace_back();
+    Node.ID = BB->getID();
+    Node.Kind = static_cast<uint8_t>(BB->getNodeType());
+    Node.Name = BB->getNameStr();
+    for (const auto &[Successor, EdgeInfo] : BB->labeled_successors())
+      Node.Edges.push_back({ Successor->getID(), EdgeInfo.Inlined });
+  }
+  return Result;
+}
+
 template<class NodeT>
 inline void RegionCFG<NodeT>::dumpCFGOnFile(const std::string &FileName) const {
   std::error_code EC;
@@ -284,7 +295,10 @@ inline void RegionCFG<NodeT>::dumpCFGOnFile(const std::string &FuncName,
   const std::string PathName = GraphDir + "/" + FuncName + "/" + FolderName;
   EC = llvm::sys::fs::create_directory(PathName);
   revng_check(not EC, "Could not create directory to print RegionCFG dot");
-  dumpCFGOnFile(PathName + "/" + FileName);
+  if (dumpBinarySnapshots())
+    snapshot().writeToFile(PathName + "/" + FileName + ".snapshot");
+  else
+    dumpCFGOnFile(PathName + "/" + FileName);
 }
 
 template<class NodeT>
@@ -374,7 +388,7 @@ RegionCFG<NodeT>::cloneUntilExit(BasicBlockNode<NodeT> *Node,
                                  BasicBlockNode<NodeT> *Sink) {
 
   // Clone the postdominator node.
-  BBNodeMap CloneMap;
+  llvm::DenseMap<BBNodeT *, BBNodeT *> CloneMap;
   BasicBlockNode<NodeT> *Clone = cloneNode(*Node);
 
   // Insert the postdominator clone in the map.
@@ -384,7 +398,7 @@ RegionCFG<NodeT>::cloneUntilExit(BasicBlockNode<NodeT> *Node,
   WorkList.push_back(Node);
 
   // Set of nodes which have been already processed.
-  BasicBlockNodeTSet AlreadyProcessed;
+  llvm::SmallPtrSet<BBNodeT *, 16> AlreadyProcessed;
 
   while (!WorkList.empty()) {
     BasicBlockNode<NodeT> *CurrentNode = WorkList.back();
@@ -398,7 +412,9 @@ RegionCFG<NodeT>::cloneUntilExit(BasicBlockNode<NodeT> *Node,
       continue;
 
     // Get the clone of the `CurrentNode`.
-    BasicBlockNode<NodeT> *CurrentClone = CloneMap.at(CurrentNode);
+    auto CurrentIt = CloneMap.find(CurrentNode);
+    revng_assert(CurrentIt != CloneMap.end());
+    BasicBlockNode<NodeT> *CurrentClone = CurrentIt->second;
 
     for (const auto &[Succ, Labels] : CurrentNode->labeled_successors()) {
       // If the successor is not the sink, create and edge that directly
@@ -421,7 +437,8 @@ RegionCFG<NodeT>::cloneUntilExit(BasicBlockNode<NodeT> *Node,
         addEdge(EdgeDescriptor(CurrentClone, SuccessorClone), Labels);
 
         // Add the successor to the worklist.
-        WorkList.push_back(Succ);
+        if (not AlreadyProcessed.contains(Succ))
+          WorkList.push_back(Succ);
       }
     }
   }
@@ -430,7 +447,7 @@ RegionCFG<NodeT>::cloneUntilExit(BasicBlockNode<NodeT> *Node,
 }
 
 template<class NodeT>
-inline void RegionCFG<NodeT>::untangle() {
+inline void RegionCFG<NodeT>::untangle(const RestructureBudget *Budget) {
   // TODO: Here we handle only conditional nodes with two successors. We should
   //       consider extending the untangle procedure also to conditional nodes
   //       with more than two successors (switch nodes).
@@ -478,14 +495,20 @@ inline void RegionCFG<NodeT>::untangle() {
     }
   }
 
+  // Most conditionals are not untangled, and leave the graph untouched, so we
+  // only recompute the dominator and postdominator trees after an untangle.
+  bool TreesOutdated = true;
   while (not ConditionalNodes.empty()) {
 
     BasicBlockNode<NodeT> *Conditional = ConditionalNodes.back();
     ConditionalNodes.pop_back();
 
     // Update the information of the dominator and postdominator trees.
-    DT.recalculate(Graph);
-    IFPDT.recalculate(Graph);
+    if (TreesOutdated) {
+      DT.recalculate(Graph);
+      IFPDT.recalculate(Graph);
+      TreesOutdated = false;
+    }
 
     // Update the postdominator
     BasicBlockNodeT *PostDominator = IFPDT[Conditional]->getIDom()->getBlock();
@@ -571,6 +594,14 @@ inline void RegionCFG<NodeT>::untangle() {
       ElseWeight += WeightMap[Node];
     }
 
+    // Untangling never costs less than the lighter branch, hence it can only
+    // win if something has to be combed. This is always the case for the
+    // conditionals of already structured regions, where both branches are
+    // dominated by their edge, and spares us the visit of the rest of the
+    // region below the postdominator.
+    if (ThenWeight + ElseWeight == 0)
+      continue;
+
     // The weight of the nodes placed after the immediate postdominator is the
     // sum of all the weights of the nodes which are reachable starting from the
     // immediate post dominator and the sink node (to which all the exits have
@@ -624,6 +655,15 @@ inline void RegionCFG<NodeT>::untangle() {
       // Register a tentative untangle in the dedicated counter.
       UntangleTentativeCounter++;
 
+      // Untangling duplicates nodes just like combing does, so it draws from
+      // the same budget. Once it is exhausted, we leave the remaining
+      // conditionals to the comb, which will give up on the region.
+      DuplicatedWeightCounter += UntanglingCost;
+      if (Budget != nullptr and Budget->isExhausted()) {
+        revng_log(CombLogger, "Budget exhausted, giving up untangling");
+        break;
+      }
+
       // Register an actual untangle in the dedicated counter.
       UntanglePerformedCounter++;
       revng_log(CombLogger, "Actually splitting node");
@@ -643,21 +683,29 @@ inline void RegionCFG<NodeT>::untangle() {
       // In this way, in all the next phases, these edges will be ignored by the
       // dominator and postdominator trees.
       markEdgeInlined(EdgeDescriptor(Conditional, UntangledChild));
+      TreesOutdated = true;
 
       // Remove nodes that have no predecessors (nodes that are the result of
       // node cloning and that remains dandling around).
-      // While doing this, update InlineEdges.
-      bool Removed = true;
-      while (Removed) {
-        Removed = false;
-        BasicBlockNode<NodeT> *Entry = &getEntryNode();
-        for (auto It = begin(); It != end(); ++It) {
-          if ((Entry != *It and (*It)->predecessor_size() == 0)) {
-            removeNode(*It);
-            Removed = true;
-            break;
-          }
-        }
+      // Removing a node may leave its successors without predecessors, so we
+      // use a worklist instead of rescanning the whole graph after each
+      // removal.
+      BasicBlockNode<NodeT> *Entry = &getEntryNode();
+      const auto IsDangling = [Entry](BasicBlockNodeT *Node) {
+        return Node != Entry and Node->predecessor_size() == 0;
+      };
+      BasicBlockNodeTVect Dangling;
+      llvm::copy_if(BlockNodes, std::back_inserter(Dangling), IsDangling);
+      while (not Dangling.empty()) {
+        BasicBlockNodeT *Node = Dangling.back();
+        Dangling.pop_back();
+
+        // Deduplicate the successors, so that nodes reached through multiple
+        // edges are not removed twice
+        llvm::SmallSetVector<BasicBlockNodeT *, 2>
+          Successors(Node->successors().begin(), Node->successors().end());
+        removeNode(Node);
+        llvm::copy_if(Successors, std::back_inserter(Dangling), IsDangling);
       }
     }
   }
@@ -704,10 +752,10 @@ struct ReachableExitsAnalysis
 };
 
 template<class NodeT>
-inline void RegionCFG<NodeT>::inflate() {
+inline void RegionCFG<NodeT>::inflate(const RestructureBudget *Budget) {
 
   // Call the untangle preprocessing.
-  untangle();
+  untangle(Budget);
 
   revng_assert(isDAG());
 
@@ -870,7 +918,7 @@ inline void RegionCFG<NodeT>::inflate() {
   std::map<BasicBlockNode<NodeT> *, SmallPtrSet<NodeT>> NodesEquivalenceClass;
 
   // Map to keep track of the cloning relationship.
-  BBNodeMap CloneToOriginalMap;
+  SubstitutionMap CloneToOriginalMap;
 
   // Initialize a list containing the reverse post order of the nodes of the
   // graph.
@@ -879,13 +927,21 @@ inline void RegionCFG<NodeT>::inflate() {
   // Vector of conditional nodes, to be filled in reverse post order.
   BasicBlockNodeTVect ConditionalNodes;
 
+  // Position of each conditional node in RevPostOrderList. Iterators on a
+  // std::list stay valid across insertions, and conditional nodes are never
+  // removed from it, since only trivial dummies are.
+  using RPOPosition = typename std::list<BasicBlockNode<NodeT> *>::iterator;
+  std::map<BasicBlockNode<NodeT> *, RPOPosition> ConditionalPositions;
+
   llvm::ReversePostOrderTraversal<BasicBlockNode<NodeT> *> RPOT(Entry);
   for (BasicBlockNode<NodeT> *RPOTBB : RPOT) {
     RevPostOrderList.push_back(RPOTBB);
     NodesEquivalenceClass[RPOTBB].insert(RPOTBB);
     CloneToOriginalMap[RPOTBB] = RPOTBB;
-    if (ConditionalNodesSet.contains(RPOTBB))
+    if (ConditionalNodesSet.contains(RPOTBB)) {
       ConditionalNodes.push_back(RPOTBB);
+      ConditionalPositions[RPOTBB] = std::prev(RevPostOrderList.end());
+    }
   }
   NodesEquivalenceClass[nullptr] = {};
 
@@ -925,10 +981,8 @@ inline void RegionCFG<NodeT>::inflate() {
 
     // Get an iterator from the reverse post order list in the position of the
     // conditional node.
-    auto ListIt = std::find(RevPostOrderList.begin(),
-                            RevPostOrderList.end(),
-                            Conditional);
-    revng_assert(ListIt != RevPostOrderList.end());
+    auto ListIt = ConditionalPositions.at(Conditional);
+    revng_assert(*ListIt == Conditional);
 
     int Iteration = 0;
     while (++ListIt != RevPostOrderList.end() and not WorkList.empty()) {
@@ -1035,6 +1089,14 @@ inline void RegionCFG<NodeT>::inflate() {
 
       } else {
 
+        // Account for the size of the duplicate before creating it, so that
+        // we stop as soon as combing becomes too expensive.
+        DuplicatedWeightCounter += Candidate->getWeight();
+        if (Budget != nullptr and Budget->isExhausted()) {
+          revng_log(CombLogger, "Budget exhausted, giving up combing");
+          return;
+        }
+
         // Duplicate node.
         DuplicationCounter++;
         revng_log(CombLogger, "Duplicating node " << Candidate->getNameStr());
@@ -1071,7 +1133,9 @@ inline void RegionCFG<NodeT>::inflate() {
                      + std::to_string(Iteration));
         }
 
-        BasicBlockNode<NodeT> *OriginalNode = CloneToOriginalMap.at(Candidate);
+        BasicBlockNode<NodeT> *OriginalNode = CloneToOriginalMap
+                                                .lookup(Candidate);
+        revng_assert(OriginalNode != nullptr);
 
         bool AreDummies = Candidate->isEmpty();
         revng_assert(AreDummies == Duplicated->isEmpty());
@@ -4,11 +4,36 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
+#include <optional>
+
 #include "llvm/IR/Function.h"
 #include "llvm/Pass.h"
 
 class ASTTree;
 
+/// Limits on the work that can be spent building the GHAST of a single
+/// function. They are checked at coarse-grained points (e.g. after each
+/// RegionCFG is inflated), so they can be slightly exceeded.
+struct RestructureBudget {
+  using Clock = std::chrono::steady_clock;
+
+  /// Give up once this point in time has been reached
+  std::optional<Clock::time_point> Deadline;
+
+  /// Give up once the sum of the sizes of all the RegionCFGs after inflate
+  /// exceeds this limit
+  std::optional<unsigned> MaxInflatedNodes;
+
+  /// Give up as soon as the sum of the weights (roughly, the number of
+  /// instructions) of the nodes duplicated by combing exceeds this limit.
+  /// Unlike the other limits, this one is checked before each duplication.
+  std::optional<unsigned> MaxDuplicatedWeight;
+
+public:
+  bool isExhausted() const;
+};
+
 class RestructureCFG : public llvm::FunctionPass {
 
 public:
@@ -22,4 +47,10 @@ public:
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
 };
 
-bool restructureCFG(llvm::Function &F, ASTTree &AST);
+/// Build the GHAST of \a F in \a AST.
+///
+/// \return false if \a Budget has been exhausted, in which case \a AST must be
+///         discarded. In this case, \a F is left untouched.
+bool restructureCFG(llvm::Function &F,
+                    ASTTree &AST,
+                    const RestructureBudget &Budget = {});
@@ -0,0 +1,22 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+
+/// \return true if -restructure-metrics-output has been passed, i.e., if the
+///         metrics of restructuring and beautification have to be collected.
+bool isRestructureMetricsEnabled();
+
+/// Append \a Record to the file passed to -restructure-metrics-output, as a
+/// single line of JSON, along with the name of the function and of the phase
+/// that produced it.
+///
+/// This is thread-safe: the records of different functions are never
+/// interleaved, and they can be consumed as newline-delimited JSON.
+void emitRestructureMetrics(llvm::StringRef FunctionName,
+                            llvm::StringRef Phase,
+                            llvm::json::Object &&Record);
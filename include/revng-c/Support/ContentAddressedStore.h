@@ -0,0 +1,43 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/Support/Debug.h"
+
+/// A directory of files, each one named after a key, shared among runs and
+/// among concurrent processes.
+///
+/// Keys are meant to be hashes of everything the content of a file depends
+/// upon, see computeKey.
+class ContentAddressedStore {
+private:
+  std::string Directory;
+  std::string Extension;
+  Logger<> &Log;
+
+public:
+  ContentAddressedStore(llvm::StringRef Directory,
+                        llvm::StringRef Extension,
+                        Logger<> &Log) :
+    Directory(Directory.str()), Extension(Extension.str()), Log(Log) {}
+
+public:
+  /// \return the hex SHA1 of \a Inputs, to be used as a key.
+  static std::string computeKey(llvm::StringRef Inputs);
+
+  /// \return the content stored under \a Key, if any.
+  std::optional<std::string> lookup(llvm::StringRef Key) const;
+
+  /// Store \a Content under \a Key. Failures are logged and ignored.
+  void store(llvm::StringRef Key, llvm::StringRef Content) const;
+
+private:
+  std::string getPath(llvm::StringRef Key) const;
+};
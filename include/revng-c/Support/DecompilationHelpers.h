@@ -7,6 +7,7 @@
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Type.h"
 
@@ -82,6 +83,20 @@ inline bool areMemOpCompatible(const model::QualifiedType &ModelType,
   return ModelSize * 8 == LLVMSize;
 }
 
+/// \return the value \a V is a cast or a freeze of, looking through chains of
+///         them.
+inline llvm::Value *traverseTransparentInstructions(llvm::Value *V) {
+  llvm::Value *CurValue = V;
+
+  while (llvm::isa<llvm::IntToPtrInst>(CurValue)
+         or llvm::isa<llvm::PtrToIntInst>(CurValue)
+         or llvm::isa<llvm::BitCastInst>(CurValue)
+         or llvm::isa<llvm::FreezeInst>(CurValue))
+    CurValue = llvm::cast<llvm::Instruction>(CurValue)->getOperand(0);
+
+  return CurValue;
+}
+
 inline bool isAssignment(const llvm::Value *I) {
   return isCallToTagged(I, FunctionTags::Assign);
 }
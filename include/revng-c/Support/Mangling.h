@@ -5,8 +5,12 @@
 //
 
 #include <cctype>
+#include <cstdint>
+#include <string>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 
 // This is very simple for now.
 // In the future we might consider making it more robust using something like
@@ -19,3 +23,33 @@ inline std::string makeCIdentifier(std::string S) {
   });
   return S;
 }
+
+/// The identifiers used in a C scope, to make new ones that do not collide
+/// with them.
+///
+/// Each identifier costs a hash lookup, and the numbers resume from the last
+/// one that has been tried, so no name is tried twice.
+class CIdentifierTable {
+private:
+  llvm::StringSet<> Used;
+
+public:
+  /// Record \a Name, which is already a valid identifier, e.g., because it
+  /// comes from the model, as used in this scope
+  void reserve(llvm::StringRef Name) { Used.insert(Name); }
+
+  bool isUsed(llvm::StringRef Name) const { return Used.contains(Name); }
+
+  /// Return \a Prefix followed by the first number, starting from \a Counter,
+  /// that makes it an unused identifier, and record it as used
+  ///
+  /// \note \a Counter is moved past the returned number, and it can be shared
+  ///       among prefixes.
+  std::string numbered(llvm::StringRef Prefix, uint64_t &Counter) {
+    std::string Result;
+    do {
+      Result = Prefix.str() + std::to_string(Counter++);
+    } while (not Used.insert(Result).second);
+    return Result;
+  }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+
+/// \return true if -memory-metrics-output has been passed, i.e., if pipes and
+///         analyses have to report how much memory they use.
+bool isMemoryMetricsEnabled();
+
+/// Measures the memory used by a pipe or an analysis, from construction to
+/// destruction, when a single JSON object is appended to the file passed to
+/// -memory-metrics-output.
+///
+/// The record contains the malloc'd bytes at the beginning and at the end, the
+/// highest amount of malloc'd bytes observed by sample(), the peak RSS of the
+/// whole process so far, and the sizes of the main data structures reported
+/// through recordSize(). Since the peak RSS never decreases, the first record
+/// where it exceeds a given threshold identifies the culprit.
+///
+/// If -memory-metrics-output has not been passed, this does nothing.
+class MemoryMetrics {
+private:
+  bool Enabled = false;
+  std::string Name;
+  std::string FunctionName;
+  size_t InitialMallocUsage = 0;
+  size_t PeakMallocUsage = 0;
+  llvm::json::Object Sizes;
+
+public:
+  /// \param FunctionName the function being processed, for function passes.
+  explicit MemoryMetrics(llvm::StringRef Name,
+                         llvm::StringRef FunctionName = {});
+  ~MemoryMetrics();
+
+  MemoryMetrics(const MemoryMetrics &) = delete;
+  MemoryMetrics &operator=(const MemoryMetrics &) = delete;
+
+public:
+  /// Take note of the current amount of malloc'd bytes, if it's the highest
+  /// seen so far. Call this where the main data structures are the largest.
+  void sample();
+
+  /// Report that the data structure \a What has size \a Size, and sample().
+  void recordSize(llvm::StringRef What, uint64_t Size);
+};
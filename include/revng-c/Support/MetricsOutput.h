@@ -0,0 +1,56 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// \return the peak resident set size of the whole process so far, in KiB.
+uint64_t getPeakRSSKiB();
+
+/// A file where several threads write records of metrics, one JSON value at a
+/// time, usually passed on the command line.
+///
+/// The file is opened on the first record, and kept open until the end of the
+/// process. Each record is flushed right away, so that the file is usable even
+/// if the process crashes.
+class MetricsOutput {
+private:
+  const std::string &Path;
+  llvm::sys::fs::OpenFlags Flags;
+  llvm::StringRef Prologue;
+  llvm::StringRef Terminator;
+  std::mutex Mutex;
+  std::unique_ptr<llvm::raw_fd_ostream> Stream;
+
+public:
+  /// \param Path the path of the file, usually a cl::opt, which is read when
+  ///        the first record is written. If empty, the output is disabled.
+  /// \param Prologue written once, right after opening the file.
+  /// \param Terminator written after each record.
+  MetricsOutput(const std::string &Path,
+                llvm::sys::fs::OpenFlags Flags,
+                llvm::StringRef Prologue = "",
+                llvm::StringRef Terminator = "\n") :
+    Path(Path), Flags(Flags), Prologue(Prologue), Terminator(Terminator) {}
+
+  MetricsOutput(const MetricsOutput &) = delete;
+  MetricsOutput &operator=(const MetricsOutput &) = delete;
+
+public:
+  bool isEnabled() const { return not Path.empty(); }
+
+  /// Write \a Record on a single line, followed by the terminator.
+  ///
+  /// This is thread-safe: records are never interleaved.
+  void write(llvm::json::Value &&Record);
+};
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Type.h"
 
@@ -23,6 +24,21 @@ class Use;
 extern model::QualifiedType
 peelConstAndTypedefs(const model::QualifiedType &QT);
 
+/// Memoizes peelConstAndTypedefs, so that each chain of typedefs is walked only
+/// once.
+///
+/// The results are valid only as long as the types of the model don't change,
+/// so an instance must not outlive any change to them.
+class PeelConstAndTypedefsCache {
+private:
+  llvm::DenseMap<const model::TypedefType *, model::QualifiedType> Peeled;
+
+public:
+  model::QualifiedType peel(const model::QualifiedType &QT);
+
+  void clear() { Peeled.clear(); }
+};
+
 /// Strip off all the constness from QT, possibly having to traverse typedefs
 extern model::QualifiedType getNonConst(const model::QualifiedType &QT);
 
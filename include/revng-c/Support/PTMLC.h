@@ -4,9 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <charconv>
+#include <cstdint>
 #include <type_traits>
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Value.h"
 
@@ -17,6 +21,7 @@
 #include "revng/PTML/IndentedOstream.h"
 #include "revng/PTML/Tag.h"
 #include "revng/Pipeline/Location.h"
+#include "revng/Support/Assert.h"
 
 #include "revng-c/Pipes/Ranks.h"
 #include "revng-c/Support/PTML.h"
@@ -27,6 +32,11 @@ namespace ptml {
 class PTMLCBuilder : public ptml::PTMLBuilder {
   using Tag = ptml::Tag;
 
+  /// The serialized location of each model entity referenced so far. This
+  /// assumes that the entities being printed don't change or move while the
+  /// builder is alive.
+  mutable llvm::DenseMap<const void *, std::string> Locations;
+
 public:
   enum class Operator {
     PointerDereference,
@@ -73,6 +83,7 @@ public:
     Struct,
     Union,
     Enum,
+    Goto,
   };
 
   enum class Scopes {
@@ -136,6 +147,8 @@ private:
       return "union";
     case Keyword::Enum:
       return "enum";
+    case Keyword::Goto:
+      return "goto";
     default:
       revng_unreachable("Unknown keyword");
     }
@@ -283,14 +296,6 @@ private:
     return tokenTag(Str, ptml::c::tokens::Operator);
   }
 
-  std::string hexHelper(uint64_t Int) const {
-    std::string Result;
-    llvm::raw_string_ostream Out(Result);
-    Out.write_hex(Int);
-    Out.flush();
-    return Result;
-  }
-
   Tag keywordTagHelper(const llvm::StringRef Str) const {
     return ptml::PTMLBuilder::getTag(ptml::tags::Span, Str)
       .addAttribute(ptml::attributes::Token, ptml::c::tokens::Keyword);
@@ -305,6 +310,19 @@ private:
     return tokenTag(Str, ptml::c::tokens::Directive);
   }
 
+  template<typename... KeyTypes>
+  std::string getCachedLocation(const void *Entity,
+                                const auto &Rank,
+                                const KeyTypes &...Keys) const {
+    auto It = Locations.find(Entity);
+    if (It == Locations.end()) {
+      std::string Location = pipeline::serializedLocation(Rank, Keys...);
+      It = Locations.try_emplace(Entity, std::move(Location)).first;
+    }
+
+    return It->second;
+  }
+
 public:
   // Operators.
   Tag getOperator(Operator OperatorOp) const {
@@ -325,15 +343,36 @@ public:
   Tag getFalseTag() const { return getConstantTag("false"); }
 
   Tag getHex(uint64_t Int) const {
-    return getConstantTag("0x" + hexHelper(Int) + "U");
+    std::string Result = "0x";
+    Result += llvm::utohexstr(Int, /* LowerCase */ true);
+    Result += 'U';
+    return getConstantTag(Result);
   }
 
   Tag getNumber(const llvm::APInt &I,
                 unsigned int Radix = 10,
                 bool Signed = false) const {
+    // Decimal integers up to 64 bits, i.e., most of the constants of a
+    // function, do not need the generic algorithm of APInt
+    if (Radix == 10 and I.getBitWidth() <= 64) {
+      char Buffer[24];
+      char *End = Buffer + sizeof(Buffer);
+      std::to_chars_result Written;
+      if (Signed)
+        Written = std::to_chars(Buffer, End, I.getSExtValue());
+      else
+        Written = std::to_chars(Buffer, End, I.getZExtValue());
+      revng_assert(Written.ec == std::errc());
+
+      if (not Signed and I.getBitWidth() == 64 and I.isNegative())
+        *Written.ptr++ = 'U';
+
+      return getConstantTag(llvm::StringRef(Buffer, Written.ptr - Buffer));
+    }
+
     llvm::SmallString<12> Result;
     I.toString(Result, Radix, Signed);
-    if (I.getBitWidth() == 64 and I.isNegative())
+    if (not Signed and I.getBitWidth() == 64 and I.isNegative())
       Result += 'U';
 
     return getConstantTag(Result);
@@ -446,8 +485,7 @@ public:
   std::string getAttributePacked() { return "_PACKED"; }
 
   Tag getNameTag(const model::Type &T) const {
-    return ptml::PTMLBuilder::tokenTag(T.name().str().str(),
-                                       ptml::c::tokens::Type);
+    return ptml::PTMLBuilder::tokenTag(T.name(), ptml::c::tokens::Type);
   }
 
   // Locations.
@@ -459,7 +497,7 @@ public:
   std::string serializeLocation(const model::Type &T) const {
     if (isGenerateTagLessPTML())
       return "";
-    return pipeline::serializedLocation(revng::ranks::Type, T.key());
+    return getCachedLocation(&T, revng::ranks::Type, T.key());
   }
 
   std::string getLocation(bool IsDefinition,
@@ -496,7 +534,7 @@ public:
   std::string serializeLocation(const model::Segment &T) const {
     if (isGenerateTagLessPTML())
       return "";
-    return pipeline::serializedLocation(revng::ranks::Segment, T.key());
+    return getCachedLocation(&T, revng::ranks::Segment, T.key());
   }
 
   Tag getNameTag(const model::Segment &S) const {
@@ -504,6 +542,9 @@ public:
   }
 
   std::string getLocation(bool IsDefinition, const model::Segment &S) const {
+    if (isGenerateTagLessPTML())
+      return getNameTag(S).serialize();
+
     std::string Location = serializeLocation(S);
     return getNameTag(S)
       .addAttribute(getLocationAttribute(IsDefinition), Location)
@@ -524,9 +565,10 @@ public:
     if (isGenerateTagLessPTML())
       return "";
 
-    return pipeline::serializedLocation(revng::ranks::EnumEntry,
-                                        Enum.key(),
-                                        Entry.key());
+    return getCachedLocation(&Entry,
+                             revng::ranks::EnumEntry,
+                             Enum.key(),
+                             Entry.key());
   }
 
   std::string serializeLocation(const model::StructType &Struct,
@@ -534,9 +576,10 @@ public:
     if (isGenerateTagLessPTML())
       return "";
 
-    return pipeline::serializedLocation(revng::ranks::StructField,
-                                        Struct.key(),
-                                        Field.key());
+    return getCachedLocation(&Field,
+                             revng::ranks::StructField,
+                             Struct.key(),
+                             Field.key());
   }
 
   std::string serializeLocation(const model::UnionType &Union,
@@ -544,9 +587,10 @@ public:
     if (isGenerateTagLessPTML())
       return "";
 
-    return pipeline::serializedLocation(revng::ranks::UnionField,
-                                        Union.key(),
-                                        Field.key());
+    return getCachedLocation(&Field,
+                             revng::ranks::UnionField,
+                             Union.key(),
+                             Field.key());
   }
 
   Tag getNameTag(const model::EnumType &Enum,
@@ -558,6 +602,9 @@ public:
   std::string getLocation(bool IsDefinition,
                           const model::EnumType &Enum,
                           const model::EnumEntry &Entry) const {
+    if (isGenerateTagLessPTML())
+      return getNameTag(Enum, Entry).serialize();
+
     std::string Location = serializeLocation(Enum, Entry);
     return getNameTag(Enum, Entry)
       .addAttribute(getLocationAttribute(IsDefinition), Location)
@@ -573,6 +620,9 @@ public:
   template<typename Aggregate, typename Field>
   std::string
   getLocation(bool IsDefinition, const Aggregate &A, const Field &F) const {
+    if (isGenerateTagLessPTML())
+      return getNameTag(A, F).serialize();
+
     std::string Location = serializeLocation(A, F);
     return getNameTag(A, F)
       .addAttribute(getLocationAttribute(IsDefinition), Location)
@@ -591,7 +641,7 @@ public:
   }
 
   template<model::EntityWithComment Type>
-  std::string getModelComment(Type T) {
+  std::string getModelComment(const Type &T) {
     return ptml::comment(*this, T, "///", 0, 80);
   }
 
@@ -0,0 +1,55 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+
+/// \return true if -trace-output has been passed, i.e., if passes and their
+///         phases have to record how long they take.
+bool isTracingEnabled();
+
+/// Measures a pass or one of its phases, from construction to destruction (or
+/// to restart()), when a complete event in the Chrome trace event format is
+/// written to the file passed to -trace-output.
+///
+/// Events carry the thread they ran on, so the resulting file can be loaded in
+/// a trace viewer (e.g., Perfetto or chrome://tracing) to see where time goes
+/// across threads, and rendered as a flame graph.
+///
+/// If -trace-output has not been passed, this does nothing, and costs a check
+/// of a boolean.
+class TraceSpan {
+private:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  bool Enabled = false;
+  std::string Name;
+  std::string Category;
+  std::string FunctionName;
+  Clock::time_point Start;
+
+public:
+  /// \param Category the pass or the component the span belongs to.
+  /// \param FunctionName the function being processed, for function passes.
+  TraceSpan(llvm::StringRef Name,
+            llvm::StringRef Category,
+            llvm::StringRef FunctionName = {});
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+public:
+  /// End the current span and begin the next phase, called \a NewName, in the
+  /// same category.
+  void restart(llvm::StringRef NewName);
+
+private:
+  void emit();
+};
@@ -16,8 +16,10 @@
 extern bool isScalarCType(const llvm::Type *LLVMType);
 
 /// Get the C name of an LLVM Scalar type, in PTML.
-extern std::string getScalarCType(const llvm::Type *LLVMType,
-                                  const ptml::PTMLCBuilder &B);
+///
+/// The result is computed once for every scalar type and mode of the builder.
+extern const std::string &getScalarCType(const llvm::Type *LLVMType,
+                                         const ptml::PTMLCBuilder &B);
 
 /// Get the PTML definition of the C name of the type returned by F.
 extern std::string getReturnTypeLocationDefinition(const llvm::Function *F,
@@ -4,7 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Binary.h"
@@ -32,14 +35,28 @@ public:
     std::map<const model::Type *, Node *> TypeToNode;
   };
 
+  using StackTypesMap = std::unordered_map<const model::Function *,
+                                           std::set<const model::Type *>>;
+
 private:
   GraphInfo TypeGraph;
   std::unordered_map<const model::Type *, unsigned> TypeToNumOfRefs;
   std::set<const model::Type *> TypesToInline;
+  StackTypesMap StackTypesPerFunction;
 
 public:
   TypeInlineHelper(const model::Binary &Model);
 
+public:
+  /// Return a TypeInlineHelper for \a Model.
+  ///
+  /// The result of the last call is reused as long as \a Model is the same
+  /// object, its types are the same objects connected in the same way, and so
+  /// are the stack frames of its functions. This way, pipes working on the same
+  /// model don't need to walk the whole type graph every time.
+  static std::shared_ptr<const TypeInlineHelper>
+  get(const model::Binary &Model);
+
 public:
   const GraphInfo &getTypeGraph() const;
   const std::set<const model::Type *> &getTypesToInline() const;
@@ -47,19 +64,18 @@ public:
   getTypeToNumOfRefs() const;
 
 public:
-  // Collect stack frame types per model::Function.
-  std::unordered_map<const model::Function *, std::set<const model::Type *>>
-  findStackTypesPerFunction(const model::Binary &Model) const;
+  // Stack frame types per model::Function.
+  const StackTypesMap &getStackTypesPerFunction() const {
+    return StackTypesPerFunction;
+  }
 
   // Collect all stack frame types, since we want to dump them inline in the
   // function body.
-  std::set<const model::Type *>
-  collectStackTypes(const model::Binary &Model) const;
+  std::set<const model::Type *> collectStackTypes() const;
 
   // Find all nested types of the `RootType` that should be inlined into it.
   std::set<const model::Type *>
-  getTypesToInlineInTypeTy(const model::Binary &Model,
-                           const model::Type *RootType) const;
+  getTypesToInlineInTypeTy(const model::Type *RootType) const;
 
 private:
   std::set<const model::Type *> findTypesToInline(const model::Binary &Model,
@@ -70,15 +86,13 @@ private:
   std::unordered_map<const model::Type *, unsigned>
   calculateNumOfOccurences(const model::Binary &Model);
 
-  bool isReachableFromRootType(const model::Type *Type,
-                               const model::Type *RootType,
-                               const GraphInfo &TypeGraph);
+  StackTypesMap findStackTypesPerFunction(const model::Binary &Model) const;
 
   // Helper function used for finding all nested (into `RootType`) inlinable
   // types.
   std::set<const model::Type *>
   getNestedTypesToInline(const model::Type *RootType,
-                         const UpcastablePointer<model::Type> &NestedTy) const;
+                         model::Type *NestedTy) const;
 };
 
 extern bool declarationIsDefinition(const model::Type *T);
@@ -156,17 +156,12 @@ public:
 
   uint64_t getId() const { return getImpl()->getID(); }
 
-  uint64_t getByteSize() {
-    if (not isDefinition())
-      return 0;
-    uint64_t Max = 0;
-    for (auto Field : getFields()) {
-      mlir::Type FieldType = Field.getType();
-      uint64_t Size = FieldType.cast<mlir::clift::ValueType>().getByteSize();
-      Max = Size > Max ? Size : Max;
-    }
-    return Max;
-  }
+  /// Returns the size of the largest field.
+  ///
+  /// It's memoized once it can no longer change, since the verifiers of the
+  /// types containing the union ask for it, and computing it requires visiting
+  /// all the unions it contains by value.
+  uint64_t getByteSize();
 
   static Attribute parse(AsmParser &parser);
   Attribute print(AsmPrinter &p) const;
@@ -4,6 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
 #include "mlir/IR/AttributeSupport.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/TypeSupport.h"
@@ -21,9 +26,10 @@ public:
   // fields. That way when it is needed one can access everything.
   struct Key {
     uint64_t ID;
-    uint64_t Size;
+    // Zero until the body is set
+    uint64_t Size = 0;
     llvm::StringRef name;
-    Optional<llvm::SmallVector<FieldAttr, 2>> fields;
+    Optional<llvm::ArrayRef<FieldAttr>> fields;
 
     // struct storages are never exposed to the user, they are only used
     // internally to figure out how to create unique objects. only operator== is
@@ -75,9 +81,8 @@ public:
     if (TheKey.fields.has_value())
       return mlir::failure();
 
-    TheKey.fields = llvm::SmallVector<FieldAttr, 2>();
-    for (auto field : body)
-      TheKey.fields->push_back(field);
+    // The fields live in the allocator of the context, like the name
+    TheKey.fields = alloc.copyInto(body);
     TheKey.name = alloc.copyInto(name);
     TheKey.Size = Size;
     return mlir::success();
@@ -106,7 +111,7 @@ public:
 
     uint64_t ID;
     llvm::StringRef name;
-    Optional<llvm::SmallVector<FieldAttr, 2>> fields;
+    Optional<llvm::ArrayRef<FieldAttr>> fields;
 
     bool operator==(const Key &Other) const { return Other.ID == ID; }
 
@@ -152,9 +157,8 @@ public:
     if (TheKey.fields.has_value())
       return mlir::failure();
 
-    TheKey.fields = llvm::SmallVector<FieldAttr, 2>();
-    for (auto field : body)
-      TheKey.fields->push_back(field);
+    // The fields live in the allocator of the context, like the name
+    TheKey.fields = alloc.copyInto(body);
     TheKey.name = alloc.copyInto(name);
     return mlir::success();
   }
@@ -171,7 +175,27 @@ public:
 
   uint64_t getID() const { return TheKey.ID; }
 
+  /// \return the size of the union, if it has been computed once it could no
+  ///         longer change, i.e., once the union and all the structs and
+  ///         unions it contains by value have been defined.
+  std::optional<uint64_t> getFinalSize() const {
+    uint64_t Size = FinalSize.load(std::memory_order_relaxed);
+    if (Size == UnknownSize)
+      return std::nullopt;
+    return Size;
+  }
+
+  void setFinalSize(uint64_t Size) {
+    FinalSize.store(Size, std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr uint64_t UnknownSize = std::numeric_limits<uint64_t>::max();
+
 private:
   Key TheKey;
+  /// Not part of the key: it's a cache, derived from the fields, that can be
+  /// filled by concurrent verifiers
+  std::atomic<uint64_t> FinalSize = UnknownSize;
 };
 } // namespace mlir::clift
@@ -0,0 +1,36 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/DenseMap.h"
+
+#include "mlir/IR/MLIRContext.h"
+
+#include "revng/Model/Binary.h"
+
+#include "revng-c/mlir/Dialect/Clift/IR/CliftInterfaces.h"
+
+namespace mlir::clift {
+
+using ModelTypeMap = llvm::DenseMap<const model::Type *, ValueType>;
+
+/// Import all the types of \a Model into \a Context as Clift types.
+///
+/// Struct and union types are referenced by ID, and their bodies are set
+/// separately, so that they can reference each other through pointers. Since
+/// the verifiers of the Clift types need the sizes of the types held by value,
+/// the body of each struct and union is set before importing the types that
+/// hold it by value.
+///
+/// RawFunctionTypes returning more than one value would need an artificial
+/// struct as return type, which has no ID in the model: they are imported as
+/// returning a generic primitive type as large as all the return values.
+///
+/// \return a map from each type of \a Model to the corresponding Clift type,
+///         which is a PrimitiveType for model::PrimitiveTypes and a DefinedType
+///         for all the others.
+ModelTypeMap importModelTypes(MLIRContext &Context, const model::Binary &Model);
+
+} // namespace mlir::clift
@@ -10,8 +10,9 @@
 #include <list>
 #include <type_traits>
 
-#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
@@ -26,7 +27,10 @@
 
 #include "ALAPVariableDeclaration.h"
 
-using BBGHASTNodeMap = std::multimap<const llvm::BasicBlock *, const ASTNode *>;
+// For each `BasicBlock`, the `GHASTNode`s that cover it. Most `BasicBlock`s
+// are covered by a single `GHASTNode`, so we keep them in a flat index.
+using GHASTNodeList = llvm::SmallVector<const ASTNode *, 1>;
+using BBGHASTNodeMap = llvm::DenseMap<const llvm::BasicBlock *, GHASTNodeList>;
 
 static RecursiveCoroutine<void>
 collectExprBB(ExprNode *Expr, const ASTNode *Node, BBGHASTNodeMap &ResultMap) {
@@ -38,7 +42,7 @@ collectExprBB(ExprNode *Expr, const ASTNode *Node, BBGHASTNodeMap &ResultMap) {
   case ExprNode::NodeKind::NK_Atomic: {
     auto *Atomic = llvm::cast<AtomicNode>(Expr);
     llvm::BasicBlock *BB = Atomic->getConditionalBasicBlock();
-    ResultMap.insert(std::make_pair(BB, Node));
+    ResultMap[BB].push_back(Node);
   } break;
   case ExprNode::NodeKind::NK_Not: {
     auto *Not = llvm::cast<NotNode>(Expr);
@@ -100,7 +104,7 @@ private:
 
       // Add the original `BB` in the `ResultMap`
       llvm::BasicBlock *BB = If->getOriginalBB();
-      BBToASTNode.insert(std::make_pair(BB, If));
+      BBToASTNode[BB].push_back(If);
 
       ExprNode *IfExpr = If->getCondExpr();
       collectExprBB(IfExpr, If, BBToASTNode);
@@ -117,7 +121,7 @@ private:
 
       // Add the original `BB` in the `ResultMap`
       llvm::BasicBlock *BB = Switch->getOriginalBB();
-      BBToASTNode.insert(std::make_pair(BB, Switch));
+      BBToASTNode[BB].push_back(Switch);
 
       for (auto &LabelCasePair : Switch->cases_const_range()) {
         ASTNode *Case = LabelCasePair.second;
@@ -129,7 +133,7 @@ private:
       // Add the original `BB` in the `ResultMap`
       auto *Code = llvm::cast<CodeNode>(Node);
       llvm::BasicBlock *BB = Code->getOriginalBB();
-      BBToASTNode.insert(std::make_pair(BB, Code));
+      BBToASTNode[BB].push_back(Code);
     } break;
     case ASTNode::NK_Continue: {
       auto *Continue = llvm::cast<ContinueNode>(Node);
@@ -310,10 +314,9 @@ collectUsageASTNodes(const llvm::Instruction *Variable,
 
     // We retrieve all the `GHASTNode`s which encompass the `BasicBlock`
     // above
-    auto Range = BBToASTNode.equal_range(UserBB);
-    for (auto RangeIt = Range.first; RangeIt != Range.second; ++RangeIt) {
-      UsageASTNodes.insert(RangeIt->second);
-    }
+    auto It = BBToASTNode.find(UserBB);
+    if (It != BBToASTNode.end())
+      UsageASTNodes.insert(It->second.begin(), It->second.end());
   }
 
   // Ensure that we find usages for each `Variable` that we need to assign
@@ -336,7 +339,7 @@ static std::map<const llvm::CallInst *, llvm::SmallSet<const ASTNode *, 4>>
 computeVariableUsages(const ASTTree &GHAST,
                       PendingVariableListType &PendingVariables) {
 
-  // Compute a `BasicBlock * -> GHASTNode *` multimap representing which
+  // Compute a `BasicBlock * -> GHASTNode *` map representing which
   // `GHASTNode`s covers the usage of a certain `BasicBlock`
   BBToASTNodeMapping Mapping(GHAST);
   const BBGHASTNodeMap &BBToASTNode = Mapping.compute();
@@ -374,43 +377,31 @@ ASTVarDeclMap computeVarDeclMap(const ASTTree &GHAST,
   auto VariableUsages = computeVariableUsages(GHAST, PendingVariables);
 
   // 4: perform the `Variable` assignment operation.
-  // We want to iterate over the nodes of the newly created `GenericGraph`in
-  // post order.
+  // `ScopeReachabilityGraph` is a tree, so the nodes dominating all the uses of
+  // a `Variable` are the ancestors of the nearest common dominator of the uses,
+  // and the nearest common dominator itself is the most nested of them, which
+  // is where we emit the declaration.
   ASTVarDeclMap Result;
-  for (auto *TheNode : llvm::post_order(&ScopeReachabilityGraph.Graph)) {
-
-    // At each iteration, iterate over the list of variables that are still to
-    // assign
-    for (const llvm::CallInst *&Pending : PendingVariables) {
-
-      // We use a `nullptr` in `PendingVariables` as a tombstone to mark the
-      // fact that the variable has already been assigned
-      if (not Pending) {
-        continue;
-      }
-
-      const llvm::SmallSet<const ASTNode *, 4> &UsageASTNodes = VariableUsages
-                                                                  .at(Pending);
-
-      // If, from the current node, we dominate all the `ASTNode`s in
-      // `UsageASTNodes`, we can mark the variable to be emitted in the current
-      // `ASTNode`
-      const auto TheNodeDominatesASTUse = [&](const ASTNode *UsageASTNode) {
-        Node *UsageGraphNode = ScopeReachabilityGraph.ASTToNodeMap
-                                 .at(UsageASTNode);
-        return DT.dominates(TheNode, UsageGraphNode);
-      };
-      bool AllUsesDominated = llvm::all_of(UsageASTNodes,
-                                           TheNodeDominatesASTUse);
-
-      // If we the current TheNode dominates all the uses of the `Variable`,
-      // we mark the current node as the place where to emit the variable
-      // declaration
-      if (AllUsesDominated) {
-        Result[TheNode->getASTNode()].insert(Pending);
-        Pending = nullptr;
-      }
+  for (const llvm::CallInst *&Pending : PendingVariables) {
+    const llvm::SmallSet<const ASTNode *, 4> &UsageASTNodes = VariableUsages
+                                                                .at(Pending);
+
+    Node *DeclarationNode = nullptr;
+    for (const ASTNode *UsageASTNode : UsageASTNodes) {
+      Node *UsageGraphNode = ScopeReachabilityGraph.ASTToNodeMap
+                               .at(UsageASTNode);
+      if (DeclarationNode == nullptr)
+        DeclarationNode = UsageGraphNode;
+      else
+        DeclarationNode = DT.findNearestCommonDominator(DeclarationNode,
+                                                        UsageGraphNode);
     }
+    revng_assert(DeclarationNode != nullptr);
+
+    // We use a `nullptr` in `PendingVariables` as a tombstone to mark the
+    // fact that the variable has already been assigned
+    Result[DeclarationNode->getASTNode()].insert(Pending);
+    Pending = nullptr;
   }
 
   // At the end of the processing, we should have assigned all the pending
@@ -0,0 +1,51 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "revng/Support/Assert.h"
+
+/// The labels of a case from First to Last, both included
+struct CaseRange {
+  uint64_t First = 0;
+  uint64_t Last = 0;
+};
+
+/// Group the labels of a case, i.e., the values of a condition \a BitWidth
+/// bits wide, into the ranges to emit, sorted as unsigned values.
+///
+/// Runs of at least \a MinRangeSize consecutive labels, common in the switches
+/// lifted from jump tables, become a single range, any other label becomes a
+/// range of its own. A range never crosses the signed boundary of the
+/// condition, so that its ends are ordered both as signed and as unsigned
+/// values.
+inline llvm::SmallVector<CaseRange, 4>
+groupCaseLabels(llvm::SmallVector<uint64_t, 8> Labels,
+                unsigned BitWidth,
+                size_t MinRangeSize) {
+  revng_assert(BitWidth > 0 and BitWidth <= 64);
+  revng_assert(MinRangeSize > 1);
+  const uint64_t SignedMax = (uint64_t(1) << (BitWidth - 1)) - 1;
+
+  llvm::sort(Labels);
+  llvm::SmallVector<CaseRange, 4> Result;
+  for (size_t I = 0; I < Labels.size();) {
+    size_t RunEnd = I + 1;
+    while (RunEnd < Labels.size() and Labels[RunEnd - 1] != SignedMax
+           and Labels[RunEnd] == Labels[RunEnd - 1] + 1)
+      ++RunEnd;
+    if (RunEnd - I < MinRangeSize)
+      RunEnd = I + 1;
+
+    Result.push_back({ Labels[I], Labels[RunEnd - 1] });
+    I = RunEnd;
+  }
+
+  return Result;
+}
@@ -0,0 +1,484 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/IRHelpers.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/Support/YAMLTraits.h"
+
+#include "revng-c/Support/DecompilationHelpers.h"
+#include "revng-c/Support/FunctionTags.h"
+#include "revng-c/Support/ModelHelpers.h"
+
+#include "DecompilationCache.h"
+
+static Logger<> Log{ "decompilation-cache" };
+
+/// Bump this every time the C backend changes in a way that affects its
+/// output, so that stale entries are never reused.
+static constexpr const char *CacheFormatVersion = "2";
+
+/// A thread-safe LRU map from keys to C code, bounded in the total size of the
+/// entries it holds.
+///
+/// PTML is very repetitive, hence entries can be kept compressed, so that the
+/// same budget holds many more functions, at the cost of compressing them when
+/// they are stored and of decompressing them each time they are looked up.
+class RecentlyEmitted {
+private:
+  struct Entry {
+    std::string Key;
+    /// The C code, compressed with zlib if Compressed is true
+    std::string Data;
+    bool Compressed = false;
+    size_t UncompressedSize = 0;
+  };
+
+private:
+  std::mutex Mutex;
+  /// Most recently used first
+  std::list<Entry> Entries;
+  llvm::StringMap<std::list<Entry>::iterator> Index;
+  size_t Size = 0;
+
+public:
+  std::optional<std::string> lookup(llvm::StringRef Key) {
+    Entry Found;
+    {
+      std::lock_guard Lock(Mutex);
+      auto It = Index.find(Key);
+      if (It == Index.end())
+        return std::nullopt;
+
+      Entries.splice(Entries.begin(), Entries, It->second);
+      Found = *It->second;
+    }
+
+    if (not Found.Compressed)
+      return std::move(Found.Data);
+
+    // Decompress outside of the lock, so that threads looking up different
+    // functions don't wait for each other
+    namespace zlib = llvm::compression::zlib;
+    auto Compressed = llvm::arrayRefFromStringRef(Found.Data);
+    llvm::SmallVector<uint8_t, 0> Buffer;
+    if (llvm::Error Error = zlib::decompress(Compressed,
+                                             Buffer,
+                                             Found.UncompressedSize)) {
+      revng_log(Log,
+                "Cannot decompress " << Key.str() << ": "
+                                     << llvm::toString(std::move(Error)));
+      return std::nullopt;
+    }
+
+    return llvm::toStringRef(Buffer).str();
+  }
+
+  void store(llvm::StringRef Key,
+             llvm::StringRef CCode,
+             size_t Budget,
+             bool Compress) {
+    {
+      std::lock_guard Lock(Mutex);
+      if (auto It = Index.find(Key); It != Index.end()) {
+        Entries.splice(Entries.begin(), Entries, It->second);
+        return;
+      }
+    }
+
+    Entry New{ Key.str(), CCode.str(), false, CCode.size() };
+    namespace zlib = llvm::compression::zlib;
+    if (Compress and zlib::isAvailable()) {
+      llvm::SmallVector<uint8_t, 0> Buffer;
+      zlib::compress(llvm::arrayRefFromStringRef(CCode), Buffer);
+      New.Data = llvm::toStringRef(Buffer).str();
+      New.Compressed = true;
+    }
+
+    if (New.Data.size() > Budget)
+      return;
+
+    std::lock_guard Lock(Mutex);
+    // Another thread might have stored the same key in the meantime
+    if (Index.count(Key) != 0)
+      return;
+
+    Size += New.Data.size();
+    Entries.push_front(std::move(New));
+    Index[Key] = Entries.begin();
+
+    while (Size > Budget) {
+      Entry &Last = Entries.back();
+      Size -= Last.Data.size();
+      Index.erase(Last.Key);
+      Entries.pop_back();
+    }
+  }
+};
+
+static RecentlyEmitted InMemoryCache;
+
+template<typename T>
+static void appendYAML(std::string &Buffer, const T &Object) {
+  llvm::raw_string_ostream Stream(Buffer);
+  llvm::yaml::Output YAMLOutput(Stream);
+  YAMLOutput << const_cast<T &>(Object);
+}
+
+DecompilationCache::DecompilationCache(const model::Binary &Model,
+                                       llvm::StringRef Directory,
+                                       size_t MemoryBudget,
+                                       bool CompressInMemory,
+                                       llvm::StringRef Options) :
+  MemoryBudget(MemoryBudget), CompressInMemory(CompressInMemory), Model(Model) {
+  if (not Directory.empty())
+    Store.emplace(Directory, ".c.ptml", Log);
+
+  for (const UpcastablePointer<model::Type> &T : Model.Types())
+    TypeDefinitions[T.get()] = &T;
+
+  SerializedGlobals += Options;
+  SerializedGlobals += model::Architecture::getName(Model.Architecture()).str();
+  SerializedGlobals += '\n';
+  appendYAML(SerializedGlobals, Model.Segments());
+  appendYAML(SerializedGlobals, Model.ImportedDynamicFunctions());
+}
+
+const std::string &
+DecompilationCache::getSerializedType(const model::Type *T) {
+  auto It = SerializedTypes.find(T);
+  if (It != SerializedTypes.end())
+    return It->second;
+
+  std::string &Result = SerializedTypes[T];
+  appendYAML(Result, *TypeDefinitions.at(T));
+  return Result;
+}
+
+/// Collect all the global variables used, directly or through constant
+/// expressions, by \a C
+static void collectGlobals(const llvm::Constant *C,
+                           llvm::SmallPtrSetImpl<const llvm::Constant *> &Seen,
+                           std::vector<const llvm::GlobalVariable *> &Result) {
+  if (not Seen.insert(C).second)
+    return;
+
+  if (auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(C)) {
+    Result.push_back(GV);
+    return;
+  }
+
+  if (llvm::isa<llvm::GlobalValue>(C))
+    return;
+
+  for (const llvm::Use &Op : C->operands())
+    if (auto *OpC = llvm::dyn_cast<llvm::Constant>(Op.get()))
+      collectGlobals(OpC, Seen, Result);
+}
+
+/// Append \a Text to \a Buffer, replacing the references to metadata nodes
+/// (`!N`) with their order of appearance in \a Text and dropping the references
+/// to attribute groups (`#N`).
+///
+/// Both are numbered across the whole module, hence they change when an
+/// unrelated function or global is added, or when the module is filtered.
+static void appendRenumbered(std::string &Buffer, llvm::StringRef Text) {
+  std::map<unsigned, unsigned> MetadataSlots;
+  bool InString = false;
+  for (size_t I = 0; I < Text.size(); ++I) {
+    char C = Text[I];
+    bool IsSlot = not InString and (C == '!' or C == '#')
+                  and I + 1 < Text.size() and llvm::isDigit(Text[I + 1]);
+    if (not IsSlot) {
+      // Quotes within strings and names are escaped, hence each one opens or
+      // closes them
+      if (C == '"')
+        InString = not InString;
+      Buffer += C;
+      continue;
+    }
+
+    size_t End = I + 1;
+    while (End < Text.size() and llvm::isDigit(Text[End]))
+      ++End;
+
+    if (C == '!') {
+      unsigned Slot = 0;
+      bool Failed = Text.slice(I + 1, End).getAsInteger(10, Slot);
+      revng_assert(not Failed);
+      auto It = MetadataSlots.try_emplace(Slot, MetadataSlots.size()).first;
+      Buffer += '!';
+      Buffer += std::to_string(It->second);
+    }
+
+    I = End - 1;
+  }
+}
+
+/// Append the IR of \a F to \a Buffer, including the content of the attached
+/// metadata, so that the result does not depend on the rest of the module.
+///
+/// The attributes are printed by content, in place of the attribute groups,
+/// and the metadata nodes are renumbered by appendRenumbered.
+static void appendIR(std::string &Buffer, const llvm::Function &F) {
+  std::string Text;
+  llvm::raw_string_ostream Stream(Text);
+
+  // Only number the metadata of F, not the one of the whole module
+  llvm::ModuleSlotTracker MST(F.getParent(), false);
+  MST.incorporateFunction(F);
+
+  llvm::SmallVector<llvm::StringRef, 16> KindNames;
+  F.getContext().getMDKindNames(KindNames);
+
+  llvm::SmallVector<const llvm::MDNode *, 16> Attached;
+  llvm::SmallVector<std::pair<unsigned, llvm::MDNode *>, 4> Attachments;
+
+  Stream << F.getName() << ' ';
+  F.getFunctionType()->print(Stream);
+  const llvm::AttributeList &Attributes = F.getAttributes();
+  for (unsigned Index : Attributes.indexes())
+    Stream << ' ' << Attributes.getAsString(Index);
+
+  F.getAllMetadata(Attachments);
+  for (const auto &[Kind, Node] : Attachments) {
+    Stream << " !" << KindNames[Kind] << ' ';
+    Node->printAsOperand(Stream, MST);
+    Attached.push_back(Node);
+  }
+  Stream << '\n';
+
+  for (const llvm::Argument &Argument : F.args()) {
+    Argument.printAsOperand(Stream, true, MST);
+    Stream << '\n';
+  }
+
+  for (const llvm::BasicBlock &BB : F) {
+    BB.printAsOperand(Stream, false, MST);
+    Stream << ":\n";
+
+    for (const llvm::Instruction &I : BB) {
+      I.print(Stream, MST);
+      if (auto *Call = llvm::dyn_cast<llvm::CallBase>(&I)) {
+        const llvm::AttributeList &CallAttributes = Call->getAttributes();
+        if (CallAttributes.hasFnAttrs())
+          Stream << ' '
+                 << CallAttributes.getAsString(llvm::AttributeList::
+                                                 FunctionIndex);
+      }
+      Stream << '\n';
+
+      Attachments.clear();
+      I.getAllMetadata(Attachments);
+      for (const auto &[Kind, Node] : Attachments)
+        Attached.push_back(Node);
+    }
+  }
+
+  // The content of the attached metadata, which is not printed along with the
+  // function
+  for (const llvm::MDNode *Node : Attached) {
+    Node->printTree(Stream, MST, F.getParent());
+    Stream << '\n';
+  }
+
+  appendRenumbered(Buffer, Text);
+}
+
+static bool hasTypeAsFirstArgument(const llvm::CallInst *Call) {
+  return isCallToTagged(Call, FunctionTags::ModelGEP)
+         or isCallToTagged(Call, FunctionTags::ModelGEPRef)
+         or isCallToTagged(Call, FunctionTags::ModelCast)
+         or isCallToTagged(Call, FunctionTags::AddressOf)
+         or isCallToTagged(Call, FunctionTags::LocalVariable)
+         or isCallStackArgumentDecl(Call);
+}
+
+FunctionDependencies collectDependencies(FunctionMetadataCache &Cache,
+                                         const model::Binary &Model,
+                                         const llvm::Function &F) {
+  FunctionDependencies Result;
+
+  const model::Function *ModelFunction = llvmToModelFunction(Model, F);
+  revng_assert(ModelFunction != nullptr);
+
+  llvm::SmallVector<const model::Type *, 16> TypeRoots;
+  TypeRoots.push_back(ModelFunction->prototype(Model).getConst());
+  if (not ModelFunction->StackFrameType().empty())
+    TypeRoots.push_back(ModelFunction->StackFrameType().getConst());
+
+  for (const llvm::Instruction &I : llvm::instructions(F)) {
+    auto *Call = llvm::dyn_cast<llvm::CallInst>(&I);
+    if (Call == nullptr)
+      continue;
+
+    if (isCallToIsolatedFunction(Call)) {
+      auto Prototype = Cache.getCallSitePrototype(Model, Call);
+      TypeRoots.push_back(Prototype.getConst());
+
+      if (const llvm::Function *Callee = Call->getCalledFunction())
+        if (const auto *ModelCallee = llvmToModelFunction(Model, *Callee))
+          Result.Callees.insert(ModelCallee);
+
+    } else if (hasTypeAsFirstArgument(Call)) {
+      auto Type = deserializeFromLLVMString(Call->getArgOperand(0), Model);
+      TypeRoots.push_back(Type.UnqualifiedType().getConst());
+    }
+  }
+
+  // Visit all the types reachable from the roots
+  std::set<const model::Type *> Visited;
+  while (not TypeRoots.empty()) {
+    const model::Type *T = TypeRoots.pop_back_val();
+    if (not Visited.insert(T).second)
+      continue;
+
+    Result.Types.push_back(T);
+    for (const model::QualifiedType &QT : T->edges())
+      TypeRoots.push_back(QT.UnqualifiedType().getConst());
+  }
+
+  llvm::sort(Result.Types,
+             [](const model::Type *LHS, const model::Type *RHS) {
+               return LHS->ID() < RHS->ID();
+             });
+
+  // The types of F come first, so that the position of the others does not
+  // depend on their IDs (see FunctionDeduplicator)
+  const model::Type *Prototype = ModelFunction->prototype(Model).getConst();
+  const model::Type *StackFrame = nullptr;
+  if (not ModelFunction->StackFrameType().empty())
+    StackFrame = ModelFunction->StackFrameType().getConst();
+  std::stable_partition(Result.Types.begin(),
+                        Result.Types.end(),
+                        [Prototype, StackFrame](const model::Type *T) {
+                          return T == Prototype or T == StackFrame;
+                        });
+
+  return Result;
+}
+
+std::string
+DecompilationCache::computeKey(FunctionMetadataCache &Cache,
+                               const llvm::Function &F,
+                               const std::set<const model::Type *>
+                                 &InlinedStackTypes) {
+  std::string Inputs = serializeInputs(Cache, F, InlinedStackTypes);
+  return ContentAddressedStore::computeKey(Inputs);
+}
+
+std::string
+DecompilationCache::serializeInputs(FunctionMetadataCache &Cache,
+                                    const llvm::Function &F,
+                                    const std::set<const model::Type *>
+                                      &InlinedStackTypes) {
+  std::string Buffer = CacheFormatVersion;
+  Buffer += '\n';
+  Buffer += SerializedGlobals;
+
+  const model::Function *ModelFunction = llvmToModelFunction(Model, F);
+  revng_assert(ModelFunction != nullptr);
+  appendYAML(Buffer, *ModelFunction);
+
+  appendIR(Buffer, F);
+
+  {
+    llvm::raw_string_ostream Stream(Buffer);
+
+    // Referenced global constants, e.g. serialized model types and strings
+    std::vector<const llvm::GlobalVariable *> Globals;
+    llvm::SmallPtrSet<const llvm::Constant *, 16> SeenConstants;
+    for (const llvm::Instruction &I : llvm::instructions(F))
+      for (const llvm::Use &Op : I.operands())
+        if (auto *C = llvm::dyn_cast<llvm::Constant>(Op.get()))
+          collectGlobals(C, SeenConstants, Globals);
+
+    for (const llvm::GlobalVariable *GV : Globals) {
+      Stream << GV->getName() << '\n';
+      if (GV->isConstant() and GV->hasInitializer())
+        GV->getInitializer()->print(Stream);
+      Stream << '\n';
+    }
+  }
+
+  FunctionDependencies Dependencies = collectDependencies(Cache, Model, F);
+  // Callees are kept in a set of pointers: sort them by entry, so that the key
+  // does not depend on where they have been allocated
+  std::vector<const model::Function *> Callees(Dependencies.Callees.begin(),
+                                               Dependencies.Callees.end());
+  llvm::sort(Callees,
+             [](const model::Function *LHS, const model::Function *RHS) {
+               return LHS->Entry() < RHS->Entry();
+             });
+  for (const model::Function *Callee : Callees)
+    appendYAML(Buffer, *Callee);
+
+  // Whether stack types are inlined or not depends on the whole model
+  llvm::SmallVector<uint64_t, 8> InlinedIDs;
+  for (const model::Type *T : InlinedStackTypes)
+    InlinedIDs.push_back(T->ID());
+  llvm::sort(InlinedIDs);
+  for (uint64_t ID : InlinedIDs)
+    Buffer += std::to_string(ID) + '\n';
+
+  // The types whose definition affects the C code of F
+  for (const model::Type *T : Dependencies.Types)
+    Buffer += getSerializedType(T);
+
+  return Buffer;
+}
+
+std::optional<std::string>
+DecompilationCache::lookup(llvm::StringRef Key) const {
+  if (MemoryBudget != 0) {
+    if (std::optional<std::string> CCode = InMemoryCache.lookup(Key)) {
+      revng_log(Log, "Hit " << Key.str() << " in memory");
+      return CCode;
+    }
+  }
+
+  if (not Store)
+    return std::nullopt;
+
+  // Hits on disk are logged by Store
+  std::optional<std::string> CCode = Store->lookup(Key);
+  if (not CCode)
+    return std::nullopt;
+
+  if (MemoryBudget != 0)
+    InMemoryCache.store(Key, *CCode, MemoryBudget, CompressInMemory);
+  return CCode;
+}
+
+void DecompilationCache::store(llvm::StringRef Key,
+                               llvm::StringRef CCode) const {
+  if (MemoryBudget != 0)
+    InMemoryCache.store(Key, CCode, MemoryBudget, CompressInMemory);
+  if (Store)
+    Store->store(Key, CCode);
+}
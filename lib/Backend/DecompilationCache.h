@@ -0,0 +1,114 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
+
+#include "revng-c/Support/ContentAddressedStore.h"
+
+namespace llvm {
+class Function;
+} // namespace llvm
+
+/// The parts of the model, besides its own model::Function, that the C code of
+/// an isolated function depends upon
+struct FunctionDependencies {
+  /// The model::Functions called by the function
+  std::set<const model::Function *> Callees;
+
+  /// All the types reachable from the prototype and the stack frame of the
+  /// function, from the prototypes of its call sites and from the types
+  /// referenced in its IR (e.g. by ModelGEPs). The prototype and the stack
+  /// frame come first, in this order, then the others, sorted by ID.
+  std::vector<const model::Type *> Types;
+};
+
+FunctionDependencies collectDependencies(FunctionMetadataCache &Cache,
+                                         const model::Binary &Model,
+                                         const llvm::Function &F);
+
+/// A persistent, content-addressed cache of the C code emitted for isolated
+/// functions.
+///
+/// Each function is associated to a key, which is a hash of everything its C
+/// code depends upon: its LLVM IR (including referenced metadata and global
+/// constants), its model::Function, the model::Functions of its callees and
+/// all the model types reachable from its prototype, its stack frame, the
+/// prototypes of its call sites and the types referenced in the IR (e.g. by
+/// ModelGEPs), and the options that affect the C code (e.g.,
+/// -decompile-max-regioncfg-nodes). If none of them changed, the C code stored
+/// under the same key in a previous run can be reused as is.
+///
+/// Entries are kept on disk, in a directory shared among runs, and/or in
+/// memory, in a process-wide LRU cache that survives across pipe runs (e.g.,
+/// in the daemon). Since keys are content hashes, entries never need to be
+/// invalidated: stale ones are simply never looked up again, and get evicted.
+class DecompilationCache {
+private:
+  std::optional<ContentAddressedStore> Store;
+  size_t MemoryBudget = 0;
+  bool CompressInMemory = false;
+  const model::Binary &Model;
+
+  /// Maps each type to its definition in the model, so it can be serialized
+  std::unordered_map<const model::Type *,
+                     const UpcastablePointer<model::Type> *>
+    TypeDefinitions;
+
+  /// Memoized serializations of the types, shared among all the functions
+  std::unordered_map<const model::Type *, std::string> SerializedTypes;
+
+  /// Serialization of the parts of the model that are not function or types
+  std::string SerializedGlobals;
+
+public:
+  /// \param Directory where entries are stored on disk, if not empty.
+  /// \param MemoryBudget how many bytes of C code can be kept in memory, 0
+  ///        disables the in-memory cache.
+  /// \param CompressInMemory whether the C code kept in memory is compressed,
+  ///        in which case MemoryBudget bounds its compressed size.
+  /// \param Options the serialized values of the options that affect the C
+  ///        code of every function, which are part of all the keys.
+  DecompilationCache(const model::Binary &Model,
+                     llvm::StringRef Directory,
+                     size_t MemoryBudget,
+                     bool CompressInMemory,
+                     llvm::StringRef Options);
+
+public:
+  /// Compute the key for \a F.
+  ///
+  /// \param InlinedStackTypes the types that will be inlined in the body of F
+  std::string
+  computeKey(FunctionMetadataCache &Cache,
+             const llvm::Function &F,
+             const std::set<const model::Type *> &InlinedStackTypes);
+
+  /// \return the serialization of everything the C code of \a F depends upon,
+  ///         whose hash is the key computed by computeKey.
+  std::string
+  serializeInputs(FunctionMetadataCache &Cache,
+                  const llvm::Function &F,
+                  const std::set<const model::Type *> &InlinedStackTypes);
+
+  /// \return the C code stored under \a Key, if any.
+  std::optional<std::string> lookup(llvm::StringRef Key) const;
+
+  /// Store \a CCode under \a Key. Failures are logged and ignored.
+  void store(llvm::StringRef Key, llvm::StringRef CCode) const;
+
+private:
+  const std::string &getSerializedType(const model::Type *T);
+};
@@ -2,16 +2,29 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <optional>
 #include <utility>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -24,10 +37,18 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Progress.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 #include "revng/ABI/FunctionType/Layout.h"
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
@@ -47,6 +68,7 @@
 #include "revng/PTML/IndentedOstream.h"
 #include "revng/Pipeline/Location.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/YAMLTraits.h"
@@ -60,17 +82,23 @@
 #include "revng-c/RestructureCFG/ASTNodeUtils.h"
 #include "revng-c/RestructureCFG/ASTTree.h"
 #include "revng-c/RestructureCFG/BeautifyGHAST.h"
+#include "revng-c/RestructureCFG/RegionCFGTree.h"
 #include "revng-c/RestructureCFG/RestructureCFG.h"
 #include "revng-c/Support/DecompilationHelpers.h"
 #include "revng-c/Support/FunctionTags.h"
 #include "revng-c/Support/IRHelpers.h"
+#include "revng-c/Support/Mangling.h"
 #include "revng-c/Support/ModelHelpers.h"
 #include "revng-c/Support/PTMLC.h"
+#include "revng-c/Support/TraceSpan.h"
 #include "revng-c/TypeNames/LLVMTypeNames.h"
 #include "revng-c/TypeNames/ModelToPTMLTypeHelpers.h"
 #include "revng-c/TypeNames/ModelTypeNames.h"
 
 #include "ALAPVariableDeclaration.h"
+#include "CaseRanges.h"
+#include "DecompilationCache.h"
+#include "FunctionDeduplicator.h"
 
 using llvm::cast;
 using llvm::dyn_cast;
@@ -101,10 +129,45 @@ using ModelTypesMap = std::map<const llvm::Value *, const model::QualifiedType>;
 using InlineableTypesMap = std::unordered_map<const model::Function *,
                                               std::set<const model::Type *>>;
 
+/// A flat, read-only version of ModelTypesMap, which is queried several times
+/// for each emitted token.
+///
+/// Each type is stored only once in a vector, and values are mapped to an
+/// index in it through an open-addressing hash table, instead of walking a
+/// red-black tree.
+class ValueTypeTable {
+private:
+  std::vector<model::QualifiedType> Types;
+  llvm::DenseMap<const llvm::Value *, unsigned> TypeIndices;
+
+public:
+  explicit ValueTypeTable(ModelTypesMap &&TypeMap) {
+    std::map<model::QualifiedType, unsigned> Interned;
+    TypeIndices.reserve(TypeMap.size());
+    for (auto &[Value, Type] : TypeMap) {
+      auto [It, New] = Interned.try_emplace(Type, Types.size());
+      if (New)
+        Types.push_back(Type);
+      TypeIndices[Value] = It->second;
+    }
+  }
+
+public:
+  const model::QualifiedType &at(const llvm::Value *V) const {
+    auto It = TypeIndices.find(V);
+    revng_assert(It != TypeIndices.end());
+    return Types[It->second];
+  }
+};
+
 static constexpr const char *StackFrameVarName = "_stack";
 
+/// Minimum number of consecutive labels of a case to emit as a case range
+static constexpr size_t MinCaseRangeSize = 3;
+
 static Logger<> Log{ "c-backend" };
 static Logger<> VisitLog{ "c-backend-visit-order" };
+static Logger<> ProgressLog{ "decompile-progress" };
 
 static bool isStackFrameDecl(const llvm::Value *I) {
   auto *Call = dyn_cast_or_null<llvm::CallInst>(I);
@@ -141,8 +204,43 @@ static bool isCConstant(const llvm::Value *V) {
          or isCallToTagged(V, FunctionTags::LiteralPrintDecorator);
 }
 
+/// Concatenate \a Pieces into a new string, allocating it only once.
+///
+/// Expressions are built out of many small tokens: chaining operator+ on
+/// std::strings reallocates and copies the partial result at every step.
+static std::string concatTokens(std::initializer_list<llvm::StringRef> Pieces) {
+  size_t Size = 0;
+  for (llvm::StringRef Piece : Pieces)
+    Size += Piece.size();
+
+  std::string Result;
+  Result.reserve(Size);
+  for (llvm::StringRef Piece : Pieces)
+    Result.append(Piece.data(), Piece.size());
+  return Result;
+}
+
 static std::string addAlwaysParentheses(llvm::StringRef Expr) {
-  return std::string("(") + Expr.str() + ")";
+  return concatTokens({ "(", Expr, ")" });
+}
+
+/// Enough for "0x" followed by the 16 digits of a 64-bit value
+using HexLiteralBuffer = std::array<char, 2 + 16>;
+
+/// Format \a Value at the end of \a Buffer as APInt::toString does for C
+/// literals in radix 16, i.e., "0x" followed by uppercase digits
+static llvm::StringRef formatHexLiteral(uint64_t Value,
+                                        HexLiteralBuffer &Buffer) {
+  static constexpr char Digits[] = "0123456789ABCDEF";
+  char *End = Buffer.data() + Buffer.size();
+  char *Begin = End;
+  do {
+    *--Begin = Digits[Value & 0xF];
+    Value >>= 4;
+  } while (Value != 0);
+  *--Begin = 'x';
+  *--Begin = '0';
+  return llvm::StringRef(Begin, End - Begin);
 }
 
 static std::string get128BitIntegerHexConstant(llvm::APInt Value,
@@ -168,14 +266,11 @@ static std::string get128BitIntegerHexConstant(llvm::APInt Value,
   bool NeedsOr = not HighBits.isZero() and not LowBits.isZero();
 
   std::string CompositeConstant = Cast + " ";
+  HexLiteralBuffer Buffer;
 
   if (not HighBits.isZero()) {
-    StringToken HighBitsString;
-    HighBits.toString(HighBitsString,
-                      /*radix=*/16,
-                      /*signed=*/false,
-                      /*formatAsCLiteral=*/true);
-
+    llvm::StringRef HighBitsString = formatHexLiteral(HighBits.getZExtValue(),
+                                                      Buffer);
     auto HighConst = B.getConstantTag(HighBitsString) + " "
                      + B.getOperator(PTMLOperator::LShift) + " "
                      + B.getNumber(64);
@@ -187,11 +282,8 @@ static std::string get128BitIntegerHexConstant(llvm::APInt Value,
     CompositeConstant += " " + B.getOperator(PTMLOperator::Or) + " ";
 
   if (not LowBits.isZero()) {
-    StringToken LowBitsString;
-    LowBits.toString(LowBitsString,
-                     /*radix=*/16,
-                     /*signed=*/false,
-                     /*formatAsCLiteral=*/true);
+    llvm::StringRef LowBitsString = formatHexLiteral(LowBits.getZExtValue(),
+                                                     Buffer);
     CompositeConstant += B.getConstantTag(LowBitsString).serialize();
   }
   return addAlwaysParentheses(CompositeConstant);
@@ -200,15 +292,16 @@ static std::string get128BitIntegerHexConstant(llvm::APInt Value,
 static std::string hexLiteral(const llvm::ConstantInt *Int,
                               const ptml::PTMLCBuilder &B,
                               const model::Binary &Model) {
-  StringToken Formatted;
   if (Int->getBitWidth() <= 64) {
-    Int->getValue().toString(Formatted,
-                             /*radix*/ 16,
-                             /*signed*/ false,
-                             /*formatAsCLiteral*/ true);
-    return Formatted.str().str();
+    HexLiteralBuffer Buffer;
+    return B.getConstantTag(formatHexLiteral(Int->getZExtValue(), Buffer))
+      .serialize();
   }
-  return get128BitIntegerHexConstant(Int->getValue(), B, Model);
+
+  std::string Composite = get128BitIntegerHexConstant(Int->getValue(),
+                                                      B,
+                                                      Model);
+  return B.getConstantTag(Composite).serialize();
 }
 
 static std::string charLiteral(const llvm::ConstantInt *Int) {
@@ -216,6 +309,15 @@ static std::string charLiteral(const llvm::ConstantInt *Int) {
   const auto LimitedValue = Int->getLimitedValue(0xffu);
   const auto CharValue = static_cast<char>(LimitedValue);
 
+  // Most characters need neither C nor HTML escaping
+  bool NeedsCEscape = CharValue == '\\' or CharValue == '"'
+                      or not llvm::isPrint(CharValue);
+  bool NeedsHTMLEscape = CharValue == '&' or CharValue == '<'
+                         or CharValue == '>' or CharValue == '\''
+                         or CharValue == '"';
+  if (not NeedsCEscape and not NeedsHTMLEscape)
+    return { '\'', CharValue, '\'' };
+
   std::string EscapedC;
   llvm::raw_string_ostream EscapeCStream(EscapedC);
   EscapeCStream.write_escaped(std::string(&CharValue, 1));
@@ -227,7 +329,7 @@ static std::string charLiteral(const llvm::ConstantInt *Int) {
   return llvm::formatv("'{0}'", EscapeHTMLStream.str());
 }
 
-static std::string boolLiteral(const llvm::ConstantInt *Int) {
+static llvm::StringRef boolLiteral(const llvm::ConstantInt *Int) {
   revng_assert(Int->getBitWidth() == 1);
   if (Int->isZero()) {
     return "false";
@@ -236,6 +338,20 @@ static std::string boolLiteral(const llvm::ConstantInt *Int) {
   }
 }
 
+/// Counters of the hot paths of CCodeGenerator, reported through
+/// -decompile-telemetry-output
+struct EmissionCounters {
+  /// Calls to getToken, including the recursive ones
+  uint64_t GetTokenCalls = 0;
+  /// Calls to getToken answered by TokenMap, i.e., for variables and arguments
+  uint64_t TokenMapHits = 0;
+  /// Casts actually emitted by buildCastExpr, each one renders a type name
+  uint64_t CastExprs = 0;
+  /// Parentheses added by addParentheses, i.e., when the operator precedence
+  /// resolution pass didn't run
+  uint64_t Parentheses = 0;
+};
+
 struct CCodeGenerator {
 private:
   /// The model of the binary being analysed
@@ -255,7 +371,7 @@ private:
   const ASTVarDeclMap &VariablesToDeclare;
 
   /// A map containing a model type for each LLVM value in the function
-  const ModelTypesMap TypeMap;
+  const ValueTypeTable TypeMap;
 
   /// Where to output the decompiled C code
   ptml::PTMLIndentedOstream Out;
@@ -271,21 +387,27 @@ private:
 private:
   class VarNameGenerator {
   private:
+    CIdentifierTable Names;
     uint64_t CurVarID = 0;
 
   public:
-    std::string nextVarName() { return "_var_" + to_string(CurVarID++); }
+    /// Make sure no generated name collides with \a Name
+    void reserve(llvm::StringRef Name) { Names.reserve(Name); }
+
+    std::string nextVarName() { return Names.numbered("_var_", CurVarID); }
 
-    StringToken nextSwitchStateVar() {
-      StringToken StateVar("_break_from_loop_");
-      StateVar += to_string(CurVarID++);
-      return StateVar;
+    std::string nextSwitchStateVar() {
+      return Names.numbered("_break_from_loop_", CurVarID);
     }
   };
 
-  /// Stateful generator for variable names
+  /// Stateful generator for variable names, aware of the names of the
+  /// arguments and of the other variables of the function
   VarNameGenerator NameGenerator;
 
+  /// Labels of the basic blocks, only used when emitting gotos
+  std::map<const llvm::BasicBlock *, std::string> BlockLabels;
+
   /// Keep track of the names associated with function arguments, and local
   /// variables. In the past it also kept track of intermediate expressions, but
   /// with the new design all the tokens corresponding to instructions that
@@ -301,12 +423,18 @@ private:
   /// Emission of parentheses may change whether the OPRP is enabled or not
   bool IsOperatorPrecedenceResolutionPassEnabled = false;
 
+  /// Updated by const member functions too, since they don't affect the output
+  mutable EmissionCounters Counters;
+
 public:
+  /// \param Types the result of initModelTypes on \a LLVMFunction, which is
+  ///        computed by the caller since it creates LLVM types
   CCodeGenerator(FunctionMetadataCache &Cache,
                  const Binary &Model,
                  const llvm::Function &LLVMFunction,
                  const ASTTree &GHAST,
                  const ASTVarDeclMap &VarToDeclare,
+                 ModelTypesMap &&Types,
                  raw_ostream &Out,
                  ptml::PTMLCBuilder &B) :
     Model(Model),
@@ -315,17 +443,15 @@ public:
     Prototype(*ModelFunction.prototype(Model).getConst()),
     GHAST(GHAST),
     VariablesToDeclare(VarToDeclare),
-    TypeMap(initModelTypes(Cache,
-                           LLVMFunction,
-                           &ModelFunction,
-                           Model,
-                           /*PointersOnly=*/false)),
+    TypeMap(std::move(Types)),
     Out(Out, DecompiledCCodeIndentation),
     B(B),
     SwitchStateVars(),
     Cache(Cache) {
     // TODO: don't use a global loop state variable
     static const char *LoopStateVarName = "_loop_state_var";
+    NameGenerator.reserve(LoopStateVarName);
+    NameGenerator.reserve(StackFrameVarName);
     LoopStateVar = getVariableLocationReference(LoopStateVarName,
                                                 ModelFunction,
                                                 B);
@@ -337,7 +463,23 @@ public:
       IsOperatorPrecedenceResolutionPassEnabled = true;
   }
 
-  void emitFunction(bool NeedsLocalStateVar, InlineableTypesMap &StackTypes);
+  /// Emit the whole function. If \a EmitGotos is true, the GHAST is ignored,
+  /// and the body is emitted as a sequence of labeled basic blocks connected
+  /// by gotos.
+  void emitFunction(bool NeedsLocalStateVar,
+                    bool EmitGotos,
+                    const InlineableTypesMap &StackTypes);
+
+  const EmissionCounters &getCounters() const { return Counters; }
+
+private:
+  void emitVariableDeclarations(const LocalVarDeclSet &Vars);
+
+  /// Emit the body of the function without relying on the GHAST. Variables
+  /// are expected to be all associated to the nullptr scope.
+  void emitGotoBody();
+
+  void emitGoto(const llvm::BasicBlock *Target);
 
 private:
   /// Visit a GHAST node and all its children recursively, emitting BBs
@@ -393,6 +535,19 @@ private:
 private:
   std::string addParentheses(llvm::StringRef Expr) const;
 
+  std::string addParentheses(std::string &&Expr) const;
+
+  /// The opening parenthesis that addParentheses wraps around expressions,
+  /// for building expressions with concatTokens without intermediate strings
+  llvm::StringRef openParen() const {
+    return IsOperatorPrecedenceResolutionPassEnabled ? "" : "(";
+  }
+
+  /// The closing counterpart of openParen
+  llvm::StringRef closeParen() const {
+    return IsOperatorPrecedenceResolutionPassEnabled ? "" : ")";
+  }
+
   std::string buildDerefExpr(llvm::StringRef Expr) const;
 
   std::string buildAddressExpr(llvm::StringRef Expr) const;
@@ -424,7 +579,7 @@ private:
     return getVariableLocationDefinition(VarName, ModelFunction, B);
   }
 
-  std::string getVarName(const llvm::Instruction *I) const {
+  const std::string &getVarName(const llvm::Instruction *I) const {
     revng_assert(isStackFrameDecl(I) or isLocalVarDecl(I)
                  or isArtificialAggregateLocalVarDecl(I)
                  or isCallStackArgumentDecl(I));
@@ -436,17 +591,28 @@ private:
 std::string CCodeGenerator::addParentheses(llvm::StringRef Expr) const {
   if (IsOperatorPrecedenceResolutionPassEnabled)
     return Expr.str();
+  ++Counters.Parentheses;
+  return addAlwaysParentheses(Expr);
+}
+
+std::string CCodeGenerator::addParentheses(std::string &&Expr) const {
+  if (IsOperatorPrecedenceResolutionPassEnabled)
+    return std::move(Expr);
+  ++Counters.Parentheses;
   return addAlwaysParentheses(Expr);
 }
 
 std::string CCodeGenerator::buildDerefExpr(llvm::StringRef Expr) const {
   using PTMLOperator = ptml::PTMLCBuilder::Operator;
-  return B.getOperator(PTMLOperator::PointerDereference) + addParentheses(Expr);
+  std::string Operator = B.getOperator(PTMLOperator::PointerDereference)
+                           .serialize();
+  return concatTokens({ Operator, openParen(), Expr, closeParen() });
 }
 
 std::string CCodeGenerator::buildAddressExpr(llvm::StringRef Expr) const {
-  return B.getOperator(ptml::PTMLCBuilder::Operator::AddressOf)
-         + addParentheses(Expr);
+  std::string Operator = B.getOperator(ptml::PTMLCBuilder::Operator::AddressOf)
+                           .serialize();
+  return concatTokens({ Operator, openParen(), Expr, closeParen() });
 }
 
 std::string
@@ -460,8 +626,14 @@ CCodeGenerator::buildCastExpr(StringRef ExprToCast,
   revng_assert(SrcType.skipTypedefs() == DestType.skipTypedefs()
                or (SrcType.isScalar() and DestType.isScalar()));
 
-  return addAlwaysParentheses(getTypeName(DestType, B)) + " "
-         + addParentheses(ExprToCast);
+  ++Counters.CastExprs;
+  std::string TypeName = getTypeName(DestType, B);
+  return concatTokens({ "(",
+                        TypeName,
+                        ") ",
+                        openParen(),
+                        ExprToCast,
+                        closeParen() });
 }
 
 static std::string getUndefToken(model::QualifiedType UndefType,
@@ -481,7 +653,7 @@ static std::string getFormattedIntegerToken(const llvm::CallInst *Call,
   if (isCallToTagged(Call, FunctionTags::HexInteger)) {
     const auto Operand = Call->getArgOperand(0);
     const auto *Value = cast<llvm::ConstantInt>(Operand);
-    return B.getConstantTag(hexLiteral(Value, B, Model)).serialize();
+    return hexLiteral(Value, B, Model);
   }
 
   if (isCallToTagged(Call, FunctionTags::CharInteger)) {
@@ -671,7 +843,7 @@ CCodeGenerator::getModelGEPToken(const llvm::CallInst *Call) const {
         IndexExpr = rc_recur getToken(ThirdArgument);
       }
 
-      rc_return BaseString + "[" + IndexExpr + "]";
+      rc_return concatTokens({ BaseString, "[", IndexExpr, "]" });
     }
 
     // Here we know that there is at least one variadic argument.
@@ -697,7 +869,7 @@ CCodeGenerator::getModelGEPToken(const llvm::CallInst *Call) const {
         // represented by square brackets that want to access elements of the
         // array. So we have to first dereference the pointer-to-array in order
         // to be able to access elements via [] in C.
-        BaseString = "(" + buildDerefExpr(BaseString) + ")";
+        BaseString = addAlwaysParentheses(buildDerefExpr(BaseString));
       } else {
         // If CurType is not an array we're going to represent the first level
         // of the traversal with the `->` operator rather than `.`, so let's
@@ -708,7 +880,7 @@ CCodeGenerator::getModelGEPToken(const llvm::CallInst *Call) const {
   }
   ++CurArg;
 
-  std::string CurExpr = addParentheses(BaseString);
+  std::string CurExpr = addParentheses(std::move(BaseString));
   using PTMLOperator = ptml::PTMLCBuilder::Operator;
   Tag Deref = UseArrow ? B.getOperator(PTMLOperator::Arrow) :
                          B.getOperator(PTMLOperator::Dot);
@@ -734,7 +906,9 @@ CCodeGenerator::getModelGEPToken(const llvm::CallInst *Call) const {
         IndexExpr = rc_recur getToken(CurArg->get());
       }
 
-      CurExpr += "[" + IndexExpr + "]";
+      CurExpr += '[';
+      CurExpr += IndexExpr;
+      CurExpr += ']';
     } else {
       // If it's a struct or union, we can only navigate it with fixed
       // indexes.
@@ -777,9 +951,11 @@ CCodeGenerator::getCustomOpcodeToken(const llvm::CallInst *Call) const {
   if (isAssignment(Call)) {
     const llvm::Value *StoredVal = Call->getArgOperand(0);
     const llvm::Value *PointerVal = Call->getArgOperand(1);
-    rc_return rc_recur getToken(PointerVal) + " "
-      + B.getOperator(ptml::PTMLCBuilder::Operator::Assign) + " "
-      + rc_recur getToken(StoredVal);
+    std::string PointerToken = rc_recur getToken(PointerVal);
+    std::string StoredToken = rc_recur getToken(StoredVal);
+    std::string Operator = B.getOperator(ptml::PTMLCBuilder::Operator::Assign)
+                             .serialize();
+    rc_return concatTokens({ PointerToken, " ", Operator, " ", StoredToken });
   }
 
   if (isCallToTagged(Call, FunctionTags::Copy))
@@ -840,7 +1016,10 @@ CCodeGenerator::getCustomOpcodeToken(const llvm::CallInst *Call) const {
     // Emit RHS
     llvm::StringRef Separator = " {";
     for (const auto &Arg : Call->args()) {
-      StructInit += Separator.str() + " " + rc_recur getToken(Arg);
+      std::string ArgToken = rc_recur getToken(Arg);
+      StructInit += Separator;
+      StructInit += ' ';
+      StructInit += ArgToken;
       Separator = ",";
     }
     StructInit += " }";
@@ -876,7 +1055,8 @@ CCodeGenerator::getCustomOpcodeToken(const llvm::CallInst *Call) const {
                          .str();
     }
 
-    rc_return rc_recur getToken(AggregateOp) + "." + StructFieldRef;
+    std::string AggregateToken = rc_recur getToken(AggregateOp);
+    rc_return concatTokens({ AggregateToken, ".", StructFieldRef });
   }
 
   if (isCallToTagged(Call, FunctionTags::SegmentRef)) {
@@ -952,7 +1132,7 @@ CCodeGenerator::getIsolatedCallToken(const llvm::CallInst *Call) const {
   std::string CalleeToken;
   if (not isa<llvm::Function>(Call->getCalledOperand())) {
     std::string CalledString = rc_recur getToken(Call->getCalledOperand());
-    CalleeToken = addParentheses(CalledString);
+    CalleeToken = addParentheses(std::move(CalledString));
   } else {
     if (not CallEdge->DynamicFunction().empty()) {
       // Dynamic Function
@@ -1013,7 +1193,7 @@ static bool shouldGenerateDebugInfoAsPTML(const llvm::Instruction &I) {
 }
 
 static std::string addDebugInfo(const llvm::Instruction *I,
-                                const std::string &Str,
+                                std::string Str,
                                 const ptml::PTMLCBuilder &B) {
   if (shouldGenerateDebugInfoAsPTML(*I)) {
     std::string Location = I->getDebugLoc()->getScope()->getName().str();
@@ -1149,8 +1329,13 @@ CCodeGenerator::getInstructionToken(const llvm::Instruction *I) const {
 
     // TODO: Integer promotion
     rc_return addDebugInfo(I,
-                           addParentheses(Op0Token) + OperatorString
-                             + addParentheses(Op1Token),
+                           concatTokens({ openParen(),
+                                          Op0Token,
+                                          closeParen(),
+                                          OperatorString,
+                                          openParen(),
+                                          Op1Token,
+                                          closeParen() }),
                            B);
   }
 
@@ -1158,7 +1343,7 @@ CCodeGenerator::getInstructionToken(const llvm::Instruction *I) const {
     // Those are usually noops on the LLVM IR.
     const llvm::Value *Op = I->getOperand(0);
     std::string Token = rc_recur getToken(Op);
-    rc_return addDebugInfo(I, Token, B);
+    rc_return addDebugInfo(I, std::move(Token), B);
   }
 
   switch (I->getOpcode()) {
@@ -1211,9 +1396,17 @@ CCodeGenerator::getInstructionToken(const llvm::Instruction *I) const {
     std::string Op2String = rc_recur getToken(Op2);
 
     rc_return addDebugInfo(I,
-                           addParentheses(Condition) + " ? "
-                             + addParentheses(Op1String) + " : "
-                             + addParentheses(Op2String),
+                           concatTokens({ openParen(),
+                                          Condition,
+                                          closeParen(),
+                                          " ? ",
+                                          openParen(),
+                                          Op1String,
+                                          closeParen(),
+                                          " : ",
+                                          openParen(),
+                                          Op2String,
+                                          closeParen() }),
                            B);
 
   } break;
@@ -1236,9 +1429,11 @@ RecursiveCoroutine<std::string>
 CCodeGenerator::getToken(const llvm::Value *V) const {
   revng_log(Log, "getToken(): " << dumpToString(V));
   LoggerIndent Indent{ Log };
+  ++Counters.GetTokenCalls;
   // If we already have a variable name for this, return it.
   auto It = TokenMap.find(V);
   if (It != TokenMap.end()) {
+    ++Counters.TokenMapHits;
     revng_assert(isa<llvm::Argument>(V) or isStackFrameDecl(V)
                  or isCallStackArgumentDecl(V) or isLocalVarDecl(V)
                  or isArtificialAggregateLocalVarDecl(V)
@@ -1277,7 +1472,9 @@ CCodeGenerator::getCallToken(const llvm::CallInst *Call,
   } else {
     llvm::StringRef Separator = "(";
     for (const auto &Arg : Call->args()) {
-      Expression += Separator.str() + rc_recur getToken(Arg);
+      std::string ArgToken = rc_recur getToken(Arg);
+      Expression += Separator;
+      Expression += ArgToken;
       Separator = ", ";
     }
     Expression += ')';
@@ -1356,7 +1553,7 @@ void CCodeGenerator::emitBasicBlock(const llvm::BasicBlock *BB,
       // types on the LLVM IR are not on the model.
       revng_assert(Call->getType()->isAggregateType());
 
-      std::string VarName = getVarName(Call);
+      const std::string &VarName = getVarName(Call);
       revng_assert(not VarName.empty());
 
       // Get the token. If the Call is a call to an isolated function that
@@ -1548,8 +1745,14 @@ CCodeGenerator::buildGHASTCondition(const ExprNode *E, bool EmitBB) {
     const Tag &OpToken = E->getKind() == NodeKind::NK_And ?
                            B.getOperator(PTMLOperator::BoolAnd) :
                            B.getOperator(PTMLOperator::BoolOr);
-    rc_return addAlwaysParentheses(Child1Token) + " " + OpToken.serialize()
-      + " " + addAlwaysParentheses(Child2Token);
+    std::string OpString = OpToken.serialize();
+    rc_return concatTokens({ "(",
+                             Child1Token,
+                             ") ",
+                             OpString,
+                             " (",
+                             Child2Token,
+                             ")" });
   } break;
 
   default:
@@ -1564,33 +1767,90 @@ static std::string makeWhile(const ptml::PTMLCBuilder &B,
          + CondExpr + ")";
 }
 
-RecursiveCoroutine<void> CCodeGenerator::emitGHASTNode(const ASTNode *N) {
-  if (N == nullptr)
-    rc_return;
+void CCodeGenerator::emitVariableDeclarations(const LocalVarDeclSet &Vars) {
+  for (const CallInst *VarDeclCall : Vars) {
+    // Emit missing local variable declarations
+    if (isLocalVarDecl(VarDeclCall) or isCallStackArgumentDecl(VarDeclCall)) {
+      std::string VarName = createLocalVarDeclName(VarDeclCall);
+      revng_assert(not VarName.empty());
+      Out << getNamedCInstance(TypeMap.at(VarDeclCall), VarName, B) << ";\n";
+    } else if (isHelperAggregateLocalVarDecl(VarDeclCall)
+               or isArtificialAggregateLocalVarDecl(VarDeclCall)) {
+      // Create missing local variable declarations
+      std::string VarName = createLocalVarDeclName(VarDeclCall);
+      revng_assert(not VarName.empty());
+      const auto &Prototype = Cache.getCallSitePrototype(Model, VarDeclCall);
+      revng_assert(Prototype.isValid() and not Prototype.empty());
+      const auto *FunctionType = Prototype.getConst();
+      Out << getNamedInstanceOfReturnType(*FunctionType, VarName, B, false)
+          << ";\n";
+    } else {
+      revng_assert(not VarDeclCall->getType()->isAggregateType());
+    }
+  }
+}
 
-  auto VarToDeclareIt = VariablesToDeclare.find(N);
-  if (VarToDeclareIt != VariablesToDeclare.end()) {
-    for (const CallInst *VarDeclCall : VarToDeclareIt->second) {
-      // Emit missing local variable declarations
-      if (isLocalVarDecl(VarDeclCall) or isCallStackArgumentDecl(VarDeclCall)) {
-        std::string VarName = createLocalVarDeclName(VarDeclCall);
-        revng_assert(not VarName.empty());
-        Out << getNamedCInstance(TypeMap.at(VarDeclCall), VarName, B) << ";\n";
-      } else if (isHelperAggregateLocalVarDecl(VarDeclCall)
-                 or isArtificialAggregateLocalVarDecl(VarDeclCall)) {
-        // Create missing local variable declarations
-        std::string VarName = createLocalVarDeclName(VarDeclCall);
-        revng_assert(not VarName.empty());
-        const auto &Prototype = Cache.getCallSitePrototype(Model, VarDeclCall);
-        revng_assert(Prototype.isValid() and not Prototype.empty());
-        const auto *FunctionType = Prototype.getConst();
-        Out << getNamedInstanceOfReturnType(*FunctionType, VarName, B, false)
-            << ";\n";
+void CCodeGenerator::emitGoto(const llvm::BasicBlock *Target) {
+  Out << B.getKeyword(ptml::PTMLCBuilder::Keyword::Goto) << " "
+      << BlockLabels.at(Target) << ";\n";
+}
+
+void CCodeGenerator::emitGotoBody() {
+  // All the variables are declared at the top of the function
+  auto VarToDeclareIt = VariablesToDeclare.find(nullptr);
+  if (VarToDeclareIt != VariablesToDeclare.end())
+    emitVariableDeclarations(VarToDeclareIt->second);
+
+  unsigned BlockID = 0;
+  for (const BasicBlock &BB : LLVMFunction)
+    BlockLabels[&BB] = "_block_" + std::to_string(BlockID++);
+
+  using PTMLKeyword = ptml::PTMLCBuilder::Keyword;
+  for (const BasicBlock &BB : LLVMFunction) {
+    // The empty statement after the label allows it to precede declarations
+    // and the end of the function
+    if (not llvm::pred_empty(&BB))
+      Out << BlockLabels.at(&BB) << ":;\n";
+
+    emitBasicBlock(&BB, /*EmitReturn=*/true);
+
+    const Instruction *Terminator = BB.getTerminator();
+    if (auto *Branch = dyn_cast<llvm::BranchInst>(Terminator)) {
+      if (Branch->isUnconditional()) {
+        emitGoto(Branch->getSuccessor(0));
       } else {
-        revng_assert(not VarDeclCall->getType()->isAggregateType());
+        Out << B.getKeyword(PTMLKeyword::If) << " ("
+            << getToken(Branch->getCondition()) << ") ";
+        emitGoto(Branch->getSuccessor(0));
+        Out << B.getKeyword(PTMLKeyword::Else) << " ";
+        emitGoto(Branch->getSuccessor(1));
+      }
+    } else if (auto *Switch = dyn_cast<llvm::SwitchInst>(Terminator)) {
+      Out << B.getKeyword(PTMLKeyword::Switch) << " ("
+          << getToken(Switch->getCondition()) << ") ";
+      Scope TheScope(Out);
+      for (const auto &Case : Switch->cases()) {
+        Out << B.getKeyword(PTMLKeyword::Case) << " "
+            << B.getNumber(Case.getCaseValue()->getValue()) << ": ";
+        emitGoto(Case.getCaseSuccessor());
       }
+      Out << B.getKeyword(PTMLKeyword::Default) << ": ";
+      emitGoto(Switch->getDefaultDest());
+    } else {
+      // Returns have already been emitted along with the other statements
+      revng_assert(isa<llvm::ReturnInst>(Terminator)
+                   or isa<llvm::UnreachableInst>(Terminator));
     }
   }
+}
+
+RecursiveCoroutine<void> CCodeGenerator::emitGHASTNode(const ASTNode *N) {
+  if (N == nullptr)
+    rc_return;
+
+  auto VarToDeclareIt = VariablesToDeclare.find(N);
+  if (VarToDeclareIt != VariablesToDeclare.end())
+    emitVariableDeclarations(VarToDeclareIt->second);
 
   revng_log(VisitLog, "|__ GHAST Node " << N->getID());
   LoggerIndent Indent{ VisitLog };
@@ -1747,7 +2007,7 @@ RecursiveCoroutine<void> CCodeGenerator::emitGHASTNode(const ASTNode *N) {
     // is used by nested switches inside loops to break out of the loop
     if (Switch->needsStateVariable()) {
       revng_assert(Switch->needsLoopBreakDispatcher());
-      StringToken NewVarName = NameGenerator.nextSwitchStateVar();
+      std::string NewVarName = NameGenerator.nextSwitchStateVar();
       std::string SwitchStateVar = getVariableLocationReference(NewVarName,
                                                                 ModelFunction,
                                                                 B);
@@ -1787,6 +2047,36 @@ RecursiveCoroutine<void> CCodeGenerator::emitGHASTNode(const ASTNode *N) {
     }
     revng_assert(not SwitchVarToken.empty());
 
+    // The labels are printed as signed values if the condition is signed
+    bool IsSigned = false;
+    model::QualifiedType PeeledType = peelConstAndTypedefs(SwitchVarType);
+    if (PeeledType.isPrimitive()) {
+      const model::Type *Unqualified = PeeledType.UnqualifiedType().getConst();
+      auto *Primitive = cast<model::PrimitiveType>(Unqualified);
+      using model::PrimitiveTypeKind::Signed;
+      IsSigned = Primitive->PrimitiveKind() == Signed;
+    }
+
+    unsigned SwitchVarWidth = 64;
+    if (SwitchVar)
+      SwitchVarWidth = cast<llvm::IntegerType>(SwitchVar->getType())
+                         ->getBitWidth();
+
+    const auto GetCaseLabel = [this, SwitchVar, SwitchVarWidth, IsSigned](
+                                uint64_t CaseVal) {
+      if (not SwitchVar)
+        return B.getNumber(CaseVal);
+
+      // Don't go through llvm::ConstantInt::get, since the LLVMContext
+      // must not be touched while emitting C code.
+      llvm::APInt CaseConst(SwitchVarWidth, CaseVal);
+      // The minimum 64-bit signed value has no literal of a signed type
+      bool Signed = IsSigned
+                    and not(SwitchVarWidth == 64
+                            and CaseConst.isMinSignedValue());
+      return B.getNumber(CaseConst, 10, Signed);
+    };
+
     // Generate the switch statement
     Out << B.getKeyword(ptml::PTMLCBuilder::Keyword::Switch) + " ("
         << SwitchVarToken << ") ";
@@ -1803,19 +2093,17 @@ RecursiveCoroutine<void> CCodeGenerator::emitGHASTNode(const ASTNode *N) {
         }
 
         // Generate the case label(s) (multiple case labels might share the
-        // same body)
-        for (uint64_t CaseVal : Labels) {
-          Out << B.getKeyword(ptml::PTMLCBuilder::Keyword::Case) + " ";
-          if (SwitchVar) {
-            llvm::Type *SwitchVarT = SwitchVar->getType();
-            auto *IntType = cast<llvm::IntegerType>(SwitchVarT);
-            auto *CaseConst = llvm::ConstantInt::get(IntType, CaseVal);
-            // TODO: assigned the signedness based on the signedness of the
-            // condition
-            Out << B.getNumber(CaseConst->getValue());
-          } else {
-            Out << B.getNumber(CaseVal);
-          }
+        // same body). Runs of consecutive labels are emitted as a single GNU
+        // case range.
+        llvm::SmallVector<uint64_t, 8> LabelValues(Labels.begin(),
+                                                   Labels.end());
+        for (const CaseRange &Range : groupCaseLabels(std::move(LabelValues),
+                                                      SwitchVarWidth,
+                                                      MinCaseRangeSize)) {
+          Out << B.getKeyword(ptml::PTMLCBuilder::Keyword::Case) + " "
+              << GetCaseLabel(Range.First);
+          if (Range.Last != Range.First)
+            Out << " ... " << GetCaseLabel(Range.Last);
           Out << ":\n";
         }
 
@@ -1912,7 +2200,8 @@ static std::string getModelArgIdentifier(const model::Type *ModelFunctionType,
 }
 
 void CCodeGenerator::emitFunction(bool NeedsLocalStateVar,
-                                  InlineableTypesMap &StackTypes) {
+                                  bool EmitGotos,
+                                  const InlineableTypesMap &StackTypes) {
   revng_log(Log, "========= Emitting Function " << LLVMFunction.getName());
   revng_log(VisitLog, "========= Function " << LLVMFunction.getName());
   LoggerIndent Indent{ VisitLog };
@@ -1930,6 +2219,7 @@ void CCodeGenerator::emitFunction(bool NeedsLocalStateVar,
   // Set up the argument identifiers to be used in the function's body.
   for (const auto &Arg : LLVMFunction.args()) {
     std::string ArgString = getModelArgIdentifier(&Prototype, Arg);
+    NameGenerator.reserve(ArgString);
     TokenMap[&Arg] = getArgumentLocationReference(ArgString, ModelFunction, B);
   }
 
@@ -1957,7 +2247,7 @@ void CCodeGenerator::emitFunction(bool NeedsLocalStateVar,
         // This will contain the stack types that we can inline, since
         // there could be a stack type that is being used somewhere else,
         // so we do not want to inline it.
-        auto TheStackTypes = StackTypes.at(&ModelFunction);
+        const auto &TheStackTypes = StackTypes.at(&ModelFunction);
         if (TheStackTypes.contains(TheType) and !IsStackDefined) {
           IsStackDefined = true;
           std::map<model::QualifiedType, std::string> AdditionalTypeNames;
@@ -1995,38 +2285,45 @@ void CCodeGenerator::emitFunction(bool NeedsLocalStateVar,
           << LoopStateVarDeclaration << ";\n";
 
     // Recursively print the body of this function
-    emitGHASTNode(GHAST.getRoot());
+    if (EmitGotos)
+      emitGotoBody();
+    else
+      emitGHASTNode(GHAST.getRoot());
   }
 
   Out << "\n";
 }
 
-static std::string decompileFunction(FunctionMetadataCache &Cache,
-                                     const llvm::Function &LLVMFunc,
-                                     const ASTTree &CombedAST,
-                                     const Binary &Model,
-                                     const ASTVarDeclMap &VarToDeclare,
-                                     bool NeedsLocalStateVar,
-                                     InlineableTypesMap &StackTypes) {
-  std::string Result;
-
-  llvm::raw_string_ostream Out(Result);
+static EmissionCounters decompileFunction(FunctionMetadataCache &Cache,
+                                          const llvm::Function &LLVMFunc,
+                                          const ASTTree &CombedAST,
+                                          const Binary &Model,
+                                          const ASTVarDeclMap &VarToDeclare,
+                                          ModelTypesMap &&TypeMap,
+                                          bool NeedsLocalStateVar,
+                                          bool EmitGotos,
+                                          const InlineableTypesMap &StackTypes,
+                                          llvm::raw_ostream &Out) {
   ptml::PTMLCBuilder B;
 
-  CCodeGenerator
-    Backend(Cache, Model, LLVMFunc, CombedAST, VarToDeclare, Out, B);
-  Backend.emitFunction(NeedsLocalStateVar, StackTypes);
-  Out.flush();
-
-  return Result;
+  CCodeGenerator Backend(Cache,
+                         Model,
+                         LLVMFunc,
+                         CombedAST,
+                         VarToDeclare,
+                         std::move(TypeMap),
+                         Out,
+                         B);
+  Backend.emitFunction(NeedsLocalStateVar, EmitGotos, StackTypes);
+  return Backend.getCounters();
 }
 
 static bool hasLoopDispatchers(const ASTTree &GHAST) {
   return needsLoopVar(GHAST.getRoot());
 }
 
-static ASTVarDeclMap computeVariableDeclarationScope(const llvm::Function &F,
-                                                     const ASTTree &GHAST) {
+static PendingVariableListType
+collectVariablesToDeclare(const llvm::Function &F) {
   PendingVariableListType PendingVariables;
   for (const BasicBlock &BB : F) {
     for (const Instruction &I : BB) {
@@ -2051,70 +2348,815 @@ static ASTVarDeclMap computeVariableDeclarationScope(const llvm::Function &F,
     }
   }
 
+  return PendingVariables;
+}
+
+static ASTVarDeclMap computeVariableDeclarationScope(const llvm::Function &F,
+                                                     const ASTTree &GHAST) {
+  PendingVariableListType PendingVariables = collectVariablesToDeclare(F);
   return computeVarDeclMap(GHAST, PendingVariables);
 }
 
-using Container = revng::pipes::DecompileStringMap;
-void decompile(FunctionMetadataCache &Cache,
-               llvm::Module &Module,
-               const model::Binary &Model,
-               Container &DecompiledFunctions) {
-  TypeInlineHelper TheTypeInlineHelper(Model);
+namespace {
+
+/// Measurements collected while decompiling a single function
+struct FunctionTelemetry {
+  double RestructureMs = 0;
+  double BeautifyMs = 0;
+  double EmitMs = 0;
+  /// Number of RegionCFG nodes after inflate, summed over all the regions
+  unsigned InflatedRegionCFGNodes = 0;
+  size_t GHASTNodes = 0;
+  bool EmittedGotos = false;
+  /// Highest increase of the malloc'd bytes observed at phase boundaries. In
+  /// parallel mode this doesn't account for C emission.
+  size_t PeakMallocDelta = 0;
+  size_t InitialMallocUsage = 0;
+  size_t CCodeSize = 0;
+  EmissionCounters Emission;
+
+public:
+  void start() { InitialMallocUsage = llvm::sys::Process::GetMallocUsage(); }
+
+  void sampleMallocUsage() {
+    size_t Usage = llvm::sys::Process::GetMallocUsage();
+    if (Usage > InitialMallocUsage)
+      PeakMallocDelta = std::max(PeakMallocDelta, Usage - InitialMallocUsage);
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point Start) {
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+  return std::chrono::duration_cast<Milliseconds>(Clock::now() - Start).count();
+}
+
+/// Everything that is needed to emit the C code of an isolated function, once
+/// its GHAST has been built and beautified.
+struct FunctionToEmit {
+  const llvm::Function *F = nullptr;
+  ASTTree GHAST;
+  ASTVarDeclMap VariablesToDeclare;
+  /// The result of initModelTypes on F, moved into the CCodeGenerator
+  ModelTypesMap TypeMap;
+  bool NeedsLoopStateVar = false;
+  /// Set when the GHAST could not be built within the budget
+  bool EmitGotos = false;
+  std::string CCode;
+  /// The key used to store CCode in the DecompilationCache, if enabled
+  std::string CacheKey;
+  FunctionTelemetry Telemetry;
+};
+
+} // namespace
+
+/// Build and beautify the GHAST of \a F.
+static FunctionToEmit buildGHAST(const Binary &Model,
+                                 llvm::Function &F,
+                                 const RestructureBudget &Budget,
+                                 llvm::Task &T) {
+  FunctionToEmit Result;
+  Result.F = &F;
+
+  // If the budget is exhausted, fall back to emitting gotos, declaring all the
+  // variables at the top of the function
+  const auto FallBackToGotos = [&]() {
+    revng_log(Log, "Falling back to gotos for " << F.getName());
+    Result.GHAST = ASTTree();
+    Result.EmitGotos = true;
+    Result.Telemetry.EmittedGotos = true;
+    for (const llvm::CallInst *Call : collectVariablesToDeclare(F))
+      Result.VariablesToDeclare[nullptr].insert(Call);
+  };
+
+  // TODO: this will eventually become a GHASTContainer for revng pipeline.
+  //       Note that such a container cannot hold the GHAST alone: beautifyAST
+  //       also changes the IR the GHAST refers to (e.g., simplifyHybridNot
+  //       flips the predicates of the comparisons), so the container needs to
+  //       be produced together with the IR it has been computed on.
+  ASTTree &GHAST = Result.GHAST;
+
+  FunctionTelemetry &Telemetry = Result.Telemetry;
+  Telemetry.start();
+
+  // Generate the GHAST and beautify it.
+  {
+    T.advance("restructureCFG");
+    auto Start = Clock::now();
+    bool Success = restructureCFG(F, GHAST, Budget);
+    Telemetry.RestructureMs = millisecondsSince(Start);
+    Telemetry.InflatedRegionCFGNodes = InflatedNodesCounter;
+    Telemetry.sampleMallocUsage();
+    if (not Success) {
+      FallBackToGotos();
+      return Result;
+    }
+
+    // TODO: beautification should be optional, but at the moment it's not
+    // truly so (if disabled, things crash). We should strive to make it
+    // optional for real.
+    T.advance("beautifyAST");
+    Start = Clock::now();
+    Success = beautifyAST(Model, F, GHAST, &Budget);
+    Telemetry.BeautifyMs = millisecondsSince(Start);
+    Telemetry.GHASTNodes = GHAST.size();
+    Telemetry.sampleMallocUsage();
+    if (not Success) {
+      FallBackToGotos();
+      return Result;
+    }
+  }
+
+  if (Log.isEnabled()) {
+    GHAST.dumpASTOnFile(F.getName().str(),
+                        "ast-backend",
+                        "AST-during-c-codegen.dot");
+  }
+
+  Result.VariablesToDeclare = computeVariableDeclarationScope(F, GHAST);
+  Result.NeedsLoopStateVar = hasLoopDispatchers(GHAST);
+  return Result;
+}
+
+/// Build and beautify the GHAST of \a F, and compute all the information that
+/// is needed to emit its C code.
+///
+/// \note This mutates the IR of \a F and creates LLVM types, hence it must
+///       never run concurrently with anything else touching the same
+///       llvm::LLVMContext. On the other hand, emitting the C code of the
+///       result only reads the IR.
+static FunctionToEmit prepareFunction(FunctionMetadataCache &Cache,
+                                      const Binary &Model,
+                                      llvm::Function &F,
+                                      const RestructureBudget &Budget,
+                                      llvm::Task &T) {
+  FunctionToEmit Result = buildGHAST(Model, F, Budget, T);
+
+  // initModelTypes gets integer types from the LLVMContext, which is not
+  // thread-safe, hence it runs here rather than in the CCodeGenerator, which
+  // might run on a worker thread. This must happen after beautifyAST, which
+  // changes the IR.
+  Result.TypeMap = initModelTypes(Cache,
+                                  F,
+                                  llvmToModelFunction(Model, F),
+                                  Model,
+                                  /*PointersOnly=*/false);
+  return Result;
+}
+
+/// Emit the C code of \a ToEmit to \a Out.
+static void emitFunction(FunctionMetadataCache &Cache,
+                         const Binary &Model,
+                         const InlineableTypesMap &StackTypes,
+                         FunctionToEmit &ToEmit,
+                         llvm::raw_ostream &Out) {
+  TraceSpan Span("emitFunction", "c-backend", ToEmit.F->getName());
+  auto Start = Clock::now();
+  uint64_t StartOffset = Out.tell();
+  ToEmit.Telemetry.Emission = decompileFunction(Cache,
+                                                *ToEmit.F,
+                                                ToEmit.GHAST,
+                                                Model,
+                                                ToEmit.VariablesToDeclare,
+                                                std::move(ToEmit.TypeMap),
+                                                ToEmit.NeedsLoopStateVar,
+                                                ToEmit.EmitGotos,
+                                                StackTypes,
+                                                Out);
+  ToEmit.Telemetry.EmitMs = millisecondsSince(Start);
+  ToEmit.Telemetry.CCodeSize = Out.tell() - StartOffset;
+}
+
+/// Emit the C code of \a ToEmit into ToEmit.CCode.
+static void emitFunction(FunctionMetadataCache &Cache,
+                         const Binary &Model,
+                         const InlineableTypesMap &StackTypes,
+                         FunctionToEmit &ToEmit) {
+  llvm::raw_string_ostream Out(ToEmit.CCode);
+  emitFunction(Cache, Model, StackTypes, ToEmit, Out);
+  Out.flush();
+}
+
+using llvm::cl::cat;
+using llvm::cl::desc;
+using llvm::cl::init;
+
+static llvm::cl::opt<unsigned>
+  DecompileThreads("decompile-threads",
+                   desc("Number of threads emitting C code (0 means one per "
+                        "core, 1 disables parallel emission)"),
+                   init(1),
+                   cat(MainCategory));
+
+static llvm::cl::opt<std::string>
+  CacheDirectory("decompile-cache-dir",
+                 desc("Directory where the C code of each function is cached, "
+                      "keyed on a hash of its inputs"),
+                 llvm::cl::value_desc("directory"),
+                 cat(MainCategory));
+
+static llvm::cl::opt<unsigned>
+  MemoryCacheMiB("decompile-memory-cache-mb",
+                 desc("MiB of C code kept in memory across runs of the "
+                      "decompile pipes, keyed like -decompile-cache-dir (0 "
+                      "disables it)"),
+                 init(0),
+                 cat(MainCategory));
+
+static llvm::cl::opt<bool>
+  CompressMemoryCache("decompile-compress-memory-cache",
+                      desc("Keep the C code cached by "
+                           "-decompile-memory-cache-mb compressed, so that the "
+                           "same budget holds several times more functions"),
+                      init(false),
+                      cat(MainCategory));
+
+static llvm::cl::opt<unsigned>
+  FunctionTimeout("decompile-function-timeout-ms",
+                  desc("Time after which building the GHAST of a function is "
+                       "abandoned and gotos are emitted instead (0 means no "
+                       "limit)"),
+                  init(0),
+                  cat(MainCategory));
+
+static llvm::cl::opt<unsigned>
+  MaxRegionCFGNodes("decompile-max-regioncfg-nodes",
+                    desc("Number of RegionCFG nodes after inflate above which "
+                         "building the GHAST of a function is abandoned and "
+                         "gotos are emitted instead (0 means no limit)"),
+                    init(0),
+                    cat(MainCategory));
+
+static llvm::cl::opt<unsigned>
+  MaxDuplicatedWeight("decompile-max-duplicated-weight",
+                      desc("Total weight (roughly, number of instructions) "
+                           "of the nodes duplicated by combing above which "
+                           "building the GHAST of a function is abandoned "
+                           "and gotos are emitted instead (0 means no limit)"),
+                      init(0),
+                      cat(MainCategory));
+
+static llvm::cl::opt<unsigned>
+  BatchMemoryMiB("decompile-batch-memory-mb",
+                 desc("MiB of memory that the GHASTs waiting for parallel C "
+                      "emission can take: when exceeded, the functions "
+                      "prepared so far are emitted before preparing the "
+                      "next one (0 means no limit)"),
+                 init(0),
+                 cat(MainCategory));
+
+static llvm::cl::opt<bool>
+  Deduplicate("decompile-deduplicate",
+              desc("Restructure and emit only once the functions that are "
+                   "the same besides their name and addresses, e.g., "
+                   "statically linked copies, and reuse their C code for "
+                   "the others"),
+              init(false),
+              cat(MainCategory));
+
+static RestructureBudget makeBudget() {
+  RestructureBudget Result;
+  if (FunctionTimeout != 0) {
+    auto Timeout = std::chrono::milliseconds(FunctionTimeout);
+    Result.Deadline = RestructureBudget::Clock::now() + Timeout;
+  }
+  if (MaxRegionCFGNodes != 0)
+    Result.MaxInflatedNodes = MaxRegionCFGNodes;
+  if (MaxDuplicatedWeight != 0)
+    Result.MaxDuplicatedWeight = MaxDuplicatedWeight;
+  return Result;
+}
+
+/// \return the serialized values of the options that affect the C code of a
+///         function, which are part of the keys of the DecompilationCache.
+///
+/// The budgets decide which functions fall back to gotos: without them in the
+/// key, a run with a tighter budget would be served the structured C code
+/// stored by a previous run, and its output would depend on the state of the
+/// cache. -decompile-function-timeout-ms is left out, since the time taken is
+/// not a property of the inputs, and functions hitting it are never stored.
+static std::string serializeBudgetOptions() {
+  std::string Result;
+  for (const llvm::cl::opt<unsigned> *Option :
+       { &MaxRegionCFGNodes, &MaxDuplicatedWeight }) {
+    Result += Option->ArgStr;
+    Result += '=';
+    Result += std::to_string(Option->getValue());
+    Result += '\n';
+  }
+  return Result;
+}
+
+static llvm::cl::opt<std::string>
+  TelemetryPath("decompile-telemetry-output",
+                desc("Path of a CSV file where per-function timings and sizes "
+                     "of the decompile step are written"),
+                llvm::cl::value_desc("path"),
+                cat(MainCategory));
+
+static MetaAddress getEntry(const llvm::Function &F) {
+  return getMetaAddressMetadata(&F, "revng.function.entry");
+}
+
+static void printTelemetryHeader(llvm::raw_ostream &OS) {
+  OS << "function,entry,restructure_ms,beautify_ms,emit_ms,"
+        "regioncfg_nodes,ghast_nodes,gotos,peak_malloc_delta,c_size,"
+        "get_token_calls,token_map_hits,cast_exprs,parentheses\n";
+}
+
+static void printTelemetry(llvm::raw_ostream &OS, const FunctionToEmit &F) {
+  const FunctionTelemetry &T = F.Telemetry;
+  OS << F.F->getName() << "," << getEntry(*F.F).toString() << ","
+     << llvm::format("%.3f,%.3f,%.3f,", T.RestructureMs, T.BeautifyMs, T.EmitMs)
+     << T.InflatedRegionCFGNodes << "," << T.GHASTNodes << ","
+     << T.EmittedGotos << "," << T.PeakMallocDelta << "," << T.CCodeSize
+     << "," << T.Emission.GetTokenCalls << "," << T.Emission.TokenMapHits << ","
+     << T.Emission.CastExprs << "," << T.Emission.Parentheses << "\n";
+}
+
+static const std::set<const model::Type *> &
+getInlinedStackTypes(const Binary &Model,
+                     const llvm::Function &F,
+                     const InlineableTypesMap &StackTypes) {
+  static const std::set<const model::Type *> NoStackTypes;
+  auto It = StackTypes.find(llvmToModelFunction(Model, F));
+  return It != StackTypes.end() ? It->second : NoStackTypes;
+}
+
+static std::string getCacheKey(DecompilationCache &OutputCache,
+                               FunctionMetadataCache &Cache,
+                               const Binary &Model,
+                               const llvm::Function &F,
+                               const InlineableTypesMap &StackTypes) {
+  return OutputCache.computeKey(Cache,
+                                F,
+                                getInlinedStackTypes(Model, F, StackTypes));
+}
+
+/// \return the cache enabled by -decompile-cache-dir and
+///         -decompile-memory-cache-mb, if any
+static std::optional<DecompilationCache> makeOutputCache(const Binary &Model) {
+  std::optional<DecompilationCache> Result;
+  if (not CacheDirectory.empty() or MemoryCacheMiB != 0) {
+    size_t MemoryBudget = size_t(MemoryCacheMiB) * 1024 * 1024;
+    Result.emplace(Model,
+                   CacheDirectory,
+                   MemoryBudget,
+                   CompressMemoryCache,
+                   serializeBudgetOptions());
+  }
+  return Result;
+}
+
+/// A rough estimate of the time it takes to emit the C code of \a ToEmit,
+/// which is dominated by the visit of the GHAST and of the instructions.
+static size_t predictEmissionCost(const FunctionToEmit &ToEmit) {
+  return ToEmit.F->getInstructionCount() + ToEmit.Telemetry.GHASTNodes;
+}
+
+/// Emit the C code for all the functions in \a Batch using the workers of
+/// \a Pool, each with its own FunctionMetadataCache.
+///
+/// The most expensive functions are handed out first, so that a large function
+/// does not start last and keep a single worker busy while the others idle.
+/// Results stay in \a Batch, hence the output order is not affected.
+static void emitBatchInParallel(llvm::ThreadPool &Pool,
+                                llvm::MutableArrayRef<FunctionMetadataCache *>
+                                  Caches,
+                                const Binary &Model,
+                                const InlineableTypesMap &StackTypes,
+                                std::vector<FunctionToEmit> &Batch) {
+  llvm::SmallVector<std::pair<size_t, size_t>, 64> Schedule;
+  for (size_t I = 0; I < Batch.size(); ++I)
+    Schedule.emplace_back(predictEmissionCost(Batch[I]), I);
+  std::stable_sort(Schedule.begin(),
+                   Schedule.end(),
+                   [](const auto &LHS, const auto &RHS) {
+                     return LHS.first > RHS.first;
+                   });
+
+  std::atomic<size_t> NextIndex = 0;
+  for (FunctionMetadataCache *WorkerCache : Caches) {
+    Pool.async([&, WorkerCache]() {
+      for (size_t I = NextIndex++; I < Schedule.size(); I = NextIndex++) {
+        FunctionToEmit &ToEmit = Batch[Schedule[I].second];
+        emitFunction(*WorkerCache, Model, StackTypes, ToEmit);
+      }
+    });
+  }
+  Pool.wait();
+}
+
+using EntryAndFunction = std::pair<MetaAddress, llvm::Function *>;
+
+/// \return the isolated functions that directly call, or are directly called
+///         by, one of \a Functions, and are not in \a Functions themselves, in
+///         order of entry address
+static std::vector<EntryAndFunction>
+collectCallNeighbors(llvm::ArrayRef<EntryAndFunction> Functions) {
+  llvm::SmallPtrSet<const llvm::Function *, 16> Seen;
+  for (const auto &[Entry, F] : Functions)
+    Seen.insert(F);
+
+  std::vector<EntryAndFunction> Result;
+  const auto Add = [&](llvm::Function *F) {
+    if (F == nullptr or F->empty() or not FunctionTags::Isolated.isTagOf(F))
+      return;
+
+    if (Seen.insert(F).second)
+      Result.emplace_back(getEntry(*F), F);
+  };
+
+  for (const auto &[Entry, F] : Functions) {
+    for (llvm::Instruction &I : llvm::instructions(F))
+      if (llvm::CallInst *Call = getCallToIsolatedFunction(&I))
+        Add(Call->getCalledFunction());
+
+    for (llvm::User *U : F->users())
+      if (auto *Call = llvm::dyn_cast<llvm::CallInst>(U))
+        if (Call->getCalledFunction() == F)
+          Add(Call->getFunction());
+  }
+
+  llvm::sort(Result, [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  });
+  return Result;
+}
+
+/// Decompile all the isolated functions in \a Module.
+///
+/// If \a DirectOut is not nullptr, the C code is written there, each function
+/// followed by a newline, and \a Sink is ignored. If possible, the C code is
+/// emitted directly on the stream, without materializing it in memory.
+static void decompileImpl(FunctionMetadataCache &Cache,
+                          llvm::Module &Module,
+                          const model::Binary &Model,
+                          const std::set<MetaAddress> &Targets,
+                          DecompiledFunctionSink Sink,
+                          llvm::raw_ostream *DirectOut) {
+  const auto PushCCode = [&](const llvm::Function &F, std::string &&CCode) {
+    if (DirectOut != nullptr)
+      *DirectOut << CCode << '\n';
+    else
+      Sink(getEntry(F), std::move(CCode));
+  };
+
+  auto TheTypeInlineHelper = TypeInlineHelper::get(Model);
 
   // Get all Stack types and all the inlinable types reachable from it,
   // since we want to emit forward declarations for all of them.
-  auto StackTypes = TheTypeInlineHelper.findStackTypesPerFunction(Model);
-
-  auto
-    T = llvm::make_task_on_set(llvm::make_address_range(FunctionTags::Isolated
-                                                          .functions(&Module)),
-                               "decompile");
+  const auto &StackTypes = TheTypeInlineHelper->getStackTypesPerFunction();
 
+  // Decompile functions in order of entry address, so that the sink can
+  // consume them in that same order.
+  std::vector<EntryAndFunction> Functions;
   for (llvm::Function &F : FunctionTags::Isolated.functions(&Module)) {
-    T.advance(&F,
-              llvm::Twine("decompile Function: ") + llvm::Twine(F.getName()));
-
     if (F.empty())
       continue;
 
-    llvm::Task T2(3,
+    MetaAddress Entry = getEntry(F);
+    if (not Targets.empty() and not Targets.contains(Entry))
+      continue;
+
+    Functions.emplace_back(Entry, &F);
+  }
+  llvm::sort(Functions, [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  });
+
+  llvm::Task T(Functions.size(), "decompile");
+
+  std::optional<DecompilationCache> OutputCache = makeOutputCache(Model);
+
+  std::optional<FunctionDeduplicator> Deduplicator;
+  if (Deduplicate) {
+    // Used only to serialize the inputs of each function, never stores
+    DecompilationCache Inputs(Model,
+                              "",
+                              0,
+                              /* CompressInMemory */ false,
+                              serializeBudgetOptions());
+    const auto SerializeInputs = [&](const llvm::Function &F) {
+      return Inputs.serializeInputs(Cache,
+                                    F,
+                                    getInlinedStackTypes(Model, F, StackTypes));
+    };
+
+    std::vector<const llvm::Function *> ToGroup;
+    for (const auto &[Entry, F] : Functions)
+      ToGroup.push_back(F);
+    Deduplicator.emplace(Model, ToGroup, SerializeInputs);
+  }
+
+  // Look up F in OutputCache, if enabled: on a hit, return true after pushing
+  // the cached C code, otherwise set Key to where the C code should be stored.
+  const auto PushCachedCCode = [&](const llvm::Function &F, std::string &Key) {
+    if (not OutputCache)
+      return false;
+
+    Key = getCacheKey(*OutputCache, Cache, Model, F, StackTypes);
+    std::optional<std::string> CCode = OutputCache->lookup(Key);
+    if (not CCode)
+      return false;
+
+    if (Deduplicator) {
+      Deduplicator->record(F, *CCode);
+      Deduplicator->skip(F);
+    }
+    PushCCode(F, std::move(*CCode));
+    return true;
+  };
+
+  // If F is the same as a function decompiled before it, push the C code of
+  // the latter, rewritten for F, and return true
+  const auto PushDuplicateCCode = [&](const llvm::Function &F,
+                                      const std::string &Key) {
+    if (not Deduplicator)
+      return false;
+
+    std::optional<std::string> CCode = Deduplicator->getDuplicateCCode(F);
+    if (not CCode)
+      return false;
+
+    if (OutputCache)
+      OutputCache->store(Key, *CCode);
+    PushCCode(F, std::move(*CCode));
+    return true;
+  };
+
+  std::optional<llvm::raw_fd_ostream> TelemetryStream;
+  if (not TelemetryPath.empty()) {
+    std::error_code EC;
+    TelemetryStream.emplace(TelemetryPath, EC, llvm::sys::fs::OF_Text);
+    if (EC)
+      revng_abort("Cannot open the decompile telemetry output file");
+    printTelemetryHeader(*TelemetryStream);
+  }
+
+  unsigned NumThreads = DecompileThreads;
+  if (NumThreads == 0)
+    NumThreads = llvm::hardware_concurrency().compute_thread_count();
+
+  if (NumThreads <= 1) {
+    for (auto &[Entry, FunctionPtr] : Functions) {
+      llvm::Function &F = *FunctionPtr;
+      T.advance(llvm::Twine("decompile Function: ")
+                + llvm::Twine(F.getName()));
+
+      std::string CacheKey;
+      if (PushCachedCCode(F, CacheKey) or PushDuplicateCCode(F, CacheKey))
+        continue;
+
+      llvm::Task T2(3,
+                    llvm::Twine("decompile Function: ")
+                      + llvm::Twine(F.getName()));
+
+      FunctionToEmit ToEmit = prepareFunction(Cache,
+                                              Model,
+                                              F,
+                                              makeBudget(),
+                                              T2);
+
+      // Generated C code for F. If it doesn't have to be stored in the
+      // cache, nor reused for its duplicates, write it out directly, if
+      // possible.
+      T2.advance("decompileFunction");
+      bool Direct = DirectOut != nullptr and not OutputCache
+                    and not (Deduplicator and Deduplicator->hasDuplicates(F));
+      if (Direct) {
+        emitFunction(Cache, Model, StackTypes, ToEmit, *DirectOut);
+        *DirectOut << '\n';
+      } else {
+        emitFunction(Cache, Model, StackTypes, ToEmit);
+      }
+      ToEmit.Telemetry.sampleMallocUsage();
+
+      if (TelemetryStream)
+        printTelemetry(*TelemetryStream, ToEmit);
+
+      if (Direct)
+        continue;
+
+      // The goto fallback depends on the budget, not only on the inputs
+      if (OutputCache and not ToEmit.EmitGotos)
+        OutputCache->store(CacheKey, ToEmit.CCode);
+      if (Deduplicator and not ToEmit.EmitGotos)
+        Deduplicator->record(F, ToEmit.CCode);
+
+      // Push the C code into
+      PushCCode(F, std::move(ToEmit.CCode));
+    }
+    return;
+  }
+
+  // Building the GHAST mutates the IR, so it's always done serially. On the
+  // other hand, C emission only reads the IR and the model, so it's handed
+  // over to a pool of workers, each with its own FunctionMetadataCache.
+  // Functions are processed in batches, so that only a bounded number of
+  // GHASTs is alive at any given time. The results are merged in the same
+  // order as the serial path, so the output is identical.
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  std::vector<std::unique_ptr<FunctionMetadataCache>> WorkerCaches;
+  llvm::SmallVector<FunctionMetadataCache *, 16> Caches = { &Cache };
+  for (unsigned I = 1; I < NumThreads; ++I) {
+    WorkerCaches.push_back(std::make_unique<FunctionMetadataCache>());
+    Caches.push_back(WorkerCaches.back().get());
+  }
+
+  const size_t BatchSize = 8 * NumThreads;
+  std::vector<FunctionToEmit> Batch;
+  Batch.reserve(BatchSize);
+
+  // The first batch is smaller, so that the first functions are handed over
+  // to the sink without waiting for a whole batch to be restructured
+  size_t CurrentBatchSize = NumThreads;
+
+  // The malloc'd bytes when the current batch started, to keep the memory
+  // taken by the pending GHASTs within BatchMemoryMiB
+  size_t BatchStartUsage = llvm::sys::Process::GetMallocUsage();
+  const auto IsBatchOverBudget = [&]() {
+    if (BatchMemoryMiB == 0)
+      return false;
+
+    size_t Usage = llvm::sys::Process::GetMallocUsage();
+    size_t Budget = size_t(BatchMemoryMiB) * 1024 * 1024;
+    return Usage > BatchStartUsage and Usage - BatchStartUsage > Budget;
+  };
+
+  const auto FlushBatch = [&]() {
+    emitBatchInParallel(Pool, Caches, Model, StackTypes, Batch);
+    for (FunctionToEmit &ToEmit : Batch) {
+      if (TelemetryStream)
+        printTelemetry(*TelemetryStream, ToEmit);
+      if (OutputCache and not ToEmit.EmitGotos)
+        OutputCache->store(ToEmit.CacheKey, ToEmit.CCode);
+      if (Deduplicator and not ToEmit.EmitGotos)
+        Deduplicator->record(*ToEmit.F, ToEmit.CCode);
+      PushCCode(*ToEmit.F, std::move(ToEmit.CCode));
+    }
+    Batch.clear();
+    CurrentBatchSize = BatchSize;
+    BatchStartUsage = llvm::sys::Process::GetMallocUsage();
+  };
+
+  for (auto &[Entry, FunctionPtr] : Functions) {
+    llvm::Function &F = *FunctionPtr;
+    T.advance(llvm::Twine("decompile Function: ") + llvm::Twine(F.getName()));
+
+    std::string CacheKey;
+    if (PushCachedCCode(F, CacheKey))
+      continue;
+
+    if (Deduplicator and Deduplicator->isDuplicate(F)) {
+      // If the first function of the group of F is in the pending batch, its
+      // C code is not available yet
+      const llvm::Function *Representative = Deduplicator->getRepresentative(F);
+      const auto IsRepresentative = [Representative](const FunctionToEmit &E) {
+        return E.F == Representative;
+      };
+      if (llvm::any_of(Batch, IsRepresentative))
+        FlushBatch();
+      if (PushDuplicateCCode(F, CacheKey))
+        continue;
+    }
+
+    llvm::Task T2(2,
                   llvm::Twine("decompile Function: ")
                     + llvm::Twine(F.getName()));
 
-    // TODO: this will eventually become a GHASTContainer for revng pipeline
-    ASTTree GHAST;
+    Batch.push_back(prepareFunction(Cache, Model, F, makeBudget(), T2));
+    Batch.back().CacheKey = std::move(CacheKey);
 
-    // Generate the GHAST and beautify it.
-    {
-      T2.advance("restructureCFG");
-      restructureCFG(F, GHAST);
-      // TODO: beautification should be optional, but at the moment it's not
-      // truly so (if disabled, things crash). We should strive to make it
-      // optional for real.
-      T2.advance("beautifyAST");
-      beautifyAST(Model, F, GHAST);
-    }
+    // A function that alone exceeds the budget is emitted in a batch of its
+    // own, i.e., as in the serial path
+    if (Batch.size() >= CurrentBatchSize or IsBatchOverBudget())
+      FlushBatch();
+  }
 
-    T2.advance("decompileFunction");
-    if (Log.isEnabled()) {
-      GHAST.dumpASTOnFile(F.getName().str(),
-                          "ast-backend",
-                          "AST-during-c-codegen.dot");
+  FlushBatch();
+}
+
+void decompile(FunctionMetadataCache &Cache,
+               llvm::Module &Module,
+               const model::Binary &Model,
+               DecompiledFunctionSink Sink,
+               const std::set<MetaAddress> &Targets) {
+  decompileImpl(Cache, Module, Model, Targets, Sink, nullptr);
+}
+
+void decompile(FunctionMetadataCache &Cache,
+               llvm::Module &Module,
+               const model::Binary &Model,
+               llvm::raw_ostream &Out,
+               const std::set<MetaAddress> &Targets) {
+  const auto Unused = [](const MetaAddress &, std::string &&) {
+    revng_abort();
+  };
+  decompileImpl(Cache, Module, Model, Targets, Unused, &Out);
+}
+
+void decompile(FunctionMetadataCache &Cache,
+               llvm::Module &Module,
+               const model::Binary &Model,
+               revng::pipes::DecompileStringMap &DecompiledFunctions,
+               const std::set<MetaAddress> &Targets) {
+  // Each function is published in the container as soon as it's ready, and
+  // its entry is reported, so that clients can consume partial results
+  size_t Published = 0;
+  const auto Insert = [&DecompiledFunctions,
+                       &Published,
+                       &Targets](const MetaAddress &Entry,
+                                 std::string &&CCode) {
+    DecompiledFunctions.insert_or_assign(Entry, std::move(CCode));
+    ++Published;
+    if (Targets.empty()) {
+      revng_log(ProgressLog, "decompiled " << Entry.toString());
+    } else {
+      revng_log(ProgressLog,
+                "decompiled " << Entry.toString() << " (" << Published << "/"
+                              << Targets.size() << ")");
     }
+  };
+  decompile(Cache, Module, Model, Insert, Targets);
+}
+
+void prefetchCallNeighbors(llvm::Module &Module,
+                           const model::Binary &Model,
+                           const std::set<MetaAddress> &Around) {
+  std::optional<DecompilationCache> OutputCache = makeOutputCache(Model);
+  if (not OutputCache)
+    return;
+
+  std::vector<EntryAndFunction> Functions;
+  for (llvm::Function &F : FunctionTags::Isolated.functions(&Module))
+    if (not F.empty() and Around.contains(getEntry(F)))
+      Functions.emplace_back(getEntry(F), &F);
+
+  std::vector<EntryAndFunction> Neighbors = collectCallNeighbors(Functions);
+  if (Neighbors.empty())
+    return;
+
+  // Restructuring mutates the IR, work on a copy so that the module the
+  // pipeline serves the next requests from is left untouched. Only the
+  // neighbors are cloned: the other functions become declarations, while the
+  // constant globals keep their initializer, which their C code depends upon.
+  llvm::SmallPtrSet<const llvm::GlobalValue *, 16> ToClone;
+  for (const auto &[Entry, F] : Neighbors)
+    ToClone.insert(F);
+
+  llvm::ValueToValueMapTy Map;
+  auto ShouldCloneDefinition = [&ToClone](const llvm::GlobalValue *GV) {
+    if (const auto *Variable = llvm::dyn_cast<llvm::GlobalVariable>(GV))
+      return Variable->isConstant();
+    return ToClone.contains(GV);
+  };
+  auto Clone = llvm::CloneModule(Module, Map, ShouldCloneDefinition);
+
+  // CloneModule drops the metadata of the definitions it turns into
+  // declarations, but the entry and the tags of the callees are still needed
+  for (const llvm::Function &F : Module) {
+    if (F.isDeclaration() or ToClone.contains(&F))
+      continue;
 
-    // Generated C code for F
-    auto VariablesToDeclare = computeVariableDeclarationScope(F, GHAST);
-    auto NeedsLoopStateVar = hasLoopDispatchers(GHAST);
-    std::string CCode = decompileFunction(Cache,
-                                          F,
-                                          GHAST,
-                                          Model,
-                                          VariablesToDeclare,
-                                          NeedsLoopStateVar,
-                                          StackTypes);
-
-    // Push the C code into
-    MetaAddress Key = getMetaAddressMetadata(&F, "revng.function.entry");
-    DecompiledFunctions.insert_or_assign(Key, std::move(CCode));
+    auto *Declaration = llvm::cast<llvm::Function>(Map[&F]);
+    llvm::SmallVector<std::pair<unsigned, llvm::MDNode *>, 4> Attachments;
+    F.getAllMetadata(Attachments);
+    for (const auto &[Kind, Node] : Attachments)
+      Declaration->setMetadata(Kind, llvm::MapMetadata(Node, Map));
+  }
+
+  auto TheTypeInlineHelper = TypeInlineHelper::get(Model);
+  const auto &StackTypes = TheTypeInlineHelper->getStackTypesPerFunction();
+  FunctionMetadataCache Cache;
+
+  // Compute all the keys before restructuring any function, so that they
+  // match the ones computed on the untouched IR of a later request
+  std::vector<std::pair<llvm::Function *, std::string>> ToPrefetch;
+  for (const auto &[Entry, Original] : Neighbors) {
+    auto *F = llvm::cast<llvm::Function>(Map[Original]);
+    std::string Key = getCacheKey(*OutputCache, Cache, Model, *F, StackTypes);
+    if (not OutputCache->lookup(Key))
+      ToPrefetch.emplace_back(F, std::move(Key));
+  }
+
+  llvm::Task T(ToPrefetch.size(), "prefetch neighbors");
+  for (auto &[F, Key] : ToPrefetch) {
+    T.advance(llvm::Twine("prefetch Function: ") + llvm::Twine(F->getName()));
+
+    llvm::Task T2(3,
+                  llvm::Twine("prefetch Function: ")
+                    + llvm::Twine(F->getName()));
+    FunctionToEmit ToEmit = prepareFunction(Cache,
+                                            Model,
+                                            *F,
+                                            makeBudget(),
+                                            T2);
+
+    T2.advance("decompileFunction");
+    emitFunction(Cache, Model, StackTypes, ToEmit);
+    if (not ToEmit.EmitGotos)
+      OutputCache->store(Key, ToEmit.CCode);
   }
 }
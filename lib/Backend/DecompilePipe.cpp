@@ -2,29 +2,108 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/Location.h"
+#include "revng/Pipeline/Option.h"
+#include "revng/Pipeline/RegisterAnalysis.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/StringMap.h"
+#include "revng/Support/CommandLine.h"
 
 #include "revng-c/Backend/DecompileFunction.h"
 #include "revng-c/Backend/DecompilePipe.h"
 #include "revng-c/Pipes/Kinds.h"
+#include "revng-c/Pipes/Ranks.h"
+#include "revng-c/Support/MemoryMetrics.h"
+#include "revng-c/Support/TraceSpan.h"
+
+#include "FunctionCapture.h"
+
+using namespace llvm::cl;
+
+static list<std::string> CaptureEntries("decompile-capture",
+                                        desc("Comma-separated list of entry "
+                                             "addresses of functions to "
+                                             "capture in a self-contained "
+                                             "bundle, to replay their "
+                                             "decompilation alone"),
+                                        CommaSeparated,
+                                        cat(MainCategory));
+
+static opt<std::string> CaptureDirectory("decompile-capture-dir",
+                                         desc("Directory where the bundles "
+                                              "of -decompile-capture are "
+                                              "written"),
+                                         value_desc("path"),
+                                         init("."),
+                                         cat(MainCategory));
 
 namespace revng::pipes {
 
 using namespace pipeline;
 static RegisterDefaultConstructibleContainer<DecompileStringMap> Reg;
 
+std::set<MetaAddress> getFunctionsToDecompile(pipeline::LLVMContainer &IR) {
+  std::set<MetaAddress> Result;
+  for (const pipeline::Target &Target : IR.enumerate()) {
+    if (&Target.getKind() != &kinds::StackAccessesSegregated)
+      continue;
+
+    const auto &PathComponents = Target.getPathComponents();
+    revng_assert(PathComponents.size() == 1);
+    Result.insert(MetaAddress::fromString(PathComponents[0]));
+  }
+
+  return Result;
+}
+
 void Decompile::run(const pipeline::ExecutionContext &Ctx,
                     pipeline::LLVMContainer &IRContainer,
                     DecompileStringMap &DecompiledFunctions) {
 
+  // Only decompile the requested functions, so that the cost of a request
+  // for a single function doesn't depend on the size of the binary
+  std::set<MetaAddress> Targets = getFunctionsToDecompile(IRContainer);
+  if (Targets.empty())
+    return;
+
+  MemoryMetrics Metrics("decompile");
+  TraceSpan Span("decompile", "pass");
+
   llvm::Module &Module = IRContainer.getModule();
   const model::Binary &Model = *getModelFromContext(Ctx);
   FunctionMetadataCache Cache;
-  decompile(Cache, Module, Model, DecompiledFunctions);
+
+  if (not CaptureEntries.empty()) {
+    std::set<MetaAddress> ToCapture;
+    for (const std::string &Entry : CaptureEntries) {
+      MetaAddress Address = MetaAddress::fromString(Entry);
+      revng_assert(Address.isValid(), "Invalid -decompile-capture address");
+      if (Targets.contains(Address))
+        ToCapture.insert(Address);
+    }
+    captureFunctions(Cache, Module, Model, ToCapture, CaptureDirectory);
+  }
+
+  decompile(Cache, Module, Model, DecompiledFunctions, Targets);
+
+  if (isMemoryMetricsEnabled()) {
+    uint64_t Bytes = 0;
+    for (const auto &[Entry, CCode] : DecompiledFunctions)
+      Bytes += CCode.size();
+    Metrics.recordSize("decompiled_functions", Targets.size());
+    Metrics.recordSize("decompile_string_map_bytes", Bytes);
+  }
 }
 
 void Decompile::print(const pipeline::Context &Ctx,
@@ -34,6 +113,40 @@ void Decompile::print(const pipeline::Context &Ctx,
   OS << " decompile -m model.yml -i " << Names[0] << " -o " << Names[1];
 }
 
+/// Decompile the direct callers and callees of a function into the cache of the
+/// decompile pipe, to be run after the function itself has been requested.
+///
+/// This is an analysis, rather than part of the decompile pipe, so that the
+/// request for the function is never delayed, and so that clients (e.g., the
+/// daemon) can schedule it when they are idle, or not at all.
+struct PrefetchDecompilationAnalysis {
+  static constexpr auto Name = "prefetch-decompilation";
+
+  constexpr static std::tuple Options = { pipeline::Option("around", "") };
+
+  std::vector<std::vector<pipeline::Kind *>> AcceptedKinds = {
+    { &kinds::StackAccessesSegregated }
+  };
+
+  llvm::Error run(pipeline::ExecutionContext &Ctx,
+                  pipeline::LLVMContainer &IRContainer,
+                  std::string Around) {
+    auto Location = pipeline::locationFromString(revng::ranks::Function,
+                                                 Around);
+    if (not Location)
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "Invalid function location: " + Around);
+
+    MetaAddress Entry = std::get<0>(Location->at(revng::ranks::Function));
+    prefetchCallNeighbors(IRContainer.getModule(),
+                          *getModelFromContext(Ctx),
+                          { Entry });
+    return llvm::Error::success();
+  }
+};
+
 } // end namespace revng::pipes
 
 static pipeline::RegisterPipe<revng::pipes::Decompile> Y;
+static pipeline::RegisterAnalysis<revng::pipes::PrefetchDecompilationAnalysis>
+  PrefetchReg;
@@ -2,20 +2,32 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/Support/Assert.h"
+
 #include "revng-c/Backend/DecompileToSingleFile.h"
 
 using namespace revng::pipes;
 
+void printSingleCFileIncludes(llvm::raw_ostream &Out, ptml::PTMLCBuilder &B) {
+  Out << B.getIncludeQuote("types-and-globals.h")
+      << B.getIncludeQuote("helpers.h") << "\n";
+}
+
 void printSingleCFile(llvm::raw_ostream &Out,
                       ptml::PTMLCBuilder &B,
                       const DecompileStringMap &Functions,
                       const std::set<MetaAddress> &Targets) {
   auto Scope = B.getTag(ptml::tags::Div).scope(Out);
   // Print headers
-  Out << B.getIncludeQuote("types-and-globals.h")
-      << B.getIncludeQuote("helpers.h") << "\n";
+  printSingleCFileIncludes(Out, B);
 
   if (Targets.empty()) {
     // If Targets is empty print all the Functions' bodies
@@ -29,3 +41,54 @@ void printSingleCFile(llvm::raw_ostream &Out,
         Out << It->second << '\n';
   }
 }
+
+std::vector<std::vector<MetaAddress>>
+partitionCFunctions(const DecompileStringMap &Functions, unsigned ShardCount) {
+  revng_assert(ShardCount > 0);
+
+  // Place the largest functions first, each in the smallest shard so far:
+  // this keeps the shards balanced even if a few functions dominate the size
+  std::vector<std::pair<size_t, MetaAddress>> BySize;
+  for (const auto &[Entry, CFunction] : Functions)
+    BySize.emplace_back(CFunction.size(), Entry);
+  llvm::stable_sort(BySize, [](const auto &LHS, const auto &RHS) {
+    return LHS.first > RHS.first;
+  });
+
+  unsigned Count = std::min<size_t>(ShardCount, BySize.size());
+  std::vector<std::vector<MetaAddress>> Result(Count);
+
+  // Pairs of size and index of each shard, the smallest on top
+  using ShardSize = std::pair<size_t, unsigned>;
+  std::priority_queue<ShardSize, std::vector<ShardSize>, std::greater<>>
+    Smallest;
+  for (unsigned I = 0; I < Count; ++I)
+    Smallest.push({ 0, I });
+
+  for (const auto &[Size, Entry] : BySize) {
+    auto [ShardTotal, Index] = Smallest.top();
+    Smallest.pop();
+    Result[Index].push_back(Entry);
+    Smallest.push({ ShardTotal + Size, Index });
+  }
+
+  for (std::vector<MetaAddress> &Shard : Result)
+    llvm::sort(Shard);
+
+  return Result;
+}
+
+void printCFileShard(llvm::raw_ostream &Out,
+                     ptml::PTMLCBuilder &B,
+                     const DecompileStringMap &Functions,
+                     llvm::ArrayRef<MetaAddress> Shard) {
+  auto Scope = B.getTag(ptml::tags::Div).scope(Out);
+  printSingleCFileIncludes(Out, B);
+
+  auto End = Functions.end();
+  for (const MetaAddress &Entry : Shard) {
+    auto It = Functions.find(Entry);
+    revng_assert(It != End);
+    Out << It->second << '\n';
+  }
+}
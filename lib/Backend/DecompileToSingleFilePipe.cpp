@@ -2,11 +2,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <string>
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/RegisterContainerFactory.h"
 #include "revng/Pipes/FileContainer.h"
 #include "revng/Pipes/Kinds.h"
+#include "revng/Pipes/ModelGlobal.h"
 
+#include "revng-c/Backend/DecompileFunction.h"
 #include "revng-c/Backend/DecompileToSingleFile.h"
 #include "revng-c/Backend/DecompileToSingleFilePipe.h"
 #include "revng-c/Pipes/Kinds.h"
@@ -17,8 +24,12 @@ namespace revng::pipes {
 
 static pipeline::RegisterDefaultConstructibleContainer<DecompiledFileContainer>
   Reg;
+static pipeline::RegisterDefaultConstructibleContainer<
+  DirectlyDecompiledFileContainer>
+  DirectReg;
 
 using Container = DecompileStringMap;
+
 void DecompileToSingleFile::run(const pipeline::ExecutionContext &Ctx,
                                 const Container &DecompiledFunctions,
                                 DecompiledFileContainer &OutCFile) {
@@ -40,6 +51,50 @@ void DecompileToSingleFile::print(const pipeline::Context &Ctx,
   OS << " decompiled-yaml-to-c -i " << Names[0] << " -o " << Names[1];
 }
 
+void
+DecompileDirectlyToSingleFile::run(const pipeline::ExecutionContext &Ctx,
+                                   pipeline::LLVMContainer &IRContainer,
+                                   DirectlyDecompiledFileContainer &OutCFile) {
+  llvm::Module &Module = IRContainer.getModule();
+  const model::Binary &Model = *getModelFromContext(Ctx);
+  FunctionMetadataCache Cache;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream Out(OutCFile.getOrCreatePath(), EC);
+  if (EC)
+    revng_abort(EC.message().c_str());
+
+  ptml::PTMLCBuilder B;
+  {
+    auto Scope = B.getTag(ptml::tags::Div).scope(Out);
+    printSingleCFileIncludes(Out, B);
+
+    // Write out each function as soon as it's ready, so that only the C code
+    // of the functions being decompiled is alive at any given time
+    std::set<MetaAddress> Targets = getFunctionsToDecompile(IRContainer);
+    if (not Targets.empty())
+      decompile(Cache, Module, Model, Out, Targets);
+  }
+
+  Out.flush();
+  EC = Out.error();
+  if (EC)
+    revng_abort(EC.message().c_str());
+}
+
+void DecompileDirectlyToSingleFile::print(const pipeline::Context &Ctx,
+                                          llvm::raw_ostream &OS,
+                                          llvm::ArrayRef<std::string> Names)
+  const {
+  // The output is the same as decompile followed by decompile-to-single-file,
+  // only produced without the intermediate container
+  std::string Revng = *revng::ResourceFinder.findFile("bin/revng");
+  OS << Revng << " decompile -m model.yml -i " << Names[0]
+     << " -o decompiled.tar.gz && ";
+  OS << Revng << " decompiled-yaml-to-c -i decompiled.tar.gz -o " << Names[1];
+}
+
 } // end namespace revng::pipes
 
 static pipeline::RegisterPipe<revng::pipes::DecompileToSingleFile> Y;
+static pipeline::RegisterPipe<revng::pipes::DecompileDirectlyToSingleFile> Z;
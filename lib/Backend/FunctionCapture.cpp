@@ -0,0 +1,99 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "revng/Model/IRHelpers.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+
+#include "revng-c/Backend/ModelSlice.h"
+
+#include "FunctionCapture.h"
+
+static Logger<> Log{ "decompile-capture" };
+
+static bool writeFile(llvm::StringRef Path, llvm::StringRef Content) {
+  std::error_code EC;
+  llvm::raw_fd_ostream Stream(Path, EC);
+  if (EC) {
+    revng_log(Log, "Cannot write " << Path << ": " << EC.message());
+    return false;
+  }
+
+  Stream << Content;
+  return true;
+}
+
+static void captureFunction(const ModelSlicer &Slicer,
+                            llvm::Module &Module,
+                            const llvm::Function &F,
+                            llvm::StringRef Directory) {
+  std::string Entry = getMetaAddressMetadata(&F, "revng.function.entry")
+                        .toString();
+
+  // All the global variables are kept, since they hold serialized model types
+  // and strings, while all the other functions become declarations
+  llvm::ValueToValueMapTy Map;
+  auto ShouldCloneDefinition = [&F](const llvm::GlobalValue *GV) {
+    return llvm::isa<llvm::GlobalVariable>(GV) or GV == &F;
+  };
+  auto Clone = llvm::CloneModule(Module, Map, ShouldCloneDefinition);
+
+  std::string Bitcode;
+  {
+    llvm::raw_string_ostream Stream(Bitcode);
+    llvm::WriteBitcodeToFile(*Clone, Stream);
+  }
+
+  llvm::SmallString<128> IRPath(Directory);
+  llvm::sys::path::append(IRPath, Entry + ".bc");
+  llvm::SmallString<128> ModelPath(Directory);
+  llvm::sys::path::append(ModelPath, Entry + ".model.yml");
+
+  if (writeFile(IRPath, Bitcode)
+      and writeFile(ModelPath, Slicer.serializeSlice(F)))
+    revng_log(Log, "Captured " << F.getName() << " in " << IRPath);
+}
+
+void captureFunctions(FunctionMetadataCache &Cache,
+                      llvm::Module &Module,
+                      const model::Binary &Model,
+                      const std::set<MetaAddress> &Entries,
+                      llvm::StringRef Directory) {
+  if (Entries.empty())
+    return;
+
+  if (std::error_code EC = llvm::sys::fs::create_directories(Directory)) {
+    revng_log(Log, "Cannot create " << Directory << ": " << EC.message());
+    return;
+  }
+
+  // The model is serialized only if there's at least a function to capture
+  std::optional<ModelSlicer> Slicer;
+  for (llvm::Function &F : FunctionTags::Isolated.functions(&Module)) {
+    if (F.empty())
+      continue;
+
+    if (Entries.contains(getMetaAddressMetadata(&F, "revng.function.entry"))) {
+      if (not Slicer)
+        Slicer.emplace(Cache, Model);
+      captureFunction(*Slicer, Module, F, Directory);
+    }
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <set>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
+#include "revng/Support/MetaAddress.h"
+
+namespace llvm {
+class Module;
+} // namespace llvm
+
+/// For each isolated function of \a Module whose entry is in \a Entries, write
+/// to \a Directory a self-contained bundle to replay its decompilation alone:
+///
+/// * `<entry>.bc`: \a Module with all the global variables, but the body of
+///   that function only;
+/// * `<entry>.model.yml`: the slice of \a Model the C code of the function
+///   depends upon, as extracted by ModelSlicer.
+///
+/// The bundle can then be decompiled with
+/// `revng decompile -m <entry>.model.yml -i <entry>.bc -o <output>`.
+void captureFunctions(FunctionMetadataCache &Cache,
+                      llvm::Module &Module,
+                      const model::Binary &Model,
+                      const std::set<MetaAddress> &Entries,
+                      llvm::StringRef Directory);
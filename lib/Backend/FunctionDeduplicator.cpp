@@ -0,0 +1,273 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cctype>
+#include <cstdint>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+
+#include "revng/Model/IRHelpers.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+
+#include "revng-c/Support/ContentAddressedStore.h"
+
+#include "FunctionDeduplicator.h"
+
+static Logger<> Log{ "decompile-deduplicate" };
+
+static bool isIdentifierChar(char C) {
+  return std::isalnum(static_cast<unsigned char>(C)) or C == '_';
+}
+
+static bool isLowerHexDigit(char C) {
+  return std::isdigit(static_cast<unsigned char>(C)) or (C >= 'a' and C <= 'f');
+}
+
+/// Call \a Visit on each serialized MetaAddress in \a Text, i.e., on each
+/// `0x<lowercase hex>:<type>` not preceded nor followed by identifier
+/// characters, passing the whole string, its address and its type.
+///
+/// \return \a Text, with each MetaAddress replaced by what \a Visit returns.
+template<typename CallableT>
+static std::string rewriteAddresses(llvm::StringRef Text, CallableT &&Visit) {
+  std::string Result;
+  Result.reserve(Text.size());
+  size_t Copied = 0;
+  for (size_t I = Text.find("0x"); I != llvm::StringRef::npos;
+       I = Text.find("0x", I + 1)) {
+    if (I < Copied or (I != 0 and isIdentifierChar(Text[I - 1])))
+      continue;
+
+    size_t HexEnd = I + 2;
+    while (HexEnd < Text.size() and isLowerHexDigit(Text[HexEnd]))
+      ++HexEnd;
+    if (HexEnd == I + 2 or HexEnd == Text.size() or Text[HexEnd] != ':')
+      continue;
+
+    size_t End = HexEnd + 1;
+    while (End < Text.size() and isIdentifierChar(Text[End]))
+      ++End;
+    if (End == HexEnd + 1)
+      continue;
+
+    uint64_t Address = 0;
+    if (Text.slice(I + 2, HexEnd).getAsInteger(16, Address))
+      continue;
+
+    Result.append(Text.data() + Copied, I - Copied);
+    Result += Visit(Text.slice(I, End), Address, Text.slice(HexEnd, End));
+    Copied = End;
+  }
+  Result.append(Text.data() + Copied, Text.size() - Copied);
+  return Result;
+}
+
+/// Replace the occurrences of \a Word in \a Text that are not part of a longer
+/// identifier with \a Replacement.
+static std::string replaceWord(llvm::StringRef Text,
+                               llvm::StringRef Word,
+                               llvm::StringRef Replacement) {
+  revng_assert(not Word.empty());
+  std::string Result;
+  Result.reserve(Text.size());
+  size_t Copied = 0;
+  for (size_t I = Text.find(Word); I != llvm::StringRef::npos;
+       I = Text.find(Word, I + 1)) {
+    size_t End = I + Word.size();
+    if (I < Copied or (I != 0 and isIdentifierChar(Text[I - 1]))
+        or (End < Text.size() and isIdentifierChar(Text[End])))
+      continue;
+
+    Result.append(Text.data() + Copied, I - Copied);
+    Result += Replacement;
+    Copied = End;
+  }
+  Result.append(Text.data() + Copied, Text.size() - Copied);
+  return Result;
+}
+
+/// \return how many times each value appears as a hexadecimal literal in
+///         \a Text, in any case, even as part of an identifier.
+static std::map<uint64_t, unsigned> countHexMentions(llvm::StringRef Text) {
+  std::map<uint64_t, unsigned> Result;
+  for (size_t I = Text.find("0x"); I != llvm::StringRef::npos;
+       I = Text.find("0x", I + 1)) {
+    if (I != 0 and std::isalnum(static_cast<unsigned char>(Text[I - 1])))
+      continue;
+
+    size_t End = I + 2;
+    while (End < Text.size()
+           and std::isxdigit(static_cast<unsigned char>(Text[End])))
+      ++End;
+
+    uint64_t Value = 0;
+    if (not Text.slice(I + 2, End).getAsInteger(16, Value))
+      ++Result[Value];
+  }
+  return Result;
+}
+
+static std::string toHex(uint64_t Address) {
+  return "0x" + llvm::utohexstr(Address, /* LowerCase */ true);
+}
+
+FunctionDeduplicator::FunctionDeduplicator(const model::Binary &Model,
+                                           llvm::ArrayRef<const llvm::Function
+                                                            *> Functions,
+                                           SerializeInputsT SerializeInputs) {
+  llvm::StringMap<const llvm::Function *> FirstOfGroup;
+  for (const llvm::Function *F : Functions) {
+    const model::Function *ModelFunction = llvmToModelFunction(Model, *F);
+    revng_assert(ModelFunction != nullptr);
+
+    Identity &Self = Identities[F];
+    Self.Entry = ModelFunction->Entry();
+    Self.Name = ModelFunction->name().str();
+    Self.LLVMName = F->getName().str();
+    Self.OwnAddresses.insert(Self.Entry.toString());
+
+    const auto AddOwnType = [&Self](const model::TypePath &Path) {
+      if (Path.empty())
+        return;
+      const model::Type *T = Path.getConst();
+      Self.OwnTypes.emplace_back(T->name().str(), std::to_string(T->ID()));
+    };
+    AddOwnType(ModelFunction->prototype(Model));
+    AddOwnType(ModelFunction->StackFrameType());
+
+    // The debug location of each instruction holds the addresses of the
+    // entry, of the block and of the instruction itself
+    for (const llvm::Instruction &I : llvm::instructions(F)) {
+      const llvm::DebugLoc &Location = I.getDebugLoc();
+      if (not Location or Location->getScope() == nullptr)
+        continue;
+
+      const auto Collect = [&Self](llvm::StringRef Whole,
+                                   uint64_t,
+                                   llvm::StringRef) {
+        Self.OwnAddresses.insert(Whole.str());
+        return Whole.str();
+      };
+      rewriteAddresses(Location->getScope()->getName(), Collect);
+    }
+
+    std::string Inputs = SerializeInputs(*F);
+    Inputs = replaceWord(Inputs, Self.LLVMName, "<self-llvm-name>");
+    Inputs = replaceWord(Inputs, Self.Name, "<self-name>");
+    for (size_t I = 0; I < Self.OwnTypes.size(); ++I) {
+      const auto &[Name, ID] = Self.OwnTypes[I];
+      std::string Placeholder = "<self-type-" + std::to_string(I);
+      Inputs = replaceWord(Inputs, Name, Placeholder + "-name>");
+      Inputs = replaceWord(Inputs, ID, Placeholder + "-id>");
+    }
+    uint64_t EntryAddress = Self.Entry.address();
+    const auto MakeRelative = [&Self, EntryAddress](llvm::StringRef Whole,
+                                                    uint64_t Address,
+                                                    llvm::StringRef Type) {
+      if (not Self.OwnAddresses.contains(Whole.str()))
+        return Whole.str();
+      return "+" + toHex(Address - EntryAddress) + Type.str();
+    };
+    Inputs = rewriteAddresses(Inputs, MakeRelative);
+
+    std::string Key = ContentAddressedStore::computeKey(Inputs);
+    auto [It, New] = FirstOfGroup.try_emplace(Key, F);
+    if (New)
+      continue;
+
+    Representatives[F] = It->second;
+    ++PendingDuplicates[It->second];
+  }
+
+  revng_log(Log,
+            Representatives.size() << " of " << Functions.size()
+                                   << " functions are duplicates");
+}
+
+void FunctionDeduplicator::record(const llvm::Function &F,
+                                  llvm::StringRef CCode) {
+  if (hasDuplicates(F))
+    RepresentativeCCode[&F] = CCode.str();
+}
+
+void FunctionDeduplicator::releaseOne(const llvm::Function *Representative) {
+  auto It = PendingDuplicates.find(Representative);
+  revng_assert(It != PendingDuplicates.end());
+  if (--It->second != 0)
+    return;
+
+  PendingDuplicates.erase(It);
+  RepresentativeCCode.erase(Representative);
+}
+
+void FunctionDeduplicator::skip(const llvm::Function &F) {
+  if (const llvm::Function *Representative = getRepresentative(F))
+    releaseOne(Representative);
+}
+
+std::optional<std::string>
+FunctionDeduplicator::getDuplicateCCode(const llvm::Function &F) {
+  auto RepresentativeIt = Representatives.find(&F);
+  if (RepresentativeIt == Representatives.end())
+    return std::nullopt;
+
+  const llvm::Function *Representative = RepresentativeIt->second;
+  auto CCodeIt = RepresentativeCCode.find(Representative);
+  if (CCodeIt == RepresentativeCCode.end()) {
+    releaseOne(Representative);
+    return std::nullopt;
+  }
+
+  const Identity &From = Identities.at(Representative);
+  const Identity &To = Identities.at(&F);
+  llvm::StringRef CCode = CCodeIt->second;
+
+  uint64_t Delta = To.Entry.address() - From.Entry.address();
+  std::map<uint64_t, unsigned> Rewritten;
+  const auto Move = [&From, &Rewritten, Delta](llvm::StringRef Whole,
+                                               uint64_t Address,
+                                               llvm::StringRef Type) {
+    if (not From.OwnAddresses.contains(Whole.str()))
+      return Whole.str();
+    ++Rewritten[Address];
+    return toHex(Address + Delta) + Type.str();
+  };
+  std::string Result = rewriteAddresses(CCode, Move);
+
+  // Besides in its name, the C code must not mention the addresses of the
+  // representative in any other form than the serialized MetaAddresses that
+  // have been moved, e.g., as integer literals, since they could not be told
+  // apart from constants that happen to have the same value.
+  std::map<uint64_t, unsigned> Mentions = countHexMentions(replaceWord(CCode,
+                                                                       From
+                                                                         .Name,
+                                                                       ""));
+  for (const std::string &Own : From.OwnAddresses) {
+    uint64_t Address = MetaAddress::fromString(Own).address();
+    if (Mentions[Address] != Rewritten[Address]) {
+      revng_log(Log,
+                "Cannot reuse the C code of " << From.LLVMName << " for "
+                                              << To.LLVMName);
+      releaseOne(Representative);
+      return std::nullopt;
+    }
+  }
+
+  Result = replaceWord(Result, From.Name, To.Name);
+
+  // Both have either a stack frame or not, since their inputs are the same
+  revng_assert(From.OwnTypes.size() == To.OwnTypes.size());
+  for (const auto &[FromType, ToType] : llvm::zip(From.OwnTypes, To.OwnTypes)) {
+    Result = replaceWord(Result, FromType.first, ToType.first);
+    Result = replaceWord(Result, FromType.second, ToType.second);
+  }
+
+  releaseOne(Representative);
+  return Result;
+}
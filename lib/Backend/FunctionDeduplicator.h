@@ -0,0 +1,116 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Support/MetaAddress.h"
+
+namespace llvm {
+class Function;
+} // namespace llvm
+
+/// Groups the isolated functions whose C code is the same, besides their own
+/// name and addresses, e.g., the copies of a function statically linked more
+/// than once, so that only the first function of each group is restructured
+/// and emitted.
+///
+/// Two functions are in the same group if everything their C code depends upon
+/// (see DecompilationCache::serializeInputs) is the same, once their names are
+/// replaced by a placeholder and the addresses of their own instructions are
+/// made relative to their entry. The same goes for the names and IDs of their
+/// own prototype and stack frame type, which are distinct types even when
+/// structurally equal. The C code of the other functions of a group is then
+/// obtained from the C code of the first one, by swapping the names and the
+/// type IDs and moving the addresses of its instructions by the distance of
+/// the entries.
+class FunctionDeduplicator {
+private:
+  /// How a function refers to itself in its inputs and in its C code
+  struct Identity {
+    MetaAddress Entry;
+    std::string Name;
+    std::string LLVMName;
+    /// The serialized MetaAddresses of the entry and of the instructions
+    std::set<std::string> OwnAddresses;
+    /// The names and the IDs of the prototype and of the stack frame type, if
+    /// any, in this order
+    llvm::SmallVector<std::pair<std::string, std::string>, 2> OwnTypes;
+  };
+
+private:
+  std::map<const llvm::Function *, Identity> Identities;
+
+  /// The first function of the group of each function, for the functions that
+  /// are not the first of their group
+  std::map<const llvm::Function *, const llvm::Function *> Representatives;
+
+  /// How many functions of its group each representative still has to
+  /// provide the C code for
+  std::map<const llvm::Function *, unsigned> PendingDuplicates;
+
+  /// The C code of the representatives with pending duplicates
+  std::map<const llvm::Function *, std::string> RepresentativeCCode;
+
+public:
+  using SerializeInputsT = llvm::function_ref<std::string(
+    const llvm::Function &)>;
+
+  /// \param Functions the functions to group, in the order in which they are
+  ///        going to be decompiled.
+  FunctionDeduplicator(const model::Binary &Model,
+                       llvm::ArrayRef<const llvm::Function *> Functions,
+                       SerializeInputsT SerializeInputs);
+
+public:
+  /// \return true if the C code of \a F has to be passed to record, since it
+  ///         can be reused for other functions.
+  bool hasDuplicates(const llvm::Function &F) const {
+    return PendingDuplicates.contains(&F);
+  }
+
+  /// \return true if \a F is not the first function of its group.
+  bool isDuplicate(const llvm::Function &F) const {
+    return Representatives.contains(&F);
+  }
+
+  /// \return the first function of the group of \a F, if \a F is not the
+  ///         first function of its group, nullptr otherwise.
+  const llvm::Function *getRepresentative(const llvm::Function &F) const {
+    auto It = Representatives.find(&F);
+    return It == Representatives.end() ? nullptr : It->second;
+  }
+
+  /// Remember \a CCode as the C code of \a F.
+  void record(const llvm::Function &F, llvm::StringRef CCode);
+
+  /// \return the C code of \a F, obtained from the one of an earlier function
+  ///         of its group, if there is one, it has been recorded and it can be
+  ///         safely rewritten for \a F.
+  ///
+  /// \note Each function can be asked for its C code only once, and after the
+  ///       first function of its group has been recorded, if ever.
+  std::optional<std::string> getDuplicateCCode(const llvm::Function &F);
+
+  /// Notify that the C code of \a F has been obtained otherwise, e.g., from a
+  /// cache, so that the C code of the first function of its group can be
+  /// dropped as soon as no other function of the group needs it.
+  ///
+  /// \note This replaces the call to getDuplicateCCode for \a F.
+  void skip(const llvm::Function &F);
+
+private:
+  void releaseOne(const llvm::Function *Representative);
+};
@@ -0,0 +1,122 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <set>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/IRHelpers.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/YAMLTraits.h"
+
+#include "revng-c/Backend/ModelSlice.h"
+
+#include "DecompilationCache.h"
+
+static Logger<> Log{ "model-slice" };
+
+using BinaryTree = TupleTree<model::Binary>;
+
+static std::string serialize(const model::Binary &Model) {
+  std::string Buffer;
+  llvm::raw_string_ostream Stream(Buffer);
+  llvm::yaml::Output YAMLOutput(Stream);
+  YAMLOutput << const_cast<model::Binary &>(Model);
+  Stream.flush();
+  return Buffer;
+}
+
+/// Collect the IDs of \a Roots and of all the types reachable from them
+static std::set<uint64_t>
+collectReachableTypes(llvm::SmallVectorImpl<const model::Type *> &&Roots) {
+  std::set<uint64_t> Result;
+  while (not Roots.empty()) {
+    const model::Type *T = Roots.pop_back_val();
+    if (not Result.insert(T->ID()).second)
+      continue;
+
+    for (const model::QualifiedType &QT : T->edges())
+      Roots.push_back(QT.UnqualifiedType().getConst());
+  }
+
+  return Result;
+}
+
+ModelSlicer::ModelSlicer(FunctionMetadataCache &Cache,
+                         const model::Binary &Model) :
+  Cache(Cache), Model(Model), SerializedModel(serialize(Model)) {
+}
+
+BinaryTree ModelSlicer::slice(const llvm::Function &F) const {
+  const model::Function *ModelFunction = llvmToModelFunction(Model, F);
+  revng_assert(ModelFunction != nullptr);
+  FunctionDependencies Dependencies = collectDependencies(Cache, Model, F);
+
+  // Segments and dynamic functions are emitted in the headers no matter what
+  llvm::SmallVector<const model::Type *, 16> Roots(Dependencies.Types.begin(),
+                                                   Dependencies.Types.end());
+  for (const model::Segment &Segment : Model.Segments())
+    if (not Segment.Type().empty())
+      Roots.push_back(Segment.Type().getConst());
+  for (const auto &Function : Model.ImportedDynamicFunctions())
+    if (not Function.Prototype().empty())
+      Roots.push_back(Function.Prototype().getConst());
+  if (not Model.DefaultPrototype().empty())
+    Roots.push_back(Model.DefaultPrototype().getConst());
+  for (const model::Function *Callee : Dependencies.Callees)
+    Roots.push_back(Callee->prototype(Model).getConst());
+
+  std::set<uint64_t> KeptTypes = collectReachableTypes(std::move(Roots));
+  std::set<MetaAddress> KeptFunctions = { ModelFunction->Entry() };
+  for (const model::Function *Callee : Dependencies.Callees)
+    KeptFunctions.insert(Callee->Entry());
+
+  // Deserializing a copy of the model is the simplest way to get a deep copy
+  // whose references point within itself
+  auto MakeSlice = [&]() {
+    auto MaybeSlice = BinaryTree::deserialize(SerializedModel);
+    revng_assert(MaybeSlice);
+    BinaryTree Slice = std::move(*MaybeSlice);
+
+    llvm::erase_if(Slice->Functions(), [&](const model::Function &Function) {
+      return not KeptFunctions.contains(Function.Entry());
+    });
+
+    // Only the prototypes of the callees matter to the function
+    for (model::Function &Function : Slice->Functions()) {
+      if (Function.Entry() == ModelFunction->Entry())
+        continue;
+
+      Function.StackFrameType() = {};
+      Function.CallSitePrototypes().clear();
+    }
+
+    return Slice;
+  };
+
+  BinaryTree Pruned = MakeSlice();
+  llvm::erase_if(Pruned->Types(), [&](UpcastablePointer<model::Type> &T) {
+    return not KeptTypes.contains(T->ID());
+  });
+
+  // If something still references a type that has been dropped, give up on
+  // pruning the types: a larger but valid model is still self-contained
+  if (Pruned->verify())
+    return Pruned;
+
+  revng_log(Log,
+            "The types of the slice of " << F.getName()
+                                         << " cannot be pruned, keeping all "
+                                            "of them");
+  return MakeSlice();
+}
+
+std::string ModelSlicer::serializeSlice(const llvm::Function &F) const {
+  return serialize(*slice(F));
+}
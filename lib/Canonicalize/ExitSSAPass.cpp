@@ -4,12 +4,12 @@
 
 #include <algorithm>
 #include <compare>
-#include <limits>
 #include <map>
-#include <set>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/PostOrderIterator.h"
@@ -48,28 +48,27 @@ public:
   }
 };
 
-struct IncomingInfo {
-  BasicBlock *PHIBlock;
-  BasicBlock *IncomingBlock;
-  Value *IncomingValue;
-  bool operator==(const IncomingInfo &) const = default;
-  std::strong_ordering operator<=>(const IncomingInfo &) const = default;
-};
-
-static bool haveIncompatibleIncomings(const std::set<IncomingInfo> &LHS,
-                                      const std::set<IncomingInfo> &RHS) {
-  for (const auto &[PHIBlock, IncomingBlock, IncomingValue] : LHS) {
-    auto It = RHS.lower_bound(IncomingInfo{ PHIBlock, IncomingBlock, nullptr });
-    auto End = RHS.upper_bound(IncomingInfo{
-      PHIBlock, IncomingBlock, std::numeric_limits<Value *>::max() });
-    // If RHS contains a PHI that is in the same block as PHIBlock, and has a
-    // different incoming value on the same incoming block, the two are
-    // incompatible, because they would assign two different values to the same
-    // local variable along the same edge.
-    if (It != End and IncomingValue != It->IncomingValue)
-      return false;
+// Maps each edge, represented as a pair (IncomingBlock, PHIBlock), to the value
+// that the PHINodes of an equivalence class receive along that edge.
+using EdgeIncomings = llvm::DenseMap<std::pair<BasicBlock *, BasicBlock *>,
+                                     Value *>;
+
+static bool haveIncompatibleIncomings(const EdgeIncomings &LHS,
+                                      const EdgeIncomings &RHS) {
+  // Look up the smaller in the larger, so that joining many small classes into
+  // a large one stays linear in the size of the small ones.
+  const EdgeIncomings &Smaller = LHS.size() < RHS.size() ? LHS : RHS;
+  const EdgeIncomings &Larger = LHS.size() < RHS.size() ? RHS : LHS;
+  for (const auto &[Edge, IncomingValue] : Smaller) {
+    auto It = Larger.find(Edge);
+    // If Larger contains a PHI that is in the same block, and has a different
+    // incoming value on the same incoming block, the two are incompatible,
+    // because they would assign two different values to the same local
+    // variable along the same edge.
+    if (It != Larger.end() and IncomingValue != It->second)
+      return true;
   }
-  return true;
+  return false;
 }
 
 static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
@@ -77,7 +76,7 @@ static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
   // PHINodes in the same class are mapped onto the same local variable.
   llvm::EquivalenceClasses<PHINode *> PHISameVariableClasses;
 
-  std::unordered_map<PHINode *, std::set<IncomingInfo>> PerClassIncomings;
+  std::unordered_map<PHINode *, EdgeIncomings> PerClassIncomings;
 
   const auto InitVariableClass = [&PHISameVariableClasses,
                                   &PerClassIncomings](PHINode *PHI) {
@@ -92,10 +91,7 @@ static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
     for (unsigned I = 0U; I < NumIncomings; ++I) {
       Value *IncomingValue = PHI->getIncomingValue(I);
       BasicBlock *IncomingBlock = PHI->getIncomingBlock(I);
-      auto NewIncomingInfo = IncomingInfo{ PHIBlock,
-                                           IncomingBlock,
-                                           IncomingValue };
-      CurrentIncomingInfo.insert(std::move(NewIncomingInfo));
+      CurrentIncomingInfo[{ IncomingBlock, PHIBlock }] = IncomingValue;
     }
     return;
   };
@@ -106,6 +102,12 @@ static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
       // Set up an equivalence class for PHI, if necessary
       InitVariableClass(&PHI);
 
+      // If the PHI has a user that is not another PHI, it cannot be put in
+      // the same equivalence class as any of its users, so we bail out.
+      if (llvm::any_of(PHI.users(),
+                       [](const User *U) { return not isa<PHINode>(U); }))
+        continue;
+
       // Then, for each user, if it's a PHINode, try to see if we can insert it
       // in the same equivalence class as PHI.
       for (User *U : PHI.users()) {
@@ -126,12 +128,6 @@ static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
         if (PHISameVariableClasses.isEquivalent(&PHI, PHIUser))
           continue;
 
-        // If the PHI has a user that is not another PHI, it cannot be put in
-        // the same equivalence class as the PHIUser, so we bail out.
-        if (llvm::any_of(PHI.users(),
-                         [](const User *U) { return not isa<PHINode>(U); }))
-          continue;
-
         PHINode *PHILeader = PHISameVariableClasses.getLeaderValue(&PHI);
         PHINode *UserLeader = PHISameVariableClasses.getLeaderValue(PHIUser);
 
@@ -151,9 +147,14 @@ static std::vector<SetVector<PHINode *>> getPHIEquivalenceClasses(Function &F) {
         // Here the two are compatible so we join the equivalence classes.
         PHISameVariableClasses.unionSets(&PHI, PHIUser);
 
-        // Finally we do the same with the IncomingInfo
+        // Finally we do the same with the IncomingInfo, always moving the
+        // smaller into the larger.
         auto Handle = PerClassIncomings.extract(UserIncomingInfo);
-        PHIIncomingInfo->second.merge(std::move(Handle.mapped()));
+        EdgeIncomings &Merged = PHIIncomingInfo->second;
+        EdgeIncomings &Other = Handle.mapped();
+        if (Merged.size() < Other.size())
+          std::swap(Merged, Other);
+        Merged.insert(Other.begin(), Other.end());
       }
     }
   }
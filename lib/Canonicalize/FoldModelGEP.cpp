@@ -44,16 +44,6 @@ using llvm::dyn_cast;
 using llvm::StringRef;
 using model::QualifiedType;
 
-inline llvm::Value *traverseTransparentInstructions(llvm::Value *V) {
-  llvm::Value *CurValue = V;
-
-  while (isa<llvm::IntToPtrInst>(CurValue) or isa<llvm::PtrToIntInst>(CurValue)
-         or isa<llvm::BitCastInst>(CurValue) or isa<llvm::FreezeInst>(CurValue))
-    CurValue = cast<llvm::Instruction>(CurValue)->getOperand(0);
-
-  return CurValue;
-}
-
 static llvm::Value *getValueToSubstitute(llvm::Instruction &I,
                                          const model::Binary &Model) {
   if (auto *Call = getCallToTagged(&I, FunctionTags::ModelGEP)) {
@@ -2,6 +2,9 @@
 // Copyright rev.ng Srls. See LICENSE.md for details.
 //
 
+#include <map>
+#include <utility>
+
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstrTypes.h"
@@ -35,12 +38,29 @@ using model::QualifiedType;
 using ValueTypeMap = std::map<const llvm::Value *, const model::QualifiedType>;
 using ModelPromotedTypesMap = std::map<const llvm::Instruction *, ValueTypeMap>;
 
+// Memoizes isImplicitCast, whose result only depends on the two types.
+class ImplicitCastCache {
+private:
+  std::map<std::pair<QualifiedType, QualifiedType>, bool> Cache;
+
+public:
+  bool isImplicitCast(const QualifiedType &QT, const QualifiedType &Target);
+
+  void clear() { Cache.clear(); }
+};
+
 struct ImplicitModelCastPass : public llvm::FunctionPass {
 public:
   static char ID;
 
   ImplicitModelCastPass() : FunctionPass(ID) {}
 
+  bool doInitialization(llvm::Module &M) override {
+    ImplicitCasts.clear();
+    Peeled.clear();
+    return false;
+  }
+
   bool runOnFunction(llvm::Function &F) override;
 
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
@@ -70,6 +90,11 @@ private:
 private:
   ValueTypeMap TypeMap;
   ModelPromotedTypesMap PromotedTypes;
+
+  // The model is read-only while the pass runs, so this is shared among all
+  // the functions.
+  ImplicitCastCache ImplicitCasts;
+  PeelConstAndTypedefsCache Peeled;
 };
 
 static void setImplicitModelCast(Value *ModelCastCallValue) {
@@ -87,11 +112,12 @@ static void setImplicitModelCast(Value *ModelCastCallValue) {
 // type. This is called "Integer Promotion".
 static std::optional<model::QualifiedType>
 getOriginalOrPromotedType(const model::QualifiedType &OperandType,
-                          const model::Binary &Model) {
+                          const model::Binary &Model,
+                          PeelConstAndTypedefsCache &Peeled) {
   if (OperandType.isPointer())
     return OperandType;
 
-  auto UnwrappedType = peelConstAndTypedefs(OperandType);
+  auto UnwrappedType = Peeled.peel(OperandType);
   if (not UnwrappedType.isScalar())
     return std::nullopt;
 
@@ -173,8 +199,7 @@ static bool shouldApplyIntegerPromotion(const Instruction *I) {
 
 // Check if QT can be casted into Target type, without losing precision.
 static bool isImplicitCast(const model::QualifiedType &QT,
-                           const model::QualifiedType &Target,
-                           const llvm::Value *V) {
+                           const model::QualifiedType &Target) {
   using model::PrimitiveTypeKind::Generic;
   using model::PrimitiveTypeKind::Number;
   using model::PrimitiveTypeKind::PointerOrNumber;
@@ -265,6 +290,18 @@ static bool isImplicitCast(const model::QualifiedType &QT,
   return false;
 }
 
+bool ImplicitCastCache::isImplicitCast(const QualifiedType &QT,
+                                       const QualifiedType &Target) {
+  auto Key = std::make_pair(QT, Target);
+  auto It = Cache.find(Key);
+  if (It != Cache.end())
+    return It->second;
+
+  bool Result = ::isImplicitCast(QT, Target);
+  Cache.emplace(std::move(Key), Result);
+  return Result;
+}
+
 // This is to avoid -Wshift-count-overflow in C.
 static bool
 isShiftCountGreaterThanExpectedType(const model::QualifiedType &Type,
@@ -333,10 +370,9 @@ ImplicitModelCastPass::getOperandsToPromote(Instruction *I,
     QualifiedType CastedValueType = TypeMap.at(CastedValue);
     // If type of the value being casted or integer promoted type are implicit
     // casts, we can avoid the cast itself.
-    if (not isImplicitCast(PromotedTypeForCastedValue,
-                           ExpectedType,
-                           CastedValue)
-        and not isImplicitCast(CastedValueType, ExpectedType, CastedValue)) {
+    if (not ImplicitCasts.isImplicitCast(PromotedTypeForCastedValue,
+                                         ExpectedType)
+        and not ImplicitCasts.isImplicitCast(CastedValueType, ExpectedType)) {
       continue;
     }
 
@@ -360,7 +396,7 @@ bool IMCP::collectTypeInfoForPromotionForSingleValue(const Value *Value,
                                                      Instruction *I,
                                                      const model::Binary
                                                        &Model) {
-  auto PromotedType = getOriginalOrPromotedType(OperandType, Model);
+  auto PromotedType = getOriginalOrPromotedType(OperandType, Model, Peeled);
   if (PromotedType) {
     // This will be used in the second stage of the
     // reducing-cast-algorithm.
@@ -514,6 +550,7 @@ bool ImplicitModelCastPass::runOnFunction(Function &F) {
   auto &Cache = getAnalysis<FunctionMetadataCachePass>().get();
 
   TypeMap = initModelTypes(Cache, F, ModelFunction, *Model, false);
+  PromotedTypes.clear();
 
   Changed = process(F, *Model, Cache);
 
@@ -2,6 +2,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <memory>
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instruction.h"
@@ -42,11 +45,32 @@ private:
   ModelTypesMap TypeMap;
   const model::Function *ModelFunction = nullptr;
 
+  // The same few types are the target of most of the casts of the module,
+  // hence each of them is serialized once, and its string shared by all the
+  // casts, instead of emitting the YAML again for each cast.
+  std::map<model::QualifiedType, Constant *> TypeStrings;
+
+  // Initializing the pool scans all the functions of the module, hence it's
+  // done once and shared among all the functions.
+  std::unique_ptr<OpaqueFunctionsPool<TypePair>> ModelCastPool;
+
 public:
   static char ID;
 
   MakeModelCastPass() : FunctionPass(ID) {}
 
+  bool doInitialization(llvm::Module &M) override {
+    ModelCastPool = std::make_unique<OpaqueFunctionsPool<TypePair>>(&M, false);
+    initModelCastPool(*ModelCastPool, &M);
+    return false;
+  }
+
+  bool doFinalization(llvm::Module &M) override {
+    TypeStrings.clear();
+    ModelCastPool.reset();
+    return false;
+  }
+
   bool runOnFunction(llvm::Function &F) override;
 
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
@@ -56,6 +80,15 @@ public:
   }
 
 private:
+  Constant *serializeType(const model::QualifiedType &QT, llvm::Module &M) {
+    auto It = TypeStrings.find(QT);
+    if (It != TypeStrings.end())
+      return It->second;
+
+    It = TypeStrings.insert({ QT, serializeToLLVMString(QT, M) }).first;
+    return It->second;
+  }
+
   std::vector<SerializedType>
   serializeTypesForModelCast(FunctionMetadataCache &Cache,
                              Instruction *,
@@ -94,7 +127,7 @@ MMCP::serializeTypesForModelCast(FunctionMetadataCache &Cache,
           revng_assert(ExpectedType.isScalar() and OperandType.isScalar());
           // Create a cast only if the expected type is different from the
           // actual type propagated until here
-          auto Type = SerializedType(serializeToLLVMString(ExpectedType, *M),
+          auto Type = SerializedType(serializeType(ExpectedType, *M),
                                      Op.getOperandNo());
           Result.emplace_back(std::move(Type));
         }
@@ -153,14 +186,14 @@ MMCP::serializeTypesForModelCast(FunctionMetadataCache &Cache,
           || IsPtrOperandOfAggregateType) {
         // Pointer operand needs to be casted to the model::QualifiedType of
         // the value operand, added pointer qualified.
-        auto Type = SerializedType(serializeToLLVMString(ValOperandPtrType, *M),
+        auto Type = SerializedType(serializeType(ValOperandPtrType, *M),
                                    SI->getPointerOperandIndex());
         Result.emplace_back(std::move(Type));
       } else {
         // Value operand needs to be casted to the drop'd ptr of the
         // model::QualifiedType of the pointer type.
         revng_assert(PtrOperandPtrType.isPointer());
-        auto *LLVMString = serializeToLLVMString(PtrOperandType, *M);
+        auto *LLVMString = serializeType(PtrOperandType, *M);
         auto Type = SerializedType(LLVMString);
         Result.emplace_back(std::move(Type));
       }
@@ -230,8 +263,6 @@ bool MMCP::runOnFunction(Function &F) {
   bool Changed = false;
 
   Module *M = F.getParent();
-  OpaqueFunctionsPool<TypePair> ModelCastPool(M, false);
-  initModelCastPool(ModelCastPool, M);
 
   auto &ModelWrapper = getAnalysis<LoadModelWrapperPass>().get();
   const TupleTree<model::Binary> &Model = ModelWrapper.getReadOnlyModel();
@@ -283,15 +314,14 @@ bool MMCP::runOnFunction(Function &F) {
 
         // Create a string constant to pass as first argument of the call to
         // ModelCast, to represent the target model type.
-        Constant *TargetModelTypeString = serializeToLLVMString(ResultModelType,
-                                                                *M);
+        Constant *TargetModelTypeString = serializeType(ResultModelType, *M);
         revng_assert(TargetModelTypeString);
 
         Value *CallToModelCast = createCallToModelCast(Builder,
                                                        Key,
                                                        TargetModelTypeString,
                                                        CastedOperand,
-                                                       ModelCastPool);
+                                                       *ModelCastPool);
         I.replaceAllUsesWith(CallToModelCast);
         I.eraseFromParent();
       }
@@ -310,7 +340,7 @@ bool MMCP::runOnFunction(Function &F) {
       Changed = true;
 
       for (unsigned Idx = 0; Idx < SerializedTypes.size(); ++Idx)
-        createAndInjectModelCast(&I, SerializedTypes[Idx], ModelCastPool);
+        createAndInjectModelCast(&I, SerializedTypes[Idx], *ModelCastPool);
     }
   }
 
@@ -0,0 +1,49 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "revng/Model/Architecture.h"
+#include "revng/Model/QualifiedType.h"
+
+namespace llvm {
+class Value;
+} // end namespace llvm
+
+namespace model {
+class VerifyHelper;
+} // end namespace model
+
+/// The pointer arithmetic performed on an address: a constant Offset plus a
+/// multiple of each index, i.e., Offset + Stride1 * Index1 + Stride2 * Index2
+struct ModelGEPAccess {
+  uint64_t Offset = 0;
+
+  /// Pairs of a stride and a non-constant integer llvm::Value
+  llvm::SmallVector<std::pair<uint64_t, llvm::Value *>, 2> StridedIndices;
+
+  /// The type accessed on the IR, if known
+  std::optional<model::QualifiedType> AccessedType;
+};
+
+/// Select the best ModelGEP for each of \a Accesses to an address pointing to
+/// \a PointeeType, exactly as MakeModelGEPPass does for the uses of the
+/// addresses of a single function, i.e., sharing the memoized results.
+///
+/// This is exposed so that the traversal of model types can be benchmarked in
+/// isolation, on synthetic models.
+///
+/// \return the total number of indices of the selected ModelGEPs.
+size_t computeBestModelGEPs(const model::QualifiedType &PointeeType,
+                            llvm::ArrayRef<ModelGEPAccess> Accesses,
+                            model::Architecture::Values Architecture,
+                            model::VerifyHelper &VH);
@@ -2,8 +2,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <compare>
 #include <limits>
+#include <map>
+#include <memory>
 #include <optional>
 #include <type_traits>
 #include <utility>
@@ -51,8 +54,12 @@
 #include "revng-c/InitModelTypes/InitModelTypes.h"
 #include "revng-c/Support/FunctionTags.h"
 #include "revng-c/Support/IRHelpers.h"
+#include "revng-c/Support/MemoryMetrics.h"
+#include "revng-c/Support/TraceSpan.h"
 #include "revng-c/Support/ModelHelpers.h"
 
+#include "MakeModelGEP.h"
+
 using llvm::AnalysisUsage;
 using llvm::APInt;
 using llvm::cast;
@@ -1059,17 +1066,65 @@ difference(const ModelGEPReplacementInfo &GEPInfo,
   return DifferenceScore::nestedOutOfBound(IRSummation(IRSize), Depth);
 }
 
+// The key of the memoization of computeBest.
+// The result of computeBest only depends on these, but it refers to the
+// llvm::Values in IRSum, so the memoized results can only be reused as long as
+// those values are not changed.
+struct ComputeBestKey {
+  model::QualifiedType BaseType;
+  IRSummation IRSum;
+  std::optional<model::QualifiedType> AccessedTypeOnIR;
+
+  bool operator<(const ComputeBestKey &Other) const {
+    if (BaseType < Other.BaseType)
+      return true;
+    if (Other.BaseType < BaseType)
+      return false;
+
+    if (AccessedTypeOnIR < Other.AccessedTypeOnIR)
+      return true;
+    if (Other.AccessedTypeOnIR < AccessedTypeOnIR)
+      return false;
+
+    const auto &[Offset, Indices] = IRSum;
+    const auto &[OtherOffset, OtherIndices] = Other.IRSum;
+
+    auto MaxBitWidth = std::max(Offset.getBitWidth(),
+                                OtherOffset.getBitWidth());
+    APInt LargeOffset = Offset.zext(MaxBitWidth);
+    APInt LargeOtherOffset = OtherOffset.zext(MaxBitWidth);
+    if (LargeOffset.ult(LargeOtherOffset))
+      return true;
+    if (LargeOffset.ugt(LargeOtherOffset))
+      return false;
+
+    auto AddendLess = [](const IRAddend &LHS, const IRAddend &RHS) {
+      return std::pair(LHS.coefficient(), LHS.index())
+             < std::pair(RHS.coefficient(), RHS.index());
+    };
+    return std::lexicographical_compare(Indices.begin(),
+                                        Indices.end(),
+                                        OtherIndices.begin(),
+                                        OtherIndices.end(),
+                                        AddendLess);
+  }
+};
+
+using ComputeBestCache = std::map<ComputeBestKey, ModelGEPReplacementInfo>;
+
 static RecursiveCoroutine<ModelGEPReplacementInfo>
 computeBest(const model::QualifiedType &BaseType,
             const IRSummation &IRSum,
             const std::optional<model::QualifiedType> &AccessedTypeOnIR,
-            model::VerifyHelper &VH);
+            model::VerifyHelper &VH,
+            ComputeBestCache &Memo);
 
 static RecursiveCoroutine<ModelGEPReplacementInfo>
 computeBestInArray(const model::QualifiedType &BaseType,
                    const IRSummation &IRSum,
                    const std::optional<model::QualifiedType> &AccessedTypeOnIR,
-                   model::VerifyHelper &VH) {
+                   model::VerifyHelper &VH,
+                   ComputeBestCache &Memo) {
 
   revng_log(ModelGEPLog, "computeBestInArray for IRSum: " << IRSum);
   auto ArrayIndent = LoggerIndent{ ModelGEPLog };
@@ -1242,7 +1297,8 @@ computeBestInArray(const model::QualifiedType &BaseType,
   auto ElementResult = rc_recur computeBest(ElementType,
                                             SummationInElement,
                                             AccessedTypeOnIR,
-                                            VH);
+                                            VH,
+                                            Memo);
   // Fixup the ElementResult to be comparable with BestInArray
   ElementResult.BaseType = BaseArray;
   ElementResult.IndexVector.insert(ElementResult.IndexVector.begin(),
@@ -1267,7 +1323,8 @@ static RecursiveCoroutine<ModelGEPReplacementInfo>
 computeBestInStruct(const model::QualifiedType &BaseStruct,
                     const IRSummation &IRSum,
                     const std::optional<model::QualifiedType> &AccessedTypeOnIR,
-                    model::VerifyHelper &VH) {
+                    model::VerifyHelper &VH,
+                    ComputeBestCache &Memo) {
   revng_log(ModelGEPLog, "computeBestInStruct for IRSum: " << IRSum);
   auto StructIndent = LoggerIndent{ ModelGEPLog };
 
@@ -1318,11 +1375,6 @@ computeBestInStruct(const model::QualifiedType &BaseStruct,
   // compare because it's not a valid traversal for the given IRSum.
   auto FieldIt = TheStructType->Fields().upper_bound(BaseOffset.getZExtValue());
 
-  enum {
-    InitiallyImproving,
-    StartedDegrading,
-  } Status = InitiallyImproving;
-
   for (const model::StructField &Field :
        llvm::reverse(llvm::make_range(FieldBegin, FieldIt))) {
     revng_log(ModelGEPLog, "Analyze Field with Offset: " << Field.Offset());
@@ -1344,22 +1396,18 @@ computeBestInStruct(const model::QualifiedType &BaseStruct,
     DifferenceScore ElementLowerBound = lowerBound(InField,
                                                    AccessedTypeOnIR,
                                                    VH);
-    revng_log(ModelGEPLog, "lowerBound: " << LowerBound);
+    revng_log(ModelGEPLog, "lowerBound: " << ElementLowerBound);
 
-    // If we found a lower bound that is better, it should imply that we're
-    // still in the initial phase of improvement.
-    revng_assert(LowerBound >= BestScore or Status == InitiallyImproving);
-
-    if (LowerBound >= BestScore) {
+    if (ElementLowerBound >= BestScore) {
       revng_log(ModelGEPLog, "Cannot improve on this Field");
-      Status = StartedDegrading;
       continue;
     }
 
     auto FieldResult = rc_recur computeBest(FieldType,
                                             SumInField,
                                             AccessedTypeOnIR,
-                                            VH);
+                                            VH,
+                                            Memo);
     // Fixup the FieldResult to be comparable with BestInStruct
     FieldResult.BaseType = BaseStruct;
     FieldResult.IndexVector.insert(FieldResult.IndexVector.begin(),
@@ -1384,7 +1432,8 @@ static RecursiveCoroutine<ModelGEPReplacementInfo>
 computeBestInUnion(const model::QualifiedType &BaseUnion,
                    const IRSummation &IRSum,
                    const std::optional<model::QualifiedType> &AccessedTypeOnIR,
-                   model::VerifyHelper &VH) {
+                   model::VerifyHelper &VH,
+                   ComputeBestCache &Memo) {
 
   revng_log(ModelGEPLog, "computeBestInUnion for IRSum: " << IRSum);
   auto UnionIndent = LoggerIndent{ ModelGEPLog };
@@ -1448,8 +1497,8 @@ computeBestInUnion(const model::QualifiedType &BaseUnion,
     DifferenceScore ElementLowerBound = lowerBound(InField,
                                                    AccessedTypeOnIR,
                                                    VH);
-    revng_log(ModelGEPLog, "lowerBound: " << LowerBound);
-    if (LowerBound >= BestScore) {
+    revng_log(ModelGEPLog, "lowerBound: " << ElementLowerBound);
+    if (ElementLowerBound >= BestScore) {
       revng_log(ModelGEPLog, "Cannot improve on this Field");
       continue;
     }
@@ -1457,7 +1506,8 @@ computeBestInUnion(const model::QualifiedType &BaseUnion,
     auto FieldResult = rc_recur computeBest(FieldType,
                                             IRSum,
                                             AccessedTypeOnIR,
-                                            VH);
+                                            VH,
+                                            Memo);
     // Fixup the FieldResult to be comparable with BestInUnion
     FieldResult.BaseType = BaseUnion;
     FieldResult.IndexVector.insert(FieldResult.IndexVector.begin(),
@@ -1479,10 +1529,11 @@ computeBestInUnion(const model::QualifiedType &BaseUnion,
 }
 
 static RecursiveCoroutine<ModelGEPReplacementInfo>
-computeBest(const model::QualifiedType &BaseType,
-            const IRSummation &IRSum,
-            const std::optional<model::QualifiedType> &AccessedTypeOnIR,
-            model::VerifyHelper &VH) {
+computeBestImpl(const model::QualifiedType &BaseType,
+                const IRSummation &IRSum,
+                const std::optional<model::QualifiedType> &AccessedTypeOnIR,
+                model::VerifyHelper &VH,
+                ComputeBestCache &Memo) {
   revng_log(ModelGEPLog, "Computing Best ModelGEP for IRSum: " << IRSum);
   revng_assert(not BaseType.isVoid()
                and not BaseType.is(model::TypeKind::RawFunctionType)
@@ -1522,7 +1573,7 @@ computeBest(const model::QualifiedType &BaseType,
   if (UnwrappedBaseType.isArray()) {
     revng_log(ModelGEPLog, "Array");
     ModelGEPReplacementInfo ArrayResult = rc_recur
-      computeBestInArray(UnwrappedBaseType, IRSum, AccessedTypeOnIR, VH);
+      computeBestInArray(UnwrappedBaseType, IRSum, AccessedTypeOnIR, VH, Memo);
     revng_log(ModelGEPLog, "ArrayResult: " << ArrayResult);
 
     DifferenceScore ArrayBestScore = difference(ArrayResult,
@@ -1549,14 +1600,16 @@ computeBest(const model::QualifiedType &BaseType,
     Result = rc_recur computeBestInStruct(UnwrappedBaseType,
                                           IRSum,
                                           AccessedTypeOnIR,
-                                          VH);
+                                          VH,
+                                          Memo);
   } break;
 
   case model::TypeKind::UnionType: {
     Result = rc_recur computeBestInUnion(UnwrappedBaseType,
                                          IRSum,
                                          AccessedTypeOnIR,
-                                         VH);
+                                         VH,
+                                         Memo);
   } break;
 
   default:
@@ -1566,6 +1619,30 @@ computeBest(const model::QualifiedType &BaseType,
   rc_return Result;
 }
 
+// Memoized version of computeBestImpl. The same BaseType is often traversed
+// with the same IRSum, both by different uses of the same address and by
+// different fields of a union that share the same type.
+static RecursiveCoroutine<ModelGEPReplacementInfo>
+computeBest(const model::QualifiedType &BaseType,
+            const IRSummation &IRSum,
+            const std::optional<model::QualifiedType> &AccessedTypeOnIR,
+            model::VerifyHelper &VH,
+            ComputeBestCache &Memo) {
+  ComputeBestKey Key{ BaseType, IRSum, AccessedTypeOnIR };
+  if (auto It = Memo.find(Key); It != Memo.end()) {
+    revng_log(ModelGEPLog, "Memoized Best ModelGEP: " << It->second);
+    rc_return It->second;
+  }
+
+  ModelGEPReplacementInfo Result = rc_recur computeBestImpl(BaseType,
+                                                            IRSum,
+                                                            AccessedTypeOnIR,
+                                                            VH,
+                                                            Memo);
+  Memo.insert({ std::move(Key), Result });
+  rc_return Result;
+}
+
 static model::QualifiedType getType(const model::QualifiedType &BaseType,
                                     const ChildIndexVector &IndexVector,
                                     model::VerifyHelper &VH) {
@@ -1913,6 +1990,30 @@ getAccessedTypeOnIR(FunctionMetadataCache &Cache,
   return std::nullopt;
 }
 
+// Accesses to an address can happen both via a regular dereference and with
+// the [] operator. In order to try both, wrap \a PointeeType in a fake array
+// with an arbitrary maximum length, in which the best access is computed.
+static model::QualifiedType
+makeFakeArray(const model::QualifiedType &PointeeType,
+              model::Architecture::Values Arch) {
+  model::QualifiedType FakeArray = PointeeType.getPointerTo(Arch);
+  // Now replace the pointer qualifier with an array qualifier with
+  // arbitrary maximum length. Don't use the max value for uint64_t
+  // because it may overflow when computing the array size as array
+  // length * element size.
+  // TODO: MaxArrayLength is arbitrary. On the one hand we should make
+  // it large enough to enable traversals with large indices without
+  // falling back to out-of-bound raw-integer-arithmetic. On the other
+  // hand if we make it too large we hit overflows on computations of
+  // the total size of the array. So UINT32_MAX seemed like a good
+  // compromise, but at some point we might need to handle this
+  // properly.
+  const uint64_t MaxArrayLength = std::numeric_limits<uint32_t>::max();
+  auto LongArray = model::Qualifier::createArray(MaxArrayLength);
+  FakeArray.Qualifiers().front() = std::move(LongArray);
+  return FakeArray;
+}
+
 struct UseReplacementWithModelGEP {
   Use *U;
   Value *BaseAddress;
@@ -1923,7 +2024,8 @@ static std::vector<UseReplacementWithModelGEP>
 makeGEPReplacements(llvm::Function &F,
                     const model::Binary &Model,
                     model::VerifyHelper &VH,
-                    FunctionMetadataCache &Cache) {
+                    FunctionMetadataCache &Cache,
+                    MemoryMetrics &Metrics) {
 
   std::vector<UseReplacementWithModelGEP> Result;
 
@@ -1939,6 +2041,7 @@ makeGEPReplacements(llvm::Function &F,
                                               ModelF,
                                               Model,
                                               /*PointersOnly=*/true);
+  Metrics.recordSize("model_types_map_entries", PointerTypes.size());
   if (PointerTypes.empty()) {
     revng_log(ModelGEPLog, "Model Types not found for " << F.getName());
     return Result;
@@ -1946,6 +2049,10 @@ makeGEPReplacements(llvm::Function &F,
 
   UseTypeMap GEPifiedUsedTypes;
 
+  // The memoized results refer to the llvm::Values of F, which are not changed
+  // until all the replacements are computed.
+  ComputeBestCache BestGEPArgs;
+
   auto RPOT = ReversePostOrderTraversal(&F.getEntryBlock());
   for (auto *BB : RPOT) {
     for (auto &I : *BB) {
@@ -2028,34 +2135,20 @@ makeGEPReplacements(llvm::Function &F,
                                                  GEPifiedUsedTypes);
 
         // Now, compute the best GEP arguments for traversing the PointeeType.
-        //
-        // Notice that we have to try and access the pointer both via a
-        // regular dereference and with the [] operator.
-        // In order to do this, we have to create a fake array qualifier to
-        // wrap around the PointeeType, and compute the best access in there.
         const model::Architecture::Values &Arch = Model.Architecture();
-        model::QualifiedType FakeArray = PointeeType.getPointerTo(Arch);
-        // Now replace the pointer qualifier with an array qualifier with
-        // arbitrary maximum length. Don't use the max value for uint64_t
-        // because it may overflow when computing the array size as array
-        // length * element size.
-        // TODO: MaxArrayLength is arbitrary. On the one hand we should make
-        // it large enough to enable traversals with large indices without
-        // falling back to out-of-bound raw-integer-arithmetic. On the other
-        // hand if we make it too large we hit overflows on computations of
-        // the total size of the array. So UINT32_MAX seemed like a good
-        // compromise, but at some point we might need to handle this
-        // properly.
-        const uint64_t MaxArrayLength = std::numeric_limits<uint32_t>::max();
-        auto LongArray = model::Qualifier::createArray(MaxArrayLength);
-        FakeArray.Qualifiers().front() = std::move(LongArray);
+        model::QualifiedType FakeArray = makeFakeArray(PointeeType, Arch);
 
         // Select among the computed TAPIndices the one which best fits the
         // IRPattern
-        ModelGEPReplacementInfo GEPArgs = computeBest(FakeArray,
-                                                      IRSum,
-                                                      AccessedTypeOnIR,
-                                                      VH);
+        auto ComputeBest = [&]() -> ModelGEPReplacementInfo {
+          TraceSpan Span("computeBest", "make-model-gep", F.getName());
+          return computeBest(FakeArray,
+                             IRSum,
+                             AccessedTypeOnIR,
+                             VH,
+                             BestGEPArgs);
+        };
+        ModelGEPReplacementInfo GEPArgs = ComputeBest();
 
         // Fix up the BaseType. This needs to contain the base type as per the
         // ModelGEP specification, not the fake array.
@@ -2112,6 +2205,40 @@ makeGEPReplacements(llvm::Function &F,
   return Result;
 }
 
+size_t computeBestModelGEPs(const model::QualifiedType &PointeeType,
+                            llvm::ArrayRef<ModelGEPAccess> Accesses,
+                            model::Architecture::Values Architecture,
+                            model::VerifyHelper &VH) {
+  model::QualifiedType FakeArray = makeFakeArray(PointeeType, Architecture);
+  ComputeBestCache BestGEPArgs;
+
+  size_t Result = 0;
+  for (const ModelGEPAccess &Access : Accesses) {
+    // IRSummation wants the addends sorted by decreasing coefficient
+    auto StridedIndices = Access.StridedIndices;
+    llvm::sort(StridedIndices, [](const auto &LHS, const auto &RHS) {
+      return LHS.first > RHS.first;
+    });
+
+    SmallVector<IRAddend> Addends;
+    for (const auto &[Stride, Index] : StridedIndices) {
+      auto *IndexType = Index->getType();
+      auto *Coefficient = ConstantInt::get(IndexType, Stride);
+      Addends.emplace_back(cast<ConstantInt>(Coefficient), Index);
+    }
+
+    IRSummation IRSum(APInt(64, Access.Offset), std::move(Addends));
+    ModelGEPReplacementInfo GEPArgs = computeBest(FakeArray,
+                                                  IRSum,
+                                                  Access.AccessedType,
+                                                  VH,
+                                                  BestGEPArgs);
+    Result += GEPArgs.IndexVector.size();
+  }
+
+  return Result;
+}
+
 class ModelGEPArgCache {
 
   std::map<model::QualifiedType, Constant *> GlobalModelGEPTypeArgs;
@@ -2150,11 +2277,27 @@ static llvm::BasicBlock *getUniqueIncoming(Value *V, PHINode *Phi) {
 }
 
 struct MakeModelGEPPass : public FunctionPass {
+private:
+  // The model is read-only while this pass runs, so the sizes of the model
+  // types memoized by the VerifyHelper can be shared among all the functions,
+  // instead of walking again all the aggregates for each of them.
+  std::unique_ptr<model::VerifyHelper> VH;
+
 public:
   static char ID;
 
   MakeModelGEPPass() : FunctionPass(ID) {}
 
+  bool doInitialization(llvm::Module &M) override {
+    VH = std::make_unique<model::VerifyHelper>();
+    return false;
+  }
+
+  bool doFinalization(llvm::Module &M) override {
+    VH.reset();
+    return false;
+  }
+
   bool runOnFunction(llvm::Function &F) override;
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -2173,8 +2316,10 @@ bool MakeModelGEPPass::runOnFunction(llvm::Function &F) {
   auto &Model = getAnalysis<LoadModelWrapperPass>().get().getReadOnlyModel();
   auto &Cache = getAnalysis<FunctionMetadataCachePass>().get();
 
-  model::VerifyHelper VH;
-  auto GEPReplacements = makeGEPReplacements(F, *Model, VH, Cache);
+  MemoryMetrics Metrics("make-model-gep", F.getName());
+  TraceSpan Span("make-model-gep", "pass", F.getName());
+  auto GEPReplacements = makeGEPReplacements(F, *Model, *VH, Cache, Metrics);
+  Metrics.recordSize("gep_replacements", GEPReplacements.size());
 
   llvm::Module &M = *F.getParent();
   LLVMContext &Ctxt = M.getContext();
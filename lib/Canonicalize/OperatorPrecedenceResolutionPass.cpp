@@ -3,6 +3,7 @@
 //
 
 #include <array>
+#include <memory>
 
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instruction.h"
@@ -131,14 +132,35 @@ static constexpr std::array<const OperatorInfo, 37>
     OperatorInfo{ Instruction::Call, 0, LeftToRight, NAry },
   };
 
-static OperatorInfo
-getPrecedence(const std::array<const OperatorInfo, 37> *Table,
-              unsigned Opcode) {
-  auto It = llvm::find_if(*Table, [&](const auto &Elem) {
-    return Elem.Opcode == Opcode;
-  });
-  revng_assert(It != Table->end());
-  return *It;
+// Tables that map each opcode to its OperatorInfo, so that looking up the
+// precedence of an opcode is a single access. They are built at compile time
+// from the tables above. Opcodes without an entry are left with Opcode 0, which
+// is not a valid opcode.
+static constexpr unsigned OpcodeCount = CustomInstruction::BooleanNot + 1;
+using OpcodeToOperatorInfo = std::array<OperatorInfo, OpcodeCount>;
+
+template<size_t N>
+static constexpr OpcodeToOperatorInfo
+makeOpcodeToOperatorInfo(const std::array<const OperatorInfo, N> &Infos) {
+  OpcodeToOperatorInfo Result{};
+  for (const OperatorInfo &Info : Infos)
+    if (Info.Opcode != 0)
+      Result[Info.Opcode] = Info;
+  return Result;
+}
+
+static constexpr OpcodeToOperatorInfo
+  CPrecedence = makeOpcodeToOperatorInfo(LLVMOpcodeToCOpPrecedenceArray);
+
+static constexpr OpcodeToOperatorInfo
+  NopPrecedence = makeOpcodeToOperatorInfo(LLVMOpcodeToNopOpPrecedenceArray);
+
+static OperatorInfo getPrecedence(const OpcodeToOperatorInfo *Table,
+                                  unsigned Opcode) {
+  revng_assert(Opcode < Table->size());
+  const OperatorInfo &Info = (*Table)[Opcode];
+  revng_assert(Info.Opcode == Opcode);
+  return Info;
 }
 
 static bool isCustomOpcode(const Value *I) {
@@ -262,22 +284,37 @@ static Value *traverseTransparentOpcodes(Value *I) {
 
 struct OperatorPrecedenceResolutionPass : public FunctionPass {
 private:
-  const std::array<const OperatorInfo, 37>
-    *LLVMOpcodeToLangOpPrecedenceArray = nullptr;
+  const OpcodeToOperatorInfo *LLVMOpcodeToLangOpPrecedenceArray = nullptr;
+
+  // No other pass creates parentheses, so the pool is initialized once and
+  // shared among all the functions, instead of scanning the module for each
+  // of them.
+  std::unique_ptr<OpaqueFunctionsPool<Type *>> ParenthesesPool;
 
 public:
   static char ID;
 
   OperatorPrecedenceResolutionPass() : FunctionPass(ID) {
     if (LanguageName == "C" || LanguageName == "c")
-      LLVMOpcodeToLangOpPrecedenceArray = &LLVMOpcodeToCOpPrecedenceArray;
+      LLVMOpcodeToLangOpPrecedenceArray = &CPrecedence;
     else if (LanguageName == "NOP" || LanguageName == "nop")
-      LLVMOpcodeToLangOpPrecedenceArray = &LLVMOpcodeToNopOpPrecedenceArray;
+      LLVMOpcodeToLangOpPrecedenceArray = &NopPrecedence;
     revng_assert(LLVMOpcodeToLangOpPrecedenceArray);
   }
 
+  bool doInitialization(Module &M) override {
+    ParenthesesPool = std::make_unique<OpaqueFunctionsPool<Type *>>(&M, false);
+    initParenthesesPool(*ParenthesesPool);
+    return false;
+  }
+
   bool runOnFunction(Function &F) override;
 
+  bool doFinalization(Module &M) override {
+    ParenthesesPool.reset();
+    return false;
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.setPreservesCFG();
   }
@@ -478,9 +515,6 @@ bool OPRP::needsParentheses(Instruction *I, Use &U) {
 }
 
 bool OPRP::runOnFunction(Function &F) {
-  OpaqueFunctionsPool<Type *> ParenthesesPool(F.getParent(), false);
-  initParenthesesPool(ParenthesesPool);
-
   std::vector<std::pair<Instruction *, Use *>> InstructionsToBeParenthesized;
   for (BasicBlock &BB : F)
     for (Instruction &I : BB)
@@ -501,10 +535,10 @@ bool OPRP::runOnFunction(Function &F) {
 
     Type *OpToReplaceType = I->getOperand(Op->getOperandNo())->getType();
 
-    auto *ParenthesisFunction = ParenthesesPool.get(OpToReplaceType,
-                                                    OpToReplaceType,
-                                                    { Ins->getType() },
-                                                    "parentheses");
+    auto *ParenthesisFunction = ParenthesesPool->get(OpToReplaceType,
+                                                     OpToReplaceType,
+                                                     { Ins->getType() },
+                                                     "parentheses");
     Value *Call = Builder.CreateCall(ParenthesisFunction, { Ins });
     I->setOperand(Op->getOperandNo(), Call);
   }
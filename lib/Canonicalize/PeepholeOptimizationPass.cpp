@@ -2,7 +2,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
@@ -92,7 +95,9 @@ static bool replaceNonConstantOperandWithAddSub(Instruction &I,
   return true;
 }
 
-static bool reusePHIIncomings(PHINode &PHI, const DominatorTree &DT) {
+using GetDominatorTree = function_ref<const DominatorTree &()>;
+
+static bool reusePHIIncomings(PHINode &PHI, GetDominatorTree GetDT) {
   // Ignore non-integers
   if (not PHI.getType()->isIntegerTy())
     return false;
@@ -134,30 +139,36 @@ static bool reusePHIIncomings(PHINode &PHI, const DominatorTree &DT) {
     // operands.
 
     BasicBlock *AddSubBlock = AddSub->getParent();
+    const DominatorTree &DT = GetDT();
 
     revng_log(Log, "Look for instruction that can be rewritten using AddSub");
     LoggerIndent MoreIndent{ Log };
-    // Start looking in remainder of the same block of Incoming.
-    {
-      revng_log(Log, "In Block: " << AddSubBlock->getName());
-      LoggerIndent MoreIndent{ Log };
-      auto AfterIncoming = std::next(AddSub->getIterator());
-      auto BinaryOpBlockEnd = AddSubBlock->getTerminator()->getIterator();
-      for (Instruction &I : llvm::make_range(AfterIncoming, BinaryOpBlockEnd))
-        Changed |= replaceNonConstantOperandWithAddSub(I, AddSub, Builder);
-    }
 
-    // Then look at all the other blocks dominated by Incoming.
-    for (auto *DominatorNode : llvm::depth_first(DT.getNode(IncomingBlock))) {
-      BasicBlock *BB = DominatorNode->getBlock();
-      if (BB == AddSubBlock)
+    // Only the users of the non-constant operand of AddSub can be rewritten to
+    // use AddSub instead. Among them, we consider the ones in the remainder of
+    // the block of AddSub, and the ones in the other blocks dominated by
+    // IncomingBlock.
+    // Collect them first, because rewriting them changes the uses of the
+    // operand.
+    SmallVector<Instruction *, 8> Candidates;
+    for (User *U : AddSub->getOperand(0)->users()) {
+      auto *I = dyn_cast<Instruction>(U);
+      if (not I)
         continue;
 
-      revng_log(Log, "In Block: " << BB->getName());
-      LoggerIndent MoreIndent{ Log };
+      BasicBlock *BB = I->getParent();
+      if (BB == AddSubBlock) {
+        if (AddSub->comesBefore(I))
+          Candidates.push_back(I);
+      } else if (DT.isReachableFromEntry(BB)
+                 and DT.dominates(IncomingBlock, BB)) {
+        Candidates.push_back(I);
+      }
+    }
 
-      for (Instruction &I : *BB)
-        Changed |= replaceNonConstantOperandWithAddSub(I, AddSub, Builder);
+    for (Instruction *I : Candidates) {
+      revng_log(Log, "In Block: " << I->getParent()->getName());
+      Changed |= replaceNonConstantOperandWithAddSub(*I, AddSub, Builder);
     }
   }
 
@@ -168,11 +179,20 @@ bool PeepholeOptimizationPass::runOnFunction(Function &F) {
   revng_log(Log, "Peephole For Decompilation: " << F.getName());
   LoggerIndent Indent{ Log };
   bool Changed = false;
-  DominatorTree DT;
-  DT.recalculate(F);
+
+  // Most PHIs have no incoming value to reuse, and many functions have no
+  // PHIs at all: build the dominator tree only once the first one is found.
+  // The pass doesn't change the CFG, so it stays valid from then on.
+  std::optional<DominatorTree> DT;
+  const auto GetDT = [&DT, &F]() -> const DominatorTree & {
+    if (not DT)
+      DT.emplace(F);
+    return *DT;
+  };
+
   for (BasicBlock &B : F) {
     for (PHINode &PHI : B.phis()) {
-      Changed |= reusePHIIncomings(PHI, DT);
+      Changed |= reusePHIIncomings(PHI, GetDT);
     }
   }
   return Changed;
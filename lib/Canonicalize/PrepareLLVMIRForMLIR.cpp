@@ -134,22 +134,46 @@ static void adjustRevngMetadata(Module &M) {
   }
 }
 
+static bool needsName(llvm::Type *Type) {
+  auto *ST = llvm::dyn_cast<llvm::StructType>(Type);
+  return ST != nullptr and not ST->isLiteral() and not ST->hasName();
+}
+
 static void setStructNameIfNeeded(llvm::Type *Type,
                                   const model::Type &Prototype) {
-  if (llvm::StructType *ST = llvm::dyn_cast<llvm::StructType>(Type)) {
-    if (not ST->isLiteral() and not ST->hasName()) {
-      if (llvm::isa<model::CABIFunctionType>(Prototype))
-        ST->setName("struct_returned_by_cft_" + std::to_string(Prototype.ID()));
-      else if (llvm::isa<model::RawFunctionType>(Prototype))
-        ST->setName("struct_returned_by_rft_" + std::to_string(Prototype.ID()));
-      else
-        revng_abort("Non-FunctionType prototypes are no allowed.");
-    }
+  if (needsName(Type)) {
+    llvm::StructType *ST = llvm::cast<llvm::StructType>(Type);
+    if (llvm::isa<model::CABIFunctionType>(Prototype))
+      ST->setName("struct_returned_by_cft_" + std::to_string(Prototype.ID()));
+    else if (llvm::isa<model::RawFunctionType>(Prototype))
+      ST->setName("struct_returned_by_rft_" + std::to_string(Prototype.ID()));
+    else
+      revng_abort("Non-FunctionType prototypes are no allowed.");
   }
 }
 
+static const model::Type *getPrototype(const model::Binary &Model,
+                                       const llvm::Function &F,
+                                       bool IsIsolated) {
+  if (IsIsolated) {
+    const model::Function *ModelFunc = llvmToModelFunction(Model, F);
+    return ModelFunc->Prototype().getConst();
+  }
+
+  llvm::StringRef SymbolName = F.getName().drop_front(strlen("dynamic_"));
+  auto It = Model.ImportedDynamicFunctions().find(SymbolName.str());
+  revng_assert(It != Model.ImportedDynamicFunctions().end());
+  const auto &TTR = It->prototype(Model);
+  revng_assert(TTR.isValid());
+  return TTR.getConst();
+}
+
 /// Give a name to all anonymous structs, because LLVM MLIR dialect does not
 /// expect nameless structs. Only literals can be anonymous.
+///
+/// Prototypes are looked up in the model only for the functions and the call
+/// sites that actually return a struct still without a name, which is usually
+/// a small fraction of them, since many share the same struct.
 static void adjustAnonymousStructs(Module &M, const model::Binary &Model) {
   using PTMLCBuilder = ptml::PTMLCBuilder;
   PTMLCBuilder B(/*GeneratePlainC*/ true);
@@ -164,32 +188,24 @@ static void adjustAnonymousStructs(Module &M, const model::Binary &Model) {
         and not FunctionTags.contains(FunctionTags::DynamicFunction))
       continue;
 
-    const model::Type *Prototype = nullptr;
-    if (IsIsolated) {
-      const model::Function *ModelFunc = llvmToModelFunction(Model, F);
-      Prototype = ModelFunc->Prototype().getConst();
-    } else if (FunctionTags.contains(FunctionTags::DynamicFunction)) {
-      llvm::StringRef SymbolName = F.getName().drop_front(strlen("dynamic_"));
-      auto It = Model.ImportedDynamicFunctions().find(SymbolName.str());
-      revng_assert(It != Model.ImportedDynamicFunctions().end());
-      const auto &TTR = It->prototype(Model);
-      revng_assert(TTR.isValid());
-      Prototype = TTR.getConst();
-    }
-
-    revng_assert(Prototype);
-
     for (Argument &Argument : F.args())
       revng_assert(not Argument.getType()->isStructTy());
 
     llvm::Type *ReturnType = F.getReturnType();
-    setStructNameIfNeeded(ReturnType, *Prototype);
+    if (needsName(ReturnType)) {
+      const model::Type *Prototype = getPrototype(Model, F, IsIsolated);
+      revng_assert(Prototype);
+      setStructNameIfNeeded(ReturnType, *Prototype);
+    }
 
     // Look for all the call sites: they might return anonymous structs too
     for (Instruction &I : llvm::instructions(F)) {
       auto *T = I.getType();
+      if (not needsName(T))
+        continue;
+
       CallInst *Ins = getCallToIsolatedFunction(&I);
-      if (Ins != nullptr and T->isStructTy())
+      if (Ins != nullptr)
         setStructNameIfNeeded(T, *Cache.getCallSitePrototype(Model, Ins).get());
     }
   }
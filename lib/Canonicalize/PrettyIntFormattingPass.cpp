@@ -3,6 +3,7 @@
 //
 
 #include <array>
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -47,14 +48,53 @@ public:
 
   PrettyIntFormatting() : llvm::FunctionPass(ID) {}
 
+  bool doInitialization(llvm::Module &M) override;
+
   bool runOnFunction(llvm::Function &F) override;
 
+  bool doFinalization(llvm::Module &M) override;
+
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
     AU.setPreservesCFG();
     AU.addRequired<LoadModelWrapperPass>();
   }
+
+private:
+  using PrintPool = OpaqueFunctionsPool<llvm::Type *>;
+
+  // No other pass creates these functions, so the pools can be initialized
+  // once and shared among all the functions, instead of scanning the module
+  // for each of them.
+  std::unique_ptr<PrintPool> HexIntegerPool;
+  std::unique_ptr<PrintPool> CharIntegerPool;
+  std::unique_ptr<PrintPool> BoolIntegerPool;
+  std::unique_ptr<PrintPool> NullPtrPool;
 };
 
+bool PrettyIntFormatting::doInitialization(llvm::Module &M) {
+  HexIntegerPool = std::make_unique<PrintPool>(&M, false);
+  initHexPrintPool(*HexIntegerPool);
+
+  CharIntegerPool = std::make_unique<PrintPool>(&M, false);
+  initCharPrintPool(*CharIntegerPool);
+
+  BoolIntegerPool = std::make_unique<PrintPool>(&M, false);
+  initBoolPrintPool(*BoolIntegerPool);
+
+  NullPtrPool = std::make_unique<PrintPool>(&M, false);
+  initNullPtrPrintPool(*NullPtrPool);
+
+  return false;
+}
+
+bool PrettyIntFormatting::doFinalization(llvm::Module &M) {
+  HexIntegerPool.reset();
+  CharIntegerPool.reset();
+  BoolIntegerPool.reset();
+  NullPtrPool.reset();
+  return false;
+}
+
 bool PrettyIntFormatting::runOnFunction(llvm::Function &F) {
 
   if (not FunctionTags::TagsSet::from(&F).contains(FunctionTags::Isolated))
@@ -63,18 +103,6 @@ bool PrettyIntFormatting::runOnFunction(llvm::Function &F) {
   const model::Binary
     &Model = *getAnalysis<LoadModelWrapperPass>().get().getReadOnlyModel();
 
-  OpaqueFunctionsPool<llvm::Type *> HexIntegerPool(F.getParent(), false);
-  initHexPrintPool(HexIntegerPool);
-
-  OpaqueFunctionsPool<llvm::Type *> CharIntegerPool(F.getParent(), false);
-  initCharPrintPool(CharIntegerPool);
-
-  OpaqueFunctionsPool<llvm::Type *> BoolIntegerPool(F.getParent(), false);
-  initBoolPrintPool(BoolIntegerPool);
-
-  OpaqueFunctionsPool<llvm::Type *> NullPtrPool(F.getParent(), false);
-  initNullPtrPrintPool(NullPtrPool);
-
   std::vector<FormatInt> IntsToBeFormatted;
 
   for (llvm::Instruction &I : llvm::instructions(F)) {
@@ -93,13 +121,19 @@ bool PrettyIntFormatting::runOnFunction(llvm::Function &F) {
     auto PrettyFunction = [&, Format = Format]() -> llvm::Function * {
       switch (Format) {
       case IntFormatting::HEX:
-        return HexIntegerPool.get(IntType, IntType, { IntType }, "print_hex");
+        return HexIntegerPool->get(IntType, IntType, { IntType }, "print_hex");
       case IntFormatting::CHAR:
-        return CharIntegerPool.get(IntType, IntType, { IntType }, "print_char");
+        return CharIntegerPool->get(IntType,
+                                    IntType,
+                                    { IntType },
+                                    "print_char");
       case IntFormatting::BOOL:
-        return BoolIntegerPool.get(IntType, IntType, { IntType }, "print_bool");
+        return BoolIntegerPool->get(IntType,
+                                    IntType,
+                                    { IntType },
+                                    "print_bool");
       case IntFormatting::NULLPTR:
-        return NullPtrPool.get(IntType, IntType, { IntType }, "print_nullptr");
+        return NullPtrPool->get(IntType, IntType, { IntType }, "print_nullptr");
       case IntFormatting::NONE:
       default:
         return nullptr;
@@ -40,20 +40,49 @@ public:
 using llvm::dyn_cast;
 using model::QualifiedType;
 
+/// \return the value whose address \a Pointer is, if \a Pointer is an
+///         AddressOf with \a PointedType as its type.
+static llvm::Value *getAddressOfOperand(llvm::Value *Pointer,
+                                        const QualifiedType &PointedType,
+                                        const model::Binary &Model) {
+  llvm::Value *Base = traverseTransparentInstructions(Pointer);
+  llvm::CallInst *AddressOf = getCallToTagged(Base, FunctionTags::AddressOf);
+  if (AddressOf == nullptr)
+    return nullptr;
+
+  llvm::Value *AddressOfTypeArg = AddressOf->getArgOperand(0);
+  if (deserializeFromLLVMString(AddressOfTypeArg, Model) != PointedType)
+    return nullptr;
+
+  return AddressOf->getArgOperand(1);
+}
+
 static llvm::CallInst *buildDerefCall(llvm::Module &M,
                                       llvm::IRBuilder<> &Builder,
                                       llvm::Value *Arg,
                                       model::QualifiedType &PointedType,
-                                      llvm::Type *ReturnType) {
+                                      llvm::Type *ReturnType,
+                                      const model::Binary &Model) {
   llvm::Type *BaseType = Arg->getType();
 
-  auto *ModelGEPFunction = getModelGEP(M, ReturnType, BaseType);
-
   // The first argument is always a pointer to a constant global variable
   // that holds the string representing the yaml serialization of the
   // qualified type of the base type of the modelGEP
   auto *BaseTypeConstantStrPtr = serializeToLLVMString(PointedType, M);
 
+  // Dereferencing the address of a value with the same type yields the value
+  // itself, e.g., a local variable: refer to it directly, as fold-model-gep
+  // would do later on, instead of building a ModelGEP just to be folded.
+  if (llvm::Value *Referenced = getAddressOfOperand(Arg, PointedType, Model)) {
+    auto *ModelGEPRefFunction = getModelGEPRef(M,
+                                               ReturnType,
+                                               Referenced->getType());
+    return Builder.CreateCall(ModelGEPRefFunction,
+                              { BaseTypeConstantStrPtr, Referenced });
+  }
+
+  auto *ModelGEPFunction = getModelGEP(M, ReturnType, BaseType);
+
   // The second argument is the base address, and the third (representing the
   // array access) is defaulted to 0, representing regular pointer access (not
   // array access).
@@ -123,7 +152,8 @@ bool RemoveLoadStore::runOnFunction(llvm::Function &F) {
                                          Builder,
                                          PtrOp,
                                          PointedType,
-                                         Load->getType());
+                                         Load->getType(),
+                                         *Model);
 
         // Create a Copy to dereference the ModelGEP
         auto *CopyFnType = getCopyType(DerefCall->getType());
@@ -170,7 +200,8 @@ bool RemoveLoadStore::runOnFunction(llvm::Function &F) {
                                          Builder,
                                          PointerOp,
                                          StoredQT,
-                                         ValueOp->getType());
+                                         ValueOp->getType(),
+                                         *Model);
 
         // Add the dereferenced type to the type map
         TypeMap.insert({ DerefCall, StoredQT });
@@ -10,7 +10,11 @@
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
@@ -28,7 +32,6 @@
 #include "revng/ADT/SmallMap.h"
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
 #include "revng/MFP/MFP.h"
-#include "revng/MFP/SetLattices.h"
 #include "revng/Model/Binary.h"
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Support/Debug.h"
@@ -75,7 +78,57 @@ struct AvailableExpression {
   std::strong_ordering operator<=>(const AvailableExpression &) const = default;
 };
 
-using AvailableSet = std::set<AvailableExpression>;
+// All the AvailableExpressions that can be generated by the program points of a
+// function, sorted.
+// This allows to represent each set of AvailableExpressions as a BitVector over
+// their indices, with all the AvailableExpressions of the same Expression
+// assigned to contiguous indices.
+class AvailableExpressionsIndex {
+private:
+  std::vector<AvailableExpression> Expressions;
+
+public:
+  AvailableExpressionsIndex() = default;
+
+  AvailableExpressionsIndex(const std::set<AvailableExpression> &Availables) :
+    Expressions(Availables.begin(), Availables.end()) {}
+
+public:
+  size_t size() const { return Expressions.size(); }
+
+  ArrayRef<AvailableExpression> expressions() const { return Expressions; }
+
+  const AvailableExpression &operator[](size_t Index) const {
+    return Expressions[Index];
+  }
+
+  size_t indexOf(const AvailableExpression &A) const {
+    auto It = llvm::lower_bound(Expressions, A);
+    revng_assert(It != Expressions.end() and *It == A);
+    return std::distance(Expressions.begin(), It);
+  }
+
+  /// \return the range of indices of the AvailableExpressions of \a I
+  std::pair<size_t, size_t> getRange(Instruction *I) const {
+    auto Begin = llvm::lower_bound(Expressions,
+                                   AvailableExpression{ .Expression = I,
+                                                        .Assign = nullptr });
+    auto End = llvm::lower_bound(Expressions,
+                                 AvailableExpression{
+                                   .Expression = std::next(I),
+                                   .Assign = nullptr });
+    return { std::distance(Expressions.begin(), Begin),
+             std::distance(Expressions.begin(), End) };
+  }
+};
+
+// A set of AvailableExpressions, represented as a BitVector over the indices of
+// an AvailableExpressionsIndex.
+using AvailableSet = BitVector;
+
+// Maps each Copy and Assign that accesses local variables to the local variable
+// it accesses, or to nullptr if it may access many of them.
+using AccessedLocalVariableMap = DenseMap<const Instruction *, const Value *>;
 
 constexpr size_t SmallSize = 8;
 using InstructionVector = SmallVector<Instruction *, SmallSize>;
@@ -86,12 +139,15 @@ struct ProgramPointData {
   ProgramPointData(Instruction *I) : TheInstruction(I){};
 };
 
-static auto findAvailableRange(const AvailableSet &Availables, Instruction *I) {
-  auto Begin = Availables.lower_bound(AvailableExpression{ .Expression = I,
-                                                           .Assign = nullptr });
-  auto End = Availables.upper_bound(AvailableExpression{
-    .Expression = std::next(I), .Assign = nullptr });
-  return llvm::make_range(Begin, End);
+static auto findAvailableRange(const AvailableExpressionsIndex &Index,
+                               const AvailableSet &Availables,
+                               Instruction *I) {
+  ArrayRef<AvailableExpression> All = Index.expressions();
+  auto IsAvailable = [All, &Availables](const AvailableExpression &A) {
+    return Availables.test(&A - All.data());
+  };
+  auto [Begin, End] = Index.getRange(I);
+  return llvm::make_filter_range(All.slice(Begin, End - Begin), IsAvailable);
 }
 
 using ProgramPointNode = BidirectionalNode<ProgramPointData>;
@@ -106,14 +162,21 @@ struct AvailableExpressionsAnalysis {
   using Label = ProgramPointNode *;
   using MFPResult = MFP::MFPResult<ALA::LatticeElement>;
 
+  const AvailableExpressionsIndex &Index;
+  const AccessedLocalVariableMap &AccessedVariables;
+
   ALA::LatticeElement combineValues(const ALA::LatticeElement &LHS,
                                     const ALA::LatticeElement &RHS) const {
-    return SetIntersectionLattice<LatticeElement>::combineValues(LHS, RHS);
+    ALA::LatticeElement Result = LHS;
+    Result &= RHS;
+    return Result;
   }
 
   bool isLessOrEqual(const ALA::LatticeElement &LHS,
                      const ALA::LatticeElement &RHS) const {
-    return SetIntersectionLattice<LatticeElement>::isLessOrEqual(LHS, RHS);
+    // This is an intersection lattice, so LHS is lower if it's a superset of
+    // RHS, i.e. if RHS has no element that is not in LHS.
+    return not RHS.test(LHS);
   }
 
   ALA::LatticeElement applyTransferFunction(ProgramPointNode *L,
@@ -191,7 +254,7 @@ getAccessedLocalVariableFromModelGEP(const CallInst *ModelGEPRefCall) {
 }
 
 static std::optional<const Value *>
-getAccessedLocalVariable(const Instruction *I) {
+computeAccessedLocalVariable(const Instruction *I) {
 
   // If it's not a Copy not an Assign then it's not an access to a local
   // variable.
@@ -221,12 +284,36 @@ getAccessedLocalVariable(const Instruction *I) {
   return getAccessedLocalVariableFromModelGEP(ModelGEPRef);
 }
 
-static bool localVariablesNoAlias(const Instruction *I, const Instruction *J) {
+static AccessedLocalVariableMap computeAccessedLocalVariables(Function &F) {
+  AccessedLocalVariableMap Result;
+  for (const Instruction &I : llvm::instructions(F)) {
+    std::optional<const Value *> Accessed = computeAccessedLocalVariable(&I);
+    if (Accessed.has_value())
+      Result[&I] = *Accessed;
+  }
+  return Result;
+}
+
+static std::optional<const Value *>
+getAccessedLocalVariable(const Instruction *I,
+                         const AccessedLocalVariableMap &AccessedVariables) {
+  auto It = AccessedVariables.find(I);
+  if (It == AccessedVariables.end())
+    return std::nullopt;
+  return It->second;
+}
+
+static bool
+localVariablesNoAlias(const Instruction *I,
+                      const Instruction *J,
+                      const AccessedLocalVariableMap &AccessedVariables) {
 
   // Copies from local variables never alias anyone else, except other
   // instructions that copy or assign the same local variable
-  std::optional<const Value *> MayBeAccessedByI = getAccessedLocalVariable(I);
-  std::optional<const Value *> MayBeAccessedByJ = getAccessedLocalVariable(J);
+  std::optional<const Value *>
+    MayBeAccessedByI = getAccessedLocalVariable(I, AccessedVariables);
+  std::optional<const Value *>
+    MayBeAccessedByJ = getAccessedLocalVariable(J, AccessedVariables);
 
   // If either doesn't access a local variable, they are noAlias.
   if (not MayBeAccessedByI.has_value() or not MayBeAccessedByJ.has_value())
@@ -250,7 +337,9 @@ static bool doesNotAccessMemory(const Instruction *I) {
   return Call and Call->getMemoryEffects().doesNotAccessMemory();
 }
 
-static bool noAlias(const Instruction *I, const Instruction *J) {
+static bool noAlias(const Instruction *I,
+                    const Instruction *J,
+                    const AccessedLocalVariableMap &AccessedVariables) {
   revng_log(Log, "noAlias?");
   LoggerIndent X{ Log };
   revng_log(Log, "I: " << dumpToString(I));
@@ -268,7 +357,7 @@ static bool noAlias(const Instruction *I, const Instruction *J) {
   // TODO: this is a poor's man alias analysis, which only explicitly handles
   // stuff that is frequent and that we care about. In the future we have plans
   // to replace it with a full fledged AliasAnalysis from LLVM
-  if (localVariablesNoAlias(I, J)) {
+  if (localVariablesNoAlias(I, J, AccessedVariables)) {
     revng_log(Log, "I and J both access local variables that do not alias");
     return true;
   }
@@ -281,7 +370,11 @@ static bool noAlias(const Instruction *I, const Instruction *J) {
   return false;
 }
 
-static void applyTransferFunction(Instruction *I, LatticeElement &E) {
+static void
+applyTransferFunction(Instruction *I,
+                      const AvailableExpressionsIndex &Index,
+                      const AccessedLocalVariableMap &AccessedVariables,
+                      LatticeElement &E) {
 
   revng_log(Log, "applyTransferFunction on Instruction: " << dumpToString(I));
   LoggerIndent X{ Log };
@@ -289,20 +382,20 @@ static void applyTransferFunction(Instruction *I, LatticeElement &E) {
   if (isStatement(I)) {
     revng_log(Log, "isStatement");
     LoggerIndent XX{ Log };
-    for (const AvailableExpression &A : llvm::make_early_inc_range(E)) {
-      const auto &[Available, Assign] = A;
+    for (unsigned AvailableIndex : E.set_bits()) {
+      const auto &[Available, Assign] = Index[AvailableIndex];
       revng_log(Log, "Available: " << dumpToString(Available));
       revng_log(Log, "Assign: " << dumpToString(Assign));
       LoggerIndent XXX{ Log };
-      if (not noAlias(I, Available)) {
+      if (not noAlias(I, Available, AccessedVariables)) {
         revng_log(Log, "Available: " << dumpToString(Available));
         revng_log(Log, "is not noAlias (MayAlias) with I");
         revng_log(Log, "erase Available");
-        E.erase(A);
-      } else if (not noAlias(I, Assign)) {
+        E.reset(AvailableIndex);
+      } else if (not noAlias(I, Assign, AccessedVariables)) {
         revng_log(Log, "Assign: " << dumpToString(Assign));
         revng_log(Log, "erase Available");
-        E.erase(A);
+        E.reset(AvailableIndex);
       } else {
         revng_log(Log, "is noAlias with I");
       }
@@ -315,19 +408,19 @@ static void applyTransferFunction(Instruction *I, LatticeElement &E) {
       revng_log(Log,
                 "insert Available: " << dumpToString(Assign->getArgOperand(0)));
       revng_log(Log, "       Assign: " << dumpToString(Assign));
-      E.insert(AvailableExpression{
+      E.set(Index.indexOf(AvailableExpression{
         .Expression = cast<Instruction>(Assign->getArgOperand(0)),
         .Assign = Assign,
-      });
+      }));
     }
   }
 
   if (mayReadMemory(*I)) {
     revng_log(Log, "mayReadMemory -> insert Available: I");
-    E.insert(AvailableExpression{
+    E.set(Index.indexOf(AvailableExpression{
       .Expression = I,
       .Assign = nullptr,
-    });
+    }));
   }
 }
 
@@ -344,18 +437,20 @@ LatticeElement ALA::applyTransferFunction(ProgramPointNode *ProgramPoint,
   revng_log(Log, "initial set");
   if (Log.isEnabled()) {
     LoggerIndent X{ Log };
-    for (const auto &[Available, Assign] : Result) {
+    for (unsigned AvailableIndex : Result.set_bits()) {
+      const auto &[Available, Assign] = Index[AvailableIndex];
       revng_log(Log, "Available: " << dumpToString(Available));
       revng_log(Log, "Assign: " << dumpToString(Assign));
     }
   }
 
-  ::applyTransferFunction(I, Result);
+  ::applyTransferFunction(I, Index, AccessedVariables, Result);
 
   revng_log(Log, "final set");
   if (Log.isEnabled()) {
     LoggerIndent X{ Log };
-    for (const auto &[Available, Assign] : Result) {
+    for (unsigned AvailableIndex : Result.set_bits()) {
+      const auto &[Available, Assign] = Index[AvailableIndex];
       revng_log(Log, "Available: " << dumpToString(Available));
       revng_log(Log, "Assign: " << dumpToString(Assign));
     }
@@ -382,6 +477,8 @@ struct ProgramPointsGraphWithInstructionMap {
   InstructionProgramPoint ProgramPoint;
   InstructionProgramPoint PreviousProgramPointInBlock;
   InstructionProgramPoint NextProgramPointInBlock;
+  AvailableExpressionsIndex Availables;
+  AccessedLocalVariableMap AccessedLocalVariables;
 
   auto getAvailableAt(Instruction *I,
                       const Instruction *Where,
@@ -397,7 +494,7 @@ struct ProgramPointsGraphWithInstructionMap {
 
       ProgramPointNode *UserProgramPoint = ProgramPointIt->second;
       const AvailableSet &Available = MFPResultMap.at(UserProgramPoint).InValue;
-      return findAvailableRange(Available, I);
+      return findAvailableRange(Availables, Available, I);
     }
 
     auto PreviousPointIt = PreviousProgramPointInBlock.find(Where);
@@ -410,7 +507,7 @@ struct ProgramPointsGraphWithInstructionMap {
                   << dumpToString(UserProgramPoint->TheInstruction));
       const AvailableSet &Available = MFPResultMap.at(UserProgramPoint)
                                         .OutValue;
-      return findAvailableRange(Available, I);
+      return findAvailableRange(Availables, Available, I);
     }
 
     auto NextProgramPointIt = NextProgramPointInBlock.find(Where);
@@ -422,7 +519,7 @@ struct ProgramPointsGraphWithInstructionMap {
                 "first ProgramPoint in BasicBlock: "
                   << dumpToString(UserProgramPoint->TheInstruction));
       const AvailableSet &Available = MFPResultMap.at(UserProgramPoint).InValue;
-      return findAvailableRange(Available, I);
+      return findAvailableRange(Availables, Available, I);
     }
 
     revng_abort();
@@ -516,16 +613,14 @@ makeProgramPointsWithInstructionsGraph(Function &F) {
   // instead of iterating in sparse order.
   TheCFG.setEntryNode(BlockToBeginEndNode.at(&F.getEntryBlock()).first);
 
-  return Result;
-}
-
-static ResultMap getMFP(ProgramPointsCFG *TheGraph) {
-  AvailableSet Bottom;
-  for (ProgramPointNode *N : llvm::nodes(TheGraph)) {
+  // Finally, collect all the AvailableExpressions that can be generated by the
+  // program points.
+  std::set<AvailableExpression> Availables;
+  for (ProgramPointNode *N : llvm::nodes(&TheCFG)) {
     Instruction *I = N->TheInstruction;
 
     if (mayReadMemory(*I)) {
-      Bottom.insert(AvailableExpression{
+      Availables.insert(AvailableExpression{
         .Expression = I,
         .Assign = nullptr,
       });
@@ -533,16 +628,30 @@ static ResultMap getMFP(ProgramPointsCFG *TheGraph) {
 
     if (auto *Assign = getCallToTagged(I, FunctionTags::Assign)) {
       if (isa<Instruction>(Assign->getArgOperand(0))) {
-        Bottom.insert(AvailableExpression{
+        Availables.insert(AvailableExpression{
           .Expression = cast<Instruction>(Assign->getArgOperand(0)),
           .Assign = Assign,
         });
       }
     }
   }
+  Result.Availables = AvailableExpressionsIndex(Availables);
+
+  Result.AccessedLocalVariables = computeAccessedLocalVariables(F);
+
+  return Result;
+}
+
+static ResultMap getMFP(PPGWithInstructionMap &Graph) {
+  ProgramPointsCFG *TheGraph = &Graph.ProgramPointsGraph;
+  const AvailableExpressionsIndex &Index = Graph.Availables;
+  const AccessedLocalVariableMap &AccessedVariables = Graph
+                                                        .AccessedLocalVariables;
 
-  AvailableSet Empty{};
-  return MFP::getMaximalFixedPoint<ALA>({},
+  // Bottom is the set of all the AvailableExpressions
+  AvailableSet Bottom(Index.size(), true);
+  AvailableSet Empty(Index.size(), false);
+  return MFP::getMaximalFixedPoint<ALA>(ALA{ Index, AccessedVariables },
                                         TheGraph,
                                         Bottom,
                                         Empty,
@@ -726,10 +835,13 @@ private:
             continue;
           }
 
+          const auto &Accessed = Graph.AccessedLocalVariables;
           std::optional<const Value *>
-            MayBeAccessedByUser = getAccessedLocalVariable(UserAssignCall);
+            MayBeAccessedByUser = getAccessedLocalVariable(UserAssignCall,
+                                                           Accessed);
           std::optional<const Value *>
-            MayBeAccessedBySelected = getAccessedLocalVariable(Selected);
+            MayBeAccessedBySelected = getAccessedLocalVariable(Selected,
+                                                               Accessed);
 
           // If either doesn't access a local variable, we have to read from
           // there.
@@ -1045,7 +1157,7 @@ bool SwitchToStatements::runOnFunction(Function &F) {
   ProgramPointsGraphWithInstructionMap
     Graph = makeProgramPointsWithInstructionsGraph(F);
 
-  ResultMap Result = getMFP(&Graph.ProgramPointsGraph);
+  ResultMap Result = getMFP(Graph);
 
   auto &ModelWrapper = getAnalysis<LoadModelWrapperPass>().get();
   const TupleTree<model::Binary> &Model = ModelWrapper.getReadOnlyModel();
@@ -141,160 +141,157 @@ bool TANP::runOnFunction(llvm::Function &F) {
       Value *Val = nullptr;
       const APInt *Int = nullptr;
 
-      if ((match(&I, m_Xor(m_Value(Val), m_APInt(Int)))
-           or match(&I, m_Xor(m_APInt(Int), m_Value(Val))))
-          and Int->isAllOnesValue()) {
-        BuildBinaryNot.SetInsertPoint(&I);
-        NewV = BuildBinaryNot(I.getType(), Val);
-
-      } else if (match(&I, m_Add(m_Value(Val), m_APInt(Int)))
-                 and Int->isNegative()) {
-        Builder.SetInsertPoint(&I);
-        NewV = Builder.CreateSub(Val,
-                                 ConstantInt::get(I.getType(), ~(*Int) + 1));
-      } else if (match(&I, m_Sub(m_Value(Val), m_APInt(Int)))
-                 and Int->isNegative()) {
-        Builder.SetInsertPoint(&I);
-        NewV = Builder.CreateAdd(Val,
-                                 ConstantInt::get(I.getType(), ~(*Int) + 1));
-      } else if ((match(&I, m_Mul(m_Value(Val), m_APInt(Int)))
-                  or match(&I, m_Mul(m_APInt(Int), m_Value(Val))))
-                 and Int->isNegative()) {
+      // Rebuild I, a binary operator with the negative constant Int as the
+      // operand at ConstantIndex and Val as the other one, replacing Int with
+      // a unary_minus of its absolute value.
+      const auto NegateConstantOperand = [&](unsigned ConstantIndex)
+        -> Value * {
         const auto IntType = Val->getType();
-
-        if (Int->isSignBitSet()
-            and Int->isSignedIntN(IntType->getIntegerBitWidth())) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(Val->getType(), *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateMul(Val, UnaryMinus);
+        if (not Int->isSignBitSet()
+            or not Int->isSignedIntN(IntType->getIntegerBitWidth()))
+          return nullptr;
+
+        BuildUnaryMinus.SetInsertPoint(&I);
+        auto UnaryMinus = BuildUnaryMinus(IntType, *Int);
+        Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
+        auto Opcode = cast<BinaryOperator>(I).getOpcode();
+        if (ConstantIndex == 0)
+          return Builder.CreateBinOp(Opcode, UnaryMinus, Val);
+        return Builder.CreateBinOp(Opcode, Val, UnaryMinus);
+      };
+
+      // Dispatch on the opcode, so that each instruction is only matched
+      // against the patterns that can apply to it
+      switch (I.getOpcode()) {
+
+      case Instruction::Xor: {
+        if ((match(&I, m_Xor(m_Value(Val), m_APInt(Int)))
+             or match(&I, m_Xor(m_APInt(Int), m_Value(Val))))
+            and Int->isAllOnesValue()) {
+          BuildBinaryNot.SetInsertPoint(&I);
+          NewV = BuildBinaryNot(I.getType(), Val);
         }
-
-      } else if (match(&I, m_SDiv(m_Value(Val), m_APInt(Int)))
-                 and Int->isNegative()) {
-
-        const auto IntType = Val->getType();
-
-        if (Int->isSignBitSet()
-            and Int->isSignedIntN(IntType->getIntegerBitWidth())) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(Val->getType(), *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateSDiv(Val, UnaryMinus);
+      } break;
+
+      case Instruction::Add: {
+        if (match(&I, m_Add(m_Value(Val), m_APInt(Int)))
+            and Int->isNegative()) {
+          Builder.SetInsertPoint(&I);
+          NewV = Builder.CreateSub(Val,
+                                   ConstantInt::get(I.getType(), ~(*Int) + 1));
         }
-
-      } else if (match(&I, m_SDiv(m_APInt(Int), m_Value(Val)))
-                 and Int->isNegative()) {
-
-        const auto IntType = Val->getType();
-
-        if (Int->isSignBitSet()
-            and Int->isSignedIntN(IntType->getIntegerBitWidth())) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(Val->getType(), *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateSDiv(UnaryMinus, Val);
-        }
-
-      } else if (match(&I, m_SRem(m_Value(Val), m_APInt(Int)))
-                 and Int->isNegative()) {
-
-        const auto IntType = Val->getType();
-
-        if (Int->isSignBitSet()
-            and Int->isSignedIntN(IntType->getIntegerBitWidth())) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(Val->getType(), *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateSRem(Val, UnaryMinus);
+      } break;
+
+      case Instruction::Sub: {
+        if (match(&I, m_Sub(m_Value(Val), m_APInt(Int)))
+            and Int->isNegative()) {
+          Builder.SetInsertPoint(&I);
+          NewV = Builder.CreateAdd(Val,
+                                   ConstantInt::get(I.getType(), ~(*Int) + 1));
         }
-      } else if (match(&I, m_SRem(m_APInt(Int), m_Value(Val)))
-                 and Int->isNegative()) {
-
-        const auto IntType = Val->getType();
-
-        if (Int->isSignBitSet()
-            and Int->isSignedIntN(IntType->getIntegerBitWidth())) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(Val->getType(), *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateSRem(UnaryMinus, Val);
+      } break;
+
+      case Instruction::Mul: {
+        // Multiplication commutes: the constant always goes on the right
+        if ((match(&I, m_Mul(m_Value(Val), m_APInt(Int)))
+             or match(&I, m_Mul(m_APInt(Int), m_Value(Val))))
+            and Int->isNegative())
+          NewV = NegateConstantOperand(1);
+      } break;
+
+      case Instruction::SDiv:
+      case Instruction::SRem: {
+        Value *LHS = I.getOperand(0);
+        Value *RHS = I.getOperand(1);
+        if (match(RHS, m_APInt(Int)) and Int->isNegative()) {
+          Val = LHS;
+          NewV = NegateConstantOperand(1);
+        } else if (match(LHS, m_APInt(Int)) and Int->isNegative()) {
+          Val = RHS;
+          NewV = NegateConstantOperand(0);
         }
-
-      } else if (Predicate Pred;
-                 match(&I, m_ICmp(Pred, m_Value(Val), m_APInt(Int)))) {
-        const auto IntType = Val->getType();
-
-        llvm::Value *Unknown = nullptr;
-        const APInt *RHS = nullptr;
-        if (match(Val, m_Add(m_Value(Unknown), m_APInt(RHS)))
-            or match(Val, m_Sub(m_Value(Unknown), m_APInt(RHS)))) {
-          // Compute the new RHS if we move the RHS to the right of the
-          // comparison operator, adjusting the old value of Int.
-          using llvm::Instruction::Add;
-          bool IsAdd = cast<llvm::Instruction>(Val)->getOpcode() == Add;
-          APInt NewRHS = IsAdd ? (*Int - *RHS) : (*Int + *RHS);
-          Builder.SetInsertPoint(I.getNextNonDebugInstruction());
-          NewV = Builder.CreateICmp(Pred,
-                                    Unknown,
-                                    ConstantInt::get(IntType, NewRHS));
-
-          // If the predicate is relational, I is an inequality, meaning that it
-          // has a range of results, that wraps around, and we have to take care
-          // of that to avoid breaking semantics.
-          if (llvm::ICmpInst::isRelational(Pred)) {
-            unsigned BitWidth = RHS->getBitWidth();
-            bool IsSigned = llvm::ICmpInst::isSigned(Pred);
-            APInt Min = IsSigned ? APInt::getSignedMinValue(BitWidth) :
-                                   /*Unsigned*/ APInt::getMinValue(BitWidth);
-            APInt Max = IsSigned ? APInt::getSignedMaxValue(BitWidth) :
-                                   /*Unsigned*/ APInt::getMaxValue(BitWidth);
-            APInt MinPlusRHS = Min + *RHS;
-            APInt MaxMinusRHS = Max - *RHS;
-
-            // The limit for discriminating the two cases of solutions for the
-            // inequalities
-            APInt IntLimit = IsAdd ? MinPlusRHS : /*Sub*/ MaxMinusRHS;
-
-            // TODO: if Int and IntLimit have the same value we can avoid
-            // creating two inqualities.
-            // Basically we can ditch Int altogether and only emit expressions
-            // that depend on RHS and MinPlusRHS or MaxMinusRHS.
-            // When checked on tests though, this turned out to never happen so
-            // we haven't implemented this yet.
-
-            bool IsGreater = isGreater(Pred);
-            Predicate WrappingPredicate = IsGreater ?
-                                            (IsSigned ? Predicate::ICMP_SLT :
-                                                        Predicate::ICMP_ULT) :
-                                            /*IsLower*/
-                                            (IsSigned ? Predicate::ICMP_SGE :
-                                                        Predicate::ICMP_UGE);
-
-            // The value at which Unknown + RHS wraps back
-            APInt WrappingValue = IsAdd ? MaxMinusRHS : /*Sub*/ MinPlusRHS;
-            auto *WrapConst = llvm::ConstantInt::get(IntType, WrappingValue);
-            llvm::Value *WrappingComparison = Builder
-                                                .CreateICmp(WrappingPredicate,
-                                                            Unknown,
-                                                            WrapConst);
-
-            bool IntIntersectsAfterWrap = IsSigned ? Int->slt(IntLimit) :
-                                                     Int->ult(IntLimit);
-            if (IntIntersectsAfterWrap == IsGreater)
-              NewV = Builder.CreateOr(NewV, WrappingComparison);
-            else
-              NewV = Builder.CreateAnd(NewV, WrappingComparison);
+      } break;
+
+      case Instruction::ICmp: {
+        if (Predicate Pred;
+            match(&I, m_ICmp(Pred, m_Value(Val), m_APInt(Int)))) {
+          const auto IntType = Val->getType();
+
+          llvm::Value *Unknown = nullptr;
+          const APInt *RHS = nullptr;
+          if (match(Val, m_Add(m_Value(Unknown), m_APInt(RHS)))
+              or match(Val, m_Sub(m_Value(Unknown), m_APInt(RHS)))) {
+            // Compute the new RHS if we move the RHS to the right of the
+            // comparison operator, adjusting the old value of Int.
+            using llvm::Instruction::Add;
+            bool IsAdd = cast<llvm::Instruction>(Val)->getOpcode() == Add;
+            APInt NewRHS = IsAdd ? (*Int - *RHS) : (*Int + *RHS);
+            Builder.SetInsertPoint(I.getNextNonDebugInstruction());
+            NewV = Builder.CreateICmp(Pred,
+                                      Unknown,
+                                      ConstantInt::get(IntType, NewRHS));
+
+            // If the predicate is relational, I is an inequality, meaning that
+            // it has a range of results, that wraps around, and we have to take
+            // care of that to avoid breaking semantics.
+            if (llvm::ICmpInst::isRelational(Pred)) {
+              unsigned BitWidth = RHS->getBitWidth();
+              bool IsSigned = llvm::ICmpInst::isSigned(Pred);
+              APInt Min = IsSigned ? APInt::getSignedMinValue(BitWidth) :
+                                     /*Unsigned*/ APInt::getMinValue(BitWidth);
+              APInt Max = IsSigned ? APInt::getSignedMaxValue(BitWidth) :
+                                     /*Unsigned*/ APInt::getMaxValue(BitWidth);
+              APInt MinPlusRHS = Min + *RHS;
+              APInt MaxMinusRHS = Max - *RHS;
+
+              // The limit for discriminating the two cases of solutions for the
+              // inequalities
+              APInt IntLimit = IsAdd ? MinPlusRHS : /*Sub*/ MaxMinusRHS;
+
+              // TODO: if Int and IntLimit have the same value we can avoid
+              // creating two inqualities.
+              // Basically we can ditch Int altogether and only emit expressions
+              // that depend on RHS and MinPlusRHS or MaxMinusRHS.
+              // When checked on tests though, this turned out to never happen
+              // so we haven't implemented this yet.
+
+              bool IsGreater = isGreater(Pred);
+              Predicate WrappingPredicate = IsGreater ?
+                                              (IsSigned ? Predicate::ICMP_SLT :
+                                                          Predicate::ICMP_ULT) :
+                                              /*IsLower*/
+                                              (IsSigned ? Predicate::ICMP_SGE :
+                                                          Predicate::ICMP_UGE);
+
+              // The value at which Unknown + RHS wraps back
+              APInt WrappingValue = IsAdd ? MaxMinusRHS : /*Sub*/ MinPlusRHS;
+              auto *WrapConst = llvm::ConstantInt::get(IntType, WrappingValue);
+              llvm::Value *WrappingComparison = Builder
+                                                  .CreateICmp(WrappingPredicate,
+                                                              Unknown,
+                                                              WrapConst);
+
+              bool IntIntersectsAfterWrap = IsSigned ? Int->slt(IntLimit) :
+                                                       Int->ult(IntLimit);
+              if (IntIntersectsAfterWrap == IsGreater)
+                NewV = Builder.CreateOr(NewV, WrappingComparison);
+              else
+                NewV = Builder.CreateAnd(NewV, WrappingComparison);
+            }
+          } else if (Int->isNegative()) {
+            BuildUnaryMinus.SetInsertPoint(&I);
+            auto UnaryMinus = BuildUnaryMinus(IntType, *Int);
+            Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
+            NewV = Builder.CreateICmp(Pred, Val, UnaryMinus);
+          } else if (Pred == Predicate::ICMP_EQ and Int->isNullValue()) {
+            BuildBooleanNot.SetInsertPoint(&I);
+            NewV = BuildBooleanNot(Val->getType(), Val);
           }
-        } else if (Int->isNegative()) {
-          BuildUnaryMinus.SetInsertPoint(&I);
-          auto UnaryMinus = BuildUnaryMinus(IntType, *Int);
-          Builder.SetInsertPoint(UnaryMinus->getNextNonDebugInstruction());
-          NewV = Builder.CreateICmp(Pred, Val, UnaryMinus);
-        } else if (Pred == Predicate::ICMP_EQ and Int->isNullValue()) {
-          BuildBooleanNot.SetInsertPoint(&I);
-          NewV = BuildBooleanNot(Val->getType(), Val);
         }
+      } break;
+
+      default:
+        break;
       }
 
       if (NewV) {
@@ -3,20 +3,26 @@
 //
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <limits>
+#include <mutex>
 #include <variant>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ADT/FilteredGraphTraits.h"
 #include "revng/Model/Binary.h"
 #include "revng/Model/Type.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 
 #include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
@@ -30,6 +36,19 @@ static Logger<> Log("dla-make-model");
 static Logger<> ModelLog("dla-dump-model");
 static Logger<> TypeMapLog("dla-type-map");
 
+static llvm::cl::opt<unsigned>
+  MakeModelThreads("dla-make-model-threads",
+                   llvm::cl::desc("Number of threads creating the model "
+                                  "types of independent components of the "
+                                  "type system (0 means one per core, 1 "
+                                  "disables parallel creation)"),
+                   llvm::cl::init(1),
+                   llvm::cl::cat(MainCategory));
+
+unsigned dla::getMakeModelThreads() {
+  return MakeModelThreads;
+}
+
 using LTSN = LayoutTypeSystemNode;
 using ConstNonPointerFilterT = EdgeFilteredGraph<const LTSN *,
                                                  isNotPointerEdge>;
@@ -46,6 +65,19 @@ using model::QualifierKind::Pointer;
 using PtrFieldsMap = std::map<const LTSN *,
                               llvm::SmallPtrSet<QualifiedType *, 8>>;
 
+/// Types get their ID when they are constructed, so their construction is
+/// serialized when types are created on multiple threads.
+static std::mutex MakeTypeMutex;
+
+template<typename T>
+static TypePath recordNewType(TupleTree<model::Binary> &Model) {
+  auto NewType = []() {
+    std::lock_guard Lock(MakeTypeMutex);
+    return makeType<T>();
+  }();
+  return Model->recordNewType(std::move(NewType));
+}
+
 /// Create a single-field struct to wrap a given type
 static QualifiedType createStructWrapper(const LTSN *N,
                                          const QualifiedType &T,
@@ -54,7 +86,7 @@ static QualifiedType createStructWrapper(const LTSN *N,
                                          uint64_t Offset = 0ULL,
                                          uint64_t WrapperSize = 0ULL) {
   // Create struct
-  TypePath StructPath = Model->recordNewType(makeType<model::StructType>());
+  TypePath StructPath = recordNewType<model::StructType>(Model);
   auto *Struct = llvm::cast<model::StructType>(StructPath.get());
 
   // Create and insert field in struct
@@ -194,7 +226,7 @@ static QualifiedType makeStructFromNode(const LTSN *N,
   // Create struct
   revng_log(Log, "Creating struct type for node " << N->ID);
   LoggerIndent StructIndent{ Log };
-  TypePath StructPath = Model->recordNewType(makeType<model::StructType>());
+  TypePath StructPath = recordNewType<model::StructType>(Model);
   auto *Struct = llvm::cast<model::StructType>(StructPath.get());
   Struct->Size() = N->Size;
 
@@ -264,7 +296,7 @@ static QualifiedType makeUnionFromNode(const LTSN *N,
                                        const VectEqClasses &EqClasses) {
   // Create union
   revng_log(Log, "Creating union type for node " << N->ID);
-  TypePath UnionPath = Model->recordNewType(makeType<model::UnionType>());
+  TypePath UnionPath = recordNewType<model::UnionType>(Model);
   auto *Union = llvm::cast<model::UnionType>(UnionPath.get());
   LoggerIndent StructIndent{ Log };
 
@@ -497,23 +529,15 @@ static TypeMapT mapLLVMValuesToModelTypes(const LayoutTypeSystem &TS,
   return ValMap;
 }
 
-TypeMapT dla::makeModelTypes(const LayoutTypeSystem &TS,
-                             const LayoutTypePtrVect &Values,
-                             TupleTree<model::Binary> &Model) {
-  logEntry(TS, Model);
-
-  const dla::VectEqClasses &EqClasses = TS.getEqClasses();
-  TypeVect Types;
-  Types.resize(EqClasses.getNumClasses());
-  PtrFieldsMap PointerFieldsToUpdate;
-
-  // Create nodes for anything that is not a pointer
-  llvm::SmallPtrSet<const LTSN *, 16> Visited;
-  for (const LTSN *Root : llvm::nodes(&TS)) {
-    revng_assert(Root != nullptr);
-    if (not isRoot(Root))
-      continue;
-
+/// Create the types of all the nodes reachable from \a Roots through
+/// non-pointer edges, that are not in \a Visited yet, children first
+static void createTypesFromRoots(llvm::ArrayRef<const LTSN *> Roots,
+                                 TypeVect &Types,
+                                 const VectEqClasses &EqClasses,
+                                 llvm::SmallPtrSetImpl<const LTSN *> &Visited,
+                                 PtrFieldsMap &PointerFieldsToUpdate,
+                                 TupleTree<model::Binary> &Model) {
+  for (const LTSN *Root : Roots) {
     for (const LTSN *N : llvm::post_order(ConstNonPointerFilterT(Root))) {
 
       if (bool New = Visited.insert(N).second; not New)
@@ -536,6 +560,145 @@ TypeMapT dla::makeModelTypes(const LayoutTypeSystem &TS,
       }
     }
   }
+}
+
+/// Group the roots of \a TS by the component they belong to, where components
+/// are the sets of nodes connected by non-pointer edges, in either direction.
+/// Types created for different components never refer to each other, except
+/// through pointers, that are fixed at the end.
+static std::vector<llvm::SmallVector<const LTSN *, 4>>
+getRootsByComponent(const LayoutTypeSystem &TS) {
+  std::vector<llvm::SmallVector<const LTSN *, 4>> Result;
+  llvm::DenseMap<const LTSN *, size_t> ComponentOf;
+  llvm::SmallVector<const LTSN *, 16> ToVisit;
+
+  for (const LTSN *Node : llvm::nodes(&TS)) {
+    auto [It, New] = ComponentOf.try_emplace(Node, Result.size());
+    if (not New) {
+      if (isRoot(Node))
+        Result[It->second].push_back(Node);
+      continue;
+    }
+
+    size_t Component = Result.size();
+    Result.emplace_back();
+    if (isRoot(Node))
+      Result.back().push_back(Node);
+
+    ToVisit.push_back(Node);
+    while (not ToVisit.empty()) {
+      const LTSN *Current = ToVisit.pop_back_val();
+      for (const auto *Neighbors : { &Current->Successors,
+                                     &Current->Predecessors }) {
+        for (const auto &Edge : *Neighbors) {
+          if (not isNotPointerEdge(Edge))
+            continue;
+
+          if (ComponentOf.try_emplace(Edge.first, Component).second)
+            ToVisit.push_back(Edge.first);
+        }
+      }
+    }
+  }
+
+  return Result;
+}
+
+/// The types created for some of the components of the type system, in a
+/// model of their own, until they are moved into the real one
+struct TypeBatch {
+  TupleTree<model::Binary> Model;
+  PtrFieldsMap PointerFieldsToUpdate;
+};
+
+/// Move all the types of \a Batches into \a Model
+static void mergeTypeBatches(std::vector<TypeBatch> &Batches,
+                             TypeVect &Types,
+                             PtrFieldsMap &PointerFieldsToUpdate,
+                             TupleTree<model::Binary> &Model) {
+  for (TypeBatch &Batch : Batches) {
+    for (UpcastablePointer<model::Type> &T : Batch.Model->Types()) {
+      // Primitive types have the same ID in all the models
+      if (auto *Primitive = llvm::dyn_cast<model::PrimitiveType>(T.get())) {
+        Model->getPrimitiveType(Primitive->PrimitiveKind(), Primitive->Size());
+        continue;
+      }
+
+      bool Inserted = Model->Types().insert(std::move(T)).second;
+      revng_assert(Inserted);
+    }
+
+    for (auto &[PointerNode, PointerQTypes] : Batch.PointerFieldsToUpdate)
+      PointerFieldsToUpdate[PointerNode].insert(PointerQTypes.begin(),
+                                                PointerQTypes.end());
+  }
+
+  // Now all the references point to the models of the batches, which are
+  // about to be destroyed. Make them point to Model instead.
+  Model.initializeReferences();
+  for (std::optional<QualifiedType> &MaybeType : Types)
+    if (MaybeType.has_value())
+      MaybeType->UnqualifiedType().setRoot(Model.get());
+}
+
+TypeMapT dla::makeModelTypes(const LayoutTypeSystem &TS,
+                             const LayoutTypePtrVect &Values,
+                             TupleTree<model::Binary> &Model) {
+  logEntry(TS, Model);
+
+  const dla::VectEqClasses &EqClasses = TS.getEqClasses();
+  TypeVect Types;
+  Types.resize(EqClasses.getNumClasses());
+  PtrFieldsMap PointerFieldsToUpdate;
+
+  unsigned NumThreads = MakeModelThreads;
+  if (NumThreads == 0)
+    NumThreads = llvm::hardware_concurrency().compute_thread_count();
+
+  // Create nodes for anything that is not a pointer.
+  // The debug output of the workers would be interleaved, so in that case the
+  // types are created on a single thread.
+  if (NumThreads <= 1 or Log.isEnabled()) {
+    llvm::SmallVector<const LTSN *, 16> Roots;
+    for (const LTSN *Root : llvm::nodes(&TS)) {
+      revng_assert(Root != nullptr);
+      if (isRoot(Root))
+        Roots.push_back(Root);
+    }
+
+    llvm::SmallPtrSet<const LTSN *, 16> Visited;
+    createTypesFromRoots(Roots,
+                         Types,
+                         EqClasses,
+                         Visited,
+                         PointerFieldsToUpdate,
+                         Model);
+  } else {
+    // Each worker picks the next component and creates its types in its own
+    // batch. Each node has its own slot in Types, so the workers never write
+    // to the same one.
+    auto Components = getRootsByComponent(TS);
+    std::vector<TypeBatch> Batches(NumThreads);
+    std::atomic<size_t> NextIndex = 0;
+    const auto CreateTypes = [&](TypeBatch &Batch) {
+      Batch.Model->Architecture() = Model->Architecture();
+      llvm::SmallPtrSet<const LTSN *, 16> Visited;
+      for (size_t I = NextIndex++; I < Components.size(); I = NextIndex++)
+        createTypesFromRoots(Components[I],
+                             Types,
+                             EqClasses,
+                             Visited,
+                             Batch.PointerFieldsToUpdate,
+                             Batch.Model);
+    };
+
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+    for (TypeBatch &Batch : Batches)
+      Pool.async([&CreateTypes, &Batch]() { CreateTypes(Batch); });
+    Pool.wait();
+
+    mergeTypeBatches(Batches, Types, PointerFieldsToUpdate, Model);
+  }
 
   // Fix pointers
   // TODO: possible optimization: explore in bfs the pointer edges backwards
@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
+
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
 #include "revng/Model/Binary.h"
 #include "revng/Model/Type.h"
@@ -15,6 +18,9 @@ using TypeMapT = std::map<dla::LayoutTypePtr, model::QualifiedType>;
 
 namespace dla {
 
+/// \return the value of -dla-make-model-threads
+unsigned getMakeModelThreads();
+
 /// Generate model types from a LayoutTypeSystem graph.
 ///\return A vector of model Types where each position corresponds to the
 /// equivalence class of the LayoutTypeSystemNode that generated the type.
@@ -22,16 +28,24 @@ TypeMapT makeModelTypes(const LayoutTypeSystem &TS,
                         const LayoutTypePtrVect &Values,
                         TupleTree<model::Binary> &Model);
 
+/// Set of model types touched by an update
+using UpdatedTypesSet = std::set<const model::Type *>;
+
 /// Attach model types to function arguments and return values.
 /// Whether there was anything to update in the model.
+///\param UpdatedTypes the prototypes and stack frames that were updated are
+///                    added here
 bool updateFuncSignatures(const llvm::Module &M,
                           TupleTree<model::Binary> &Model,
                           const TypeMapT &TypeMap,
-                          FunctionMetadataCache &Cache);
+                          FunctionMetadataCache &Cache,
+                          UpdatedTypesSet &UpdatedTypes);
 
 /// Attach model types to segments and update the model.
+///\param UpdatedTypes the segment types that were updated are added here
 bool updateSegmentsTypes(const llvm::Module &M,
                          TupleTree<model::Binary> &Model,
-                         const TypeMapT &TypeMap);
+                         const TypeMapT &TypeMap,
+                         UpdatedTypesSet &UpdatedTypes);
 
 } // end namespace dla
@@ -713,7 +713,8 @@ static bool updateStackFrameType(model::Function &ModelFunc,
 bool dla::updateFuncSignatures(const llvm::Module &M,
                                TupleTree<model::Binary> &Model,
                                const TypeMapT &TypeMap,
-                               FunctionMetadataCache &Cache) {
+                               FunctionMetadataCache &Cache,
+                               UpdatedTypesSet &UpdatedTypes) {
   if (ModelLog.isEnabled())
     writeToFile(Model->toString(), "model-before-func-update.yaml");
   if (VerifyLog.isEnabled())
@@ -734,8 +735,14 @@ bool dla::updateFuncSignatures(const llvm::Module &M,
     revng_log(Log,
               "Updating prototype of function "
                 << LLVMFunc.getNameOrAsOperand());
-    Updated |= updatePrototype(*Model, ModelPrototype, &LLVMFunc, TypeMap);
-    Updated |= updateStackFrameType(*ModelFunc, LLVMFunc, TypeMap, *Model);
+    if (updatePrototype(*Model, ModelPrototype, &LLVMFunc, TypeMap)) {
+      UpdatedTypes.insert(ModelPrototype);
+      Updated = true;
+    }
+    if (updateStackFrameType(*ModelFunc, LLVMFunc, TypeMap, *Model)) {
+      UpdatedTypes.insert(ModelFunc->StackFrameType().getConst());
+      Updated = true;
+    }
 
     // Update prototypes associated to indirect calls, if any are found
     for (const auto &Inst : LLVMFunc)
@@ -745,7 +752,10 @@ bool dla::updateFuncSignatures(const llvm::Module &M,
           revng_log(Log,
                     "Updating prototype of indirect call "
                       << I->getNameOrAsOperand());
-          Updated |= updatePrototype(*Model, Prototype.get(), I, TypeMap);
+          if (updatePrototype(*Model, Prototype.get(), I, TypeMap)) {
+            UpdatedTypes.insert(Prototype.getConst());
+            Updated = true;
+          }
         }
       }
   }
@@ -760,7 +770,8 @@ bool dla::updateFuncSignatures(const llvm::Module &M,
 
 bool dla::updateSegmentsTypes(const llvm::Module &M,
                               TupleTree<model::Binary> &Model,
-                              const TypeMapT &TypeMap) {
+                              const TypeMapT &TypeMap,
+                              UpdatedTypesSet &UpdatedTypes) {
   bool Updated = false;
 
   for (const auto &F : FunctionTags::SegmentRef.functions(&M)) {
@@ -791,6 +802,7 @@ bool dla::updateSegmentsTypes(const llvm::Module &M,
       revng_assert(*NewSegmentType->size() == SegmentStructSize);
       revng_assert(NewSegmentType->verify());
 
+      UpdatedTypes.insert(NewSegmentType);
       Updated = true;
     }
   }
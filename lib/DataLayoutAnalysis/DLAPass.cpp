@@ -2,6 +2,16 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Model/VerifyHelper.h"
 #include "revng/Pipeline/Context.h"
@@ -9,12 +19,16 @@
 #include "revng/Pipeline/RegisterAnalysis.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/CommandLine.h"
 
 #include "revng-c/DataLayoutAnalysis/DLALayouts.h"
 #include "revng-c/DataLayoutAnalysis/DLAPass.h"
 #include "revng-c/Pipes/Kinds.h"
+#include "revng-c/Support/MemoryMetrics.h"
+#include "revng-c/Support/TraceSpan.h"
 
 #include "Backend/DLAMakeModelTypes.h"
+#include "DLAResultCache.h"
 #include "Frontend/DLATypeSystemBuilder.h"
 #include "Middleend/DLAStep.h"
 
@@ -22,6 +36,35 @@ char DLAPass::ID = 0;
 
 static Logger<> BuilderLog("dla-builder-log");
 
+static llvm::cl::opt<std::string>
+  CacheDirectory("dla-cache-dir",
+                 llvm::cl::desc("Directory where the model produced by DLA is "
+                                "cached, keyed on a hash of its inputs"),
+                 llvm::cl::value_desc("directory"),
+                 llvm::cl::cat(MainCategory));
+
+static llvm::cl::opt<std::string>
+  ColumnsDirectory("dla-values-columns-dir",
+                   llvm::cl::desc("Directory where the columnar dumps of the "
+                                  "nodes of DLA, before and after the "
+                                  "middle-end, are written"),
+                   llvm::cl::value_desc("directory"),
+                   llvm::cl::cat(MainCategory));
+
+static void dumpValuesColumns(const dla::DLATypeSystemLLVMBuilder &Builder,
+                              const llvm::Module &M,
+                              llvm::StringRef FileName) {
+  if (ColumnsDirectory.empty())
+    return;
+
+  std::error_code EC = llvm::sys::fs::create_directories(ColumnsDirectory);
+  revng_check(not EC, "Cannot create the DLA columns directory");
+
+  llvm::SmallString<128> Path(ColumnsDirectory);
+  llvm::sys::path::append(Path, FileName);
+  Builder.dumpValuesColumns(M, Path);
+}
+
 using Register = llvm::RegisterPass<DLAPass>;
 static ::Register X("dla", "Data Layout Analysis Pass", false, false);
 
@@ -36,94 +79,111 @@ void DLAPass::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
 bool DLAPass::runOnModule(llvm::Module &M) {
 
   llvm::Task T(3, "DLAPass::runOnModule");
+  MemoryMetrics Metrics("dla");
+  TraceSpan PassSpan("dla", "pass");
 
   T.advance("DLA Frontend");
+  TraceSpan Span("DLA Frontend", "dla");
 
   auto &ModelWrapper = getAnalysis<LoadModelWrapperPass>().get();
   auto &Cache = getAnalysis<FunctionMetadataCachePass>().get();
+  const model::Binary &Model = *ModelWrapper.getReadOnlyModel();
+
+  // If DLA already ran on the very same module and model, reuse its result
+  std::optional<dla::DLAResultCache> ResultCache;
+  if (not CacheDirectory.empty()) {
+    ResultCache.emplace(CacheDirectory, M, Model);
+    if (std::optional<std::string> Cached = ResultCache->lookup()) {
+      using BinaryTree = TupleTree<model::Binary>;
+      if (auto MaybeModel = BinaryTree::deserialize(*Cached)) {
+        auto &WritableModel = ModelWrapper.getWriteableModel();
+        WritableModel = std::move(*MaybeModel);
+        revng_assert(WritableModel->verify(true));
+        return not ResultCache->isInputModel(*Cached);
+      }
+    }
+  }
 
   // Front-end: Create the LayoutTypeSystem graph from an LLVM module
-  dla::LayoutTypeSystem TS;
-  dla::DLATypeSystemLLVMBuilder Builder{ TS, Cache };
-  const model::Binary &Model = *ModelWrapper.getReadOnlyModel();
+  // TS is on the heap so that it can be freed as soon as model types exist
+  auto TS = std::make_unique<dla::LayoutTypeSystem>();
+  dla::DLATypeSystemLLVMBuilder Builder{ *TS, Cache };
   Builder.buildFromLLVMModule(M, this, Model);
+  Metrics.recordSize("layout_type_system_nodes", TS->getNumLayouts());
+  Metrics.recordSize("layout_type_system_edges", TS->countEdges());
 
   if (BuilderLog.isEnabled())
     Builder.dumpValuesMapping("DLA-values-initial.csv");
+  dumpValuesColumns(Builder, M, "DLA-values-initial.cols");
 
   // Middle-end Steps: manipulate nodes and edges of the DLATypeSystem graph
   T.advance("DLA Middleend");
+  Span.restart("DLA Middleend");
   dla::StepManager SM;
   size_t PtrSize = getPointerSize(Model.Architecture());
-
-  //
-  // Graph normalization phase
-  //
-  revng_check(SM.addStep<dla::RemoveInvalidPointers>(PtrSize));
-  revng_check(SM.addStep<dla::CollapseEqualitySCC>());
-  revng_check(SM.addStep<dla::CollapseInstanceAtOffset0SCC>());
-  revng_check(SM.addStep<dla::SimplifyInstanceAtOffset0>());
-  revng_check(SM.addStep<dla::PruneLayoutNodesWithoutLayout>());
-  revng_check(SM.addStep<dla::ComputeUpperMemberAccesses>());
-  revng_check(SM.addStep<dla::RemoveInvalidStrideEdges>());
-  revng_check(SM.addStep<dla::PruneLayoutNodesWithoutLayout>());
-  revng_check(SM.addStep<dla::ComputeUpperMemberAccesses>());
-  revng_check(SM.addStep<dla::DecomposeStridedEdges>());
-
-  //
-  // Graph optimization phase
-  //
-  revng_check(SM.addStep<dla::CollapseSingleChild>());
-  revng_check(SM.addStep<dla::DeduplicateFields>());
-  revng_check(SM.addStep<dla::MergePointeesOfPointerUnion>(PtrSize));
-  revng_check(SM.addStep<dla::MergePointerNodes>());
-  revng_check(SM.addStep<dla::CollapseInstanceAtOffset0SCC>());
-  revng_check(SM.addStep<dla::SimplifyInstanceAtOffset0>());
-  revng_check(SM.addStep<dla::PruneLayoutNodesWithoutLayout>());
-  revng_check(SM.addStep<dla::ComputeUpperMemberAccesses>());
-  revng_check(SM.addStep<dla::RemoveInvalidStrideEdges>());
-  revng_check(SM.addStep<dla::PruneLayoutNodesWithoutLayout>());
-  revng_check(SM.addStep<dla::ComputeUpperMemberAccesses>());
-
-  revng_check(SM.addStep<dla::MergePointerNodes>());
-  // CollapseSingleChild and DeduplicateFields run before
-  // CompactCompatibleArrays and ArrangeAccessesHierarchically, to allow them to
-  // produce better results
-  revng_check(SM.addStep<dla::CollapseSingleChild>());
-  revng_check(SM.addStep<dla::DeduplicateFields>());
-  revng_check(SM.addStep<dla::ArrangeAccessesHierarchically>());
-  revng_check(SM.addStep<dla::CompactCompatibleArrays>());
-  revng_check(SM.addStep<dla::PushDownPointers>());
-  // ArrangeAccessesHierarchically can move pointer edges around in some cases,
-  // so we want to run MergePointerNodes again afterwards.
-  revng_check(SM.addStep<dla::MergePointerNodes>());
-  // CollapseSingleChild and DeduplicateFields run again after
-  // CompactCompatibleArrays and ArrangeAccessesHierarchically, to allow them to
-  // improve the results even further.
-  revng_check(SM.addStep<dla::ResolveLeafUnions>());
-  revng_check(SM.addStep<dla::CollapseSingleChild>());
-  revng_check(SM.addStep<dla::DeduplicateFields>());
-  revng_check(SM.addStep<dla::ComputeNonInterferingComponents>());
-  SM.run(TS);
+  dla::populateDefaultSchedule(SM, PtrSize);
+  SM.run(*TS);
+  Metrics.recordSize("layout_type_system_nodes_after_middleend",
+                     TS->getNumLayouts());
+  Metrics.recordSize("layout_type_system_edges_after_middleend",
+                     TS->countEdges());
 
   // Compress the equivalence classes obtained after graph manipulation
-  dla::VectEqClasses &EqClasses = TS.getEqClasses();
+  dla::VectEqClasses &EqClasses = TS->getEqClasses();
   EqClasses.compress();
-  dla::LayoutTypePtrVect Values = Builder.getValues();
 
   if (BuilderLog.isEnabled())
     Builder.dumpValuesMapping("DLA-values-after-ME.csv");
+  dumpValuesColumns(Builder, M, "DLA-values-after-ME.cols");
+
+  dla::LayoutTypePtrVect Values = std::move(Builder.getValues());
 
   T.advance("DLA Backend");
+  Span.restart("DLA Backend");
 
   // Generate model types
   auto &WritableModel = ModelWrapper.getWriteableModel();
-  auto ValueToTypeMap = dla::makeModelTypes(TS, Values, WritableModel);
+
+  // Remember the types that exist before DLA, so that only the new ones need
+  // to be verified
+  std::set<const model::Type *> OldTypes;
+  for (const UpcastablePointer<model::Type> &Type : WritableModel->Types())
+    OldTypes.insert(Type.get());
+
+  auto ValueToTypeMap = dla::makeModelTypes(*TS, Values, WritableModel);
+  Metrics.recordSize("value_to_type_map_entries", ValueToTypeMap.size());
+
+  // The graph is not needed anymore, release it before updating the model
+  TS.reset();
+  Values = {};
+
   bool Changed = false;
 
-  Changed |= dla::updateFuncSignatures(M, WritableModel, ValueToTypeMap, Cache);
-  Changed |= dla::updateSegmentsTypes(M, WritableModel, ValueToTypeMap);
-  revng_assert(WritableModel->verify(true));
+  dla::UpdatedTypesSet UpdatedTypes;
+  Changed |= dla::updateFuncSignatures(M,
+                                       WritableModel,
+                                       ValueToTypeMap,
+                                       Cache,
+                                       UpdatedTypes);
+  Changed |= dla::updateSegmentsTypes(M,
+                                      WritableModel,
+                                      ValueToTypeMap,
+                                      UpdatedTypes);
+
+  // Verifying the whole model is expensive on large binaries: only verify the
+  // types that DLA created or updated, unless expensive checks are enabled.
+  if (VerifyLog.isEnabled()) {
+    revng_assert(WritableModel->verify(true));
+  } else {
+    for (const UpcastablePointer<model::Type> &Type : WritableModel->Types())
+      if (not OldTypes.contains(Type.get()))
+        revng_assert(Type->verify(true));
+    for (const model::Type *Type : UpdatedTypes)
+      revng_assert(Type->verify(true));
+  }
+
+  if (ResultCache)
+    ResultCache->store(*WritableModel);
 
   return Changed;
 }
@@ -0,0 +1,85 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Debug.h"
+#include "revng/Support/YAMLTraits.h"
+
+#include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
+
+#include "Backend/DLAMakeModelTypes.h"
+#include "DLAResultCache.h"
+#include "Middleend/DLAStep.h"
+
+static Logger<> Log{ "dla-cache" };
+
+/// Bump this every time DLA changes in a way that affects its output, so that
+/// stale entries are never reused.
+static constexpr const char *CacheFormatVersion = "2";
+
+static std::string serialize(const model::Binary &Model) {
+  std::string Buffer;
+  llvm::raw_string_ostream Stream(Buffer);
+  llvm::yaml::Output YAMLOutput(Stream);
+  YAMLOutput << const_cast<model::Binary &>(Model);
+  Stream.flush();
+  return Buffer;
+}
+
+/// Append the name of the option \a Name and its \a Value to \a Buffer
+static void
+appendOption(std::string &Buffer, llvm::StringRef Name, uint64_t Value) {
+  Buffer += Name;
+  Buffer += '=';
+  Buffer += std::to_string(Value);
+  Buffer += '\n';
+}
+
+/// Append the options that affect the model produced by DLA to \a Buffer
+static void appendOptions(std::string &Buffer) {
+  using dla::LayoutTypeSystem;
+  appendOption(Buffer,
+               "dla-max-instance-offset",
+               LayoutTypeSystem::getMaxInstanceOffset());
+  appendOption(Buffer,
+               "dla-skip-redundant-steps",
+               dla::getSkipRedundantSteps());
+  appendOption(Buffer, "dla-threads", dla::getDLAThreads());
+  appendOption(Buffer, "dla-make-model-threads", dla::getMakeModelThreads());
+}
+
+namespace dla {
+
+DLAResultCache::DLAResultCache(llvm::StringRef Directory,
+                               const llvm::Module &M,
+                               const model::Binary &Model) :
+  Store(Directory, ".model.yml", Log), SerializedInput(serialize(Model)) {
+  std::string Buffer = CacheFormatVersion;
+  Buffer += '\n';
+  appendOptions(Buffer);
+  Buffer += SerializedInput;
+  {
+    // Printing the module includes the named metadata and the metadata
+    // attached to functions and instructions, which DLA reads too.
+    llvm::raw_string_ostream Stream(Buffer);
+    M.print(Stream, nullptr);
+  }
+
+  Key = ContentAddressedStore::computeKey(Buffer);
+}
+
+std::optional<std::string> DLAResultCache::lookup() const {
+  return Store.lookup(Key);
+}
+
+void DLAResultCache::store(const model::Binary &Result) const {
+  Store.store(Key, serialize(Result));
+}
+
+} // end namespace dla
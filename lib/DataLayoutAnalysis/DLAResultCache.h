@@ -0,0 +1,53 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/Model/Binary.h"
+
+#include "revng-c/Support/ContentAddressedStore.h"
+
+namespace llvm {
+class Module;
+} // end namespace llvm
+
+namespace dla {
+
+/// A persistent, content-addressed cache of the model produced by DLA.
+///
+/// The key is a hash of everything DLA reads: the LLVM module (including its
+/// metadata), the input model and the options that affect its output (e.g.,
+/// -dla-max-instance-offset). If none of them changed, the model stored under
+/// the same key by a previous run is the result of DLA.
+class DLAResultCache {
+private:
+  ContentAddressedStore Store;
+  std::string SerializedInput;
+  std::string Key;
+
+public:
+  DLAResultCache(llvm::StringRef Directory,
+                 const llvm::Module &M,
+                 const model::Binary &Model);
+
+public:
+  /// \return the serialized model stored by a previous run on the same inputs,
+  ///         if any.
+  std::optional<std::string> lookup() const;
+
+  /// \return true if \a SerializedModel is the same as the input model.
+  bool isInputModel(llvm::StringRef SerializedModel) const {
+    return SerializedModel == SerializedInput;
+  }
+
+  /// Store \a Result for the current inputs. Failures are logged and ignored.
+  void store(const model::Binary &Result) const;
+};
+
+} // end namespace dla
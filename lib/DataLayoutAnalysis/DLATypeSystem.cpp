@@ -3,19 +3,27 @@
 //
 
 #include <algorithm>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ADT/FilteredGraphTraits.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 
@@ -206,17 +214,344 @@ void debug_function LayoutTypeSystem::dumpDotOnFile(const char *FName,
   DotFile << "}\n";
 }
 
+/// Identifies DLA snapshots, followed by the format version. Bump the version
+/// every time the format changes.
+static constexpr llvm::StringLiteral SnapshotMagic = "DLATS";
+static constexpr uint64_t SnapshotVersion = 1;
+
+void LayoutTypeSystem::writeSnapshot(llvm::raw_ostream &OS) const {
+  const VectEqClasses &EqClasses = getEqClasses();
+  revng_assert(EqClasses.getNumClasses() == 0);
+
+  OS << SnapshotMagic;
+  encodeULEB128(SnapshotVersion, OS);
+  encodeULEB128(getNID(), OS);
+
+  // Equivalence classes: the leader of each element, and the removed class
+  encodeULEB128(EqClasses.getNumElements(), OS);
+  for (unsigned ID = 0; ID < EqClasses.getNumElements(); ++ID)
+    encodeULEB128(EqClasses.findLeader(ID), OS);
+  std::optional<unsigned> RemovedID = EqClasses.getRemovedID();
+  encodeULEB128(RemovedID.has_value(), OS);
+  if (RemovedID)
+    encodeULEB128(*RemovedID, OS);
+
+  // Nodes, in increasing order of ID
+  encodeULEB128(getNumLayouts(), OS);
+  for (const LayoutTypeSystemNode *N : getLayoutsRange()) {
+    encodeULEB128(N->ID, OS);
+    encodeULEB128(N->Size, OS);
+    encodeULEB128(N->InterferingInfo, OS);
+    encodeULEB128(N->NonScalar, OS);
+  }
+
+  // Edges, grouped by source
+  for (const LayoutTypeSystemNode *N : getLayoutsRange()) {
+    encodeULEB128(N->Successors.size(), OS);
+    for (const auto &[Target, Tag] : N->Successors) {
+      encodeULEB128(Target->ID, OS);
+      encodeULEB128(Tag->getKind(), OS);
+      if (Tag->getKind() != TypeLinkTag::LK_Instance)
+        continue;
+
+      const OffsetExpression &OE = Tag->getOffsetExpr();
+      encodeULEB128(OE.Offset, OS);
+      encodeULEB128(OE.Strides.size(), OS);
+      for (const auto &[Stride, TripCount] :
+           llvm::zip(OE.Strides, OE.TripCounts)) {
+        encodeULEB128(Stride, OS);
+        // Unknown trip counts are encoded as 0, which is never a valid one
+        encodeULEB128(TripCount.value_or(0), OS);
+      }
+    }
+  }
+}
+
+void debug_function
+LayoutTypeSystem::dumpSnapshotOnFile(const std::string &FName) const {
+  std::error_code EC;
+  raw_fd_ostream File(FName, EC);
+  revng_check(not EC, (EC.message() + ": " + FName).c_str());
+  writeSnapshot(File);
+}
+
+namespace {
+
+/// Reads the ULEB128 values of a snapshot, keeping track of
+/// malformed or truncated input
+class SnapshotReader {
+private:
+  const uint8_t *Cursor;
+  const uint8_t *End;
+  bool Failed = false;
+
+public:
+  SnapshotReader(llvm::StringRef Buffer) :
+    Cursor(Buffer.bytes_begin()), End(Buffer.bytes_end()) {}
+
+  bool failed() const { return Failed; }
+
+  uint64_t readULEB128() {
+    if (Failed)
+      return 0;
+
+    unsigned Size = 0;
+    const char *Error = nullptr;
+    uint64_t Result = decodeULEB128(Cursor, &Size, End, &Error);
+    Failed = Error != nullptr;
+    Cursor += Size;
+    return Result;
+  }
+
+  /// Reads a value that must be lower than \a Limit
+  uint64_t readULEB128(uint64_t Limit) {
+    uint64_t Result = readULEB128();
+    Failed |= Result >= Limit;
+    return Failed ? 0 : Result;
+  }
+
+  bool atEnd() const { return Cursor == End; }
+};
+
+} // end unnamed namespace
+
+bool LayoutTypeSystem::readSnapshot(llvm::StringRef Buffer) {
+  revng_assert(not isView() and Layouts.empty() and getNID() == 0);
+
+  if (not Buffer.consume_front(SnapshotMagic))
+    return false;
+
+  SnapshotReader Reader(Buffer);
+  if (Reader.readULEB128() != SnapshotVersion or Reader.failed())
+    return false;
+
+  uint64_t SnapshotNID = Reader.readULEB128();
+
+  uint64_t NumElements = Reader.readULEB128(SnapshotNID + 1);
+  if (Reader.failed())
+    return false;
+  for (uint64_t ID = 0; ID < NumElements; ++ID)
+    EqClasses.growBy1();
+  for (uint64_t ID = 0; ID < NumElements; ++ID) {
+    unsigned Leader = Reader.readULEB128(NumElements);
+    if (Reader.failed())
+      return false;
+    if (Leader != ID)
+      EqClasses.join(ID, Leader);
+  }
+  if (Reader.readULEB128(2)) {
+    unsigned RemovedID = Reader.readULEB128(NumElements);
+    if (Reader.failed())
+      return false;
+    EqClasses.remove(RemovedID);
+  }
+
+  uint64_t NumNodes = Reader.readULEB128(SnapshotNID + 1);
+  if (Reader.failed())
+    return false;
+
+  llvm::DenseMap<uint64_t, LayoutTypeSystemNode *> NodesByID;
+  std::optional<uint64_t> PreviousID;
+  for (uint64_t I = 0; I < NumNodes; ++I) {
+    uint64_t ID = Reader.readULEB128(SnapshotNID);
+    // IDs must be strictly increasing
+    if (Reader.failed() or (PreviousID and ID <= *PreviousID))
+      return false;
+    PreviousID = ID;
+
+    auto *New = new (NodeAllocator) LayoutTypeSystemNode(ID, LinkPool);
+    New->Size = Reader.readULEB128();
+    New->InterferingInfo = static_cast<InterferingChildrenInfo>(
+      Reader.readULEB128(AllChildrenAreNonInterfering + 1));
+    New->NonScalar = Reader.readULEB128(2);
+    Layouts.insert(New);
+    NodesByID[ID] = New;
+    if (Reader.failed())
+      return false;
+  }
+  NID = SnapshotNID;
+
+  for (LayoutTypeSystemNode *Source : getLayoutsRange()) {
+    uint64_t NumSuccessors = Reader.readULEB128();
+    for (uint64_t I = 0; I < NumSuccessors and not Reader.failed(); ++I) {
+      auto TargetIt = NodesByID.find(Reader.readULEB128());
+      auto Kind = Reader.readULEB128(TypeLinkTag::LK_All);
+      if (Reader.failed() or TargetIt == NodesByID.end())
+        return false;
+
+      LayoutTypeSystemNode *Target = TargetIt->second;
+      switch (Kind) {
+      case TypeLinkTag::LK_Equality:
+        addLink(Source, Target, TypeLinkTag::equalityTag());
+        break;
+
+      case TypeLinkTag::LK_Pointer:
+        addLink(Source, Target, TypeLinkTag::pointerTag());
+        break;
+
+      case TypeLinkTag::LK_Instance: {
+        OffsetExpression OE{ Reader.readULEB128() };
+        uint64_t NumStrides = Reader.readULEB128();
+        for (uint64_t S = 0; S < NumStrides and not Reader.failed(); ++S) {
+          OE.Strides.push_back(Reader.readULEB128());
+          uint64_t TripCount = Reader.readULEB128();
+          OE.TripCounts.push_back(TripCount ? std::optional(TripCount) :
+                                              std::nullopt);
+        }
+        if (Reader.failed() or not OE.verify())
+          return false;
+        addLink(Source, Target, TypeLinkTag::instanceTag(std::move(OE)));
+      } break;
+
+      default:
+        revng_abort();
+      }
+    }
+  }
+
+  return not Reader.failed() and Reader.atEnd();
+}
+
+LayoutTypeSystem::LayoutTypeSystem(LayoutTypeSystem &Parent,
+                                   llvm::ArrayRef<LayoutTypeSystemNode *>
+                                     Nodes) :
+  Parent(&Parent), DebugPrinter(new TSDebugPrinter) {
+  revng_assert(not Parent.isView());
+  for (LayoutTypeSystemNode *N : Nodes)
+    Layouts.insert(N);
+}
+
+LayoutTypeSystem::~LayoutTypeSystem() {
+  if (isView()) {
+    std::lock_guard Lock(Parent->SharedStateMutex);
+    Parent->Layouts.append(Layouts);
+    llvm::append_range(Parent->FreeNodes, DestroyedNodes);
+    revng_assert(Parent->NumViews > 0);
+    if (--Parent->NumViews == 0)
+      Parent->Layouts.sortByID();
+    return;
+  }
+
+  revng_assert(NumViews == 0);
+
+  for (auto *Layout : Layouts) {
+    Layout->~LayoutTypeSystemNode();
+    NodeAllocator.Deallocate(Layout);
+  }
+  Layouts.clear();
+}
+
+std::vector<std::unique_ptr<LayoutTypeSystem>>
+LayoutTypeSystem::splitIntoViews(unsigned MaxViews) {
+  using LTSN = LayoutTypeSystemNode;
+  revng_assert(not isView());
+  revng_assert(MaxViews > 0);
+
+  // Collect the weakly connected components
+  std::vector<std::vector<LTSN *>> Components;
+  llvm::DenseSet<const LTSN *> Visited;
+  for (LTSN *Start : Layouts) {
+    if (not Visited.insert(Start).second)
+      continue;
+
+    std::vector<LTSN *> &Component = Components.emplace_back();
+    llvm::SmallVector<LTSN *, 16> Worklist = { Start };
+    while (not Worklist.empty()) {
+      LTSN *N = Worklist.pop_back_val();
+      Component.push_back(N);
+      for (const auto &[Neighbor, Tag] : N->Successors)
+        if (Visited.insert(Neighbor).second)
+          Worklist.push_back(Neighbor);
+      for (const auto &[Neighbor, Tag] : N->Predecessors)
+        if (Visited.insert(Neighbor).second)
+          Worklist.push_back(Neighbor);
+    }
+  }
+
+  // Assign the biggest components first, each to the view with fewest nodes
+  llvm::stable_sort(Components, [](const auto &LHS, const auto &RHS) {
+    return LHS.size() > RHS.size();
+  });
+
+  NumViews = std::min<size_t>(MaxViews, Components.size());
+  std::vector<std::vector<LTSN *>> ViewNodes(NumViews);
+  for (const std::vector<LTSN *> &Component : Components) {
+    const auto FewerNodes = [](const auto &LHS, const auto &RHS) {
+      return LHS.size() < RHS.size();
+    };
+    auto Smallest = std::min_element(ViewNodes.begin(),
+                                     ViewNodes.end(),
+                                     FewerNodes);
+    Smallest->insert(Smallest->end(), Component.begin(), Component.end());
+  }
+  Layouts.clear();
+
+  // The position of the nodes in the table is about to change
+  clearJournal();
+
+  std::vector<std::unique_ptr<LayoutTypeSystem>> Result;
+  for (std::vector<LTSN *> &Nodes : ViewNodes) {
+    llvm::sort(Nodes, [](const LTSN *LHS, const LTSN *RHS) {
+      return LHS->ID < RHS->ID;
+    });
+    Result.emplace_back(new LayoutTypeSystem(*this, Nodes));
+  }
+  return Result;
+}
+
+void LayoutTypeSystem::compactNodes() {
+  std::vector<size_t> NewIndex = Layouts.compact();
+  if (NewIndex.empty())
+    return;
+
+  for (size_t &Index : NewEdgesJournal)
+    if (Index != LayoutTypeSystemNodeTable::Removed)
+      Index = NewIndex[Index];
+}
+
+void LayoutTypeSystem::recycleDestroyedNodes() {
+  if (DestroyedNodes.empty())
+    return;
+
+  LayoutTypeSystem &Owner = getOwner();
+  {
+    std::lock_guard Lock(Owner.SharedStateMutex);
+    llvm::append_range(Owner.FreeNodes, DestroyedNodes);
+  }
+  DestroyedNodes.clear();
+}
+
 LayoutTypeSystemNode *LayoutTypeSystem::createArtificialLayoutType() {
   using LTSN = LayoutTypeSystemNode;
-  LTSN *New = new (NodeAllocator) LayoutTypeSystemNode(NID);
-  revng_assert(New);
-  ++NID;
-  EqClasses.growBy1();
-  bool Success = Layouts.insert(New).second;
-  revng_assert(Success);
+  LTSN *New = nullptr;
+  {
+    LayoutTypeSystem &Owner = getOwner();
+    std::lock_guard Lock(Owner.SharedStateMutex);
+    // BumpPtrAllocator never frees anything: reuse the memory of the nodes
+    // destroyed by merges and removals first, if it has been recycled.
+    if (Owner.FreeNodes.empty()) {
+      New = new (Owner.NodeAllocator) LayoutTypeSystemNode(Owner.NID,
+                                                           Owner.LinkPool);
+    } else {
+      void *Memory = Owner.FreeNodes.back();
+      Owner.FreeNodes.pop_back();
+      New = new (Memory) LayoutTypeSystemNode(Owner.NID, Owner.LinkPool);
+    }
+    revng_assert(New);
+    ++Owner.NID;
+    Owner.EqClasses.growBy1();
+  }
+  Layouts.insert(New);
   return New;
 }
 
+size_t LayoutTypeSystem::countEdges() const {
+  size_t Result = 0;
+  for (const LayoutTypeSystemNode *N : Layouts)
+    Result += N->Successors.size();
+  return Result;
+}
+
 SmallVector<LayoutTypeSystemNode *, 2>
 LayoutTypeSystem::createArtificialLayoutTypes(unsigned N) {
   llvm::SmallVector<LayoutTypeSystemNode *, 2> Result;
@@ -295,12 +630,14 @@ static Logger<> MergeLog("dla-merge-nodes");
 void LayoutTypeSystem::mergeNodes(llvm::ArrayRef<LayoutTypeSystemNode *>
                                     ToMerge) {
   revng_assert(ToMerge.size() > 0ULL);
+  ++NumMergeNodesCalls;
   // If we're merging just one node there's nothing to do.
   if (ToMerge.size() <= 1ULL)
     return;
 
   LayoutTypeSystemNode *Into = ToMerge[0];
   const unsigned IntoID = Into->ID;
+  recordNewEdge(Into);
 
   for (LayoutTypeSystemNode *From : llvm::drop_begin(ToMerge, 1)) {
     revng_assert(From != Into);
@@ -320,22 +657,30 @@ void LayoutTypeSystem::mergeNodes(llvm::ArrayRef<LayoutTypeSystemNode *>
     }
     Into->NonScalar |= From->NonScalar;
 
-    EqClasses.join(IntoID, From->ID);
+    LayoutTypeSystem &Owner = getOwner();
+    {
+      std::lock_guard Lock(Owner.SharedStateMutex);
+      Owner.EqClasses.join(IntoID, From->ID);
+    }
 
     fixPredSucc(From, Into);
 
     // Remove From from Layouts
-    bool Erased = Layouts.erase(From);
-    revng_assert(Erased);
+    Layouts.erase(From);
     From->~LayoutTypeSystemNode();
-    NodeAllocator.Deallocate(From);
+    DestroyedNodes.push_back(From);
   }
 }
 
 void LayoutTypeSystem::removeNode(LayoutTypeSystemNode *ToRemove) {
   // Join the node's eq class with the removed class
+  ++NumRemoveNodeCalls;
   uint64_t TheID = ToRemove->ID;
-  EqClasses.remove(TheID);
+  {
+    LayoutTypeSystem &Owner = getOwner();
+    std::lock_guard Lock(Owner.SharedStateMutex);
+    Owner.EqClasses.remove(TheID);
+  }
   revng_log(MergeLog, "Removing " << ToRemove->ID << "\n");
 
   using IDBasedKey = std::pair<uint64_t, const TypeLinkTag *>;
@@ -354,10 +699,9 @@ void LayoutTypeSystem::removeNode(LayoutTypeSystemNode *ToRemove) {
     SuccOfPred.erase(It, End);
   }
 
-  bool Erased = Layouts.erase(ToRemove);
-  revng_assert(Erased);
+  Layouts.erase(ToRemove);
   ToRemove->~LayoutTypeSystemNode();
-  NodeAllocator.Deallocate(ToRemove);
+  DestroyedNodes.push_back(ToRemove);
 }
 
 using NeighborIterator = LayoutTypeSystem::NeighborIterator;
@@ -403,6 +747,8 @@ void LayoutTypeSystem::moveEdgeTarget(LayoutTypeSystemNode *OldTgt,
   if (not OldTgt or not NewTgt)
     return;
 
+  recordNewEdge(InverseEdgeIt->first);
+
   if (not OffsetToSum)
     return moveEdgeTargetWithoutSumming(OldTgt, NewTgt, InverseEdgeIt);
 
@@ -441,6 +787,8 @@ void LayoutTypeSystem::moveEdgeSource(LayoutTypeSystemNode *OldSrc,
   if (not OldSrc or not NewSrc)
     return;
 
+  recordNewEdge(NewSrc);
+
   if (not OffsetToSum)
     return moveEdgeSourceWithoutSumming(OldSrc, NewSrc, EdgeIt);
 
@@ -471,6 +819,34 @@ void LayoutTypeSystem::moveEdgeSource(LayoutTypeSystemNode *OldSrc,
   }
 }
 
+std::optional<std::vector<LayoutTypeSystemNode *>>
+LayoutTypeSystem::takeNodesWithNewEdges(const void *Consumer) {
+  auto [CursorIt, New] = JournalCursors.try_emplace(Consumer,
+                                                    NewEdgesJournal.size());
+  if (New)
+    return std::nullopt;
+
+  // Deduplicate the entries, and drop the ones that are not nodes anymore
+  std::vector<LayoutTypeSystemNode *> Result;
+  llvm::SmallPtrSet<LayoutTypeSystemNode *, 16> Seen;
+  for (size_t Index : llvm::drop_begin(NewEdgesJournal, CursorIt->second))
+    if (LayoutTypeSystemNode *N = Layouts.getSlot(Index))
+      if (Seen.insert(N).second)
+        Result.push_back(N);
+  CursorIt->second = NewEdgesJournal.size();
+
+  // Forget the entries that all the consumers have seen
+  size_t SeenByAll = NewEdgesJournal.size();
+  for (const auto &[_, Cursor] : JournalCursors)
+    SeenByAll = std::min(SeenByAll, Cursor);
+  NewEdgesJournal.erase(NewEdgesJournal.begin(),
+                        NewEdgesJournal.begin() + SeenByAll);
+  for (auto &[_, Cursor] : JournalCursors)
+    Cursor -= SeenByAll;
+
+  return Result;
+}
+
 NeighborIterator LayoutTypeSystem::eraseEdge(LayoutTypeSystemNode *Src,
                                              NeighborIterator EdgeIt) {
   LayoutTypeSystemNode *Tgt = EdgeIt->first;
@@ -491,9 +867,88 @@ void LayoutTypeSystem::dropOutgoingEdges(LayoutTypeSystemNode *N) {
 }
 
 static Logger<> VerifyDLALog("dla-verify-strict");
+static Logger<> DroppedLinksLog("dla-dropped-instance-links");
+
+static llvm::cl::opt<uint64_t>
+  MaxInstanceOffset("dla-max-instance-offset",
+                    llvm::cl::desc("Largest offset of an instance link: links "
+                                   "at larger offsets are dropped, to avoid "
+                                   "huge leading paddings when the base "
+                                   "address of an access is not recognized. "
+                                   "Raise it to type large global tables"),
+                    llvm::cl::init(0xFFFF),
+                    llvm::cl::cat(MainCategory));
+
+bool LayoutTypeSystem::isInstanceOffsetAllowed(uint64_t Offset) {
+  if (Offset <= MaxInstanceOffset)
+    return true;
+
+  revng_log(DroppedLinksLog, "Dropping instance link at offset " << Offset);
+  return false;
+}
+
+uint64_t LayoutTypeSystem::getMaxInstanceOffset() {
+  return MaxInstanceOffset;
+}
+
+static llvm::cl::opt<unsigned>
+  VerifySamplePercent("dla-verify-sample-percent",
+                      llvm::cl::desc("Percentage of the nodes of the DLA type "
+                                     "system checked by each verification "
+                                     "(100 checks all of them, 0 disables "
+                                     "the checks). When sampling, the "
+                                     "sources of new edges are always "
+                                     "checked too"),
+                      llvm::cl::init(100),
+                      llvm::cl::cat(MainCategory));
+
+/// The consumer of the journal of new edges registered by the verifications
+static const char VerificationConsumer = 0;
+
+void LayoutTypeSystem::startVerificationRound() {
+  if (JournalCursors.contains(&VerificationConsumer))
+    takeNodesWithNewEdges(&VerificationConsumer);
+}
+
+std::vector<LayoutTypeSystemNode *> LayoutTypeSystem::getNodesToVerify() const {
+  std::vector<LayoutTypeSystemNode *> Result;
+  if (VerifySamplePercent == 0)
+    return Result;
+
+  if (VerifySamplePercent >= 100) {
+    Result.assign(Layouts.begin(), Layouts.end());
+    return Result;
+  }
+
+  // Every new cycle goes through the source of one of the edges added since
+  // the current round of verifications started, hence they're always checked.
+  // The journal only records them while it has consumers, so the
+  // verifications register one. Until then, e.g., on the first verification
+  // or after the journal has been cleared, all the nodes are checked.
+  auto [CursorIt, New] = JournalCursors.try_emplace(&VerificationConsumer,
+                                                    NewEdgesJournal.size());
+  if (New) {
+    Result.assign(Layouts.begin(), Layouts.end());
+    return Result;
+  }
+
+  for (size_t Index : llvm::drop_begin(NewEdgesJournal, CursorIt->second))
+    if (LayoutTypeSystemNode *N = Layouts.getSlot(Index))
+      Result.push_back(N);
+
+  // Check different nodes on each verification
+  uint64_t Round = NumVerifications++;
+  for (LayoutTypeSystemNode *N : Layouts)
+    if (llvm::hash_combine(N->ID, Round) % 100 < VerifySamplePercent)
+      Result.push_back(N);
+
+  llvm::sort(Result);
+  Result.erase(std::unique(Result.begin(), Result.end()), Result.end());
+  return Result;
+}
 
 bool LayoutTypeSystem::verifyConsistency() const {
-  for (LayoutTypeSystemNode *NodePtr : Layouts) {
+  for (LayoutTypeSystemNode *NodePtr : getNodesToVerify()) {
     if (not NodePtr) {
       if (VerifyDLALog.isEnabled())
         revng_check(false);
@@ -584,7 +1039,7 @@ bool LayoutTypeSystem::verifyDAG() const {
   // A graph is a DAG if and only if all its strongly connected components have
   // size 1
   std::set<const LayoutTypeSystemNode *> Visited;
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     revng_assert(Node != nullptr);
     if (Visited.contains(Node))
       continue;
@@ -614,7 +1069,7 @@ bool LayoutTypeSystem::verifyInstanceDAG() const {
   // A graph is a DAG if and only if all its strongly connected components have
   // size 1
   std::set<const LayoutTypeSystemNode *> Visited;
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     revng_assert(Node != nullptr);
     if (Visited.contains(Node))
       continue;
@@ -643,7 +1098,7 @@ bool LayoutTypeSystem::verifyPointerDAG() const {
   // A graph is a DAG if and only if all its strongly connected components have
   // size 1
   std::set<const LayoutTypeSystemNode *> Visited;
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     revng_assert(Node != nullptr);
     if (Visited.contains(Node))
       continue;
@@ -668,7 +1123,7 @@ bool LayoutTypeSystem::verifyPointerDAG() const {
 bool LayoutTypeSystem::verifyNoEquality() const {
   if (not verifyConsistency())
     return false;
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     using LTSN = LayoutTypeSystemNode;
     for (const auto &Edge : llvm::children_edges<const LTSN *>(Node)) {
       if (isEqualityEdge(Edge)) {
@@ -686,7 +1141,7 @@ bool LayoutTypeSystem::verifyInstanceAtOffset0DAG() const {
     return false;
 
   std::set<const LayoutTypeSystemNode *> Visited;
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     revng_assert(Node != nullptr);
     if (Visited.contains(Node))
       continue;
@@ -709,7 +1164,7 @@ bool LayoutTypeSystem::verifyInstanceAtOffset0DAG() const {
 }
 
 bool LayoutTypeSystem::verifyLeafs() const {
-  for (const auto &Node : llvm::nodes(this)) {
+  for (LayoutTypeSystemNode *Node : getNodesToVerify()) {
     if (isLeaf(Node) and Node->Size == 0) {
       if (VerifyDLALog.isEnabled())
         revng_check(false);
@@ -722,7 +1177,7 @@ bool LayoutTypeSystem::verifyLeafs() const {
 
 bool LayoutTypeSystem::verifyUnions() const {
   using GraphNodeT = const LayoutTypeSystemNode *;
-  for (GraphNodeT Node : llvm::nodes(this)) {
+  for (GraphNodeT Node : getNodesToVerify()) {
     if (Node->InterferingInfo == AllChildrenAreInterfering
         and Node->Successors.size() <= 1) {
       if (VerifyDLALog.isEnabled())
@@ -762,6 +1217,31 @@ bool VectEqClasses::isRemoved(const unsigned ID) const {
   return (ElementEqClass == RemovedEqClass);
 }
 
+void VectEqClasses::compress() {
+  if (getNumClasses() != 0)
+    return;
+
+  llvm::IntEqClasses::compress();
+
+  // Counting sort of the elements by class ID
+  MembersBegin.assign(getNumClasses() + 1, 0);
+  for (unsigned ID = 0; ID < NElems; ++ID)
+    ++MembersBegin[lookupEqClass(ID) + 1];
+  for (unsigned C = 1; C < MembersBegin.size(); ++C)
+    MembersBegin[C] += MembersBegin[C - 1];
+
+  Members.resize(NElems);
+  std::vector<unsigned> Next(MembersBegin.begin(), MembersBegin.end() - 1);
+  for (unsigned ID = 0; ID < NElems; ++ID)
+    Members[Next[lookupEqClass(ID)]++] = ID;
+}
+
+void VectEqClasses::uncompress() {
+  llvm::IntEqClasses::uncompress();
+  MembersBegin.clear();
+  Members.clear();
+}
+
 std::optional<unsigned> VectEqClasses::getEqClassID(const unsigned ID) const {
   unsigned EqID = lookupEqClass(ID);
   bool IsRemoved = (RemovedID) ? lookupEqClass(*RemovedID) == EqID : false;
@@ -773,8 +1253,15 @@ std::optional<unsigned> VectEqClasses::getEqClassID(const unsigned ID) const {
 
 std::vector<unsigned>
 VectEqClasses::computeEqClass(const unsigned ElemID) const {
-  std::vector<unsigned> EqClass;
+  // Compressed map
+  if (getNumClasses() != 0) {
+    unsigned EqID = lookupEqClass(ElemID);
+    return std::vector<unsigned>(Members.begin() + MembersBegin[EqID],
+                                 Members.begin() + MembersBegin[EqID + 1]);
+  }
 
+  // Uncompressed map
+  std::vector<unsigned> EqClass;
   for (unsigned OtherID = 0; OtherID < NElems; OtherID++)
     if (haveSameEqClass(ElemID, OtherID))
       EqClass.push_back(OtherID);
@@ -794,7 +1281,7 @@ bool VectEqClasses::haveSameEqClass(unsigned ID1, unsigned ID2) const {
 void TSDebugPrinter::printNodeContent(const LayoutTypeSystem &TS,
                                       const LayoutTypeSystemNode *N,
                                       llvm::raw_fd_ostream &File) const {
-  auto EqClasses = TS.getEqClasses();
+  const VectEqClasses &EqClasses = TS.getEqClasses();
 
   File << DoRet;
   if (EqClasses.isRemoved(N->ID))
@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -31,9 +32,17 @@ using TSBuilder = DLATypeSystemLLVMBuilder;
 
 bool TSBuilder::createInterproceduralTypes(llvm::Module &M,
                                            const model::Binary &Model) {
+  // SegmentRef and StringLiteral functions are collected while scanning the
+  // module for isolated functions, instead of scanning it again for each tag
+  SmallVector<const Function *, 16> SegmentRefs;
+  SmallVector<const Function *, 16> StringLiterals;
+
   for (const Function &F : M.functions()) {
+    if (FunctionTags::SegmentRef.isTagOf(&F))
+      SegmentRefs.push_back(&F);
+    else if (FunctionTags::StringLiteral.isTagOf(&F))
+      StringLiterals.push_back(&F);
 
-    auto FTags = FunctionTags::TagsSet::from(&F);
     // Skip intrinsics
     if (F.isIntrinsic())
       continue;
@@ -264,17 +273,17 @@ bool TSBuilder::createInterproceduralTypes(llvm::Module &M,
     SegmentNode->NonScalar = true;
   }
 
-  for (Function &F : FunctionTags::SegmentRef.functions(&M)) {
-    const auto &[StartAddress, VirtualSize] = extractSegmentKeyFromMetadata(F);
+  for (const Function *F : SegmentRefs) {
+    const auto &[StartAddress, VirtualSize] = extractSegmentKeyFromMetadata(*F);
     const model::Segment *Segment = &Segments.at({ StartAddress, VirtualSize });
     LayoutTypeSystemNode *SegmentNode = SegmentNodeMap.at(Segment);
 
-    LayoutTypeSystemNode *SegmentRefNode = getOrCreateLayoutType(&F).first;
+    LayoutTypeSystemNode *SegmentRefNode = getOrCreateLayoutType(F).first;
 
     // The type of the segment and the type returned by segmentref are the same
     TS.addEqualityLink(SegmentNode, SegmentRefNode);
 
-    for (const Use &U : F.uses()) {
+    for (const Use &U : F->uses()) {
       auto *Call = cast<CallInst>(U.getUser());
       LayoutTypeSystemNode *SegmentRefCallNode = getOrCreateLayoutType(Call)
                                                    .first;
@@ -284,16 +293,16 @@ bool TSBuilder::createInterproceduralTypes(llvm::Module &M,
     }
   }
 
-  for (Function &F : FunctionTags::StringLiteral.functions(&M)) {
+  for (const Function *F : StringLiterals) {
     const auto &[StartAddress,
                  VirtualSize,
                  Offset,
-                 StrLen] = extractStringLiteralFromMetadata(F);
+                 StrLen] = extractStringLiteralFromMetadata(*F);
 
     const model::Segment *Segment = &Segments.at({ StartAddress, VirtualSize });
     LayoutTypeSystemNode *SegmentNode = SegmentNodeMap.at(Segment);
 
-    LayoutTypeSystemNode *LiteralNode = getOrCreateLayoutType(&F).first;
+    LayoutTypeSystemNode *LiteralNode = getOrCreateLayoutType(F).first;
 
     // We have an instance of the literal at Offset inside the type of the
     // segment itself.
@@ -309,7 +318,7 @@ bool TSBuilder::createInterproceduralTypes(llvm::Module &M,
     // instances of ByteType.
     TS.addInstanceLink(LiteralNode, ByteType, std::move(OE));
 
-    for (const Use &U : F.uses()) {
+    for (const Use &U : F->uses()) {
       auto *Call = cast<CallInst>(U.getUser());
       LayoutTypeSystemNode *StringLiteralCall = getOrCreateLayoutType(Call)
                                                   .first;
@@ -5,8 +5,10 @@
 #include <optional>
 #include <utility>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/ScalarEvolution.h"
@@ -54,12 +56,33 @@ private:
   const model::Binary &Model;
   Function *F;
   ScalarEvolution *SE;
-  llvm::DominatorTree DT;
-  llvm::PostDominatorTree PDT;
+  // Only needed to compute the trip count of loops, which happens for few
+  // functions, so they are built lazily.
+  std::optional<llvm::DominatorTree> DT;
+  std::optional<llvm::PostDominatorTree> PDT;
+
+  /// What the trip count of the accesses in a loop depends upon, besides the
+  /// block of the access
+  struct LoopFacts {
+    /// The backedge-taken count, if the loop is in loop-simplify form and it
+    /// is a positive constant
+    std::optional<int64_t> BackedgeCount;
+    SmallVector<BasicBlock *, 4> ExitBlocks;
+  };
+
+  /// Facts about the loops of F, computed once for all the accesses in them,
+  /// which in large loop nests are many
+  DenseMap<const Loop *, LoopFacts> LoopFactsCache;
 
   SCEVTypeMap SCEVToLayoutType;
   FunctionMetadataCache *Cache;
 
+  // Shared among all the memory accesses of F, which often have common
+  // subexpressions in their pointer operands. This is safe because, after
+  // getOrCreateSCEVTypes, only SCEVUnknowns are added to SCEVToLayoutType, and
+  // they are never traversed anyway.
+  SCEVBaseAddressExplorer BaseAddressExplorer;
+
 protected:
   bool addInstanceLink(DLATypeSystemLLVMBuilder &Builder,
                        Value *PointerVal,
@@ -165,38 +188,26 @@ protected:
       const Loop *L = Rec->getLoop();
       revng_assert(L != nullptr);
       std::optional<int64_t> TripCount;
-      if (L->isLoopSimplifyForm()) {
-        // If the loop is simplified, use getBackedgeTakenCount to infer the
-        // trip count.
-        const SCEV *SCEVBackedgeCount = SE->getBackedgeTakenCount(L);
-        auto *Count = dyn_cast<SCEVConstant>(SCEVBackedgeCount);
-        if (Count != nullptr and not Count->isZero()) {
-          SmallVector<BasicBlock *, 4> ExitBlocks;
-          L->getUniqueExitBlocks(ExitBlocks);
-          const auto IsDominatedByB = [&DT = this->DT,
-                                       &B](const BasicBlock *OtherB) {
-            return DT.dominates(&B, OtherB);
-          };
-          if (std::all_of(ExitBlocks.begin(),
-                          ExitBlocks.end(),
-                          IsDominatedByB)) {
-            // If B (where the memory access is) dominates all the exit
-            // blocks, then B is executed the same number of times as the
-            // loop header.
-            // This number is the trip count of the loop, which in
-            // loop-simplified form is SCEVBackedgeCount + 1, because in
-            // loop-simplified form we only have one back edge.
-            TripCount = Count->getAPInt().getSExtValue() + 1;
-          } else if (PDT.dominates(L->getHeader(), &B)) {
-            // If the loop header postdominates B, B is executed the same
-            // number of times as the only backedge
-            TripCount = Count->getAPInt().getSExtValue();
-          } // In all the other cases we know nothing
-        }
-      } else {
-        // If the loop is not simplified, getBackedgeTakenCount may give some
-        // results, but not enough to reliably infer the trip count.
-        // Just set it as missing and keep going.
+      const LoopFacts &Facts = getLoopFacts(L);
+      if (Facts.BackedgeCount.has_value()) {
+        int64_t Count = *Facts.BackedgeCount;
+        const auto IsDominatedByB = [&DT = getDominatorTree(),
+                                     &B](const BasicBlock *OtherB) {
+          return DT.dominates(&B, OtherB);
+        };
+        if (llvm::all_of(Facts.ExitBlocks, IsDominatedByB)) {
+          // If B (where the memory access is) dominates all the exit
+          // blocks, then B is executed the same number of times as the
+          // loop header.
+          // This number is the trip count of the loop, which in
+          // loop-simplified form is SCEVBackedgeCount + 1, because in
+          // loop-simplified form we only have one back edge.
+          TripCount = Count + 1;
+        } else if (getPostDominatorTree().dominates(L->getHeader(), &B)) {
+          // If the loop header postdominates B, B is executed the same
+          // number of times as the only backedge
+          TripCount = Count;
+        } // In all the other cases we know nothing
       }
 
       // Don't add links for recurring expressions with negative trip counts.
@@ -242,9 +253,44 @@ public:
   void setupForProcessingFunction(ModulePass *MP, Function *TheF) {
     SE = &MP->getAnalysis<llvm::ScalarEvolutionWrapperPass>(*TheF).getSE();
     F = TheF;
-    DT.recalculate(*F);
-    PDT.recalculate(*F);
+    DT.reset();
+    PDT.reset();
+    LoopFactsCache.clear();
     SCEVToLayoutType.clear();
+    BaseAddressExplorer.clear();
+  }
+
+  llvm::DominatorTree &getDominatorTree() {
+    if (not DT.has_value())
+      DT.emplace(*F);
+    return *DT;
+  }
+
+  llvm::PostDominatorTree &getPostDominatorTree() {
+    if (not PDT.has_value())
+      PDT.emplace(*F);
+    return *PDT;
+  }
+
+  const LoopFacts &getLoopFacts(const Loop *L) {
+    auto [It, New] = LoopFactsCache.try_emplace(L);
+    LoopFacts &Facts = It->second;
+    if (not New)
+      return Facts;
+
+    // If the loop is not simplified, getBackedgeTakenCount may give some
+    // results, but not enough to reliably infer the trip count.
+    if (not L->isLoopSimplifyForm())
+      return Facts;
+
+    const SCEV *SCEVBackedgeCount = SE->getBackedgeTakenCount(L);
+    auto *Count = dyn_cast<SCEVConstant>(SCEVBackedgeCount);
+    if (Count == nullptr or Count->isZero())
+      return Facts;
+
+    Facts.BackedgeCount = Count->getAPInt().getSExtValue();
+    L->getUniqueExitBlocks(Facts.ExitBlocks);
+    return Facts;
   }
 
   bool getOrCreateSCEVTypes(DLATypeSystemLLVMBuilder &Builder) {
@@ -627,10 +673,8 @@ public:
       return AddedSomething;
 
     const SCEV *PtrSCEV = SE->getSCEV(PointerVal);
-    using Explorer = SCEVBaseAddressExplorer;
-    auto PossibleBaseAddresses = Explorer().findBases(SE,
-                                                      PtrSCEV,
-                                                      SCEVToLayoutType);
+    auto PossibleBaseAddresses = BaseAddressExplorer
+                                   .findBases(SE, PtrSCEV, SCEVToLayoutType);
     for (const SCEV *BaseAddrSCEV : PossibleBaseAddresses)
       AddedSomething |= addInstanceLink(Builder, PointerVal, BaseAddrSCEV, B);
 
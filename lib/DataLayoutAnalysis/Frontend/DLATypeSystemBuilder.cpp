@@ -2,10 +2,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include "llvm/IR/Argument.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/Endian.h"
 
 #include "revng/Support/Assert.h"
 #include "revng/Support/IRHelpers.h"
@@ -25,7 +33,7 @@ static constexpr const char DoRet[] = "\\l";
 void LLVMTSDebugPrinter::printNodeContent(const LayoutTypeSystem &TS,
                                           const LayoutTypeSystemNode *N,
                                           raw_fd_ostream &File) const {
-  auto EqClasses = TS.getEqClasses();
+  const VectEqClasses &EqClasses = TS.getEqClasses();
   revng_assert(not EqClasses.isRemoved(N->ID));
 
   File << DoRet;
@@ -88,15 +96,13 @@ DLATypeSystemLLVMBuilder::getOrCreateLayoutType(const Value *V, unsigned Id) {
   assertGetLayoutTypePreConditions(V, Id);
 
   LayoutTypePtr Key(V, Id);
-  auto HintIt = VisitedValues.lower_bound(Key);
-  if (HintIt != VisitedValues.end()
-      and not VisitedValues.key_comp()(Key, HintIt->first)) {
-    return std::make_pair(HintIt->second, false);
-  }
+  auto [It, New] = VisitedValues.try_emplace(Key, nullptr);
+  if (not New)
+    return std::make_pair(It->second, false);
 
   LayoutTypeSystemNode *Res = TS.createArtificialLayoutType();
 
-  VisitedValues.emplace_hint(HintIt, Key, Res);
+  It->second = Res;
   return std::make_pair(Res, true);
 }
 
@@ -382,6 +388,95 @@ void DLATypeSystemLLVMBuilder::dumpValuesMapping(const StringRef Name) const {
   }
 }
 
+/// Number the globals, the functions, their arguments and their instructions
+/// in the order in which they appear in \a M
+static DenseMap<const Value *, uint64_t> numberValues(const Module &M) {
+  DenseMap<const Value *, uint64_t> Result;
+  for (const GlobalVariable &G : M.globals())
+    Result.try_emplace(&G, Result.size());
+
+  for (const Function &F : M) {
+    Result.try_emplace(&F, Result.size());
+    for (const Argument &A : F.args())
+      Result.try_emplace(&A, Result.size());
+    for (const Instruction &I : instructions(F))
+      Result.try_emplace(&I, Result.size());
+  }
+
+  return Result;
+}
+
+void DLATypeSystemLLVMBuilder::dumpValuesColumns(const Module &M,
+                                                 const StringRef Name) const {
+  std::error_code EC;
+  raw_fd_ostream OutFile(Name, EC);
+  {
+    using namespace std::string_literals;
+    revng_check(not EC, ("Cannot open: "s + Name.str()).c_str());
+  }
+
+  const VectEqClasses &EqClasses = TS.getEqClasses();
+  bool Compressed = EqClasses.getNumClasses() != 0;
+  constexpr uint64_t Removed = std::numeric_limits<uint64_t>::max();
+  constexpr uint64_t Absent = std::numeric_limits<uint64_t>::max();
+  DenseMap<const Value *, uint64_t> ValueIDs = numberValues(M);
+
+  auto ToLittle = [](uint64_t Value) {
+    return support::endian::byte_swap<uint64_t, support::little>(Value);
+  };
+
+  uint64_t NumRows = TS.getNumLayouts();
+  std::vector<uint64_t> IDs;
+  std::vector<uint64_t> Classes;
+  std::vector<uint64_t> Sizes;
+  std::vector<uint64_t> ValueColumn;
+  std::vector<uint64_t> FieldColumn;
+  IDs.reserve(NumRows);
+  Classes.reserve(NumRows);
+  Sizes.reserve(NumRows);
+  ValueColumn.reserve(NumRows);
+  FieldColumn.reserve(NumRows);
+  for (const LayoutTypeSystemNode *N : TS.getLayoutsRange()) {
+    IDs.push_back(ToLittle(N->ID));
+    Sizes.push_back(ToLittle(N->Size));
+
+    // The value of the node, as in dumpValuesMapping
+    uint64_t ValueID = Absent;
+    uint64_t Field = Absent;
+    if (N->ID < Values.size() and not Values[N->ID].isEmpty()) {
+      const LayoutTypePtr &Ptr = Values[N->ID];
+      auto It = ValueIDs.find(&Ptr.getValue());
+      if (It != ValueIDs.end())
+        ValueID = It->second;
+      if (Ptr.fieldNum() != LayoutTypePtr::fieldNumNone)
+        Field = Ptr.fieldNum();
+    }
+    ValueColumn.push_back(ToLittle(ValueID));
+    FieldColumn.push_back(ToLittle(Field));
+
+    if (not Compressed) {
+      Classes.push_back(ToLittle(EqClasses.findLeader(N->ID)));
+    } else if (auto Class = EqClasses.getEqClassID(N->ID)) {
+      Classes.push_back(ToLittle(*Class));
+    } else {
+      Classes.push_back(ToLittle(Removed));
+    }
+  }
+
+  auto WriteColumn = [&OutFile](const std::vector<uint64_t> &Column) {
+    OutFile.write(reinterpret_cast<const char *>(Column.data()),
+                  Column.size() * sizeof(uint64_t));
+  };
+
+  OutFile << "DLACOLS2";
+  WriteColumn({ ToLittle(NumRows) });
+  WriteColumn(IDs);
+  WriteColumn(Classes);
+  WriteColumn(Sizes);
+  WriteColumn(ValueColumn);
+  WriteColumn(FieldColumn);
+}
+
 void DLATypeSystemLLVMBuilder::buildFromLLVMModule(llvm::Module &M,
                                                    llvm::ModulePass *MP,
                                                    const model::Binary &Model) {
@@ -392,6 +487,8 @@ void DLATypeSystemLLVMBuilder::buildFromLLVMModule(llvm::Module &M,
   createIntraproceduralTypes(M, MP, Model);
 
   createValuesList();
-  VisitedValues.clear();
-  VisitedPrototypes.clear();
+
+  // Release the memory of the maps, not just their content
+  VisitedValues = {};
+  VisitedPrototypes = {};
 }
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Pass.h"
 
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
@@ -50,8 +51,10 @@ public:
 /// This class builds a DLA type system from an LLVM module
 class DLATypeSystemLLVMBuilder {
 public:
-  using VisitedMapT = std::map<LayoutTypePtr, LayoutTypeSystemNode *>;
-  using PrototypesMapT = std::map<const model::Type *, FuncOrCallInst>;
+  // These maps grow with the size of the module, so they are hash maps of
+  // small keys rather than std::maps with a node for each entry.
+  using VisitedMapT = llvm::DenseMap<LayoutTypePtr, LayoutTypeSystemNode *>;
+  using PrototypesMapT = llvm::DenseMap<const model::Type *, FuncOrCallInst>;
 
 private:
   /// Separate class that add `Instance` edges
@@ -112,6 +115,22 @@ public:
   /// generated .csv uses _semicolons_ as separators.
   void debug_function dumpValuesMapping(const llvm::StringRef Name) const;
 
+  /// Write, in bulk, a columnar binary file with the ID, the equivalence
+  /// class, the size and the value of each node, which is much cheaper than
+  /// dumpValuesMapping on large modules.
+  ///
+  /// The file starts with the 8 bytes `DLACOLS2` and with the number of nodes,
+  /// followed by the column of IDs, the column of equivalence classes (with
+  /// the maximum uint64_t for removed nodes), the column of sizes, the column
+  /// of value IDs and the column of field indices. The ID of a value is its
+  /// position among the globals, the functions, their arguments and their
+  /// instructions of \a M, in this order. Nodes without a value, or whose
+  /// value is not numbered, e.g., a constant, and nodes that are not a field
+  /// of an aggregate, have the maximum uint64_t there. All the values are
+  /// little-endian uint64_t.
+  void dumpValuesColumns(const llvm::Module &M,
+                         const llvm::StringRef Name) const;
+
 public:
   DLATypeSystemLLVMBuilder(LayoutTypeSystem &TS, FunctionMetadataCache &Cache) :
     TS(TS), Cache(&Cache){};
@@ -34,93 +34,155 @@ static bool isAlwaysAddress(const llvm::Value *V) {
   return false;
 }
 
-std::set<const llvm::SCEV *>
+// Returns true if \p S, which has not been traversed, is an address that
+// points to a type.
+static bool isUntraversedBaseAddress(const llvm::SCEV *S) {
+  // If we have not traversed S, it looks like an address SCEV.
+  // Despite the fact that S looks like an address, there are some cases of
+  // stuff that looks like an address that should be ignored.
+  auto *U = dyn_cast<llvm::SCEVUnknown>(S);
+  if (U == nullptr)
+    return true;
+
+  auto *UVal = U->getValue();
+  if (isAlwaysAddress(UVal))
+    return true;
+
+  // If it's a call there are cases where we know we are never able to say
+  // anything meaningful about the type they point to, for now.
+  auto *Call = dyn_cast<llvm::CallInst>(UVal);
+  if (Call == nullptr)
+    return true;
+
+  // For OpaqueExtractValue, if they have an aggregate operand that is not a
+  // call to an isolated function, we are never able to say anything
+  // meaningful about the type they point to, for now.
+  // So we just treat them if they are never never addresses that point to a
+  // type.
+  if (isCallToTagged(Call, FunctionTags::OpaqueExtractValue))
+    return isCallToIsolatedFunction(Call->getOperand(0));
+
+  // If UVal is a call to a function that was not isolated by revng, the data
+  // layout analysis skips it, and we are never able to say something
+  // meaningful about the type it points to.
+  // So we just treat them if they are never never addresses that point to a
+  // type.
+  return isCallToIsolatedFunction(Call);
+}
+
+SCEVBaseAddressExplorer::SCEVSet
 SCEVBaseAddressExplorer::findBases(llvm::ScalarEvolution *SE,
                                    const llvm::SCEV *Root,
                                    const SCEVTypeMap &M) {
-  std::set<const llvm::SCEV *> Result;
-  Worklist.clear();
-  Worklist.push_back(Root);
-
-  while (not Worklist.empty()) {
-    const llvm::SCEV *AddressCandidate = Worklist.pop_back_val();
-    const llvm::SCEV *AddrSCEV = nullptr;
-    if (const auto *C = dyn_cast<llvm::SCEVConstant>(AddressCandidate)) {
-      // Constants are considered addresses only in case they point to some
-      // segment. They are never traversed.
-      auto *ConstantVal = C->getValue();
-      if (isConstantAddress(ConstantVal))
-        AddrSCEV = AddressCandidate;
-    } else {
-      auto NTraversed = checkAddressOrTraverse(SE, AddressCandidate);
-      if (NTraversed) {
-        // If we have traversed AddressCandidate, it means that it doesn't
-        // look like an address SCEV, so we want to keep looking in is
-        // operands to find a base address.
-        // However, it might be a typed SCEVs, so we also have to check if
-        // AddressCandidate is in M. If it is, we consider it to be an address
-        // in any case. In this case, given that we have traversed
-        // AddressCandidate, checkAddressOrTraverse has pushed something on
-        // the Worlist, and we have to clear it to prevent the SCEV
-        // exploration to continue past the address.
-        if (AddressCandidate != Root and M.contains(AddressCandidate)) {
-          // We have to stop the search in this direction. Pop back all the
-          // nodes that have been pushed by checkAddressOrTraverse.
-          for (decltype(NTraversed) I = 0ULL; I < NTraversed; ++I)
-            Worklist.pop_back();
-          AddrSCEV = AddressCandidate;
-        }
+  // Constants are considered addresses only in case they point to some
+  // segment. They are never traversed.
+  if (const auto *C = dyn_cast<llvm::SCEVConstant>(Root)) {
+    if (isConstantAddress(C->getValue()))
+      return { Root };
+    return {};
+  }
 
-      } else {
-
-        // If we have not traversed AddressCandidate, but IsAddr is true. This
-        // means that AddressCandidate looks like an address SCEV.
-        AddrSCEV = AddressCandidate;
-
-        // Despite the fact that AddressCandidate looks like an address, there
-        // are some cases of stuff that looks like an address that should be
-        // ignored.
-        if (auto *U = dyn_cast<llvm::SCEVUnknown>(AddressCandidate)) {
-          auto *UVal = U->getValue();
-          if (not isAlwaysAddress(UVal)) {
-            // If it's a call there are cases where we know we are never able to
-            // say anything meaningful about the type they point to, for now.
-            if (auto *Call = dyn_cast<llvm::CallInst>(UVal)) {
-              // For OpaqueExtractValue, if they have an aggregate operand that
-              // is not a call to an isolated function, we are never able to say
-              // anything meaningful about the type they point to, for now.
-              // So we just treat them if they are never never addresses that
-              // point to a type.
-              if (isCallToTagged(Call, FunctionTags::OpaqueExtractValue)) {
-                if (not isCallToIsolatedFunction(Call->getOperand(0)))
-                  AddrSCEV = nullptr;
-              } else {
-                // If UVal is a call to a function that was not isolated by
-                // revng, the data layout analysis skips it, and we are never
-                // able to say something meaningful about the type it points to.
-                // So we just treat them if they are never never addresses that
-                // point to a type.
-                if (not isCallToIsolatedFunction(Call))
-                  AddrSCEV = nullptr;
-              }
-            }
-          }
-        }
+  llvm::SmallVector<const llvm::SCEV *, 4> Operands;
+  if (not checkAddressOrTraverse(SE, Root, Operands)) {
+    if (isUntraversedBaseAddress(Root))
+      return { Root };
+    return {};
+  }
+
+  // The root is traversed even if it's in M, so its base addresses are the
+  // ones of its operands.
+  SCEVSet Result;
+  for (const llvm::SCEV *Operand : Operands) {
+    const SCEVSet &OperandBases = getBases(SE, Operand, M);
+    Result.insert(OperandBases.begin(), OperandBases.end());
+  }
+
+  return Result;
+}
+
+const SCEVBaseAddressExplorer::SCEVSet &
+SCEVBaseAddressExplorer::getBases(llvm::ScalarEvolution *SE,
+                                  const llvm::SCEV *S,
+                                  const SCEVTypeMap &M) {
+  if (auto It = Memo.find(S); It != Memo.end())
+    return It->second;
+
+  // Post-order visit of the subexpressions that are not memoized yet. Each
+  // one is visited twice: first to push its operands, then, when all of them
+  // have been memoized, to merge their base addresses.
+  struct Entry {
+    const llvm::SCEV *S;
+    llvm::SmallVector<const llvm::SCEV *, 4> Operands;
+    bool Expanded = false;
+  };
+  llvm::SmallVector<Entry, 8> Stack;
+  Stack.push_back({ S, {} });
+
+  while (not Stack.empty()) {
+    Entry &Current = Stack.back();
+    const llvm::SCEV *Candidate = Current.S;
+
+    if (Current.Expanded) {
+      SCEVSet Result;
+      for (const llvm::SCEV *Operand : Current.Operands) {
+        const SCEVSet &OperandBases = Memo.find(Operand)->second;
+        Result.insert(OperandBases.begin(), OperandBases.end());
       }
+      Stack.pop_back();
+      Memo[Candidate] = std::move(Result);
+      continue;
+    }
+
+    if (Memo.count(Candidate) != 0) {
+      Stack.pop_back();
+      continue;
     }
 
-    // Add AddrSCEV to the results if we have found one.
-    if (AddrSCEV != nullptr)
-      Result.insert(AddrSCEV);
+    if (const auto *C = dyn_cast<llvm::SCEVConstant>(Candidate)) {
+      SCEVSet Result;
+      if (isConstantAddress(C->getValue()))
+        Result.insert(Candidate);
+      Stack.pop_back();
+      Memo[Candidate] = std::move(Result);
+      continue;
+    }
+
+    llvm::SmallVector<const llvm::SCEV *, 4> Operands;
+    if (not checkAddressOrTraverse(SE, Candidate, Operands)) {
+      SCEVSet Result;
+      if (isUntraversedBaseAddress(Candidate))
+        Result.insert(Candidate);
+      Stack.pop_back();
+      Memo[Candidate] = std::move(Result);
+      continue;
+    }
+
+    // If we have traversed Candidate, it means that it doesn't look like an
+    // address SCEV, so we want to keep looking in its operands to find a base
+    // address. However, it might be a typed SCEV, so we also have to check if
+    // Candidate is in M. If it is, we consider it to be an address in any
+    // case, and we stop the search in this direction.
+    if (M.contains(Candidate)) {
+      Stack.pop_back();
+      Memo[Candidate] = { Candidate };
+      continue;
+    }
+
+    Current.Expanded = true;
+    Current.Operands = Operands;
+    for (const llvm::SCEV *Operand : Operands)
+      if (Memo.count(Operand) == 0)
+        Stack.push_back({ Operand, {} });
   }
 
-  return Result;
+  return Memo.find(S)->second;
 }
 
-size_t
-SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
-                                                const llvm::SCEV *S) {
-  auto OldSize = Worklist.size();
+size_t SCEVBaseAddressExplorer::checkAddressOrTraverse(
+  llvm::ScalarEvolution *SE,
+  const llvm::SCEV *S,
+  llvm::SmallVectorImpl<const llvm::SCEV *> &Operands) {
+  auto OldSize = Operands.size();
   switch (S->getSCEVType()) {
 
   case llvm::scConstant: {
@@ -141,7 +203,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
     // Zero extension never changes the value of pointers, so we can safely
     // traverse it.
     const llvm::SCEVZeroExtendExpr *ZE = cast<llvm::SCEVZeroExtendExpr>(S);
-    Worklist.push_back(ZE->getOperand());
+    Operands.push_back(ZE->getOperand());
   } break;
 
   case llvm::scPtrToInt:
@@ -150,7 +212,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
     // Truncate and Extend are basically casts, so in the first implementation
     // we did not consider them addresses per-se, and we traversed them.
     // So we initially had this code here:
-    //    Worklist.push_back(cast<SCEVCastExpr>(S)->getOperand());
+    //    Operands.push_back(cast<SCEVCastExpr>(S)->getOperand());
     // However, it turned out that tend to show up in nasty situations, so we
     // temporarily disabled their traversal.
     // For now they are simply considered addresses, but we might need to
@@ -172,7 +234,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
         if (not isConstantAddress(C->getValue()))
           continue;
       }
-      Worklist.push_back(Op);
+      Operands.push_back(Op);
     }
   } break;
 
@@ -189,7 +251,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
     }
     // The AddRec is never an address, but we traverse its start expression
     // because it could be an address.
-    Worklist.push_back(Start);
+    Operands.push_back(Start);
   } break;
 
   case llvm::scMulExpr: {
@@ -235,7 +297,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
           // traverse the composite expression A = B & 0xff00 and keep
           // exploring B, without marking A as address.
           const llvm::SCEV *UDivLHS = UDiv->getLHS();
-          Worklist.push_back(UDivLHS);
+          Operands.push_back(UDivLHS);
           break;
         }
       }
@@ -260,7 +322,7 @@ SCEVBaseAddressExplorer::checkAddressOrTraverse(llvm::ScalarEvolution *SE,
     revng_unreachable("Unknown SCEV kind!");
   }
 
-  auto NewSize = Worklist.size();
+  auto NewSize = Operands.size();
   revng_assert(NewSize >= OldSize);
   return NewSize - OldSize;
 }
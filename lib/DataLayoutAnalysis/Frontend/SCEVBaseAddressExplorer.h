@@ -7,6 +7,7 @@
 #include <map>
 #include <set>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 
 namespace llvm {
@@ -20,12 +21,20 @@ struct LayoutTypeSystemNode;
 
 /// Class useful to explore an llvm::SCEV expression to find its base
 /// addresses.
+///
+/// ScalarEvolution uniques SCEVs, so the same subexpression is often shared by
+/// the pointer operands of many memory accesses (e.g., in unrolled loops). The
+/// base addresses of each subexpression are memoized, and reused by all the
+/// explorations that reach it, until clear() is called.
 class SCEVBaseAddressExplorer {
 public:
   using SCEVTypeMap = std::map<const llvm::SCEV *, dla::LayoutTypeSystemNode *>;
+  using SCEVSet = std::set<const llvm::SCEV *>;
 
 private:
-  llvm::SmallVector<const llvm::SCEV *, 4> Worklist;
+  /// The base addresses of the SCEVs that have been explored, when they are
+  /// not the root of the exploration
+  llvm::DenseMap<const llvm::SCEV *, SCEVSet> Memo;
 
 public:
   SCEVBaseAddressExplorer() = default;
@@ -38,10 +47,30 @@ public:
   // If \M is not empty, all the SCEVs with an entry in \M are considered as
   // addresses, and the exploration of the operands does not traverse them, even
   // if the SCEV potentially has the expressive power to do it.
-  std::set<const llvm::SCEV *> findBases(llvm::ScalarEvolution *SE,
-                                         const llvm::SCEV *Root,
-                                         const SCEVTypeMap &M);
+  //
+  // The memoized results are only valid as long as \SE is the same and the
+  // SCEVs that can be traversed are either always or never in \M.
+  SCEVSet findBases(llvm::ScalarEvolution *SE,
+                    const llvm::SCEV *Root,
+                    const SCEVTypeMap &M);
+
+  /// Forget all the memoized results, e.g., when moving to another function.
+  void clear() { Memo.clear(); }
 
 private:
-  size_t checkAddressOrTraverse(llvm::ScalarEvolution *SE, const llvm::SCEV *S);
+  /// \return the base addresses of \S, which is not the root of the
+  ///         exploration, memoizing them along with the ones of all the
+  ///         subexpressions of \S.
+  const SCEVSet &getBases(llvm::ScalarEvolution *SE,
+                          const llvm::SCEV *S,
+                          const SCEVTypeMap &M);
+
+  /// Push on \Operands the operands of \S that have to be explored.
+  ///
+  /// \return the number of operands pushed. If 0, \S has not been traversed,
+  ///         i.e., it looks like an address.
+  size_t checkAddressOrTraverse(llvm::ScalarEvolution *SE,
+                                const llvm::SCEV *S,
+                                llvm::SmallVectorImpl<const llvm::SCEV *>
+                                  &Operands);
 };
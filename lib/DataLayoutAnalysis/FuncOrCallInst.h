@@ -4,8 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <variant>
-
+#include "llvm/ADT/PointerUnion.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -39,10 +38,11 @@ inline unsigned long arg_size(const llvm::CallInst *C) {
   return C->arg_size();
 }
 
-/// Wrapper around a variant between Function and CallInst
+/// Wrapper around a variant between Function and CallInst, as large as a
+/// single pointer
 class FuncOrCallInst {
 private:
-  std::variant<const llvm::Function *, const llvm::CallInst *> Val;
+  llvm::PointerUnion<const llvm::Function *, const llvm::CallInst *> Val;
 
 public:
   FuncOrCallInst() : Val((llvm::Function *) nullptr){};
@@ -111,12 +111,18 @@ static bool isFixedChild(const LayoutTypeSystemNode *Parent,
 using NonPointerFilterT = EdgeFilteredGraph<dla::LayoutTypeSystemNode *,
                                             dla::isNotPointerEdge>;
 
+using NodeSet = llvm::SmallPtrSet<LayoutTypeSystemNode *, 8>;
+
+// Returns the volatile children of Parent. If Candidates is not null, only the
+// children in Candidates are considered.
 static llvm::SetVector<LayoutTypeSystemNode *>
-getVolatileChildren(LayoutTypeSystemNode *Parent) {
+getVolatileChildren(LayoutTypeSystemNode *Parent,
+                    const NodeSet *Candidates = nullptr) {
   llvm::SetVector<LayoutTypeSystemNode *> Result;
   for (auto *Child : llvm::children<NonPointerFilterT>(Parent))
-    if (not isFixedChild(Parent, Child))
-      Result.insert(Child);
+    if (not Candidates or Candidates->contains(Child))
+      if (not isFixedChild(Parent, Child))
+        Result.insert(Child);
   return Result;
 }
 
@@ -299,9 +305,13 @@ absorbVolatileChildren(LayoutTypeSystem &TS, LayoutTypeSystemNode *Parent) {
 
   revng_assert(not hasPointerChild(Parent));
 
+  // Absorbing the volatile children only changes the parents of the
+  // grandchildren, so after the first round only the grandchildren can become
+  // volatile.
+  NodeSet GrandChildren;
   for (auto VolatileChildren = getVolatileChildren(Parent);
        not VolatileChildren.empty();
-       VolatileChildren = getVolatileChildren(Parent)) {
+       VolatileChildren = getVolatileChildren(Parent, &GrandChildren)) {
 
     struct InstanceEdge {
       OffsetExpression OE;
@@ -338,15 +348,20 @@ absorbVolatileChildren(LayoutTypeSystem &TS, LayoutTypeSystemNode *Parent) {
       }
     }
 
-    // Remove all volatile nodes
+    // Remove all volatile nodes, merging them into Parent all at once
+    llvm::SmallVector<LayoutTypeSystemNode *, 8> ToMerge = { Parent };
     for (LayoutTypeSystemNode *Volatile : VolatileChildren) {
       Absorbed.insert(Volatile);
       TS.dropOutgoingEdges(Volatile);
-      TS.mergeNodes({ Parent, Volatile });
+      ToMerge.push_back(Volatile);
     }
+    TS.mergeNodes(ToMerge);
 
-    for (auto &[OffsetExpr, Target] : CompoundEdges.takeVector())
+    GrandChildren.clear();
+    for (auto &[OffsetExpr, Target] : CompoundEdges.takeVector()) {
+      GrandChildren.insert(Target);
       TS.addInstanceLink(Parent, Target, std::move(OffsetExpr));
+    }
   }
   return Absorbed;
 }
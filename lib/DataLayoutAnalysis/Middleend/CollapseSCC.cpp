@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
 #include <set>
 #include <type_traits>
 #include <vector>
@@ -10,7 +11,6 @@
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
-#include "llvm/Support/Progress.h"
 
 #include "revng/ADT/FilteredGraphTraits.h"
 #include "revng/Support/Debug.h"
@@ -37,17 +37,16 @@ static bool sizeGreater(const LTSN *LHS, const LTSN *RHS) {
   return LHS->Size > RHS->Size;
 }
 
-template<typename NodeT>
-static bool collapseSCCs(LayoutTypeSystem &TS) {
+/// Collapses the SCCs reachable from \a StartNodes
+template<typename NodeT, typename RangeT>
+static bool collapseSCCsFrom(LayoutTypeSystem &TS, const RangeT &StartNodes) {
 
   std::set<GraphNodeT> VisitedNodes;
 
   using scc_t = std::vector<GraphNodeT>;
   llvm::SmallVector<scc_t, 0> ToCollapse;
 
-  // We cannot start just from the roots because we cannot exclude that there
-  // are loops without entries.
-  for (const auto &Node : llvm::nodes(&TS)) {
+  for (const auto &Node : StartNodes) {
     revng_assert(Node != nullptr);
     revng_log(LogVerbose, "## Analyzing SCCs from  " << Node);
     if (VisitedNodes.contains(Node)) {
@@ -167,12 +166,23 @@ static bool collapseSCCs(LayoutTypeSystem &TS) {
   return ToCollapse.size();
 }
 
-static bool collapseEqualitySCC(LayoutTypeSystem &TS) {
-  return collapseSCCs<EqualityNodeT>(TS);
-}
+/// Collapses the SCCs of the graph, if \a NodesWithNewEdges is empty, or only
+/// the ones going through \a NodesWithNewEdges, otherwise.
+///
+/// Collapsing the SCCs leaves an acyclic graph, and removing edges cannot
+/// introduce new cycles. Hence, the only SCCs left to collapse since the
+/// previous run go through the new edges, and can be found starting from their
+/// sources only.
+template<typename NodeT>
+static bool
+collapseSCCs(LayoutTypeSystem &TS,
+             const std::optional<std::vector<LTSN *>> &NodesWithNewEdges) {
+  if (NodesWithNewEdges.has_value())
+    return collapseSCCsFrom<NodeT>(TS, *NodesWithNewEdges);
 
-static bool collapseInstanceAtOffset0SCC(LayoutTypeSystem &TS) {
-  return collapseSCCs<InstanceOffset0EdgeT>(TS);
+  // We cannot start just from the roots because we cannot exclude that there
+  // are loops without entries.
+  return collapseSCCsFrom<NodeT>(TS, llvm::nodes(&TS));
 }
 
 bool CollapseEqualitySCC::runOnTypeSystem(LayoutTypeSystem &TS) {
@@ -180,8 +190,12 @@ bool CollapseEqualitySCC::runOnTypeSystem(LayoutTypeSystem &TS) {
   if (VerifyLog.isEnabled())
     revng_assert(TS.verifyConsistency());
 
+  auto NodesWithNewEdges = TS.takeNodesWithNewEdges(getID());
+  if (NodesWithNewEdges.has_value() and NodesWithNewEdges->empty())
+    return false;
+
   revng_log(LogVerbose, "#### Collapsing Equality SCC: ... ");
-  bool Changed = collapseEqualitySCC(TS);
+  bool Changed = collapseSCCs<EqualityNodeT>(TS, NodesWithNewEdges);
   revng_log(LogVerbose, "#### Collapsing Equality SCC: Done!");
 
   if (VerifyLog.isEnabled()) {
@@ -193,14 +207,20 @@ bool CollapseEqualitySCC::runOnTypeSystem(LayoutTypeSystem &TS) {
 }
 
 bool CollapseInstanceAtOffset0SCC::runOnTypeSystem(LayoutTypeSystem &TS) {
-  Task T(2, "runOnTypeSystem");
+  StepTask T(2, "runOnTypeSystem");
 
   if (VerifyLog.isEnabled())
     revng_assert(TS.verifyConsistency());
 
+  // Without new edges there cannot be new loops of any kind, so removing the
+  // instance backedges would not do anything either.
+  auto NodesWithNewEdges = TS.takeNodesWithNewEdges(getID());
+  if (NodesWithNewEdges.has_value() and NodesWithNewEdges->empty())
+    return false;
+
   T.advance("collapseInstanceAtOffset0SCC");
   revng_log(LogVerbose, "#### Collapsing Instance-at-offset-0 SCC: ... ");
-  bool Changed = collapseInstanceAtOffset0SCC(TS);
+  bool Changed = collapseSCCs<InstanceOffset0EdgeT>(TS, NodesWithNewEdges);
   revng_log(LogVerbose, "#### Collapsing Instance-at-offset-0 SCC: Done!");
 
   if (VerifyLog.isEnabled()) {
@@ -11,6 +11,7 @@
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 #include "revng/Support/Debug.h"
 
@@ -32,7 +33,7 @@ bool ComputeNonInterferingComponents::runOnTypeSystem(LayoutTypeSystem &TS) {
   bool Changed = false;
 
   // Helper set, to prevent visiting a node from multiple entry points.
-  std::set<const LTSN *> Visited;
+  llvm::SmallPtrSet<const LTSN *, 16> Visited;
 
   for (LTSN *Root : llvm::nodes(&TS)) {
     revng_assert(Root != nullptr);
@@ -42,6 +43,21 @@ bool ComputeNonInterferingComponents::runOnTypeSystem(LayoutTypeSystem &TS) {
     for (LTSN *N : llvm::post_order_ext(NonPointerFilterT(Root), Visited)) {
       revng_assert(N->Size);
 
+      // If there are no children, there's nothing to do. There might be some
+      // accesses performed directly from N, but they always interfere with each
+      // other (because they start at the same base address), so they always
+      // constitute a single non-interfering component and we can leave them
+      // alone.
+      // If there is only one children and no accesses, we are sure that there's
+      // nothing to do, because the only children cannot interfere with anything
+      // else, and it is already a component on its own.
+      // Most nodes fall in one of these cases, so check them before paying for
+      // collecting and sorting the children.
+      if (llvm::count_if(N->Successors, isNotPointerEdge) < 2) {
+        N->InterferingInfo = AllChildrenAreNonInterfering;
+        continue;
+      }
+
       struct OrderedChild {
         dla::LayoutTypeSystemNode::NeighborsSet::iterator ChildIt;
         size_t FieldSize;
@@ -76,6 +92,7 @@ bool ComputeNonInterferingComponents::runOnTypeSystem(LayoutTypeSystem &TS) {
       // that has a dedicated <=> operator so that we can later sort the vector
       // according to it.
       ChildrenVec Children;
+      Children.reserve(N->Successors.size());
       auto NChildIt = N->Successors.begin();
       auto NChildEnd = N->Successors.end();
       for (; NChildIt != NChildEnd; ++NChildIt) {
@@ -88,24 +105,6 @@ bool ComputeNonInterferingComponents::runOnTypeSystem(LayoutTypeSystem &TS) {
         });
       }
 
-      // If there are no children, there's nothing to do. There might be some
-      // accesses performed directly from N, but they always interfere with each
-      // other (because they start at the same base address), so they always
-      // constitute a single non-interfering component and we can leave them
-      // alone.
-      if (Children.empty()) {
-        N->InterferingInfo = AllChildrenAreNonInterfering;
-        continue;
-      }
-
-      // If there is only one children and no accesses, we are sure that there's
-      // nothing to do, because the only children cannot interfere with anything
-      // else, and it is already a component on its own.
-      if (Children.size() == 1ULL) {
-        N->InterferingInfo = AllChildrenAreNonInterfering;
-        continue;
-      }
-
       // Sort the children. Thanks to the ordering of OrderedChild, children at
       // lower offsets will be sorted before children with higher offsets, and
       // for children at the same offset, the smaller will be sorted before the
@@ -2,11 +2,22 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Progress.h"
+#include "llvm/Support/ThreadPool.h"
 
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 
+#include "revng-c/Support/TraceSpan.h"
+
 #include "DLAStep.h"
 
 namespace dla {
@@ -68,8 +79,50 @@ static std::string getStepNameFromID(const void *ID) {
     revng_abort("Unexpected ID for DLAStep");
 }
 
+static thread_local bool RunningOnView = false;
+
+bool isRunningOnView() {
+  return RunningOnView;
+}
+
 static Logger<> DLAStepManagerLog("dla-step-manager");
 static Logger<> DLADumpDot("dla-step-dump-dot");
+static Logger<> DLADumpSnapshot("dla-step-dump-snapshot");
+
+using llvm::cl::cat;
+using llvm::cl::desc;
+using llvm::cl::init;
+
+static llvm::cl::opt<unsigned>
+  DLAThreads("dla-threads",
+             desc("Number of threads running the DLA steps on independent "
+                  "components of the type system (0 means one per core, 1 "
+                  "disables parallel execution)"),
+             init(1),
+             cat(MainCategory));
+
+static llvm::cl::opt<std::string>
+  StepProfilePath("dla-step-profile-output",
+                  desc("Path of a CSV file where the duration of each DLA "
+                       "step and the size of the type system before and "
+                       "after it are written"),
+                  llvm::cl::value_desc("path"),
+                  cat(MainCategory));
+
+static llvm::cl::opt<bool>
+  SkipRedundantSteps("dla-skip-redundant-steps",
+                     desc("Do not run again DLA steps that did not change the "
+                          "type system, until another step changes it"),
+                     init(true),
+                     cat(MainCategory));
+
+unsigned getDLAThreads() {
+  return DLAThreads;
+}
+
+bool getSkipRedundantSteps() {
+  return SkipRedundantSteps;
+}
 
 [[nodiscard]] bool StepManager::addStep(std::unique_ptr<Step> S) {
   const void *StepID = S->getStepID();
@@ -117,26 +170,228 @@ static Logger<> DLADumpDot("dla-step-dump-dot");
   return true;
 }
 
+/// The steps whose last run on a LayoutTypeSystem did not change it, and that
+/// have been followed only by steps that did not change it either.
+///
+/// Steps are deterministic, so running them again would not change anything.
+using RedundantStepSet = llvm::SmallPtrSet<const void *, 16>;
+
+static bool runStepAndTrackChanges(Step &S,
+                                   LayoutTypeSystem &TS,
+                                   RedundantStepSet &Redundant) {
+  TraceSpan Span(getStepNameFromID(S.getStepID()), "dla");
+  bool Changed = S.runOnTypeSystem(TS);
+  TS.compactNodes();
+  TS.recycleDestroyedNodes();
+  if (Changed)
+    Redundant.clear();
+  else if (SkipRedundantSteps)
+    Redundant.insert(S.getStepID());
+  return Changed;
+}
+
+/// Runs \a S on \a TS, unless it's redundant, adding its effects to
+/// \a Profile, if any
+static bool runStep(Step &S,
+                    LayoutTypeSystem &TS,
+                    RedundantStepSet &Redundant,
+                    StepProfile *Profile = nullptr) {
+  if (Redundant.count(S.getStepID())) {
+    revng_log(DLAStepManagerLog,
+              "Skipping " << getStepNameFromID(S.getStepID()));
+    if (Profile != nullptr) {
+      size_t NumNodes = TS.getNumLayouts();
+      size_t NumEdges = TS.countEdges();
+      Profile->NodesBefore += NumNodes;
+      Profile->NodesAfter += NumNodes;
+      Profile->EdgesBefore += NumEdges;
+      Profile->EdgesAfter += NumEdges;
+      ++Profile->SkippedRuns;
+    }
+    return false;
+  }
+
+  // The sampled verifications made by S always check the new edges it adds
+  TS.startVerificationRound();
+
+  if (Profile == nullptr)
+    return runStepAndTrackChanges(S, TS, Redundant);
+
+  Profile->NodesBefore += TS.getNumLayouts();
+  Profile->EdgesBefore += TS.countEdges();
+  uint64_t MergeNodesCalls = TS.getNumMergeNodesCalls();
+  uint64_t RemoveNodeCalls = TS.getNumRemoveNodeCalls();
+
+  auto Start = std::chrono::steady_clock::now();
+  bool Changed = runStepAndTrackChanges(S, TS, Redundant);
+  std::chrono::duration<double, std::milli>
+    Elapsed = std::chrono::steady_clock::now() - Start;
+
+  Profile->Milliseconds += Elapsed.count();
+  Profile->NodesAfter += TS.getNumLayouts();
+  Profile->EdgesAfter += TS.countEdges();
+  Profile->MergeNodesCalls += TS.getNumMergeNodesCalls() - MergeNodesCalls;
+  Profile->RemoveNodeCalls += TS.getNumRemoveNodeCalls() - RemoveNodeCalls;
+  Profile->Changed |= Changed;
+  return Changed;
+}
+
+static void printProfile(llvm::raw_ostream &OS,
+                         const StepManager &SM,
+                         llvm::ArrayRef<StepProfile> Profiles) {
+  OS << "index,step,ms,nodes_before,nodes_after,edges_before,edges_after,"
+        "merge_nodes_calls,remove_node_calls,changed,skipped\n";
+  for (size_t Index = 0; Index < SM.Schedule.size(); ++Index) {
+    const StepProfile &P = Profiles[Index];
+    const void *StepID = SM.Schedule[Index]->getStepID();
+    OS << Index << "," << getStepNameFromID(StepID) << ","
+       << llvm::format("%.3f,", P.Milliseconds) << P.NodesBefore << ","
+       << P.NodesAfter << "," << P.EdgesBefore << "," << P.EdgesAfter << ","
+       << P.MergeNodesCalls << "," << P.RemoveNodeCalls << "," << P.Changed
+       << "," << P.SkippedRuns << "\n";
+  }
+}
+
+void StepManager::runInParallel(LayoutTypeSystem &TS,
+                                unsigned NumThreads,
+                                std::vector<StepProfile> &Profiles) {
+  // Each view gets the whole schedule, from start to end, without per-step
+  // progress reporting and dumps, which are not meaningful for a single view.
+  // Views are destroyed, hence give their nodes back to TS, as soon as their
+  // schedule is done.
+  auto Views = TS.splitIntoViews(NumThreads);
+  revng_log(DLAStepManagerLog,
+            "Running on " << Views.size() << " views in parallel");
+
+  llvm::Task T{ 1, "StepManager::run" };
+  T.advance("Running the steps on " + std::to_string(Views.size())
+            + " views");
+  std::mutex ProfilesMutex;
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  for (std::unique_ptr<LayoutTypeSystem> &View : Views) {
+    Pool.async([this, &View, &Profiles, &ProfilesMutex]() {
+      RunningOnView = true;
+      std::vector<StepProfile> ViewProfiles(Profiles.size());
+      RedundantStepSet Redundant;
+      for (size_t Index = 0; Index < Schedule.size(); ++Index) {
+        StepProfile *P = ViewProfiles.empty() ? nullptr : &ViewProfiles[Index];
+        runStep(*Schedule[Index], *View, Redundant, P);
+      }
+      View.reset();
+      RunningOnView = false;
+
+      std::lock_guard Lock(ProfilesMutex);
+      for (size_t Index = 0; Index < ViewProfiles.size(); ++Index)
+        Profiles[Index].add(ViewProfiles[Index]);
+    });
+  }
+  Pool.wait();
+
+  if (DLADumpDot.isEnabled())
+    TS.dumpDotOnFile("type-system-" + std::to_string(Schedule.size()) + ".dot",
+                     true);
+  if (DLADumpSnapshot.isEnabled())
+    TS.dumpSnapshotOnFile("type-system-" + std::to_string(Schedule.size())
+                          + ".dlats");
+}
+
 void StepManager::run(LayoutTypeSystem &TS) {
   if (not hasValidSchedule())
     revng_abort("Cannot run a on LayoutTypeSystem: invalid schedule");
   int x = 0;
   if (DLADumpDot.isEnabled())
     TS.dumpDotOnFile("type-system-0.dot", true);
+  if (DLADumpSnapshot.isEnabled())
+    TS.dumpSnapshotOnFile("type-system-0.dlats");
+
+  std::optional<llvm::raw_fd_ostream> ProfileStream;
+  std::vector<StepProfile> Profiles;
+  if (not StepProfilePath.empty()) {
+    std::error_code EC;
+    ProfileStream.emplace(StepProfilePath, EC, llvm::sys::fs::OF_Text);
+    if (EC)
+      revng_abort("Cannot open the DLA step profile output file");
+    Profiles.resize(Schedule.size());
+  }
+
+  unsigned NumThreads = DLAThreads;
+  if (NumThreads == 0)
+    NumThreads = llvm::hardware_concurrency().compute_thread_count();
 
-  llvm::Task T{ Schedule.size(), "StepManager::run" };
-  for (auto &S : Schedule) {
-    T.advance(getStepNameFromID(S->getStepID()));
-    S->runOnTypeSystem(TS);
-    ++x;
-    if (DLADumpDot.isEnabled()) {
-      revng_log(DLADumpDot,
-                "Step " << getStepNameFromID(S->getStepID())
-                        << " Index: " << x);
-      std::string DotName = "type-system-" + std::to_string(x) + ".dot";
-      TS.dumpDotOnFile(DotName.c_str(), true);
+  if (NumThreads > 1) {
+    runInParallel(TS, NumThreads, Profiles);
+  } else {
+    llvm::Task T{ Schedule.size(), "StepManager::run" };
+    RedundantStepSet Redundant;
+    for (auto &S : Schedule) {
+      T.advance(getStepNameFromID(S->getStepID()));
+      runStep(*S, TS, Redundant, Profiles.empty() ? nullptr : &Profiles[x]);
+      ++x;
+      if (DLADumpDot.isEnabled()) {
+        revng_log(DLADumpDot,
+                  "Step " << getStepNameFromID(S->getStepID())
+                          << " Index: " << x);
+        std::string DotName = "type-system-" + std::to_string(x) + ".dot";
+        TS.dumpDotOnFile(DotName.c_str(), true);
+      }
+      if (DLADumpSnapshot.isEnabled())
+        TS.dumpSnapshotOnFile("type-system-" + std::to_string(x) + ".dlats");
     }
   }
+
+  if (ProfileStream)
+    printProfile(*ProfileStream, *this, Profiles);
+}
+
+void populateDefaultSchedule(StepManager &SM, size_t PtrSize) {
+  //
+  // Graph normalization phase
+  //
+  revng_check(SM.addStep<RemoveInvalidPointers>(PtrSize));
+  revng_check(SM.addStep<CollapseEqualitySCC>());
+  revng_check(SM.addStep<CollapseInstanceAtOffset0SCC>());
+  revng_check(SM.addStep<SimplifyInstanceAtOffset0>());
+  revng_check(SM.addStep<PruneLayoutNodesWithoutLayout>());
+  revng_check(SM.addStep<ComputeUpperMemberAccesses>());
+  revng_check(SM.addStep<RemoveInvalidStrideEdges>());
+  revng_check(SM.addStep<PruneLayoutNodesWithoutLayout>());
+  revng_check(SM.addStep<ComputeUpperMemberAccesses>());
+  revng_check(SM.addStep<DecomposeStridedEdges>());
+
+  //
+  // Graph optimization phase
+  //
+  revng_check(SM.addStep<CollapseSingleChild>());
+  revng_check(SM.addStep<DeduplicateFields>());
+  revng_check(SM.addStep<MergePointeesOfPointerUnion>(PtrSize));
+  revng_check(SM.addStep<MergePointerNodes>());
+  revng_check(SM.addStep<CollapseInstanceAtOffset0SCC>());
+  revng_check(SM.addStep<SimplifyInstanceAtOffset0>());
+  revng_check(SM.addStep<PruneLayoutNodesWithoutLayout>());
+  revng_check(SM.addStep<ComputeUpperMemberAccesses>());
+  revng_check(SM.addStep<RemoveInvalidStrideEdges>());
+  revng_check(SM.addStep<PruneLayoutNodesWithoutLayout>());
+  revng_check(SM.addStep<ComputeUpperMemberAccesses>());
+
+  revng_check(SM.addStep<MergePointerNodes>());
+  // CollapseSingleChild and DeduplicateFields run before
+  // CompactCompatibleArrays and ArrangeAccessesHierarchically, to allow them to
+  // produce better results
+  revng_check(SM.addStep<CollapseSingleChild>());
+  revng_check(SM.addStep<DeduplicateFields>());
+  revng_check(SM.addStep<ArrangeAccessesHierarchically>());
+  revng_check(SM.addStep<CompactCompatibleArrays>());
+  revng_check(SM.addStep<PushDownPointers>());
+  // ArrangeAccessesHierarchically can move pointer edges around in some cases,
+  // so we want to run MergePointerNodes again afterwards.
+  revng_check(SM.addStep<MergePointerNodes>());
+  // CollapseSingleChild and DeduplicateFields run again after
+  // CompactCompatibleArrays and ArrangeAccessesHierarchically, to allow them to
+  // improve the results even further.
+  revng_check(SM.addStep<ResolveLeafUnions>());
+  revng_check(SM.addStep<CollapseSingleChild>());
+  revng_check(SM.addStep<DeduplicateFields>());
+  revng_check(SM.addStep<ComputeNonInterferingComponents>());
 }
 
 } // end namespace dla
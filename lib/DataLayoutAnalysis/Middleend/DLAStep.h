@@ -6,11 +6,15 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Progress.h"
 
 #include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
 
@@ -56,6 +60,34 @@ public:
   const void *getStepID() const { return StepID; };
 };
 
+/// \return true on the threads running the steps on a view of the type
+///         system, concurrently with other views.
+bool isRunningOnView();
+
+/// \return the value of -dla-threads
+unsigned getDLAThreads();
+
+/// \return the value of -dla-skip-redundant-steps
+bool getSkipRedundantSteps();
+
+/// The llvm::Task of a step, only reported when the step runs on the thread
+/// that called StepManager::run, since llvm::Task is not thread safe
+class StepTask {
+private:
+  std::optional<llvm::Task> T;
+
+public:
+  StepTask(size_t Steps, const llvm::Twine &Name) {
+    if (not isRunningOnView())
+      T.emplace(Steps, Name);
+  }
+
+  void advance(const llvm::Twine &Name) {
+    if (T)
+      T->advance(Name);
+  }
+};
+
 /// Collapses strongly connected components made of equality edges
 //
 // After the execution of this step, the LayoutTypeSystem graph should not
@@ -391,6 +423,35 @@ bool intersect(const RangeT &R1, const RangeT &R2) {
   return intersect(R1.begin(), R1.end(), R2.begin(), R2.end());
 }
 
+/// What a Step did to the LayoutTypeSystem in a run of the StepManager.
+///
+/// When the steps run in parallel on multiple views, the figures of all the
+/// views are summed up.
+struct StepProfile {
+  double Milliseconds = 0.0;
+  size_t NodesBefore = 0;
+  size_t NodesAfter = 0;
+  size_t EdgesBefore = 0;
+  size_t EdgesAfter = 0;
+  uint64_t MergeNodesCalls = 0;
+  uint64_t RemoveNodeCalls = 0;
+  bool Changed = false;
+  /// The number of times the step was not run because it was redundant
+  unsigned SkippedRuns = 0;
+
+  void add(const StepProfile &Other) {
+    Milliseconds += Other.Milliseconds;
+    NodesBefore += Other.NodesBefore;
+    NodesAfter += Other.NodesAfter;
+    EdgesBefore += Other.EdgesBefore;
+    EdgesAfter += Other.EdgesAfter;
+    MergeNodesCalls += Other.MergeNodesCalls;
+    RemoveNodeCalls += Other.RemoveNodeCalls;
+    Changed |= Other.Changed;
+    SkippedRuns += Other.SkippedRuns;
+  }
+};
+
 class StepManager {
 
 public:
@@ -420,8 +481,20 @@ public:
   }
 
   /// Runs the added steps
+  ///
+  /// A step is skipped if its last run did not change \a TS, and no step did
+  /// since then.
   void run(LayoutTypeSystem &TS);
 
+private:
+  /// Runs the added steps concurrently on independent parts of \a TS
+  ///
+  /// \param Profiles if not empty, where the effects of each step are recorded
+  void runInParallel(LayoutTypeSystem &TS,
+                     unsigned NumThreads,
+                     std::vector<StepProfile> &Profiles);
+
+public:
   /// Drops all the scheduled steps
   void reset() {
     Schedule.clear();
@@ -444,4 +517,10 @@ public:
   }
 };
 
+/// Adds to \a SM the steps of the DLA middle-end, in the order DLAPass runs
+/// them
+///
+/// \param PtrSize the size of pointers in the binary
+void populateDefaultSchedule(StepManager &SM, size_t PtrSize);
+
 } // end namespace dla
@@ -239,7 +239,7 @@ areEquivSubtrees(const Link &Child1, const Link &Child2) {
   auto [Result, Visited1, Visited2] = exploreAndCompare(Child1, Child2);
   bool AreSubtreesEqual = Result == order::equal;
 
-  return { AreSubtreesEqual, Visited1, Visited2 };
+  return { AreSubtreesEqual, std::move(Visited1), std::move(Visited2) };
 }
 
 /// Visit the two subtrees of \a Child1 and \a Child2. If they are
@@ -445,6 +445,15 @@ bool DeduplicateFields::runOnTypeSystem(LayoutTypeSystem &TS) {
                 revng_log(Log, "skip pointer edge");
               }
 
+              // Cheap rejection: the subtrees can only be equivalent if their
+              // roots have the same tag, size and number of successors. This
+              // avoids the allocations of a full comparison for the vast
+              // majority of the candidates on wide structs.
+              if (cmpLinks(NotMergedLink, CurLink) != order::equal) {
+                revng_log(CmpLog, "Different roots");
+                continue;
+              }
+
               auto [IsMerged,
                     Preserved,
                     Erased] = mergeIfTopologicallyEq(TS,
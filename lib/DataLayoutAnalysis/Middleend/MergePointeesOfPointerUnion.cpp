@@ -4,6 +4,7 @@
 
 #include <unordered_set>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/STLExtras.h"
@@ -81,45 +82,38 @@ bool MergePointeesOfPointerUnion::runOnTypeSystem(LayoutTypeSystem &TS) {
 
     llvm::EquivalenceClasses<LTSN *> ToMerge;
 
-    auto ChildEnd = Node->Successors.end();
-    for (auto AChildIt = Node->Successors.begin(); AChildIt != ChildEnd;
-         ++AChildIt) {
-
-      const auto &AEdge = *AChildIt;
-      if (not isInstanceEdge(AEdge))
+    // All the pointer nodes that are connected to Node with the same instance
+    // edge have to be merged together. Instead of comparing all the pairs of
+    // children, we join each of them with the first one found with its edge.
+    llvm::SmallDenseMap<const TypeLinkTag *, LTSN *, 8> FirstPointerWithTag;
+    for (const auto &Edge : Node->Successors) {
+      if (not isInstanceEdge(Edge))
         continue;
 
-      const auto &[APointer, ATag] = AEdge;
-      if (not hasOutgoingPointerEdge(APointer))
+      const auto &[BPointer, BTag] = Edge;
+      if (not hasOutgoingPointerEdge(BPointer))
         continue;
-      revng_assert(isWellFormedPointer(APointer));
-
-      for (auto BChildIt = std::next(AChildIt); BChildIt != ChildEnd;
-           ++BChildIt) {
-
-        const auto &BEdge = *BChildIt;
-        const auto &[BPointer, BTag] = BEdge;
-        if (ATag != BTag)
-          continue;
+      revng_assert(isWellFormedPointer(BPointer));
 
-        if (not hasOutgoingPointerEdge(BPointer))
-          continue;
-        revng_assert(isWellFormedPointer(BPointer));
+      auto [FirstIt, IsFirst] = FirstPointerWithTag.try_emplace(BTag,
+                                                                BPointer);
+      if (IsFirst)
+        continue;
 
-        // Here we're sure that A and B are connected to Node with the same kind
-        // of instance edge. And that they are both pointer nodes.
+      // Here we're sure that A and B are connected to Node with the same kind
+      // of instance edge. And that they are both pointer nodes.
+      LTSN *APointer = FirstIt->second;
 
-        revng_log(Log,
-                  "has a pair of instance children at the same offset that are "
-                  "pointer nodes:");
-        revng_log(Log, "A: " << APointer->ID << ", B:" << BPointer->ID);
+      revng_log(Log,
+                "has a pair of instance children at the same offset that are "
+                "pointer nodes:");
+      revng_log(Log, "A: " << APointer->ID << ", B:" << BPointer->ID);
 
-        revng_assert(APointer->Successors.size() == 1,
-                     std::to_string(APointer->ID).c_str());
-        revng_assert(BPointer->Successors.size() == 1,
-                     std::to_string(BPointer->ID).c_str());
-        ToMerge.unionSets(APointer, BPointer);
-      }
+      revng_assert(APointer->Successors.size() == 1,
+                   std::to_string(APointer->ID).c_str());
+      revng_assert(BPointer->Successors.size() == 1,
+                   std::to_string(BPointer->ID).c_str());
+      ToMerge.unionSets(APointer, BPointer);
     }
 
     if (not ToMerge.empty()) {
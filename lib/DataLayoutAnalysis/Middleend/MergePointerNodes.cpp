@@ -22,11 +22,16 @@ using InversePointerGraphNodeT = llvm::Inverse<PointerGraphNodeT>;
 bool MergePointerNodes::runOnTypeSystem(LayoutTypeSystem &TS) {
   bool Changed = false;
 
+  // Shared by all the visits, so that the pointers to each node are looked at
+  // only once, unless a merge gives the node new pointers to it.
+  llvm::df_iterator_default_set<LTSN *> Visited;
+
   for (LTSN *Node : llvm::nodes(&TS)) {
     revng_assert(Node != nullptr);
 
     revng_log(Log, "# Starting from Node: " << Node->ID);
-    for (auto *Node : llvm::depth_first(InversePointerGraphNodeT(Node))) {
+    for (auto *Node :
+         llvm::depth_first_ext(InversePointerGraphNodeT(Node), Visited)) {
       if (isPointerRoot(Node))
         continue;
 
@@ -57,6 +62,12 @@ bool MergePointerNodes::runOnTypeSystem(LayoutTypeSystem &TS) {
       // being held on it points to Node, not to any of the nodes in ToMerge,
       // so erasing the nodes in ToMerge never invalidats the iterator to Node
       TS.mergeNodes(ToMerge);
+
+      // The merged node now has all the pointers to the nodes merged into it,
+      // that might have to be merged too, so it has to be visited again. The
+      // other nodes in ToMerge don't exist anymore.
+      for (LTSN *Merged : ToMerge)
+        Visited.erase(Merged);
     }
   }
 
@@ -2,23 +2,26 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <compare>
 #include <limits>
 #include <vector>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
-#include "llvm/Support/Progress.h"
 
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 
 #include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
 
+#include "DLAStep.h"
 #include "RemoveBackedges.h"
 
 static Logger<> Log("dla-remove-backedges");
@@ -61,6 +64,99 @@ static bool hasNoSCCEdge(const LTSN *Node) {
   return isSCCRoot<SCC>(Node) and isSCCLeaf<SCC>(Node);
 };
 
+/// Compute the set of nodes from which a loop of mixed edges is reachable,
+/// with a single iterative Tarjan visit of the whole graph.
+///
+/// A visit starting from any other node cannot close any loop, so it can be
+/// skipped altogether.
+template<SCCWithBackedgeHelper SCC>
+static llvm::DenseSet<const LTSN *>
+getNodesReachingLoops(LayoutTypeSystem &TS) {
+  using MixedNodeT = EdgeFilteredGraph<LTSN *, isMixedEdge<SCC>>;
+
+  struct TarjanInfo {
+    unsigned Index;
+    unsigned LowLink;
+    bool OnStack;
+  };
+  llvm::DenseMap<const LTSN *, TarjanInfo> Info;
+
+  struct StackEntry {
+    LTSN *Node;
+    typename MixedNodeT::ChildEdgeIteratorType NextToVisitIt;
+  };
+  std::vector<StackEntry> VisitStack;
+  std::vector<LTSN *> SCCStack;
+  unsigned NextIndex = 0;
+
+  const auto Push = [&](LTSN *N) {
+    Info[N] = { NextIndex, NextIndex, true };
+    ++NextIndex;
+    SCCStack.push_back(N);
+    VisitStack.push_back({ N, MixedNodeT::child_edge_begin(N) });
+  };
+
+  llvm::DenseSet<const LTSN *> Result;
+  for (LTSN *Start : llvm::nodes(&TS)) {
+    if (Info.count(Start))
+      continue;
+
+    Push(Start);
+    while (not VisitStack.empty()) {
+      LTSN *Top = VisitStack.back().Node;
+      auto &NextEdgeToVisit = VisitStack.back().NextToVisitIt;
+      if (NextEdgeToVisit != MixedNodeT::child_edge_end(Top)) {
+        LTSN *Child = NextEdgeToVisit->first;
+        ++NextEdgeToVisit;
+        auto It = Info.find(Child);
+        if (It == Info.end()) {
+          Push(Child);
+        } else if (It->second.OnStack) {
+          unsigned ChildIndex = It->second.Index;
+          unsigned &LowLink = Info[Top].LowLink;
+          LowLink = std::min(LowLink, ChildIndex);
+        }
+        continue;
+      }
+
+      VisitStack.pop_back();
+      const TarjanInfo TopInfo = Info[Top];
+      if (not VisitStack.empty()) {
+        unsigned &ParentLowLink = Info[VisitStack.back().Node].LowLink;
+        ParentLowLink = std::min(ParentLowLink, TopInfo.LowLink);
+      }
+
+      if (TopInfo.LowLink != TopInfo.Index)
+        continue;
+
+      // Top is the root of an SCC, whose members are on top of SCCStack. All
+      // the SCCs reachable from it have already been completed.
+      auto SCCBegin = std::prev(std::find(SCCStack.rbegin(),
+                                          SCCStack.rend(),
+                                          Top)
+                                  .base());
+      bool ReachesLoop = std::next(SCCBegin) != SCCStack.end();
+      if (not ReachesLoop) {
+        for (const LTSN *Child : llvm::children<MixedNodeT>(Top)) {
+          if (Child == Top or Result.contains(Child)) {
+            ReachesLoop = true;
+            break;
+          }
+        }
+      }
+
+      for (LTSN *Member : llvm::make_range(SCCBegin, SCCStack.end())) {
+        Info[Member].OnStack = false;
+        if (ReachesLoop)
+          Result.insert(Member);
+      }
+      SCCStack.erase(SCCBegin, SCCStack.end());
+    }
+  }
+
+  return Result;
+}
+
 template<SCCWithBackedgeHelper SCC>
 static bool removeBackedgesFromSCC(LayoutTypeSystem &TS) {
   bool Changed = false;
@@ -86,7 +182,7 @@ static bool removeBackedgesFromSCC(LayoutTypeSystem &TS) {
 
   revng_log(Log, "Removing Backedges From Loops");
 
-  llvm::Task T(2, "removeBackedgesFromSCC");
+  StepTask T(2, "removeBackedgesFromSCC");
   T.advance("Detect SCC Node View Components");
   // Assign each node to a Component, except for those that have no incoming nor
   // outgoing SCCNodeView edges. The goal is to identify the subsets of nodes
@@ -141,6 +237,12 @@ static bool removeBackedgesFromSCC(LayoutTypeSystem &TS) {
   using MixedNodeT = EdgeFilteredGraph<LTSN *, isMixedEdge<SCC>>;
 
   T.advance("Remove Backedges");
+
+  // Removing edges can only make these sets smaller, so it's safe to compute
+  // them once for all the visits below
+  const llvm::DenseSet<const LTSN *> NodesReachingLoops = getNodesReachingLoops<
+    SCC>(TS);
+
   for (const auto &Root : llvm::nodes(&TS)) {
     revng_assert(Root != nullptr);
     // We start from SCCNodeView roots and look if we find an SCC with mixed
@@ -151,6 +253,9 @@ static bool removeBackedgesFromSCC(LayoutTypeSystem &TS) {
     if (not isSCCRoot<SCC>(Root))
       continue;
 
+    if (not NodesReachingLoops.contains(Root))
+      continue;
+
     revng_log(Log, "# Looking for mixed loops from: " << Root->ID);
 
     struct EdgeInfo {
@@ -244,7 +349,12 @@ static bool removeBackedgesFromSCC(LayoutTypeSystem &TS) {
         }
 
         ++NextEdgeToVisit;
-        StartNew = TryPush(NextChild, NextComponent);
+
+        // Visiting a node that cannot reach any loop would close no loop and
+        // leave CrossComponentEdges as it is, so we treat it as if it was
+        // already visited, without exploring it.
+        StartNew = NodesReachingLoops.contains(NextChild)
+                   and TryPush(NextChild, NextComponent);
 
         if (not StartNew) {
 
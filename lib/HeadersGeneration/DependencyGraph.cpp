@@ -4,6 +4,7 @@
 
 #include <optional>
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Casting.h"
@@ -39,11 +40,11 @@ void DependencyGraph::addNode(const model::Type *T) {
 
   constexpr auto TypeName = TypeNode::Kind::TypeName;
   auto *NameNode = GenericGraph::addNode(TypeNode{ T, TypeName });
-  TypeToNode[TypeKindPair{ T, TypeName }] = NameNode;
 
   constexpr auto FullType = TypeNode::Kind::FullType;
   auto *FullNode = GenericGraph::addNode(TypeNode{ T, FullType });
-  TypeToNode[TypeKindPair{ T, FullType }] = FullNode;
+
+  TypeToNode.insert(T, NameNode, FullNode);
 }
 
 std::string getNodeLabel(const TypeDependencyNode *N) {
@@ -255,7 +256,13 @@ static void registerDependencies(const model::Type *T,
     revng_abort();
   }
 
+  // Many fields or arguments can have the same type, don't add the same edge
+  // more than once
+  llvm::SmallDenseSet<Edge, 8> Added;
   for (const auto &[From, To] : Deps) {
+    if (not Added.insert({ From, To }).second)
+      continue;
+
     revng_log(Log,
               "Adding edge " << getNodeLabel(From) << " --> "
                              << getNodeLabel(To));
@@ -4,11 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/DOTGraphTraits.h"
 #include "llvm/Support/GraphWriter.h"
 
 #include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Type.h"
+#include "revng/Support/Assert.h"
 
 /// Represents a model::Type in the DependencyGraph
 struct TypeNode {
@@ -26,9 +30,29 @@ struct TypeNode {
 
 using TypeDependencyNode = BidirectionalNode<TypeNode>;
 using TypeKindPair = std::pair<const model::Type *, TypeNode::Kind>;
-using TypeToDependencyNodeMap = std::map<TypeKindPair, TypeDependencyNode *>;
 using TypeVector = TrackingSortedVector<UpcastablePointer<model::Type>>;
 
+/// Maps each model::Type to the nodes representing its name and its full type
+class TypeToDependencyNodeMap {
+private:
+  using NodePair = std::array<TypeDependencyNode *, 2>;
+  llvm::DenseMap<const model::Type *, NodePair> Map;
+
+public:
+  void insert(const model::Type *T,
+              TypeDependencyNode *NameNode,
+              TypeDependencyNode *FullNode) {
+    bool New = Map.insert({ T, { NameNode, FullNode } }).second;
+    revng_assert(New);
+  }
+
+  TypeDependencyNode *at(const TypeKindPair &Key) const {
+    auto It = Map.find(Key.first);
+    revng_assert(It != Map.end());
+    return It->second[Key.second];
+  }
+};
+
 /// Represents the graph of dependencies among types
 struct DependencyGraph : public GenericGraph<TypeDependencyNode> {
 
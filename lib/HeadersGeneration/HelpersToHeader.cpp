@@ -106,14 +106,17 @@ bool dumpHelpersToHeader(const llvm::Module &M, llvm::raw_ostream &Out) {
 
     for (const llvm::Function &F : M.functions()) {
 
-      // Skip non-helpers
-      bool IsHelper = FunctionTags::QEMU.isTagOf(&F)
-                      or FunctionTags::Helper.isTagOf(&F)
-                      or FunctionTags::OpaqueCSVValue.isTagOf(&F)
-                      or FunctionTags::Exceptional.isTagOf(&F)
-                      or F.isIntrinsic();
-      if (not IsHelper)
-        continue;
+      // Skip non-helpers. Most functions are not helpers, so read their tags
+      // only once.
+      if (not F.isIntrinsic()) {
+        auto Tags = FunctionTags::TagsSet::from(&F);
+        bool IsHelper = Tags.contains(FunctionTags::QEMU)
+                        or Tags.contains(FunctionTags::Helper)
+                        or Tags.contains(FunctionTags::OpaqueCSVValue)
+                        or Tags.contains(FunctionTags::Exceptional);
+        if (not IsHelper)
+          continue;
+      }
 
       // Skip helpers that should never be printed:
       // - because we expect them to never require emission and we wouldn't know
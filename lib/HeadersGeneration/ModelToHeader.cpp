@@ -70,7 +70,7 @@ static void printTypeDefinitions(const model::Binary &Model,
                                  const ModelToHeaderOptions &Options) {
   std::set<const model::Type *> StackTypes, EmptyInlineTypes;
   if (not Options.DisableTypeInlining)
-    StackTypes = TheTypeInlineHelper.collectStackTypes(Model);
+    StackTypes = TheTypeInlineHelper.collectStackTypes();
 
   DependencyGraph Dependencies = buildDependencyGraph(Model.Types());
   const auto &TypeNodes = Dependencies.TypeNodes();
@@ -132,7 +132,7 @@ static void printTypeDefinitions(const model::Binary &Model,
           if ((isa<model::UnionType>(NodeT) or isa<model::StructType>(NodeT))
               and not ToInline.contains(NodeT)) {
             auto TypesToInline = TheTypeInlineHelper
-                                   .getTypesToInlineInTypeTy(Model, NodeT);
+                                   .getTypesToInlineInTypeTy(NodeT);
             for (auto *Type : TypesToInline) {
               revng_assert(isCandidateForInline(Type));
               printDeclaration(Log,
@@ -226,10 +226,10 @@ bool dumpModelToHeader(const model::Binary &Model,
       Header << B.getLineComment("===============");
       Header << '\n';
       QualifiedTypeNameMap AdditionalTypeNames;
-      TypeInlineHelper TheTypeInlineHelper(Model);
+      auto TheTypeInlineHelper = TypeInlineHelper::get(Model);
 
       printTypeDefinitions(Model,
-                           TheTypeInlineHelper,
+                           *TheTypeInlineHelper,
                            Header,
                            B,
                            AdditionalTypeNames,
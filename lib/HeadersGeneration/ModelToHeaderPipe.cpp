@@ -2,14 +2,41 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <string>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/RegisterContainerFactory.h"
 #include "revng/Pipes/FileContainer.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/YAMLTraits.h"
 
 #include "revng-c/HeadersGeneration/ModelToHeader.h"
 #include "revng-c/HeadersGeneration/ModelToHeaderPipe.h"
 #include "revng-c/Pipes/Kinds.h"
+#include "revng-c/Support/ContentAddressedStore.h"
+#include "revng-c/Support/MemoryMetrics.h"
+#include "revng-c/Support/TraceSpan.h"
+
+static Logger<> Log{ "headers-cache" };
+
+/// Bump this every time the header generation changes in a way that affects
+/// its output, so that stale entries are never reused.
+static constexpr const char *CacheFormatVersion = "1";
+
+static llvm::cl::opt<std::string>
+  CacheDirectory("headers-cache-dir",
+                 llvm::cl::desc("Directory where the header of the model "
+                                "types is cached, keyed on a hash of the "
+                                "model"),
+                 llvm::cl::value_desc("directory"),
+                 llvm::cl::cat(MainCategory));
 
 namespace revng::pipes {
 
@@ -31,7 +58,43 @@ void ModelToHeader::run(const pipeline::ExecutionContext &Ctx,
     revng_abort(EC.message().c_str());
 
   const model::Binary &Model = *getModelFromContext(Ctx);
-  dumpModelToHeader(Model, Header, {});
+  MemoryMetrics Metrics("model-to-header");
+  TraceSpan Span("model-to-header", "pass");
+  Metrics.recordSize("model_types", Model.Types().size());
+
+  std::optional<ContentAddressedStore> Store;
+  std::string Key;
+  std::optional<std::string> Cached;
+  if (not CacheDirectory.empty()) {
+    // The header depends on nothing but the model
+    std::string Buffer = CacheFormatVersion;
+    Buffer += '\n';
+    {
+      llvm::raw_string_ostream Stream(Buffer);
+      llvm::yaml::Output YAMLOutput(Stream);
+      YAMLOutput << const_cast<model::Binary &>(Model);
+    }
+
+    Store.emplace(CacheDirectory, ".h", Log);
+    Key = ContentAddressedStore::computeKey(Buffer);
+    Cached = Store->lookup(Key);
+  }
+
+  if (Cached) {
+    Header << *Cached;
+    Metrics.recordSize("header_bytes", Cached->size());
+  } else {
+    std::string Result;
+    {
+      llvm::raw_string_ostream Stream(Result);
+      dumpModelToHeader(Model, Stream, {});
+    }
+
+    Header << Result;
+    Metrics.recordSize("header_bytes", Result.size());
+    if (Store)
+      Store->store(Key, Result);
+  }
 
   Header.flush();
   EC = Header.error();
@@ -2,6 +2,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+
+#include "llvm/Support/ThreadPool.h"
+
 #include "revng-c/Backend/DecompiledCCodeIndentation.h"
 #include "revng-c/HeadersGeneration/ModelToHeader.h"
 #include "revng-c/HeadersGeneration/ModelTypeDefinition.h"
@@ -9,21 +13,19 @@
 
 static Logger<> Log{ "model-type-definition" };
 
-std::string dumpModelTypeDefinition(const model::Binary &Model,
-                                    model::Type::Key Key) {
+static std::string dumpModelTypeDefinition(const model::Binary &Model,
+                                           const model::Type &T,
+                                           ptml::PTMLCBuilder &B) {
   std::string Result;
 
-  const UpcastablePointer<model::Type> &UpcastableType = Model.Types().at(Key);
-
   llvm::raw_string_ostream Out(Result);
   ptml::PTMLIndentedOstream PTMLOut(Out, DecompiledCCodeIndentation, true);
-  ptml::PTMLCBuilder B(true);
 
   std::map<model::QualifiedType, std::string> AdditionalNames;
   const std::set<const model::Type *> TypesToInline;
 
   printDefinition(Log,
-                  *UpcastableType,
+                  T,
                   PTMLOut,
                   B,
                   Model,
@@ -35,3 +37,37 @@ std::string dumpModelTypeDefinition(const model::Binary &Model,
 
   return Result;
 }
+
+std::string dumpModelTypeDefinition(const model::Binary &Model,
+                                    model::Type::Key Key) {
+  ptml::PTMLCBuilder B(true);
+  return dumpModelTypeDefinition(Model, *Model.Types().at(Key), B);
+}
+
+std::vector<std::string>
+dumpModelTypeDefinitions(const model::Binary &Model,
+                         llvm::ArrayRef<model::Type::Key> Keys,
+                         unsigned NumThreads) {
+  std::vector<std::string> Result(Keys.size());
+
+  // Each worker picks the next type to print, with its own builder
+  std::atomic<size_t> NextIndex = 0;
+  const auto PrintDefinitions = [&]() {
+    ptml::PTMLCBuilder B(true);
+    for (size_t I = NextIndex++; I < Keys.size(); I = NextIndex++)
+      Result[I] = dumpModelTypeDefinition(Model, *Model.Types().at(Keys[I]), B);
+  };
+
+  // The debug output of the printers would be interleaved
+  if (NumThreads <= 1 or Keys.size() <= 1 or Log.isEnabled()) {
+    PrintDefinitions();
+    return Result;
+  }
+
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  for (unsigned I = 0; I < NumThreads; ++I)
+    Pool.async(PrintDefinitions);
+  Pool.wait();
+
+  return Result;
+}
@@ -2,18 +2,37 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Threading.h"
+
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/PopulateTargetListContainer.h"
 #include "revng/Pipes/StringMap.h"
+#include "revng/Support/CommandLine.h"
 
 #include "revng-c/Backend/DecompileFunction.h"
 #include "revng-c/HeadersGeneration/ModelTypeDefinition.h"
 #include "revng-c/HeadersGeneration/ModelTypeDefinitionPipe.h"
 #include "revng-c/Pipes/Kinds.h"
 
+using llvm::cl::cat;
+using llvm::cl::desc;
+using llvm::cl::init;
+
+static llvm::cl::opt<unsigned>
+  TypeDefinitionThreads("model-type-definition-threads",
+                        desc("Number of threads printing the definitions of "
+                             "the requested types (0 means one per core, 1 "
+                             "disables parallel printing)"),
+                        init(1),
+                        cat(MainCategory));
+
 namespace revng::pipes {
 
 using namespace pipeline;
@@ -28,11 +47,19 @@ void GenerateModelTypeDefinition::run(const ExecutionContext &Ctx,
                                       TypeTargetList &TargetList,
                                       Container &ModelTypesContainer) {
   const model::Binary &Model = *getModelFromContext(Ctx);
-  for (const pipeline::Target &Target : TargetList.getTargets()) {
-    Container::KeyType
-      Key = Container::keyFromString(Target.getPathComponents()[0]);
-    ModelTypesContainer[Key] = dumpModelTypeDefinition(Model, Key);
-  }
+
+  std::vector<model::Type::Key> Keys;
+  for (const pipeline::Target &Target : TargetList.getTargets())
+    Keys.push_back(Container::keyFromString(Target.getPathComponents()[0]));
+
+  unsigned NumThreads = TypeDefinitionThreads;
+  if (NumThreads == 0)
+    NumThreads = llvm::hardware_concurrency().compute_thread_count();
+
+  std::vector<std::string>
+    Definitions = dumpModelTypeDefinitions(Model, Keys, NumThreads);
+  for (auto &&[Key, Definition] : llvm::zip(Keys, Definitions))
+    ModelTypesContainer[Key] = std::move(Definition);
 }
 
 void GenerateModelTypeDefinition::print(const Context &Ctx,
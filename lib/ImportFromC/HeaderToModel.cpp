@@ -2,6 +2,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/TextDiagnostic.h"
@@ -101,6 +108,32 @@ private:
   using RawLocation = std::pair<model::Register::Values, ModelType>;
   std::optional<llvm::SmallVector<RawLocation, 4>> MultiRegisterReturnValue;
 
+  // Maps the kind and the custom name of the types in the model to the
+  // smallest key among the types with such kind and name, so that importing
+  // many declarations does not require a scan of all the types of the model
+  // for each referenced type.
+  using KindAndName = std::pair<model::TypeKind::Values, std::string>;
+  struct KindAndNameHash {
+    size_t operator()(const KindAndName &Entry) const {
+      return llvm::hash_combine(Entry.first, Entry.second);
+    }
+  };
+  std::unordered_map<KindAndName, model::Type::Key, KindAndNameHash>
+    TypesByName;
+
+  // Where a declaration comes from. Only the declarations of the input file
+  // are imported.
+  enum class FileKind {
+    Invalid,
+    Input,
+    PrimitiveTypes,
+    Other
+  };
+
+  // The kind of each file, so that the file name is resolved and compared
+  // once per file rather than once per declaration.
+  llvm::DenseMap<clang::FileID, FileKind> FileKinds;
+
 public:
   explicit DeclVisitor(TupleTree<model::Binary> &Model,
                        ASTContext &Context,
@@ -120,6 +153,9 @@ public:
                               std::optional<llvm::StringRef> TheABI);
 
 private:
+  // Get the kind of the file \a D comes from.
+  FileKind getFileKind(const clang::Decl *D);
+
   // This checks that the declaration is the one user provided as input.
   bool comesFromInternalFile(const clang::Decl *D);
 
@@ -151,6 +187,15 @@ private:
   std::optional<model::TypePath> getTypeByNameOrID(llvm::StringRef Name,
                                                    TypeKind::Values Kind);
 
+  // Add a type to TypesByName.
+  void indexTypeName(const model::Type &T);
+
+  // Populate TypesByName from scratch.
+  void populateTypesByName();
+
+  // Add a new type to the model, replacing the type we are editing, if any.
+  model::TypePath addType(UpcastablePointer<model::Type> &&NewType);
+
   std::optional<model::QualifiedType>
   getModelTypeForClangType(const QualType &QT);
 
@@ -170,6 +215,7 @@ DeclVisitor::DeclVisitor(TupleTree<model::Binary> &Model,
   Function(Function),
   Error(Error),
   AnalysisOption(AnalysisOption) {
+  populateTypesByName();
 }
 
 // Parse ABI from the annotate attribute content.
@@ -314,33 +360,58 @@ DeclVisitor::getOrCreatePrimitive(const BuiltinType *UnderlyingBuiltin,
   return std::nullopt;
 }
 
-std::optional<model::TypePath>
-DeclVisitor::getTypeByNameOrID(llvm::StringRef Name, TypeKind::Values Kind) {
-  const bool IsStruct = Kind == model::TypeKind::StructType;
-  const bool IsUnion = Kind == model::TypeKind::UnionType;
-  const bool IsEnum = Kind == model::TypeKind::EnumType;
-  const bool IsCABIFunction = Kind == model::TypeKind::CABIFunctionType;
-  const bool IsRawFunctionType = Kind == model::TypeKind::RawFunctionType;
+void DeclVisitor::indexTypeName(const model::Type &T) {
+  KindAndName Entry = { T.Kind(), T.CustomName().str().str() };
+  auto [It, New] = TypesByName.try_emplace(std::move(Entry), T.key());
+  if (not New and T.key() < It->second)
+    It->second = T.key();
+}
 
-  // Find by name first.
-  for (auto &Type : Model->Types()) {
-    if (IsStruct and not llvm::isa<model::StructType>(Type.get()))
-      continue;
+void DeclVisitor::populateTypesByName() {
+  TypesByName.clear();
+  TypesByName.reserve(Model->Types().size());
+  for (const UpcastablePointer<model::Type> &T : Model->Types())
+    indexTypeName(*T);
+}
 
-    if (IsUnion and not llvm::isa<model::UnionType>(Type.get()))
-      continue;
+model::TypePath
+DeclVisitor::addType(UpcastablePointer<model::Type> &&NewType) {
+  model::TypePath Result;
+  if (AnalysisOption == ImportFromCOption::EditType) {
+    // Remove old and add new type with the same ID.
+    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
+      return P.get()->ID() == (*Type)->ID();
+    });
 
-    if (IsEnum and not llvm::isa<model::EnumType>(Type.get()))
-      continue;
+    model::Type::Key Key = NewType->key();
+    Model->Types().insert(std::move(NewType));
+    Result = Model->getTypePath(Key);
+  } else {
+    Result = Model->recordNewType(std::move(NewType));
+  }
 
-    if (IsCABIFunction and not llvm::isa<model::CABIFunctionType>(Type.get()))
-      continue;
+  indexTypeName(*Result.get());
 
-    if (IsRawFunctionType and not llvm::isa<model::RawFunctionType>(Type.get()))
-      continue;
+  return Result;
+}
 
-    if (Type->CustomName() == Name)
-      return Model->getTypePath(Type.get());
+std::optional<model::TypePath>
+DeclVisitor::getTypeByNameOrID(llvm::StringRef Name, TypeKind::Values Kind) {
+  // Find by name first.
+  auto It = TypesByName.find({ Kind, Name.str() });
+  if (It != TypesByName.end()) {
+    auto TypeIt = Model->Types().find(It->second);
+    if (TypeIt == Model->Types().end() or (*TypeIt)->CustomName() != Name) {
+      // The entry refers to the type we are editing, which has been replaced:
+      // start over.
+      populateTypesByName();
+      It = TypesByName.find({ Kind, Name.str() });
+      if (It != TypesByName.end())
+        TypeIt = Model->Types().find(It->second);
+    }
+
+    if (It != TypesByName.end())
+      return Model->getTypePath(TypeIt->get());
   }
 
   size_t LocationOfID = Name.rfind("_");
@@ -423,35 +494,42 @@ DeclVisitor::getTypeForEnumType(const clang::EnumType *EnumType) {
   return std::nullopt;
 }
 
-bool DeclVisitor::comesFromInternalFile(const clang::Decl *D) {
-  SourceManager &SM = Context.getSourceManager();
-  PresumedLoc Loc = SM.getPresumedLoc(D->getLocation());
-  if (!Loc.isValid()) {
+DeclVisitor::FileKind DeclVisitor::getFileKind(const clang::Decl *D) {
+  clang::SourceLocation Location = D->getLocation();
+  if (Location.isInvalid()) {
     revng_log(Log, "Invalid source location found");
-    return false;
+    return FileKind::Invalid;
   }
 
-  StringRef TheFileName(Loc.getFilename());
-  // Process the new type only.
-  if (TheFileName.contains(InputCFile))
-    return true;
-
-  return false;
-}
-
-bool DeclVisitor::comesFromPrimitiveTypesHeader(const clang::RecordDecl *RD) {
   SourceManager &SM = Context.getSourceManager();
-  PresumedLoc Loc = SM.getPresumedLoc(RD->getLocation());
-  if (!Loc.isValid()) {
-    revng_log(Log, "Invalid source location found");
-    return false;
+  clang::FileID File = SM.getFileID(SM.getExpansionLoc(Location));
+  auto [It, New] = FileKinds.try_emplace(File, FileKind::Invalid);
+  if (New) {
+    PresumedLoc Loc = SM.getPresumedLoc(Location);
+    if (Loc.isValid()) {
+      StringRef TheFileName(Loc.getFilename());
+      if (TheFileName.contains(InputCFile))
+        It->second = FileKind::Input;
+      else if (TheFileName.contains(PrimitiveTypeHeader))
+        It->second = FileKind::PrimitiveTypes;
+      else
+        It->second = FileKind::Other;
+    }
   }
 
-  StringRef TheFileName(Loc.getFilename());
-  if (TheFileName.contains(PrimitiveTypeHeader))
-    return true;
+  if (It->second == FileKind::Invalid)
+    revng_log(Log, "Invalid source location found");
+
+  return It->second;
+}
+
+bool DeclVisitor::comesFromInternalFile(const clang::Decl *D) {
+  // Process the new type only.
+  return getFileKind(D) == FileKind::Input;
+}
 
-  return false;
+bool DeclVisitor::comesFromPrimitiveTypesHeader(const clang::RecordDecl *RD) {
+  return getFileKind(RD) == FileKind::PrimitiveTypes;
 }
 
 void DeclVisitor::setupLineAndColumn(const clang::Decl *D) {
@@ -770,8 +848,7 @@ bool DeclVisitor::VisitFunctionDecl(const clang::FunctionDecl *FD) {
 
   // TODO: remember/clone StackFrameType as well.
 
-  auto Prototype = Model->recordNewType(std::move(NewType));
-  ModelFunction.Prototype() = Prototype;
+  ModelFunction.Prototype() = addType(std::move(NewType));
 
   return true;
 }
@@ -824,16 +901,7 @@ bool DeclVisitor::VisitTypedefDecl(const TypedefDecl *D) {
   TheTypeTypeDef->UnderlyingType() = *ModelTypedefType;
   setCustomName(*TheTypeTypeDef, D->getName());
 
-  if (AnalysisOption == ImportFromCOption::EditType) {
-    // Remove old and add new type with the same ID.
-    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
-      return P.get()->ID() == (*Type)->ID();
-    });
-
-    Model->Types().insert(std::move(TypeTypedef));
-  } else {
-    Model->recordNewType(std::move(TypeTypedef));
-  }
+  addType(std::move(TypeTypedef));
 
   return true;
 }
@@ -899,16 +967,7 @@ bool DeclVisitor::VisitFunctionPrototype(const FunctionProtoType *FP,
     FunctionType->FinalStackOffset() = DefaulRawType->FinalStackOffset();
   }
 
-  if (AnalysisOption == ImportFromCOption::EditType) {
-    // Remove old and add new type with the same ID.
-    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
-      return P.get()->ID() == (*Type)->ID();
-    });
-
-    Model->Types().insert(std::move(NewType));
-  } else {
-    Model->recordNewType(std::move(NewType));
-  }
+  addType(std::move(NewType));
 
   return true;
 }
@@ -1020,20 +1079,13 @@ bool DeclVisitor::handleStructType(const clang::RecordDecl *RD) {
 
   switch (AnalysisOption) {
   case ImportFromCOption::EditType:
-    // Remove old and add new type with the same ID.
-    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
-      return P.get()->ID() == (*Type)->ID();
-    });
-    Model->Types().insert(std::move(NewType));
+  case ImportFromCOption::AddType:
+    addType(std::move(NewType));
     break;
 
   case ImportFromCOption::EditFunctionPrototype:
     MultiRegisterReturnValue = ReturnValues;
     break;
-
-  case ImportFromCOption::AddType:
-    Model->recordNewType(std::move(NewType));
-    break;
   }
 
   return true;
@@ -1074,15 +1126,7 @@ bool DeclVisitor::handleUnionType(const clang::RecordDecl *RD) {
     ++CurrentIndex;
   }
 
-  if (AnalysisOption == ImportFromCOption::EditType) {
-    // Remove old and add new type with the same ID.
-    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
-      return P.get()->ID() == (*Type)->ID();
-    });
-    Model->Types().insert(std::move(NewType));
-  } else {
-    Model->recordNewType(std::move(NewType));
-  }
+  addType(std::move(NewType));
 
   return true;
 }
@@ -1165,16 +1209,7 @@ bool DeclVisitor::VisitEnumDecl(const EnumDecl *D) {
       EnumEntry.CustomName() = NewName;
   }
 
-  if (AnalysisOption == ImportFromCOption::EditType) {
-    // Remove old and add new type with the same ID.
-    llvm::erase_if(Model->Types(), [&](UpcastablePointer<model::Type> &P) {
-      return P.get()->ID() == (*Type)->ID();
-    });
-
-    Model->Types().insert(std::move(NewType));
-  } else {
-    Model->recordNewType(std::move(NewType));
-  }
+  addType(std::move(NewType));
 
   return true;
 }
@@ -1188,6 +1223,14 @@ bool DeclVisitor::TraverseDecl(clang::Decl *D) {
   if (!D)
     return true;
 
+  // Nothing is imported from the declarations of the other files, such as
+  // revng-primitive-types.h and the model header, hence skip them as a whole.
+  // The translation unit has no location, and is always traversed.
+  FileKind Kind = isa<TranslationUnitDecl>(D) ? FileKind::Invalid :
+                                                getFileKind(D);
+  if (Kind == FileKind::PrimitiveTypes or Kind == FileKind::Other)
+    return true;
+
   setupLineAndColumn(D);
 
   if (isa<EnumDecl>(D))
@@ -5,7 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <fstream>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -62,6 +65,50 @@ getOptionsFromCFGFile(llvm::StringRef FilePath) {
   return Result;
 }
 
+/// Takes note of the parts of the model HeaderToModel can change, so that they
+/// can be restored if the import fails, without copying the whole model.
+class ModelCheckpoint {
+private:
+  model::Binary &Model;
+  std::vector<model::Type::Key> TypeKeys;
+  std::optional<UpcastablePointer<model::Type>> EditedType;
+  std::optional<model::Function> EditedFunction;
+
+public:
+  ModelCheckpoint(model::Binary &Model,
+                  const std::optional<model::Type *> &Type,
+                  const std::optional<model::Function> &Function) :
+    Model(Model), EditedFunction(Function) {
+    // Types are sorted by key, and so is TypeKeys
+    TypeKeys.reserve(Model.Types().size());
+    for (const UpcastablePointer<model::Type> &T : Model.Types())
+      TypeKeys.push_back(T->key());
+
+    if (Type)
+      EditedType = *Model.Types().find((*Type)->key());
+  }
+
+public:
+  /// \return a copy of the type being edited, which, unlike the original one,
+  ///         outlives its replacement in the model.
+  model::Type *editedType() { return EditedType->get(); }
+
+  void restore() {
+    auto IsChanged = [this](const UpcastablePointer<model::Type> &T) {
+      if (EditedType and T->key() == (*EditedType)->key())
+        return true;
+      return not std::binary_search(TypeKeys.begin(), TypeKeys.end(), T->key());
+    };
+    llvm::erase_if(Model.Types(), IsChanged);
+
+    if (EditedType)
+      Model.Types().insert(*EditedType);
+
+    if (EditedFunction)
+      Model.Functions()[EditedFunction->Entry()] = *EditedFunction;
+  }
+};
+
 static std::optional<std::string> findHeaderFile(const std::string &File) {
   auto MaybeHeaderPath = revng::ResourceFinder.findFile(File);
   if (not MaybeHeaderPath)
@@ -73,6 +120,60 @@ static std::optional<std::string> findHeaderFile(const std::string &File) {
   return (*MaybeHeaderPath).substr(0, Index);
 }
 
+/// \return the arguments clang has to be run with, besides the input.
+///
+/// Finding them requires looking up and parsing resource files, whose content
+/// doesn't change during the life of the process, hence they are computed on
+/// the first import and reused by the following ones, e.g., by each type edit
+/// sent by the UI to the daemon.
+static llvm::Expected<std::vector<std::string>> getCompilationArguments() {
+  static std::mutex Mutex;
+  static std::optional<std::vector<std::string>> Cached;
+  std::lock_guard Lock(Mutex);
+  if (Cached)
+    return *Cached;
+
+  // Find compile flags to be applied to clang.
+  StringRef CompileFlagsPath = "share/revng-c/compile-flags.cfg";
+  auto MaybeCompileCFGPath = revng::ResourceFinder.findFile(CompileFlagsPath);
+  if (not MaybeCompileCFGPath) {
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "Couldn't find compile-flags.cfg");
+  }
+
+  // Since the `--config` is just a clang Driver option, we need to parse it
+  // manually.
+  auto FromCFGFile = getOptionsFromCFGFile(*MaybeCompileCFGPath);
+  std::vector<std::string> Compilation(FromCFGFile);
+  Compilation.push_back("-xc");
+
+  SmallString<16> CompilerHeadersPath;
+  {
+    StringRef LLVMLibrary = getLibrariesFullPath().at("libLLVMSupport");
+    using namespace llvm::sys::path;
+    SmallString<16> ClangPath;
+    append(ClangPath, parent_path(parent_path(LLVMLibrary)));
+    append(ClangPath, Twine("bin"));
+    append(ClangPath, Twine("clang"));
+    CompilerHeadersPath = clang::driver::Driver::GetResourcesPath(ClangPath);
+    append(CompilerHeadersPath, Twine("include"));
+  }
+  Compilation.push_back("-I" + CompilerHeadersPath.str().str());
+
+  // Find revng-primitive-types.h and revng-attributes.h.
+  const char *PrimitivesHeader = "share/revng-c/include/"
+                                 "revng-primitive-types.h";
+  auto MaybePrimitiveHeaderPath = findHeaderFile(PrimitivesHeader);
+  if (not MaybePrimitiveHeaderPath) {
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "Couldn't find revng-primitive-types.h");
+  }
+  Compilation.push_back("-I" + *MaybePrimitiveHeaderPath);
+
+  Cached = std::move(Compilation);
+  return *Cached;
+}
+
 struct ImportFromCAnalysis {
   static constexpr auto Name = "import-from-c";
 
@@ -188,68 +289,41 @@ struct ImportFromCAnalysis {
     std::string FilteredHeader = std::string("#include \"")
                                  + FilterModelPath.path().str()
                                  + std::string("\"");
-    TupleTree<model::Binary> OutModel(Model);
+
+    // The changes are applied directly to Model, and reverted if the import
+    // fails.
+    ModelCheckpoint Checkpoint(*Model, TypeToEdit, FunctionToBeEdited);
 
     std::optional<revng::ParseCCodeError> Error;
     std::unique_ptr<HeaderToModelAction> Action;
 
     if (TheOption == ImportFromCOption::EditType) {
-      Action = std::make_unique<HeaderToModelEditTypeAction>(OutModel,
+      // The type we are editing gets erased from the model, use the copy
+      TypeToEdit = Checkpoint.editedType();
+      Action = std::make_unique<HeaderToModelEditTypeAction>(Model,
                                                              Error,
                                                              TypeToEdit);
     } else if (TheOption == ImportFromCOption::EditFunctionPrototype) {
       using EditFunctionPrototype = HeaderToModelEditFunctionAction;
-      Action = std::make_unique<EditFunctionPrototype>(OutModel,
+      Action = std::make_unique<EditFunctionPrototype>(Model,
                                                        Error,
                                                        FunctionToBeEdited);
     } else {
-      Action = std::make_unique<HeaderToModelAddTypeAction>(OutModel, Error);
-    }
-
-    // Find compile flags to be applied to clang.
-    StringRef CompileFlagsPath = "share/revng-c/compile-flags.cfg";
-    auto MaybeCompileCFGPath = revng::ResourceFinder.findFile(CompileFlagsPath);
-    if (not MaybeCompileCFGPath) {
-      return llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                     "Couldn't find compile-flags.cfg");
-    }
-
-    // Since the `--config` is just a clang Driver option, we need to parse it
-    // manually.
-    auto FromCFGFile = getOptionsFromCFGFile(*MaybeCompileCFGPath);
-    std::vector<std::string> Compilation(FromCFGFile);
-    Compilation.push_back("-xc");
-
-    SmallString<16> CompilerHeadersPath;
-    {
-      StringRef LLVMLibrary = getLibrariesFullPath().at("libLLVMSupport");
-      using namespace llvm::sys::path;
-      SmallString<16> ClangPath;
-      append(ClangPath, parent_path(parent_path(LLVMLibrary)));
-      append(ClangPath, Twine("bin"));
-      append(ClangPath, Twine("clang"));
-      CompilerHeadersPath = clang::driver::Driver::GetResourcesPath(ClangPath);
-      append(CompilerHeadersPath, Twine("include"));
+      Action = std::make_unique<HeaderToModelAddTypeAction>(Model, Error);
     }
-    Compilation.push_back("-I" + CompilerHeadersPath.str().str());
 
-    // Find revng-primitive-types.h and revng-attributes.h.
-    const char *PrimitivesHeader = "share/revng-c/include/"
-                                   "revng-primitive-types.h";
-    auto MaybePrimitiveHeaderPath = findHeaderFile(PrimitivesHeader);
-    if (not MaybePrimitiveHeaderPath) {
-      return llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                     "Couldn't find revng-primitive-types.h");
-    }
-    Compilation.push_back("-I" + *MaybePrimitiveHeaderPath);
+    auto MaybeCompilation = getCompilationArguments();
+    if (not MaybeCompilation)
+      return MaybeCompilation.takeError();
 
     FilteredHeader += "\n";
     FilteredHeader += CCode;
 
     if (not clang::tooling::runToolOnCodeWithArgs(std::move(Action),
                                                   FilteredHeader,
-                                                  Compilation,
+                                                  *MaybeCompilation,
                                                   InputCFile)) {
+      Checkpoint.restore();
       return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                      "Unable to run clang");
     }
@@ -257,20 +331,19 @@ struct ImportFromCAnalysis {
     // Check if an error was reported by clang or revng during parsing of C
     // code.
     if (Error) {
+      Checkpoint.restore();
       return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                      (*Error).ErrorMessage);
     }
 
     model::VerifyHelper VH(false);
-    if (not OutModel->verify(VH)) {
+    if (not Model->verify(VH)) {
+      Checkpoint.restore();
       return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                      "New model does not verify: "
                                        + VH.getReason());
     }
 
-    // Replace the original Model with the OutModel that contains the changes.
-    Model = OutModel;
-
     return llvm::Error::success();
   }
 };
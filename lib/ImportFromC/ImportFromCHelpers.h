@@ -31,25 +31,6 @@ struct NodeData {
 using Node = BidirectionalNode<NodeData>;
 using Graph = GenericGraph<Node>;
 
-inline llvm::SmallPtrSet<const model::Type *, 2>
-getIncomingTypesFor(const model::Type *T,
-                    const TupleTree<model::Binary> &Model,
-                    const std::map<const model::Type *, Node *> &TypeToNode) {
-  llvm::SmallPtrSet<const model::Type *, 2> Result;
-
-  // Visit all the nodes reachable from RootType.
-  llvm::df_iterator_default_set<Node *> Visited;
-  for ([[maybe_unused]] Node *N : depth_first_ext(TypeToNode.at(T), Visited))
-    ;
-
-  for (auto &Type : Model->Types()) {
-    if (Visited.contains(TypeToNode.at(Type.get())))
-      Result.insert(Type.get());
-  }
-
-  return Result;
-}
-
 // Remember dependencies between types.
 inline llvm::SmallPtrSet<const model::Type *, 2>
 populateDependencies(const model::Type *TheType,
@@ -71,6 +52,12 @@ populateDependencies(const model::Type *TheType,
     }
   }
 
+  // All the types that use the types depending on TheType, found by visiting
+  // the inverse graph from each of the latter. The visits share the set of
+  // visited nodes, so that each type is visited only once in total, no matter
+  // how many types depend on TheType.
+  llvm::df_iterator_default_set<Node *> Visited;
+
   // Process types.
   for (const UpcastablePointer<model::Type> &T : Model->Types()) {
     for (const model::QualifiedType &QT : T->edges()) {
@@ -90,8 +77,9 @@ populateDependencies(const model::Type *TheType,
 
         // We need to skip all the types that can reach to this type we have
         // just ignored by doing DFS on the inverse graph.
-        auto AllThatUseTypeT = getIncomingTypesFor(T.get(), Model, TypeToNode);
-        llvm::copy(AllThatUseTypeT, std::inserter(Result, Result.begin()));
+        Node *Start = TypeToNode.at(T.get());
+        for (Node *N : depth_first_ext(Start, Visited))
+          Result.insert(N->T);
       }
     }
   }
@@ -3,11 +3,18 @@
 //
 
 #include <cstddef>
+#include <functional>
+#include <iterator>
 #include <optional>
+#include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -53,14 +60,20 @@ template<typename T>
 using RPOT = llvm::ReversePostOrderTraversal<T>;
 
 using TypeVector = llvm::SmallVector<QualifiedType, 8>;
-using ModelTypesMap = std::map<const llvm::Value *, const model::QualifiedType>;
+/// The types are looked up very often while they are being computed, so we
+/// use a hash table, and only build the ordered map at the end
+using ValueTypesMap = llvm::DenseMap<const llvm::Value *, QualifiedType>;
+
+/// The types returned by calls to isolated functions, for each prototype
+using PrototypeReturnTypesMap = llvm::DenseMap<const model::Type *,
+                                               TypeVector>;
 
 /// Map each llvm::Argument of the given llvm::Function to its
 /// QualifiedType in the model.
 static void addArgumentsTypes(const llvm::Function &LLVMFunc,
                               const model::Type *Prototype,
                               const Binary &Model,
-                              ModelTypesMap &TypeMap,
+                              ValueTypesMap &TypeMap,
                               bool PointersOnly) {
 
   const auto Layout = abi::FunctionType::Layout::make(*Prototype);
@@ -89,7 +102,7 @@ static void addArgumentsTypes(const llvm::Function &LLVMFunc,
 /// \return true if a new token has been generated for the operand
 static RecursiveCoroutine<bool> addOperandType(const llvm::Value *Operand,
                                                const Binary &Model,
-                                               ModelTypesMap &TypeMap,
+                                               ValueTypesMap &TypeMap,
                                                bool PointersOnly) {
 
   // For ConstExprs, check their OpCode
@@ -171,14 +184,25 @@ static TypeVector getReturnTypes(FunctionMetadataCache &Cache,
                                  const llvm::CallInst *Call,
                                  const model::Function *ParentFunc,
                                  const Binary &Model,
-                                 const ModelTypesMap &TypeMap) {
+                                 const ValueTypesMap &TypeMap,
+                                 PrototypeReturnTypesMap &CallReturnTypes) {
   TypeVector ReturnTypes;
 
   if (Call->getType()->isVoidTy())
     return {};
 
-  // Check if we already have strong model information for this call
-  ReturnTypes = getStrongModelInfo(Cache, Call, Model);
+  // Check if we already have strong model information for this call. For
+  // isolated functions, it only depends on the prototype of the call site,
+  // which is shared by many of them.
+  if (isCallToIsolatedFunction(Call)) {
+    auto Prototype = Cache.getCallSitePrototype(Model, Call);
+    auto [It, New] = CallReturnTypes.try_emplace(Prototype.getConst());
+    if (New)
+      It->second = getStrongModelInfo(Cache, Call, Model);
+    ReturnTypes = It->second;
+  } else {
+    ReturnTypes = getStrongModelInfo(Cache, Call, Model);
+  }
 
   if (not ReturnTypes.empty())
     return ReturnTypes;
@@ -259,14 +283,16 @@ static void handleCallInstruction(FunctionMetadataCache &Cache,
                                   const llvm::CallInst *Call,
                                   const model::Function *ParentFunc,
                                   const Binary &Model,
-                                  ModelTypesMap &TypeMap,
+                                  ValueTypesMap &TypeMap,
+                                  PrototypeReturnTypesMap &CallReturnTypes,
                                   bool PointersOnly) {
 
   TypeVector ReturnedQualTypes = getReturnTypes(Cache,
                                                 Call,
                                                 ParentFunc,
                                                 Model,
-                                                TypeMap);
+                                                TypeMap,
+                                                CallReturnTypes);
 
   if (ReturnedQualTypes.empty())
     return;
@@ -467,27 +493,134 @@ getCommonScalarType(const model::QualifiedType &A,
   return std::nullopt;
 }
 
-static llvm::SmallPtrSet<const llvm::Value *, 8>
-getTransitivePHIIncomings(const llvm::PHINode *PHI) {
-  llvm::SmallPtrSet<const llvm::Value *, 8> NonPHIIncomings;
+/// Groups the PHIs of a function in webs, i.e., the strongly connected
+/// components of the graph where each PHI points to its incoming PHIs.
+///
+/// All the PHIs of a web are reached by the same non-PHI values, and they all
+/// get the same type, so both are computed once per web.
+class PHIWebs {
+public:
+  struct Web {
+    /// The non-PHI values reaching the PHIs of the web, possibly through other
+    /// PHIs
+    llvm::SmallSetVector<const llvm::Value *, 8> Incomings;
+
+    /// The type of the PHIs of the web, once it has been computed from
+    /// incomings that all had a type already, and therefore can't change
+    std::optional<std::optional<QualifiedType>> StableType;
+  };
 
-  llvm::SmallPtrSet<const llvm::PHINode *, 8> VisitedPHIs = { PHI };
-  llvm::SmallVector<const llvm::PHINode *> WorkList = { PHI };
+private:
+  std::vector<Web> Webs;
+  llvm::DenseMap<const llvm::PHINode *, unsigned> WebIndices;
 
-  do {
-    const llvm::PHINode *Current = WorkList.back();
-    WorkList.pop_back();
-    for (const llvm::Value *Incoming : Current->incoming_values()) {
-      if (const auto *IncomingPHI = dyn_cast<llvm::PHINode>(Incoming)) {
-        if (bool New = VisitedPHIs.insert(IncomingPHI).second)
-          WorkList.push_back(IncomingPHI);
-      } else {
-        NonPHIIncomings.insert(Incoming);
+public:
+  explicit PHIWebs(const llvm::Function &F);
+
+public:
+  Web &get(const llvm::PHINode *PHI) {
+    auto It = WebIndices.find(PHI);
+    revng_assert(It != WebIndices.end());
+    return Webs[It->second];
+  }
+};
+
+PHIWebs::PHIWebs(const llvm::Function &F) {
+  // This is an iterative version of Tarjan's algorithm: each web is completed
+  // after all the webs containing its incoming PHIs, so it can simply merge
+  // their incomings.
+  struct NodeInfo {
+    unsigned Index = 0;
+    unsigned LowLink = 0;
+    bool OnStack = false;
+  };
+
+  struct Frame {
+    const llvm::PHINode *PHI = nullptr;
+    unsigned NextIncoming = 0;
+  };
+
+  llvm::DenseMap<const llvm::PHINode *, NodeInfo> Nodes;
+  llvm::SmallVector<const llvm::PHINode *, 16> Stack;
+  llvm::SmallVector<Frame, 16> DFSStack;
+
+  auto Discover = [&](const llvm::PHINode *PHI) {
+    unsigned Index = Nodes.size();
+    Nodes[PHI] = { Index, Index, true };
+    Stack.push_back(PHI);
+    DFSStack.push_back({ PHI, 0 });
+  };
+
+  for (const BasicBlock &BB : F) {
+    for (const llvm::PHINode &Root : BB.phis()) {
+      if (Nodes.count(&Root) != 0)
+        continue;
+
+      Discover(&Root);
+      while (not DFSStack.empty()) {
+        const llvm::PHINode *PHI = DFSStack.back().PHI;
+        unsigned &NextIncoming = DFSStack.back().NextIncoming;
+
+        if (NextIncoming < PHI->getNumIncomingValues()) {
+          const llvm::Value *Incoming = PHI->getIncomingValue(NextIncoming);
+          ++NextIncoming;
+
+          const auto *IncomingPHI = dyn_cast<llvm::PHINode>(Incoming);
+          if (IncomingPHI == nullptr)
+            continue;
+
+          auto It = Nodes.find(IncomingPHI);
+          if (It == Nodes.end()) {
+            Discover(IncomingPHI);
+          } else if (It->second.OnStack) {
+            unsigned IncomingIndex = It->second.Index;
+            NodeInfo &Info = Nodes[PHI];
+            Info.LowLink = std::min(Info.LowLink, IncomingIndex);
+          }
+
+          continue;
+        }
+
+        // All the incomings of PHI have been visited
+        DFSStack.pop_back();
+        const NodeInfo &Info = Nodes[PHI];
+        if (not DFSStack.empty()) {
+          NodeInfo &ParentInfo = Nodes[DFSStack.back().PHI];
+          ParentInfo.LowLink = std::min(ParentInfo.LowLink, Info.LowLink);
+        }
+
+        if (Info.LowLink != Info.Index)
+          continue;
+
+        // PHI is the root of a web, its members are on top of the stack
+        unsigned WebIndex = Webs.size();
+        llvm::SmallVector<const llvm::PHINode *, 8> Members;
+        const llvm::PHINode *Popped = nullptr;
+        do {
+          Popped = Stack.pop_back_val();
+          Nodes[Popped].OnStack = false;
+          WebIndices[Popped] = WebIndex;
+          Members.push_back(Popped);
+        } while (Popped != PHI);
+
+        Web NewWeb;
+        for (const llvm::PHINode *Member : Members) {
+          for (const llvm::Value *Incoming : Member->incoming_values()) {
+            if (const auto *IncomingPHI = dyn_cast<llvm::PHINode>(Incoming)) {
+              unsigned IncomingWeb = WebIndices.lookup(IncomingPHI);
+              if (IncomingWeb != WebIndex)
+                NewWeb.Incomings.insert(Webs[IncomingWeb].Incomings.begin(),
+                                        Webs[IncomingWeb].Incomings.end());
+            } else {
+              NewWeb.Incomings.insert(Incoming);
+            }
+          }
+        }
+
+        Webs.push_back(std::move(NewWeb));
       }
     }
-  } while (not WorkList.empty());
-
-  return NonPHIIncomings;
+  }
 }
 
 static RecursiveCoroutine<std::optional<QualifiedType>>
@@ -497,7 +630,9 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
                    const model::Function *ModelF,
                    const Binary &Model,
                    bool PointersOnly,
-                   ModelTypesMap &TypeMap,
+                   ValueTypesMap &TypeMap,
+                   PHIWebs &Webs,
+                   PrototypeReturnTypesMap &CallReturnTypes,
                    llvm::SmallPtrSet<const llvm::PHINode *, 8>
                      VisitedPHIs = {}) {
 
@@ -537,7 +672,13 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
   // the binary or to special intrinsics used by the backend, so they need
   // to be handled separately
   if (auto *Call = dyn_cast<llvm::CallInst>(&I)) {
-    handleCallInstruction(Cache, Call, ModelF, Model, TypeMap, PointersOnly);
+    handleCallInstruction(Cache,
+                          Call,
+                          ModelF,
+                          Model,
+                          TypeMap,
+                          CallReturnTypes,
+                          PointersOnly);
     auto CallTypeIt = TypeMap.find(Call);
     std::optional<QualifiedType> CallType = std::nullopt;
     if (CallTypeIt != TypeMap.end())
@@ -668,15 +809,20 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
     auto *PHI = cast<llvm::PHINode>(&I);
     bool New = VisitedPHIs.insert(PHI).second;
     if (New) {
-      llvm::SmallPtrSet<const llvm::Value *, 8>
-        NonPHIIncomings = getTransitivePHIIncomings(PHI);
+      PHIWebs::Web &Web = Webs.get(PHI);
+      if (Web.StableType.has_value()) {
+        Type = *Web.StableType;
+        break;
+      }
 
-      for (const llvm::Value *Incoming : NonPHIIncomings) {
+      bool Stable = true;
+      for (const llvm::Value *Incoming : Web.Incomings) {
         std::optional<QualifiedType> IncomingType = std::nullopt;
         auto IncomingTypeIt = TypeMap.find(Incoming);
         if (IncomingTypeIt != TypeMap.end()) {
           IncomingType = IncomingTypeIt->second;
         } else {
+          Stable = false;
           if (auto
                 *IncomingInstruction = dyn_cast<llvm::Instruction>(Incoming)) {
             IncomingType = rc_recur initModelTypesImpl(Cache,
@@ -686,6 +832,8 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
                                                        Model,
                                                        PointersOnly,
                                                        TypeMap,
+                                                       Webs,
+                                                       CallReturnTypes,
                                                        VisitedPHIs);
           }
         }
@@ -703,6 +851,9 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
             Type = llvmIntToModelType(PHI->getType(), Model);
         }
       }
+
+      if (Stable)
+        Web.StableType = Type;
     }
   } break;
 
@@ -713,16 +864,16 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
   rc_return Type;
 }
 
-static RecursiveCoroutine<ModelTypesMap>
-initModelTypesImpl(FunctionMetadataCache &Cache,
-                   const llvm::Function &F,
-                   const model::Function *ModelF,
-                   const Binary &Model,
-                   bool PointersOnly,
-                   llvm::SmallPtrSet<const llvm::PHINode *, 8>
-                     VisitedPHIs = {}) {
-
-  ModelTypesMap TypeMap;
+std::map<const llvm::Value *, const model::QualifiedType>
+initModelTypes(FunctionMetadataCache &Cache,
+               const llvm::Function &F,
+               const model::Function *ModelF,
+               const Binary &Model,
+               bool PointersOnly) {
+  llvm::SmallPtrSet<const llvm::PHINode *, 8> VisitedPHIs;
+  ValueTypesMap TypeMap;
+  PHIWebs Webs(F);
+  PrototypeReturnTypesMap CallReturnTypes;
 
   const model::Type *Prototype = ModelF->prototype(Model).getConst();
   revng_assert(Prototype);
@@ -738,6 +889,8 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
                                                              Model,
                                                              PointersOnly,
                                                              TypeMap,
+                                                             Webs,
+                                                             CallReturnTypes,
                                                              VisitedPHIs);
       if (PointersOnly) {
         // Skip if it's not a pointer and we are only interested in pointers
@@ -755,13 +908,17 @@ initModelTypesImpl(FunctionMetadataCache &Cache,
     }
   }
 
-  rc_return TypeMap;
-}
-
-ModelTypesMap initModelTypes(FunctionMetadataCache &Cache,
-                             const llvm::Function &F,
-                             const model::Function *ModelF,
-                             const Binary &Model,
-                             bool PointersOnly) {
-  return initModelTypesImpl(Cache, F, ModelF, Model, PointersOnly);
+  // Building the std::map out of entries sorted by key takes linear time, and
+  // moving the QualifiedTypes avoids copying their qualifiers
+  using Entry = std::pair<const llvm::Value *, QualifiedType>;
+  std::vector<Entry> Sorted;
+  Sorted.reserve(TypeMap.size());
+  for (auto &[Key, Type] : TypeMap)
+    Sorted.emplace_back(Key, std::move(Type));
+  llvm::sort(Sorted, [](const Entry &LHS, const Entry &RHS) {
+    return std::less<const llvm::Value *>()(LHS.first, RHS.first);
+  });
+
+  return { std::make_move_iterator(Sorted.begin()),
+           std::make_move_iterator(Sorted.end()) };
 }
@@ -2,6 +2,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Instructions.h"
@@ -15,18 +17,25 @@
 using namespace llvm;
 
 bool ComputeStackAccessesBoundsPass::runOnModule(Module &M) {
+  // Group the markers by function: requesting LazyValueInfo from a module pass
+  // computes it from scratch, so we want to do that once per function, not
+  // once per marker
+  MapVector<Function *, SmallVector<CallInst *, 16>> MarkersByFunction;
   for (Function &StackOffsetFunction :
-       FunctionTags::StackOffsetMarker.functions(&M)) {
-    auto *FunctionType = StackOffsetFunction.getFunctionType();
-    auto *DifferenceType = cast<IntegerType>(FunctionType->getParamType(1));
-    for (CallBase *Call : callers(&StackOffsetFunction)) {
-      Function &F = *Call->getParent()->getParent();
-      LazyValueInfo &LVI = getAnalysis<LazyValueInfoWrapperPass>(F).getLVI();
+       FunctionTags::StackOffsetMarker.functions(&M))
+    for (CallBase *Call : callers(&StackOffsetFunction))
+      MarkersByFunction[Call->getFunction()].push_back(cast<CallInst>(Call));
+
+  for (auto &[F, Markers] : MarkersByFunction) {
+    LazyValueInfo &LVI = getAnalysis<LazyValueInfoWrapperPass>(*F).getLVI();
+    for (CallInst *Call : Markers) {
+      auto *FunctionType = Call->getFunctionType();
+      auto *DifferenceType = cast<IntegerType>(FunctionType->getParamType(1));
       auto *Undef = UndefValue::get(DifferenceType);
 
       // Identify lower bound of the lower bound
       const auto &LowerBoundRange = LVI.getConstantRange(Call->getArgOperand(1),
-                                                         cast<CallInst>(Call));
+                                                         Call);
       Value *LowerBound = nullptr;
       if (not LowerBoundRange.isFullSet()) {
         LowerBound = ConstantInt::get(DifferenceType,
@@ -38,7 +47,7 @@ bool ComputeStackAccessesBoundsPass::runOnModule(Module &M) {
 
       // Identify upper bound of the upper bound
       const auto &UpperBoundRange = LVI.getConstantRange(Call->getArgOperand(2),
-                                                         cast<CallInst>(Call));
+                                                         Call);
       Value *UpperBound = nullptr;
       if (not UpperBoundRange.isFullSet()) {
         UpperBound = ConstantInt::get(DifferenceType,
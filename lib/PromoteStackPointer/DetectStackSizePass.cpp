@@ -102,6 +102,8 @@ private:
   TupleTree<model::Binary> &Binary;
   std::vector<FunctionStackInfo> FunctionsStackInfo;
   std::map<RawFunctionType *, UpperBoundCollector> FunctionTypeStackArguments;
+  /// Size of the stack arguments of each prototype used at a call site
+  std::map<model::Type::Key, uint64_t> StackArgumentsSizes;
   const size_t CallInstructionPushSize = 0;
   /// Helper for fast model::Type size computation
   model::VerifyHelper VH;
@@ -138,6 +140,7 @@ private:
                                const UpperBoundCollector &Bound) const;
   void electFunctionStackFrameSize(FunctionStackInfo &FSI);
   std::optional<uint64_t> handleCallSite(const CallSite &CallSite);
+  uint64_t getStackArgumentsSize(const model::Type::Key &Prototype);
 };
 
 void DetectStackSize::collectStackBounds(FunctionMetadataCache &Cache,
@@ -291,16 +294,7 @@ DetectStackSize::handleCallSite(const CallSite &CallSite) {
   if (not CallSite.StackSize)
     return std::nullopt;
 
-  using namespace abi::FunctionType;
-  uint64_t StackArgumentSize = 0;
-  for (Layout::Argument &Argument :
-       Layout::make(*Binary->Types().at(CallSite.CallType).get()).Arguments) {
-    if (Argument.Stack.has_value()) {
-      StackArgumentSize = std::max(StackArgumentSize,
-                                   Argument.Stack->Offset
-                                     + Argument.Stack->Size);
-    }
-  }
+  uint64_t StackArgumentSize = getStackArgumentsSize(CallSite.CallType);
   revng_log(Log, "StackArgumentSize: " << StackArgumentSize);
 
   int64_t Result = (*CallSite.StackSize - StackArgumentSize
@@ -314,6 +308,43 @@ DetectStackSize::handleCallSite(const CallSite &CallSite) {
     return std::nullopt;
 }
 
+uint64_t
+DetectStackSize::getStackArgumentsSize(const model::Type::Key &Prototype) {
+  // Stack arguments have all been elected at this point, so the result can be
+  // shared among all the call sites with the same prototype
+  auto It = StackArgumentsSizes.find(Prototype);
+  if (It != StackArgumentsSizes.end())
+    return It->second;
+
+  using namespace abi::FunctionType;
+  uint64_t Result = 0;
+  for (Layout::Argument &Argument :
+       Layout::make(*Binary->Types().at(Prototype).get()).Arguments) {
+    if (Argument.Stack.has_value()) {
+      Result = std::max(Result, Argument.Stack->Offset + Argument.Stack->Size);
+    }
+  }
+
+  StackArgumentsSizes[Prototype] = Result;
+  return Result;
+}
+
+/// \return true if a function has no stack frame type, or if its prototype is a
+///         RawFunctionType without stack arguments type
+static bool hasStackInfoToElect(const model::Binary &Binary) {
+  for (const model::Function &Function : Binary.Functions()) {
+    if (Function.StackFrameType().empty())
+      return true;
+
+    const model::Type *Prototype = Function.prototype(Binary).getConst();
+    if (auto *RawPrototype = dyn_cast<RawFunctionType>(Prototype))
+      if (RawPrototype->StackArgumentsType().empty())
+        return true;
+  }
+
+  return false;
+}
+
 bool DetectStackSizePass::runOnModule(Module &M) {
   //
   // Overview:
@@ -359,15 +390,21 @@ public:
                   pipeline::LLVMContainer &Module) {
     using namespace revng;
 
-    llvm::legacy::PassManager Manager;
-    auto &Global = getWritableModelFromContext(Ctx);
-
-    if (Global->Architecture() == model::Architecture::Invalid) {
+    const model::Binary &Binary = *getModelFromContext(Ctx);
+    if (Binary.Architecture() == model::Architecture::Invalid) {
       return createStringError(inconvertibleErrorCode(),
                                "DetectStackSize analysis require a valid"
                                " Architecture");
     }
 
+    // Functions and prototypes with stack information are never revisited, so
+    // if there are none left we don't even need to go through the module
+    if (not hasStackInfoToElect(Binary))
+      return Error::success();
+
+    llvm::legacy::PassManager Manager;
+    auto &Global = getWritableModelFromContext(Ctx);
+
     Manager.add(new LoadModelWrapperPass(ModelWrapper(Global)));
     Manager.add(new DetectStackSizePass());
     Manager.run(Module.getModule());
@@ -13,6 +13,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
@@ -102,43 +103,40 @@ bool PromoteStackPointerPass::runOnFunction(Function &F) {
                                   GlobalSP)
             or Changed;
 
+  // Look for the uses of GlobalSP in the instructions of F, rather than among
+  // the users of GlobalSP, which are spread across all the functions of the
+  // module: the latter would make the pass quadratic in the number of
+  // functions.
   std::vector<Instruction *> SPUsers;
-  for (User *U : GlobalSP->users()) {
-    if (auto *I = dyn_cast<Instruction>(U)) {
-      Function *UserFun = I->getFunction();
-      revng_log(Log, "Found use in Function: " << UserFun->getName());
-
-      if (UserFun != &F)
-        continue;
-
-      SPUsers.emplace_back(I);
-
-    } else if (auto *CE = dyn_cast<ConstantExpr>(U)) {
-      revng_log(Log, "Found ConstantExpr use");
-
-      if (not CE->getNumUses())
-        continue;
-
-      SmallVector<std::pair<User *, Value *>, 8> Replacements;
-      for (User *CEUser : CE->users()) {
-        auto *CEInstrUser = cast<Instruction>(CEUser);
-        Function *UserFun = CEInstrUser->getFunction();
-
-        if (UserFun != &F)
-          continue;
-
-        auto *CastInstruction = CE->getAsInstruction();
-        CastInstruction->insertBefore(CEInstrUser);
-        SPUsers.emplace_back(CastInstruction);
-        Replacements.push_back({ CEInstrUser, CastInstruction });
+  SmallVector<std::pair<Instruction *, ConstantExpr *>, 8> CEUses;
+  for (Instruction &I : instructions(F)) {
+    bool UsesSP = false;
+    for (Value *Operand : I.operand_values()) {
+      if (Operand == GlobalSP) {
+        UsesSP = true;
+      } else if (auto *CE = dyn_cast<ConstantExpr>(Operand)) {
+        if (is_contained(CE->operand_values(), GlobalSP)) {
+          revng_log(Log, "Found ConstantExpr use");
+          CEUses.push_back({ &I, CE });
+        }
       }
+    }
 
-      for (const auto &[User, CEUseReplacement] : Replacements)
-        User->replaceUsesOfWith(CE, CEUseReplacement);
+    if (UsesSP)
+      SPUsers.push_back(&I);
+  }
 
-    } else {
-      revng_unreachable();
-    }
+  // Turn the constant expressions using GlobalSP into instructions, so that
+  // they can use the local stack pointer instead
+  for (const auto &[CEInstrUser, CE] : CEUses) {
+    // The uses of a same CE in an instruction are all replaced at once
+    if (not is_contained(CEInstrUser->operand_values(), CE))
+      continue;
+
+    auto *CastInstruction = CE->getAsInstruction();
+    CastInstruction->insertBefore(CEInstrUser);
+    SPUsers.push_back(CastInstruction);
+    CEInstrUser->replaceUsesOfWith(CE, CastInstruction);
   }
 
   if (SPUsers.empty())
@@ -2,10 +2,17 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
 #include <optional>
 #include <set>
+#include <tuple>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
@@ -14,7 +21,6 @@
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
 #include "revng/MFP/MFP.h"
-#include "revng/MFP/SetLattices.h"
 #include "revng/Model/IRHelpers.h"
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Model/VerifyHelper.h"
@@ -28,7 +34,9 @@
 #include "revng-c/PromoteStackPointer/SegregateStackAccessesPass.h"
 #include "revng-c/Support/FunctionTags.h"
 #include "revng-c/Support/IRHelpers.h"
+#include "revng-c/Support/MemoryMetrics.h"
 #include "revng-c/Support/ModelHelpers.h"
+#include "revng-c/Support/TraceSpan.h"
 
 #include "Helpers.h"
 
@@ -103,17 +111,145 @@ static std::optional<int64_t> getStackOffset(Instruction *I) {
   return {};
 }
 
-struct StoredByte {
-  int64_t StackOffset = 0;
+/// A run of consecutive stack bytes written by the same store
+struct StoredRange {
   llvm::StoreInst *Store = nullptr;
-  unsigned StoreOffset = 0;
-
-  bool operator<(const StoredByte &Other) const {
-    auto ThisTuple = std::tie(StackOffset, Store, StoreOffset);
-    auto OtherTuple = std::tie(Other.StackOffset,
-                               Other.Store,
-                               Other.StoreOffset);
-    return ThisTuple < OtherTuple;
+
+  /// Stack offset of the first byte of the run
+  int64_t Start = 0;
+
+  /// Stack offset past the last byte of the run
+  int64_t End = 0;
+
+  /// Stack offset of the first byte written by Store
+  int64_t StoreStart = 0;
+
+  bool operator<(const StoredRange &Other) const {
+    return std::tie(Store, Start) < std::tie(Other.Store, Other.Start);
+  }
+};
+
+/// The stack bytes that might have been last written by each store
+///
+/// Bytes are kept in runs, sorted by store and then by offset. The runs of a
+/// store never overlap nor touch each other, so that each set of bytes has a
+/// single representation. Copies share the runs until one of them changes.
+class StoredBytes {
+private:
+  using RangeVector = std::vector<StoredRange>;
+
+private:
+  std::shared_ptr<RangeVector> Ranges;
+
+public:
+  llvm::ArrayRef<StoredRange> ranges() const {
+    if (Ranges == nullptr)
+      return {};
+    return *Ranges;
+  }
+
+  void clear() { Ranges.reset(); }
+
+  /// Forget all the bytes in [Start, End)
+  void erase(int64_t Start, int64_t End) {
+    auto Overlaps = [Start, End](const StoredRange &Range) {
+      return Range.Start < End and Start < Range.End;
+    };
+    if (llvm::none_of(ranges(), Overlaps))
+      return;
+
+    RangeVector Result;
+    for (const StoredRange &Range : ranges()) {
+      if (not Overlaps(Range)) {
+        Result.push_back(Range);
+        continue;
+      }
+
+      // Keep what's left on either side of the erased bytes
+      if (Range.Start < Start) {
+        Result.push_back(Range);
+        Result.back().End = Start;
+      }
+
+      if (End < Range.End) {
+        Result.push_back(Range);
+        Result.back().Start = End;
+      }
+    }
+
+    Ranges = std::make_shared<RangeVector>(std::move(Result));
+  }
+
+  /// Record that \p Store writes the bytes in [Start, End), replacing any
+  /// previous store to them
+  void store(llvm::StoreInst *Store, int64_t Start, int64_t End) {
+    erase(Start, End);
+
+    if (Ranges == nullptr)
+      Ranges = std::make_shared<RangeVector>();
+    else if (Ranges.use_count() != 1)
+      Ranges = std::make_shared<RangeVector>(*Ranges);
+
+    StoredRange New{ Store, Start, End, Start };
+    auto It = llvm::lower_bound(*Ranges, New);
+
+    // All the bytes written by Store have just been erased
+    revng_assert(It == Ranges->end() or It->Store != Store);
+    revng_assert(It == Ranges->begin() or std::prev(It)->Store != Store);
+
+    Ranges->insert(It, New);
+  }
+
+  bool isSubsetOf(const StoredBytes &Other) const {
+    if (Ranges == Other.Ranges)
+      return true;
+
+    // Since the runs of Other are coalesced, each of our runs must be entirely
+    // contained in one of them. Both lists are sorted, so we scan them once.
+    llvm::ArrayRef<StoredRange> OtherRanges = Other.ranges();
+    auto It = OtherRanges.begin();
+    for (const StoredRange &Range : ranges()) {
+      auto Key = std::tie(Range.Store, Range.End);
+      while (It != OtherRanges.end() and std::tie(It->Store, It->End) < Key)
+        ++It;
+
+      if (It == OtherRanges.end() or It->Store != Range.Store
+          or It->Start > Range.Start)
+        return false;
+    }
+
+    return true;
+  }
+
+  static StoredBytes merge(const StoredBytes &LHS, const StoredBytes &RHS) {
+    if (RHS.isSubsetOf(LHS))
+      return LHS;
+    if (LHS.isSubsetOf(RHS))
+      return RHS;
+
+    RangeVector Merged;
+    std::merge(LHS.ranges().begin(),
+               LHS.ranges().end(),
+               RHS.ranges().begin(),
+               RHS.ranges().end(),
+               std::back_inserter(Merged));
+
+    // Coalesce the runs of the same store that overlap or touch
+    RangeVector Result;
+    for (const StoredRange &Range : Merged) {
+      if (not Result.empty()) {
+        StoredRange &Last = Result.back();
+        if (Last.Store == Range.Store and Range.Start <= Last.End) {
+          Last.End = std::max(Last.End, Range.End);
+          continue;
+        }
+      }
+      Result.push_back(Range);
+    }
+
+    StoredBytes Union;
+    Union.Ranges = std::make_shared<RangeVector>(std::move(Result));
+    return Union;
   }
 };
 
@@ -121,9 +257,17 @@ class StackAccessRedirector {
 private:
   using Span = abi::FunctionType::Layout::Argument::StackSpan;
 
+  struct RecordedSpan {
+    int64_t Start;
+    uint64_t Size;
+    Value *BaseAddress;
+  };
+
 private:
   int64_t BaseOffset;
-  std::map<int64_t, std::pair<uint64_t, Value *>> Map;
+  /// Sorted by start. Spans are recorded once, mostly in increasing order, and
+  /// then looked up for each redirected access, hence a flat vector.
+  llvm::SmallVector<RecordedSpan, 8> Spans;
 
 public:
   StackAccessRedirector(int64_t BaseOffset) : BaseOffset(BaseOffset) {}
@@ -131,29 +275,40 @@ public:
   void recordSpan(const Span &Span, Value *BaseAddress) {
     revng_assert(BaseAddress->getType()->isIntegerTy());
     auto Offset = BaseOffset + Span.Offset;
-    revng_assert(!Map.contains(Offset));
-    Map[Offset] = { Span.Size, BaseAddress };
+    const RecordedSpan *It = findAfter(Offset);
+    revng_assert(It == Spans.begin() or std::prev(It)->Start != Offset);
+    Spans.insert(Spans.begin() + (It - Spans.begin()),
+                 { Offset, Span.Size, BaseAddress });
 
     revng_assert(verify());
   }
 
+private:
+  /// \return the first span starting after \a Offset
+  const RecordedSpan *findAfter(int64_t Offset) const {
+    auto StartsAfter = [](int64_t Key, const RecordedSpan &Span) {
+      return Key < Span.Start;
+    };
+    return std::upper_bound(Spans.begin(), Spans.end(), Offset, StartsAfter);
+  }
+
 public:
   std::optional<std::pair<uint64_t, Value *>>
   computeNewBase(int64_t Offset, uint64_t Size) const {
 
     revng_log(Log, "Searching for " << Offset << " of size " << Size);
 
-    auto It = Map.upper_bound(Offset);
-    if (It == Map.begin()) {
+    const RecordedSpan *It = findAfter(Offset);
+    if (It == Spans.begin()) {
       revng_log(Log, "Not found");
       return std::nullopt;
     }
 
     --It;
 
-    int64_t SpanStart = It->first;
-    uint64_t SpanSize = It->second.first;
-    Value *BaseAddress = It->second.second;
+    int64_t SpanStart = It->Start;
+    uint64_t SpanSize = It->Size;
+    Value *BaseAddress = It->BaseAddress;
 
     using OSI = OverflowSafeInt<int64_t>;
     auto MaybeSpanEnd = (OSI(SpanStart) + SpanSize).value();
@@ -170,36 +325,41 @@ public:
 
 public:
   bool verify() const debug_function {
-    if (Map.size() >= 2) {
-      auto FirstToSemiLast = llvm::make_range(Map.begin(), --Map.end());
-      auto SecondToLast = llvm::make_range(++Map.begin(), Map.end());
-      for (auto [Current, Next] : llvm::zip(FirstToSemiLast, SecondToLast)) {
-        auto CurrentEnd = Current.first
-                          + static_cast<int64_t>(Current.second.first);
-        auto NextStart = Next.first;
-        if (CurrentEnd > NextStart)
-          return false;
-      }
+    for (size_t I = 1; I < Spans.size(); ++I) {
+      const RecordedSpan &Current = Spans[I - 1];
+      auto CurrentEnd = Current.Start + static_cast<int64_t>(Current.Size);
+      if (CurrentEnd > Spans[I].Start)
+        return false;
     }
     return true;
   }
 
   template<typename T>
   void dump(T &Stream) const {
-    for (auto [K, V] : Map) {
-      Stream << K << ": [" << V.first << ", " << getName(V.second) << "]\n";
+    for (const RecordedSpan &Span : Spans) {
+      Stream << Span.Start << ": [" << Span.Size << ", "
+             << getName(Span.BaseAddress) << "]\n";
     }
   }
 
   void dump() const debug_function { dump(dbg); }
 };
 
-using Lattice = std::set<StoredByte>;
-
-struct SegregateStackAccessesMFI : public SetUnionLattice<Lattice> {
+struct SegregateStackAccessesMFI {
+  using LatticeElement = StoredBytes;
   using Label = llvm::BasicBlock *;
   using GraphType = llvm::Function *;
 
+  static LatticeElement combineValues(const LatticeElement &LHS,
+                                      const LatticeElement &RHS) {
+    return StoredBytes::merge(LHS, RHS);
+  }
+
+  static bool isLessOrEqual(const LatticeElement &LHS,
+                            const LatticeElement &RHS) {
+    return LHS.isSubsetOf(RHS);
+  }
+
   static LatticeElement applyTransferFunction(llvm::BasicBlock *BB,
                                               const LatticeElement &Value) {
     using namespace llvm;
@@ -230,15 +390,12 @@ struct SegregateStackAccessesMFI : public SetUnionLattice<Lattice> {
       unsigned AccessSize = getMemoryAccessSize(&I);
       int64_t EndStackOffset = StartStackOffset + AccessSize;
 
-      // Erase all the existing entries
-      // TODO: use lower_bound instead of scanning everything
-      StackBytes.erase(StackBytes.lower_bound(StoredByte{ StartStackOffset }),
-                       StackBytes.upper_bound(StoredByte{ EndStackOffset }));
-
-      // If it's a store, record all of its bytes
+      // If it's a store, record all of its bytes, otherwise just erase all the
+      // existing entries
       if (auto *Store = dyn_cast<StoreInst>(&I))
-        for (unsigned I = 0; I < AccessSize; ++I)
-          StackBytes.insert({ StartStackOffset + I, Store, I });
+        StackBytes.store(Store, StartStackOffset, EndStackOffset);
+      else
+        StackBytes.erase(StartStackOffset, EndStackOffset);
     }
 
     return StackBytes;
@@ -254,8 +411,7 @@ struct SortByFunction {
 
 class SegregateStackAccesses {
 private:
-  using MFIResult = std::map<BasicBlock *,
-                             MFP::MFPResult<std::set<StoredByte>>>;
+  using MFIResult = std::map<BasicBlock *, MFP::MFPResult<StoredBytes>>;
 
 private:
   const model::Binary &Binary;
@@ -275,6 +431,10 @@ private:
   std::map<Function *, StackAccessRedirector> StackArgumentsRedirectors;
   std::vector<Instruction *> ToPushALAP;
 
+  /// Layouts of the prototypes, computed once and shared among the functions
+  /// and their call sites
+  std::map<const model::Type *, abi::FunctionType::Layout> Layouts;
+
   llvm::Type *PtrSizedInteger = nullptr;
   llvm::Type *OpaquePointerType = nullptr;
   OpaqueFunctionsPool<TypePair> AddressOfPool;
@@ -343,6 +503,9 @@ public:
 
 public:
   bool run() {
+    MemoryMetrics Metrics("segregate-stack-accesses");
+    TraceSpan Span("segregate-stack-accesses", "pass");
+
     SmallVector<Function *, 8> IsolatedFunctions;
     for (Function &F : FunctionTags::StackPointerPromoted.functions(&M)) {
       IsolatedFunctions.push_back(&F);
@@ -359,6 +522,10 @@ public:
 
     pushALAP();
 
+    // Before purging, both the old and the new functions are alive
+    Metrics.recordSize("isolated_functions", IsolatedFunctions.size());
+    Metrics.recordSize("stores_to_purge", ToPurge.size());
+
     // Purge stores that have been used at least once
     for (Instruction *I : ToPurge)
       eraseFromParent(I);
@@ -906,7 +1073,7 @@ private:
                                                 SSACSCall,
                                                 &ModelFunction);
     using namespace abi::FunctionType;
-    abi::FunctionType::Layout Layout = Layout::make(*Prototype.get());
+    const abi::FunctionType::Layout &Layout = getLayout(*Prototype.getConst());
 
     // Find old call instruction
     CallInst *OldCall = findAssociatedCall(SSACSCall);
@@ -1295,12 +1462,11 @@ private:
     };
     std::map<StoreInst *, StoreInfo> Stores;
     BasicBlock *BB = SSACSCall->getParent();
-    const std::set<StoredByte> &BlockFinalResult = AnalysisResult.at(BB)
-                                                     .OutValue;
-    for (const StoredByte &Byte : BlockFinalResult) {
-      StoreInfo &Info = Stores[Byte.Store];
-      Info.Count += 1;
-      Info.Offset = Byte.StackOffset - Byte.StoreOffset;
+    const StoredBytes &BlockFinalResult = AnalysisResult.at(BB).OutValue;
+    for (const StoredRange &Range : BlockFinalResult.ranges()) {
+      StoreInfo &Info = Stores[Range.Store];
+      Info.Count += Range.End - Range.Start;
+      Info.Offset = Range.StoreStart;
     }
 
     // Process MarkedStores
@@ -1428,11 +1594,20 @@ private:
   }
 
 private:
-  std::pair<llvm::Function *, abi::FunctionType::Layout>
+  const abi::FunctionType::Layout &getLayout(const model::Type &Prototype) {
+    auto It = Layouts.find(&Prototype);
+    if (It == Layouts.end()) {
+      using abi::FunctionType::Layout;
+      It = Layouts.emplace(&Prototype, Layout::make(Prototype)).first;
+    }
+
+    return It->second;
+  }
+
+  std::pair<llvm::Function *, const abi::FunctionType::Layout &>
   recreateApplyingModelPrototype(Function *OldFunction,
                                  const model::TypePath &Prototype) {
-    using namespace abi::FunctionType;
-    auto Layout = Layout::make(Prototype);
+    const abi::FunctionType::Layout &Layout = getLayout(*Prototype.getConst());
 
     Type *OldReturnType = OldFunction->getReturnType();
     FunctionType &NewType = layoutToLLVMFunctionType(Layout, OldReturnType);
@@ -6,10 +6,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/Transforms/Utils/Local.h"
 
-#include "revng/Support/OpaqueFunctionsPool.h"
-
 #include "revng-c/RemoveExtractValues/RemoveExtractValuesPass.h"
-#include "revng-c/Support/FunctionTags.h"
 
 using namespace llvm;
 
@@ -40,9 +37,12 @@ bool RemoveExtractValues::runOnFunction(llvm::Function &F) {
 
   // Create a pool of functions with the same behavior: we will need a different
   // function for each different struct
-  OpaqueFunctionsPool<TypePair> OpaqueEVPool(F.getParent(),
-                                             /* PurgeOnDestruction */ false);
-  initOpaqueEVPool(OpaqueEVPool, F.getParent());
+  if (not OpaqueEVPool) {
+    using PoolT = OpaqueFunctionsPool<TypePair>;
+    OpaqueEVPool = std::make_unique<PoolT>(F.getParent(),
+                                           /* PurgeOnDestruction */ false);
+    initOpaqueEVPool(*OpaqueEVPool, F.getParent());
+  }
 
   llvm::LLVMContext &LLVMCtx = F.getContext();
   IRBuilder<> Builder(LLVMCtx);
@@ -60,9 +60,9 @@ bool RemoveExtractValues::runOnFunction(llvm::Function &F) {
     // Get or generate the function
     auto *EVFunctionType = getOpaqueEVFunctionType(I);
     const TypePair &Key = { I->getType(), I->getAggregateOperand()->getType() };
-    auto *ExtractValueFunction = OpaqueEVPool.get(Key,
-                                                  EVFunctionType,
-                                                  "OpaqueExtractvalue");
+    auto *ExtractValueFunction = OpaqueEVPool->get(Key,
+                                                   EVFunctionType,
+                                                   "OpaqueExtractvalue");
 
     // Emit a call to the new function
     CallInst *InjectedCall = Builder.CreateCall(ExtractValueFunction,
@@ -4,7 +4,10 @@
 
 #include <functional>
 #include <optional>
+#include <unordered_map>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
@@ -34,19 +37,85 @@ void MakeSegmentRefPass::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
   AU.addRequired<LoadModelWrapperPass>();
 }
 
-static std::optional<std::pair<MetaAddress, uint64_t>>
-findLiteralInSegments(const model::Binary &Binary, uint64_t Literal) {
-  std::optional<std::pair<MetaAddress, uint64_t>> Result = std::nullopt;
-  auto Arch = toLLVMArchitecture(Binary.Architecture());
-
-  for (const auto &Segment : Binary.Segments()) {
-    if (Segment.contains(MetaAddress::fromGeneric(Arch, Literal))) {
-      revng_assert(not Result.has_value());
-      Result = { { Segment.StartAddress(), Segment.VirtualSize() } };
+/// The segments of the binary sorted by address, to find the one containing a
+/// literal with a binary search, or with a linear scan if some of them overlap
+class SegmentIndex {
+private:
+  struct Entry {
+    uint64_t Start = 0;
+    uint64_t End = 0;
+    const model::Segment *Segment = nullptr;
+  };
+
+private:
+  std::vector<Entry> Entries;
+  bool Overlapping = false;
+
+public:
+  SegmentIndex(const model::Binary &Binary) {
+    for (const model::Segment &Segment : Binary.Segments()) {
+      uint64_t Start = Segment.StartAddress().address();
+      Entries.push_back({ Start, Start + Segment.VirtualSize(), &Segment });
     }
+
+    llvm::sort(Entries, [](const Entry &LHS, const Entry &RHS) {
+      return LHS.Start < RHS.Start;
+    });
+
+    // Overlapping segments are legit, as long as no literal is in more than
+    // one of them, but the binary search can't find all the candidates
+    for (const auto &[Previous, Next] :
+         llvm::zip(Entries, llvm::drop_begin(Entries)))
+      if (Previous.End > Next.Start)
+        Overlapping = true;
+  }
+
+public:
+  const model::Segment *find(uint64_t Literal) const {
+    if (Overlapping)
+      return findByScan(Literal);
+
+    auto StartsAfter = [](uint64_t Literal, const Entry &E) {
+      return Literal < E.Start;
+    };
+    auto It = llvm::upper_bound(Entries, Literal, StartsAfter);
+    if (It == Entries.begin())
+      return nullptr;
+
+    --It;
+    if (Literal >= It->End)
+      return nullptr;
+
+    return It->Segment;
   }
 
-  return Result;
+private:
+  const model::Segment *findByScan(uint64_t Literal) const {
+    const model::Segment *Result = nullptr;
+    for (const Entry &E : Entries) {
+      if (Literal < E.Start or Literal >= E.End)
+        continue;
+
+      // Each literal must belong to a single segment
+      revng_assert(Result == nullptr);
+      Result = E.Segment;
+    }
+
+    return Result;
+  }
+};
+
+static std::optional<std::pair<MetaAddress, uint64_t>>
+findLiteralInSegments(const SegmentIndex &Segments, uint64_t Literal) {
+  const model::Segment *Segment = Segments.find(Literal);
+  if (Segment == nullptr)
+    return std::nullopt;
+
+  return { { Segment->StartAddress(), Segment->VirtualSize() } };
+}
+
+static bool isCStringCharacter(const char C) {
+  return llvm::isPrint(C) or llvm::isSpace(C);
 }
 
 static std::optional<llvm::StringRef>
@@ -79,15 +148,119 @@ getStringLiteral(RawBinaryView &BinaryView,
   StringView = StringView.take_front(NullTerminatorPos);
 
   // If some of the characters are not printable, is not a string literal
-  const auto IsPrintableInCString = [](const char C) {
-    return not llvm::isPrint(C) and not llvm::isSpace(C);
-  };
-  if (llvm::any_of(StringView, IsPrintableInCString))
+  if (not llvm::all_of(StringView, isCStringCharacter))
     return std::nullopt;
 
   return StringView;
 }
 
+/// The string literals of the read-only segments, found scanning each segment
+/// once, the first time a literal points into it.
+///
+/// A string literal can start at any of the bytes of a run of printable
+/// characters terminated by a \0, or at the \0 itself, so recording the runs
+/// is enough to answer for all the addresses pointing into a segment.
+class StringLiteralIndex {
+private:
+  struct SegmentStrings {
+    /// Whether the segment has been scanned
+    bool Scanned = false;
+    /// The content of the segment, empty if it's not read only
+    llvm::StringRef Data;
+    /// Whether Data has been obtained, otherwise getStringLiteral is used
+    bool HasData = false;
+    /// The [Start, End) offsets of the non-empty runs of printable characters
+    /// followed by a \0 at End, sorted by Start
+    std::vector<std::pair<uint64_t, uint64_t>> Runs;
+  };
+
+private:
+  RawBinaryView &BinaryView;
+  std::unordered_map<uint64_t, SegmentStrings> Segments;
+
+public:
+  StringLiteralIndex(RawBinaryView &BinaryView) : BinaryView(BinaryView) {}
+
+public:
+  std::optional<llvm::StringRef> find(MetaAddress SegmentAddress,
+                                      uint64_t SegmentVirtualSize,
+                                      uint64_t StringOffsetInSegment) {
+    SegmentStrings &Strings = get(SegmentAddress, SegmentVirtualSize);
+
+    // The content of the segment is not available as a whole, check the
+    // string on its own
+    if (not Strings.HasData)
+      return getStringLiteral(BinaryView,
+                              SegmentAddress,
+                              SegmentVirtualSize,
+                              StringOffsetInSegment);
+
+    llvm::StringRef Data = Strings.Data;
+    if (StringOffsetInSegment >= Data.size())
+      return std::nullopt;
+
+    if (Data[StringOffsetInSegment] == '\0')
+      return Data.substr(StringOffsetInSegment, 0);
+
+    auto StartsAfter = [](uint64_t Offset, const auto &Run) {
+      return Offset < Run.first;
+    };
+    auto It = llvm::upper_bound(Strings.Runs,
+                                StringOffsetInSegment,
+                                StartsAfter);
+    if (It == Strings.Runs.begin())
+      return std::nullopt;
+
+    --It;
+    uint64_t End = It->second;
+    if (StringOffsetInSegment >= End)
+      return std::nullopt;
+
+    return Data.slice(StringOffsetInSegment, End);
+  }
+
+private:
+  SegmentStrings &get(MetaAddress SegmentAddress, uint64_t SegmentVirtualSize) {
+    SegmentStrings &Strings = Segments[SegmentAddress.address()];
+    if (Strings.Scanned)
+      return Strings;
+
+    Strings.Scanned = true;
+
+    // If the segment is not read only there are no string literals in it
+    if (not BinaryView.isReadOnly(SegmentAddress, SegmentVirtualSize)) {
+      Strings.HasData = true;
+      return Strings;
+    }
+
+    auto DataOrNone = BinaryView.getStringByAddress(SegmentAddress,
+                                                    SegmentVirtualSize);
+    if (not DataOrNone.has_value())
+      return Strings;
+
+    Strings.HasData = true;
+    Strings.Data = *DataOrNone;
+
+    // Look for the terminators with find, which lowers to memchr, and then
+    // walk back from each of them over the printable characters preceding it
+    llvm::StringRef Data = Strings.Data;
+    uint64_t RunStartLimit = 0;
+    for (uint64_t End = Data.find('\0'); End != llvm::StringRef::npos;
+         End = Data.find('\0', End + 1)) {
+      uint64_t Start = End;
+      while (Start > RunStartLimit and isCStringCharacter(Data[Start - 1]))
+        --Start;
+
+      if (Start != End)
+        Strings.Runs.emplace_back(Start, End);
+
+      RunStartLimit = End + 1;
+    }
+
+    return Strings;
+  }
+};
+
 bool MakeSegmentRefPass::runOnModule(Module &M) {
   llvm::LLVMContext &Context = M.getContext();
 
@@ -108,6 +281,11 @@ bool MakeSegmentRefPass::runOnModule(Module &M) {
   bool Changed = false;
   IRBuilder<> IRB(Context);
   llvm::Type *PtrSizedInteger = getPointerSizedInteger(Context, *Model);
+  auto PointerSize = model::Architecture::getPointerSize(Model->Architecture());
+
+  SegmentIndex Segments(*Model);
+
+  StringLiteralIndex StringLiterals(BinaryView);
 
   for (Function &F : M) {
     for (Instruction &I : instructions(F)) {
@@ -125,13 +303,11 @@ bool MakeSegmentRefPass::runOnModule(Module &M) {
               continue;
 
         ConstantInt *ConstOp = dyn_cast<ConstantInt>(skipCasts(Op));
-        using namespace model::Architecture;
-        auto PointerSize = getPointerSize(Model->Architecture());
         if (ConstOp != nullptr
             and (ConstOp->getBitWidth() == (8 * PointerSize))) {
           uint64_t ConstantAddress = ConstOp->getZExtValue();
 
-          if (auto Segment = findLiteralInSegments(*Model, ConstantAddress);
+          if (auto Segment = findLiteralInSegments(Segments, ConstantAddress);
               Segment) {
             const auto &[StartAddress, VirtualSize] = *Segment;
             auto OffsetInSegment = ConstantAddress - StartAddress.address();
@@ -152,8 +328,8 @@ bool MakeSegmentRefPass::runOnModule(Module &M) {
             // Check if the Op is large as a pointer. If it isn't it can't be a
             // string literal.
             // See if we can find a string literal there.
-            auto OptString = getStringLiteral(BinaryView,
-                                              StartAddress,
+            std::optional<llvm::StringRef>
+              OptString = StringLiterals.find(StartAddress,
                                               VirtualSize,
                                               OffsetInSegment);
 
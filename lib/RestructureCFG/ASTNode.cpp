@@ -34,32 +34,25 @@ IfNode *ContinueNode::getComputationIfNode() const {
 
 void IfNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
   // Update the pointers to the `then` and `else` branches.
-  if (hasThen()) {
-    revng_assert(SubstitutionMap.contains(Then));
-    Then = SubstitutionMap[Then];
-  }
+  if (hasThen())
+    Then = getSubstitute(SubstitutionMap, Then);
 
-  if (hasElse()) {
-    revng_assert(SubstitutionMap.contains(Else));
-    Else = SubstitutionMap[Else];
-  }
+  if (hasElse())
+    Else = getSubstitute(SubstitutionMap, Else);
 }
 
 void ScsNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
   if (RelatedCondition)
-    RelatedCondition = llvm::cast<IfNode>(SubstitutionMap.at(RelatedCondition));
+    RelatedCondition = llvm::cast<IfNode>(getSubstitute(SubstitutionMap,
+                                                        RelatedCondition));
   revng_assert(Body);
-  Body = SubstitutionMap.at(Body);
+  Body = getSubstitute(SubstitutionMap, Body);
 }
 
 void SequenceNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
   // Update all the pointers of the sequence node.
-  for (auto NodeIt = NodeVec.begin(); NodeIt != NodeVec.end(); NodeIt++) {
-    ASTNode *Node = *NodeIt;
-    revng_assert(SubstitutionMap.contains(Node));
-    ASTNode *NewNode = SubstitutionMap[Node];
-    *NodeIt = NewNode;
-  }
+  for (ASTNode *&Node : NodeVec)
+    Node = getSubstitute(SubstitutionMap, Node);
 }
 
 void SwitchNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
@@ -67,13 +60,14 @@ void SwitchNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
   // The `default` case, if present, is now handled in the normal iteration over
   // the `case`s
   for (auto &LabelCasePair : LabelCaseVec)
-    LabelCasePair.second = SubstitutionMap.at(LabelCasePair.second);
+    LabelCasePair.second = getSubstitute(SubstitutionMap, LabelCasePair.second);
 }
 
 void SwitchBreakNode::updateASTNodesPointers(ASTNodeMap &SubstitutionMap) {
 
   // Update the `ParentSwitch` field
-  ParentSwitch = llvm::cast<SwitchNode>(SubstitutionMap.at(ParentSwitch));
+  ParentSwitch = llvm::cast<SwitchNode>(getSubstitute(SubstitutionMap,
+                                                      ParentSwitch));
 }
 
 // #### isEqual methods ####
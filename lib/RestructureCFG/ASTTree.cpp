@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
 #include <cstdlib>
 
 #include "llvm/Support/FileSystem.h"
@@ -14,8 +15,8 @@
 #include "revng-c/RestructureCFG/Utils.h"
 
 using namespace llvm;
-using ASTNodeMap = std::map<ASTNode *, ASTNode *>;
-using ExprNodeMap = std::map<ExprNode *, ExprNode *>;
+using ASTNodeMap = ASTNode::ASTNodeMap;
+using ExprNodeMap = ASTNode::ExprNodeMap;
 
 // Helper to obtain a unique incremental counter (to give name to sequence
 // nodes).
@@ -83,7 +84,9 @@ void ASTTree::removeASTNode(ASTNode *Node) {
 }
 
 ASTNode *ASTTree::findASTNode(BasicBlockNode<BasicBlock *> *BlockNode) {
-  return BBASTMap.at(BlockNode);
+  auto It = BBASTMap.find(BlockNode);
+  revng_assert(It != BBASTMap.end());
+  return It->second;
 }
 
 BasicBlockNode<BasicBlock *> *ASTTree::findCFGNode(ASTNode *ASTNode) {
@@ -106,6 +109,10 @@ ASTNode *ASTTree::getRoot() const {
 ASTNode *ASTTree::copyASTNodesFrom(ASTTree &OldAST) {
   ASTNodeMap ASTSubstitutionMap{};
   ExprNodeMap CondExprMap{};
+  ASTSubstitutionMap.reserve(OldAST.size());
+  CondExprMap.reserve(OldAST.CondExprList.size());
+  ASTNodeList.reserve(ASTNodeList.size() + OldAST.size());
+  CondExprList.reserve(CondExprList.size() + OldAST.CondExprList.size());
 
   // Clone each ASTNode in the current AST.
   links_container::difference_type NewNodes = 0;
@@ -128,22 +135,23 @@ ASTNode *ASTTree::copyASTNodesFrom(ASTTree &OldAST) {
       // guaranteed that the second time we clone the AST (which is identical to
       // the first, the correspondence between clone node -> AST is
       // deduplicated) we hit prepopulated entries in `BBASTMap`. For this same
-      // reason, we need to use the `insert_or_assign` method instead of
-      // `insert` to guarantee that the AST tiling for that portion uses the
-      // correct newer nodes.
-      BBASTMap.insert_or_assign(OldCFGNode, NewASTNode);
+      // reason, we need to overwrite the entry instead of using `insert`, to
+      // guarantee that the AST tiling for that portion uses the correct newer
+      // nodes.
+      BBASTMap[OldCFGNode] = NewASTNode;
       bool New = ASTBBMap.insert({ NewASTNode, OldCFGNode }).second;
       revng_assert(New);
     }
     ASTSubstitutionMap[Old] = NewASTNode;
   }
 
-  // Clone the conditional expression nodes.
+  // Clone the conditional expression nodes. They are all `AtomicNode`s, hence
+  // the ones of the same `BasicBlock` in the different copies of an AST end up
+  // being shared.
   for (const expr_unique_ptr &OldExpr : OldAST.expressions()) {
-    CondExprList.emplace_back(new AtomicNode(*cast<AtomicNode>(OldExpr.get())),
-                              expr_destructor());
-    ExprNode *NewExpr = CondExprList.back().get();
-    CondExprMap[OldExpr.get()] = NewExpr;
+    auto *OldAtomic = cast<AtomicNode>(OldExpr.get());
+    llvm::BasicBlock *BB = OldAtomic->getConditionalBasicBlock();
+    CondExprMap[OldAtomic] = getAtomicExpr(BB);
   }
 
   // Update the AST and BBNode pointers inside the newly created AST nodes,
@@ -160,8 +168,55 @@ ASTNode *ASTTree::copyASTNodesFrom(ASTTree &OldAST) {
     }
   }
 
-  revng_assert(ASTSubstitutionMap.contains(OldAST.getRoot()));
-  return ASTSubstitutionMap[OldAST.getRoot()];
+  auto RootIt = ASTSubstitutionMap.find(OldAST.getRoot());
+  revng_assert(RootIt != ASTSubstitutionMap.end());
+  return RootIt->second;
+}
+
+ASTNode *ASTTree::spliceASTNodesFrom(ASTTree &&OldAST) {
+  ASTNode *Root = OldAST.getRoot();
+  revng_assert(Root != nullptr);
+
+  // The nodes keep pointing to each other, they only need a new ID
+  size_t Moved = OldAST.size();
+  ASTNodeList.reserve(ASTNodeList.size() + Moved);
+  for (ast_unique_ptr &Old : OldAST.ASTNodeList) {
+    Old->setID(getNewID());
+    ASTNodeList.push_back(std::move(Old));
+  }
+
+  // See copyASTNodesFrom for why entries of BBASTMap are overwritten
+  for (const auto &[Node, CFGNode] : OldAST.ASTBBMap) {
+    BBASTMap[CFGNode] = Node;
+    bool New = ASTBBMap.insert({ Node, CFGNode }).second;
+    revng_assert(New);
+  }
+
+  // Conditions on a `BasicBlock` that already has an `AtomicNode` in this AST
+  // are redirected to it, the others are moved along with the nodes
+  ExprNodeMap CondExprMap{};
+  bool Redirected = false;
+  for (expr_unique_ptr &OldExpr : OldAST.CondExprList) {
+    auto *OldAtomic = cast<AtomicNode>(OldExpr.get());
+    llvm::BasicBlock *BB = OldAtomic->getConditionalBasicBlock();
+    auto [It, New] = AtomicExprs.try_emplace(BB, OldAtomic);
+    CondExprMap[OldAtomic] = It->second;
+    if (New)
+      CondExprList.push_back(std::move(OldExpr));
+    else
+      Redirected = true;
+  }
+
+  if (Redirected) {
+    auto BeginMoved = ASTNodeList.end() - Moved;
+    for (ast_unique_ptr &NewNode : llvm::make_range(BeginMoved,
+                                                    ASTNodeList.end()))
+      if (auto *If = llvm::dyn_cast<IfNode>(NewNode.get()))
+        If->updateCondExprPtr(CondExprMap);
+  }
+
+  OldAST = ASTTree();
+  return Root;
 }
 
 void ASTTree::dumpASTOnFile(const std::string &FileName) const {
@@ -190,6 +245,45 @@ void ASTTree::dumpASTOnFile(const std::string &FileName) const {
   DotFile << "}\n";
 }
 
+GraphSnapshot ASTTree::snapshot() const {
+  using ASTEdgeKind = GraphSnapshot::ASTEdgeKind;
+
+  GraphSnapshot Result;
+  Result.Kind = GraphSnapshot::GraphKind::GHAST;
+  Result.Entry = RootNode != nullptr ? RootNode->getID() : UINT64_MAX;
+  Result.Nodes.reserve(ASTNodeList.size());
+  for (const auto &Owned : ASTNodeList) {
+    ASTNode *Node = Owned.get();
+    GraphSnapshot::Node &Snapshot = Result.Nodes.emplace_back();
+    Snapshot.ID = Node->getID();
+    Snapshot.Kind = static_cast<uint8_t>(Node->getKind());
+    Snapshot.Name = Node->getName();
+
+    auto AddEdge = [&Snapshot](ASTNode *Target, ASTEdgeKind Kind) {
+      if (Target != nullptr)
+        Snapshot.Edges.push_back({ Target->getID(), uint8_t(Kind) });
+    };
+
+    if (auto *If = dyn_cast<IfNode>(Node)) {
+      AddEdge(If->getThen(), ASTEdgeKind::Then);
+      AddEdge(If->getElse(), ASTEdgeKind::Else);
+    } else if (auto *Scs = dyn_cast<ScsNode>(Node)) {
+      AddEdge(Scs->getBody(), ASTEdgeKind::Body);
+    } else if (auto *Sequence = dyn_cast<SequenceNode>(Node)) {
+      for (ASTNode *Element : Sequence->nodes())
+        AddEdge(Element, ASTEdgeKind::Element);
+    } else if (auto *Switch = dyn_cast<SwitchNode>(Node)) {
+      for (const auto &[LabelSet, Case] : Switch->cases())
+        if (not LabelSet.empty())
+          AddEdge(Case, ASTEdgeKind::Case);
+      AddEdge(Switch->getDefault(), ASTEdgeKind::Default);
+    }
+
+    AddEdge(Node->getSuccessor(), ASTEdgeKind::Successor);
+  }
+  return Result;
+}
+
 void ASTTree::dumpASTOnFile(const std::string &FunctionName,
                             const std::string &FolderName,
                             const std::string &FileName) const {
@@ -202,10 +296,23 @@ void ASTTree::dumpASTOnFile(const std::string &FunctionName,
   const std::string PathName = GraphDir + "/" + FunctionName + "/" + FolderName;
   EC = llvm::sys::fs::create_directory(PathName);
   revng_check(not EC, "Could not create directory to print AST dot");
-  dumpASTOnFile(PathName + "/" + FileName);
+  if (dumpBinarySnapshots())
+    snapshot().writeToFile(PathName + "/" + FileName + ".snapshot");
+  else
+    dumpASTOnFile(PathName + "/" + FileName);
 }
 
 ExprNode *ASTTree::addCondExpr(expr_unique_ptr &&Expr) {
   CondExprList.emplace_back(std::move(Expr));
   return CondExprList.back().get();
 }
+
+AtomicNode *ASTTree::getAtomicExpr(llvm::BasicBlock *BB) {
+  auto [It, New] = AtomicExprs.try_emplace(BB, nullptr);
+  if (New) {
+    CondExprList.emplace_back(new AtomicNode(BB), expr_destructor());
+    It->second = cast<AtomicNode>(CondExprList.back().get());
+  }
+
+  return It->second;
+}
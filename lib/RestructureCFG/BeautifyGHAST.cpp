@@ -6,9 +6,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/Casting.h"
-#include "llvm/Support/Path.h"
 
 #include "revng/ADT/RecursiveCoroutine.h"
 #include "revng/Model/IRHelpers.h"
@@ -23,7 +23,10 @@
 #include "revng-c/RestructureCFG/ExprNode.h"
 #include "revng-c/RestructureCFG/GenerateAst.h"
 #include "revng-c/RestructureCFG/RegionCFGTree.h"
+#include "revng-c/RestructureCFG/RestructureCFG.h"
+#include "revng-c/RestructureCFG/RestructureMetrics.h"
 #include "revng-c/Support/DecompilationHelpers.h"
+#include "revng-c/Support/TraceSpan.h"
 
 #include "FallThroughScopeAnalysis.h"
 #include "InlineDispatcherSwitch.h"
@@ -40,46 +43,25 @@ using namespace llvm;
 
 static Logger<> BeautifyLogger("beautify");
 
-// Prefix for the short circuit metrics dir.
-static cl::opt<std::string> OutputPath("short-circuit-metrics-output-dir",
-                                       cl::desc("Short circuit metrics dir"),
-                                       cl::value_desc("short-circuit-dir"),
-                                       cl::cat(MainCategory),
-                                       cl::Optional);
+// Metrics counter variables, thread-local since functions can be beautified
+// in parallel
+static thread_local unsigned ShortCircuitCounter = 0;
+static thread_local unsigned TrivialShortCircuitCounter = 0;
 
-static std::unique_ptr<llvm::raw_fd_ostream>
-openFunctionFile(const StringRef DirectoryPath,
-                 const StringRef FunctionName,
-                 const StringRef Suffix) {
-
-  std::error_code Error;
-  SmallString<32> FilePath = DirectoryPath;
-
-  if (FilePath.empty())
-    if ((Error = llvm::sys::fs::current_path(FilePath)))
-      revng_abort(Error.message().c_str());
-
-  if ((Error = llvm::sys::fs::make_absolute(FilePath)))
-    revng_abort(Error.message().c_str());
-
-  if ((Error = llvm::sys::fs::create_directories(FilePath)))
-    revng_abort(Error.message().c_str());
-
-  llvm::sys::path::append(FilePath, FunctionName + Suffix);
-  auto FileOStream = std::make_unique<llvm::raw_fd_ostream>(FilePath, Error);
-  if (Error) {
-    FileOStream.reset();
-    revng_abort(Error.message().c_str());
-  }
-
-  return FileOStream;
-}
-
-// Metrics counter variables
-static unsigned ShortCircuitCounter = 0;
-static unsigned TrivialShortCircuitCounter = 0;
-
-static RecursiveCoroutine<bool> hasSideEffects(ExprNode *Expr) {
+/// Memoizes the result of hasSideEffects for each ExprNode.
+///
+/// The ExprNodes are never modified after being added to the ASTTree (the
+/// beautification only builds new ones on top of them), so the cache never
+/// needs to be invalidated.
+using SideEffectsCache = llvm::DenseMap<const ExprNode *, bool>;
+
+static RecursiveCoroutine<bool>
+hasSideEffects(ExprNode *Expr, SideEffectsCache &Cache) {
+  auto It = Cache.find(Expr);
+  if (It != Cache.end())
+    rc_return It->second;
+
+  bool Result = false;
   switch (Expr->getKind()) {
 
   case ExprNode::NodeKind::NK_Atomic: {
@@ -91,270 +73,290 @@ static RecursiveCoroutine<bool> hasSideEffects(ExprNode *Expr) {
         // For Instructions with void type, AddLocalVariablesDueToSideEffects
         // cannot properly assign them to LocalVariables because they have
         // void type, so we need to explicitly ask if they have side effects.
-        rc_return true;
+        Result = true;
+        break;
       } else {
         revng_assert(not isCallToTagged(&I, FunctionTags::Assign),
                      "call to assign should have matched void+hasSideEffects");
       }
     }
-    rc_return false;
   } break;
 
   case ExprNode::NodeKind::NK_Not: {
     auto *Not = llvm::cast<NotNode>(Expr);
-    rc_return rc_recur hasSideEffects(Not->getNegatedNode());
+    Result = rc_recur hasSideEffects(Not->getNegatedNode(), Cache);
   } break;
 
   case ExprNode::NodeKind::NK_And: {
     auto *And = llvm::cast<AndNode>(Expr);
     const auto [LHS, RHS] = And->getInternalNodes();
-    rc_return rc_recur hasSideEffects(LHS) or rc_recur hasSideEffects(RHS);
+    Result = rc_recur hasSideEffects(LHS, Cache)
+             or rc_recur hasSideEffects(RHS, Cache);
   } break;
 
   case ExprNode::NodeKind::NK_Or: {
     auto *Or = llvm::cast<OrNode>(Expr);
     const auto [LHS, RHS] = Or->getInternalNodes();
-    rc_return rc_recur hasSideEffects(LHS) or rc_recur hasSideEffects(RHS);
+    Result = rc_recur hasSideEffects(LHS, Cache)
+             or rc_recur hasSideEffects(RHS, Cache);
   } break;
 
   default:
     revng_abort();
   }
-  rc_return true;
+
+  Cache[Expr] = Result;
+  rc_return Result;
 }
 
-static bool hasSideEffects(IfNode *If) {
+static bool hasSideEffects(IfNode *If, SideEffectsCache &Cache) {
   // Compute how many statement we need to serialize for the basicblock
   // associated with the internal `IfNode`.
-  return hasSideEffects(If->getCondExpr());
+  return hasSideEffects(If->getCondExpr(), Cache);
 }
 
 using UniqueExpr = ASTTree::expr_unique_ptr;
 
-// Helper function to simplify short-circuit IFs
-static void simplifyShortCircuit(ASTNode *RootNode, ASTTree &AST) {
+/// Apply the first short-circuit reduction matching \a If, if any
+///
+/// \return true if \a If has been rewritten
+static bool
+reduceShortCircuit(IfNode *If, ASTTree &AST, SideEffectsCache &Cache) {
+  if (If->hasBothBranches()) {
+    if (auto NestedIf = llvm::dyn_cast_or_null<IfNode>(If->getThen())) {
 
-  if (auto *Sequence = llvm::dyn_cast<SequenceNode>(RootNode)) {
-    for (ASTNode *Node : Sequence->nodes()) {
-      simplifyShortCircuit(Node, AST);
-    }
+      // TODO: Refactor this with some kind of iterator
+      if (NestedIf->getThen() != nullptr) {
 
-  } else if (auto *Scs = llvm::dyn_cast<ScsNode>(RootNode)) {
-    simplifyShortCircuit(Scs->getBody(), AST);
-  } else if (auto *Switch = llvm::dyn_cast<SwitchNode>(RootNode)) {
+        if (If->getElse()->isEqual(NestedIf->getThen())
+            and not hasSideEffects(NestedIf, Cache)) {
+          if (BeautifyLogger.isEnabled()) {
+            BeautifyLogger << "Candidate for short-circuit reduction found:";
+            BeautifyLogger << "\n";
+            BeautifyLogger << "IF " << If->getName() << " and ";
+            BeautifyLogger << "IF " << NestedIf->getName() << "\n";
+            BeautifyLogger << "Nodes being simplified:\n";
+            BeautifyLogger << If->getElse()->getName() << " and ";
+            BeautifyLogger << NestedIf->getThen()->getName() << "\n";
+          }
+          If->setThen(NestedIf->getElse());
+          If->setElse(NestedIf->getThen());
 
-    for (auto &LabelCasePair : Switch->cases())
-      simplifyShortCircuit(LabelCasePair.second, AST);
+          // `if A and not B` situation.
+          UniqueExpr NotB;
+          NotB.reset(new NotNode(NestedIf->getCondExpr()));
+          ExprNode *NotBNode = AST.addCondExpr(std::move(NotB));
 
-  } else if (auto *If = llvm::dyn_cast<IfNode>(RootNode)) {
-    if (If->hasBothBranches()) {
-      if (auto NestedIf = llvm::dyn_cast_or_null<IfNode>(If->getThen())) {
-
-        // TODO: Refactor this with some kind of iterator
-        if (NestedIf->getThen() != nullptr) {
-
-          if (If->getElse()->isEqual(NestedIf->getThen())
-              and not hasSideEffects(NestedIf)) {
-            if (BeautifyLogger.isEnabled()) {
-              BeautifyLogger << "Candidate for short-circuit reduction found:";
-              BeautifyLogger << "\n";
-              BeautifyLogger << "IF " << If->getName() << " and ";
-              BeautifyLogger << "IF " << NestedIf->getName() << "\n";
-              BeautifyLogger << "Nodes being simplified:\n";
-              BeautifyLogger << If->getElse()->getName() << " and ";
-              BeautifyLogger << NestedIf->getThen()->getName() << "\n";
-            }
-            If->setThen(NestedIf->getElse());
-            If->setElse(NestedIf->getThen());
-
-            // `if A and not B` situation.
-            UniqueExpr NotB;
-            NotB.reset(new NotNode(NestedIf->getCondExpr()));
-            ExprNode *NotBNode = AST.addCondExpr(std::move(NotB));
-
-            UniqueExpr AAndNotB;
-            AAndNotB.reset(new AndNode(If->getCondExpr(), NotBNode));
-
-            ExprNode *AAndNotBNode = AST.addCondExpr(std::move(AAndNotB));
-
-            If->replaceCondExpr(AAndNotBNode);
-
-            // Increment counter
-            ShortCircuitCounter += 1;
-
-            // Recursive call.
-            simplifyShortCircuit(If, AST);
-          }
+          UniqueExpr AAndNotB;
+          AAndNotB.reset(new AndNode(If->getCondExpr(), NotBNode));
+
+          ExprNode *AAndNotBNode = AST.addCondExpr(std::move(AAndNotB));
+
+          If->replaceCondExpr(AAndNotBNode);
+
+          // Increment counter
+          ShortCircuitCounter += 1;
+
+          return true;
         }
+      }
+
+      if (NestedIf->getElse() != nullptr) {
+        if (If->getElse()->isEqual(NestedIf->getElse())
+            and not hasSideEffects(NestedIf, Cache)) {
+          if (BeautifyLogger.isEnabled()) {
+            BeautifyLogger << "Candidate for short-circuit reduction found:";
+            BeautifyLogger << "\n";
+            BeautifyLogger << "IF " << If->getName() << " and ";
+            BeautifyLogger << "IF " << NestedIf->getName() << "\n";
+            BeautifyLogger << "Nodes being simplified:\n";
+            BeautifyLogger << If->getElse()->getName() << " and ";
+            BeautifyLogger << NestedIf->getElse()->getName() << "\n";
+          }
+          If->setThen(NestedIf->getThen());
+          If->setElse(NestedIf->getElse());
 
-        if (NestedIf->getElse() != nullptr) {
-          if (If->getElse()->isEqual(NestedIf->getElse())
-              and not hasSideEffects(NestedIf)) {
-            if (BeautifyLogger.isEnabled()) {
-              BeautifyLogger << "Candidate for short-circuit reduction found:";
-              BeautifyLogger << "\n";
-              BeautifyLogger << "IF " << If->getName() << " and ";
-              BeautifyLogger << "IF " << NestedIf->getName() << "\n";
-              BeautifyLogger << "Nodes being simplified:\n";
-              BeautifyLogger << If->getElse()->getName() << " and ";
-              BeautifyLogger << NestedIf->getElse()->getName() << "\n";
-            }
-            If->setThen(NestedIf->getThen());
-            If->setElse(NestedIf->getElse());
-
-            // `if A and B` situation.
-            UniqueExpr AAndB;
-            {
-              ExprNode *E = new AndNode(If->getCondExpr(),
-                                        NestedIf->getCondExpr());
-              AAndB.reset(E);
-            }
-
-            ExprNode *AAndBNode = AST.addCondExpr(std::move(AAndB));
-
-            If->replaceCondExpr(AAndBNode);
-
-            // Increment counter
-            ShortCircuitCounter += 1;
-
-            simplifyShortCircuit(If, AST);
+          // `if A and B` situation.
+          UniqueExpr AAndB;
+          {
+            ExprNode *E = new AndNode(If->getCondExpr(),
+                                      NestedIf->getCondExpr());
+            AAndB.reset(E);
           }
+
+          ExprNode *AAndBNode = AST.addCondExpr(std::move(AAndB));
+
+          If->replaceCondExpr(AAndBNode);
+
+          // Increment counter
+          ShortCircuitCounter += 1;
+
+          return true;
         }
       }
     }
-    if (If->hasBothBranches()) {
-      if (auto NestedIf = llvm::dyn_cast_or_null<IfNode>(If->getElse())) {
-        // TODO: Refactor this with some kind of iterator
-        if (NestedIf->getThen() != nullptr) {
-          if (If->getThen()->isEqual(NestedIf->getThen())
-              and not hasSideEffects(NestedIf)) {
-            if (BeautifyLogger.isEnabled()) {
-              BeautifyLogger << "Candidate for short-circuit reduction found:";
-              BeautifyLogger << "\n";
-              BeautifyLogger << "IF " << If->getName() << " and ";
-              BeautifyLogger << "IF " << NestedIf->getName() << "\n";
-              BeautifyLogger << "Nodes being simplified:\n";
-              BeautifyLogger << If->getThen()->getName() << " and ";
-              BeautifyLogger << NestedIf->getThen()->getName() << "\n";
-            }
-            If->setElse(NestedIf->getElse());
-            If->setThen(NestedIf->getThen());
-
-            // `if not A and not B` situation.
-            UniqueExpr NotA;
-            NotA.reset(new NotNode(If->getCondExpr()));
-            ExprNode *NotANode = AST.addCondExpr(std::move(NotA));
-
-            UniqueExpr NotB;
-            NotB.reset(new NotNode(NestedIf->getCondExpr()));
-            ExprNode *NotBNode = AST.addCondExpr(std::move(NotB));
-
-            UniqueExpr NotAAndNotB;
-            NotAAndNotB.reset(new AndNode(NotANode, NotBNode));
-            ExprNode *NotAAndNotBNode = AST.addCondExpr(std::move(NotAAndNotB));
-
-            If->replaceCondExpr(NotAAndNotBNode);
-
-            // Increment counter
-            ShortCircuitCounter += 1;
-
-            simplifyShortCircuit(If, AST);
+  }
+  if (If->hasBothBranches()) {
+    if (auto NestedIf = llvm::dyn_cast_or_null<IfNode>(If->getElse())) {
+      // TODO: Refactor this with some kind of iterator
+      if (NestedIf->getThen() != nullptr) {
+        if (If->getThen()->isEqual(NestedIf->getThen())
+            and not hasSideEffects(NestedIf, Cache)) {
+          if (BeautifyLogger.isEnabled()) {
+            BeautifyLogger << "Candidate for short-circuit reduction found:";
+            BeautifyLogger << "\n";
+            BeautifyLogger << "IF " << If->getName() << " and ";
+            BeautifyLogger << "IF " << NestedIf->getName() << "\n";
+            BeautifyLogger << "Nodes being simplified:\n";
+            BeautifyLogger << If->getThen()->getName() << " and ";
+            BeautifyLogger << NestedIf->getThen()->getName() << "\n";
           }
+          If->setElse(NestedIf->getElse());
+          If->setThen(NestedIf->getThen());
+
+          // `if not A and not B` situation.
+          UniqueExpr NotA;
+          NotA.reset(new NotNode(If->getCondExpr()));
+          ExprNode *NotANode = AST.addCondExpr(std::move(NotA));
+
+          UniqueExpr NotB;
+          NotB.reset(new NotNode(NestedIf->getCondExpr()));
+          ExprNode *NotBNode = AST.addCondExpr(std::move(NotB));
+
+          UniqueExpr NotAAndNotB;
+          NotAAndNotB.reset(new AndNode(NotANode, NotBNode));
+          ExprNode *NotAAndNotBNode = AST.addCondExpr(std::move(NotAAndNotB));
+
+          If->replaceCondExpr(NotAAndNotBNode);
+
+          // Increment counter
+          ShortCircuitCounter += 1;
+
+          return true;
         }
+      }
 
-        if (NestedIf->getElse() != nullptr) {
-          if (If->getThen()->isEqual(NestedIf->getElse())
-              and not hasSideEffects(NestedIf)) {
-            if (BeautifyLogger.isEnabled()) {
-              BeautifyLogger << "Candidate for short-circuit reduction found:";
-              BeautifyLogger << "\n";
-              BeautifyLogger << "IF " << If->getName() << " and ";
-              BeautifyLogger << "IF " << NestedIf->getName() << "\n";
-              BeautifyLogger << "Nodes being simplified:\n";
-              BeautifyLogger << If->getThen()->getName() << " and ";
-              BeautifyLogger << NestedIf->getElse()->getName() << "\n";
-            }
-            If->setElse(NestedIf->getThen());
-            If->setThen(NestedIf->getElse());
-
-            // `if not A and B` situation.
-            UniqueExpr NotA;
-            NotA.reset(new NotNode(If->getCondExpr()));
-            ExprNode *NotANode = AST.addCondExpr(std::move(NotA));
-
-            UniqueExpr NotAAndB;
-            NotAAndB.reset(new AndNode(NotANode, NestedIf->getCondExpr()));
-            ExprNode *NotAAndBNode = AST.addCondExpr(std::move(NotAAndB));
-
-            If->replaceCondExpr(NotAAndBNode);
-
-            // Increment counter
-            ShortCircuitCounter += 1;
-
-            simplifyShortCircuit(If, AST);
+      if (NestedIf->getElse() != nullptr) {
+        if (If->getThen()->isEqual(NestedIf->getElse())
+            and not hasSideEffects(NestedIf, Cache)) {
+          if (BeautifyLogger.isEnabled()) {
+            BeautifyLogger << "Candidate for short-circuit reduction found:";
+            BeautifyLogger << "\n";
+            BeautifyLogger << "IF " << If->getName() << " and ";
+            BeautifyLogger << "IF " << NestedIf->getName() << "\n";
+            BeautifyLogger << "Nodes being simplified:\n";
+            BeautifyLogger << If->getThen()->getName() << " and ";
+            BeautifyLogger << NestedIf->getElse()->getName() << "\n";
           }
+          If->setElse(NestedIf->getThen());
+          If->setThen(NestedIf->getElse());
+
+          // `if not A and B` situation.
+          UniqueExpr NotA;
+          NotA.reset(new NotNode(If->getCondExpr()));
+          ExprNode *NotANode = AST.addCondExpr(std::move(NotA));
+
+          UniqueExpr NotAAndB;
+          NotAAndB.reset(new AndNode(NotANode, NestedIf->getCondExpr()));
+          ExprNode *NotAAndBNode = AST.addCondExpr(std::move(NotAAndB));
+
+          If->replaceCondExpr(NotAAndBNode);
+
+          // Increment counter
+          ShortCircuitCounter += 1;
+
+          return true;
         }
       }
     }
+  }
+
+  return false;
+}
+
+// Helper function to simplify short-circuit IFs
+static void simplifyShortCircuit(ASTNode *RootNode,
+                                 ASTTree &AST,
+                                 SideEffectsCache &Cache) {
+
+  if (auto *Sequence = llvm::dyn_cast<SequenceNode>(RootNode)) {
+    for (ASTNode *Node : Sequence->nodes()) {
+      simplifyShortCircuit(Node, AST, Cache);
+    }
+
+  } else if (auto *Scs = llvm::dyn_cast<ScsNode>(RootNode)) {
+    simplifyShortCircuit(Scs->getBody(), AST, Cache);
+  } else if (auto *Switch = llvm::dyn_cast<SwitchNode>(RootNode)) {
+
+    for (auto &LabelCasePair : Switch->cases())
+      simplifyShortCircuit(LabelCasePair.second, AST, Cache);
+
+  } else if (auto *If = llvm::dyn_cast<IfNode>(RootNode)) {
+    // Reduce this node to a fixed point before visiting its branches, so that
+    // each subtree is visited only once
+    while (reduceShortCircuit(If, AST, Cache))
+      ;
 
     if (If->hasThen())
-      simplifyShortCircuit(If->getThen(), AST);
+      simplifyShortCircuit(If->getThen(), AST, Cache);
     if (If->hasElse())
-      simplifyShortCircuit(If->getElse(), AST);
+      simplifyShortCircuit(If->getElse(), AST, Cache);
   }
 }
 
-static void simplifyTrivialShortCircuit(ASTNode *RootNode, ASTTree &AST) {
+static void simplifyTrivialShortCircuit(ASTNode *RootNode,
+                                        ASTTree &AST,
+                                        SideEffectsCache &Cache) {
   if (auto *Sequence = llvm::dyn_cast<SequenceNode>(RootNode)) {
     for (ASTNode *Node : Sequence->nodes()) {
-      simplifyTrivialShortCircuit(Node, AST);
+      simplifyTrivialShortCircuit(Node, AST, Cache);
     }
   } else if (auto *Scs = llvm::dyn_cast<ScsNode>(RootNode)) {
-    simplifyTrivialShortCircuit(Scs->getBody(), AST);
+    simplifyTrivialShortCircuit(Scs->getBody(), AST, Cache);
 
   } else if (auto *Switch = llvm::dyn_cast<SwitchNode>(RootNode)) {
 
     for (auto &LabelCasePair : Switch->cases())
-      simplifyTrivialShortCircuit(LabelCasePair.second, AST);
+      simplifyTrivialShortCircuit(LabelCasePair.second, AST, Cache);
 
   } else if (auto *If = llvm::dyn_cast<IfNode>(RootNode)) {
-    if (!If->hasElse()) {
-      if (auto *InternalIf = llvm::dyn_cast<IfNode>(If->getThen())) {
-        if (!InternalIf->hasElse() and not hasSideEffects(InternalIf)) {
-          if (BeautifyLogger.isEnabled()) {
-            BeautifyLogger << "Candidate for trivial short-circuit reduction";
-            BeautifyLogger << "found:\n";
-            BeautifyLogger << "IF " << If->getName() << " and ";
-            BeautifyLogger << "If " << InternalIf->getName() << "\n";
-            BeautifyLogger << "Nodes being simplified:\n";
-            BeautifyLogger << If->getThen()->getName() << " and ";
-            BeautifyLogger << InternalIf->getThen()->getName() << "\n";
-          }
-          If->setThen(InternalIf->getThen());
-
-          // `if A and B` situation.
-          UniqueExpr AAndB;
-          {
-            ExprNode *E = new AndNode(If->getCondExpr(),
-                                      InternalIf->getCondExpr());
-            AAndB.reset(E);
-          }
-          ExprNode *AAndBNode = AST.addCondExpr(std::move(AAndB));
+    // Reduce this node to a fixed point before visiting its branches, so that
+    // each subtree is visited only once
+    while (not If->hasElse()) {
+      auto *InternalIf = llvm::dyn_cast<IfNode>(If->getThen());
+      if (InternalIf == nullptr or InternalIf->hasElse()
+          or hasSideEffects(InternalIf, Cache))
+        break;
+
+      if (BeautifyLogger.isEnabled()) {
+        BeautifyLogger << "Candidate for trivial short-circuit reduction";
+        BeautifyLogger << "found:\n";
+        BeautifyLogger << "IF " << If->getName() << " and ";
+        BeautifyLogger << "If " << InternalIf->getName() << "\n";
+        BeautifyLogger << "Nodes being simplified:\n";
+        BeautifyLogger << If->getThen()->getName() << " and ";
+        BeautifyLogger << InternalIf->getThen()->getName() << "\n";
+      }
+      If->setThen(InternalIf->getThen());
 
-          If->replaceCondExpr(AAndBNode);
+      // `if A and B` situation.
+      UniqueExpr AAndB;
+      {
+        ExprNode *E = new AndNode(If->getCondExpr(), InternalIf->getCondExpr());
+        AAndB.reset(E);
+      }
+      ExprNode *AAndBNode = AST.addCondExpr(std::move(AAndB));
 
-          // Increment counter
-          TrivialShortCircuitCounter += 1;
+      If->replaceCondExpr(AAndBNode);
 
-          simplifyTrivialShortCircuit(RootNode, AST);
-        }
-      }
+      // Increment counter
+      TrivialShortCircuitCounter += 1;
     }
 
     if (If->hasThen())
-      simplifyTrivialShortCircuit(If->getThen(), AST);
+      simplifyTrivialShortCircuit(If->getThen(), AST, Cache);
     if (If->hasElse())
-      simplifyTrivialShortCircuit(If->getElse(), AST);
+      simplifyTrivialShortCircuit(If->getElse(), AST, Cache);
   }
 }
 
@@ -933,11 +935,12 @@ promoteNoFallthrough(ASTTree &AST,
 
 static ASTNode *promoteNoFallthroughIf(const model::Binary &Model,
                                        ASTNode *RootNode,
-                                       ASTTree &AST) {
+                                       ASTTree &AST,
+                                       CodeFallThroughCache &Cache) {
 
   // Perform the computation of fallthrough scopes type
   FallThroughScopeTypeMap
-    FallThroughScopeMap = computeFallThroughScope(Model, RootNode);
+    FallThroughScopeMap = computeFallThroughScope(Model, RootNode, Cache);
 
   // In this map, we store the weight of the AST starting from a node and
   // going down.
@@ -962,14 +965,10 @@ static ASTNode *promoteNoFallthroughIf(const model::Binary &Model,
   return RootNode;
 }
 
-void beautifyAST(const model::Binary &Model, Function &F, ASTTree &CombedAST) {
-
-  // If the --short-circuit-metrics-output-dir=dir argument was passed from
-  // command line, we need to print the statistics for the short circuit metrics
-  // into a file with the function name, inside the directory 'dir'.
-  std::unique_ptr<llvm::raw_fd_ostream> StatsFileStream;
-  if (OutputPath.getNumOccurrences())
-    StatsFileStream = openFunctionFile(OutputPath, F.getName(), ".csv");
+bool beautifyAST(const model::Binary &Model,
+                 Function &F,
+                 ASTTree &CombedAST,
+                 const RestructureBudget *Budget) {
 
   ShortCircuitCounter = 0;
   TrivialShortCircuitCounter = 0;
@@ -981,98 +980,142 @@ void beautifyAST(const model::Binary &Model, Function &F, ASTTree &CombedAST) {
 
   Dumper.log("before-beautify");
 
+  // Up to simplifyHybridNot, beautification only changes the GHAST, so it can
+  // still be abandoned if the budget is exhausted.
+  const auto IsExhausted = [Budget, &F]() {
+    bool Result = Budget != nullptr and Budget->isExhausted();
+    if (Result)
+      revng_log(BeautifyLogger, "Budget exhausted for " << F.getName());
+    return Result;
+  };
+
+  // The short-circuit simplifications inspect the same conditions over and
+  // over, share the side effects analysis among them.
+  SideEffectsCache SideEffects;
+
   // Simplify short-circuit nodes.
+  TraceSpan Span("simplifyShortCircuit", "beautify", F.getName());
   revng_log(BeautifyLogger, "Performing short-circuit simplification\n");
-  simplifyShortCircuit(RootNode, CombedAST);
+  simplifyShortCircuit(RootNode, CombedAST, SideEffects);
   Dumper.log("after-short-circuit");
+  if (IsExhausted())
+    return false;
 
   // Flip IFs with empty then branches.
   // We need to do it before simplifyTrivialShortCircuit, otherwise that
   // functions will need to check every possible combination of then-else to
   // simplify. In this way we can keep it simple.
+  Span.restart("flipEmptyThen");
   revng_log(BeautifyLogger,
             "Performing IFs with empty then branches flipping\n");
   flipEmptyThen(CombedAST, RootNode);
   Dumper.log("after-if-flip");
 
   // Simplify trivial short-circuit nodes.
+  Span.restart("simplifyTrivialShortCircuit");
   revng_log(BeautifyLogger,
             "Performing trivial short-circuit simplification\n");
-  simplifyTrivialShortCircuit(RootNode, CombedAST);
+  simplifyTrivialShortCircuit(RootNode, CombedAST, SideEffects);
   Dumper.log("after-trivial-short-circuit");
+  if (IsExhausted())
+    return false;
 
   // Flip IFs with empty then branches.
   // We need to do it here again, after simplifyTrivialShortCircuit, because
   // that functions can create empty then branches in some situations, and we
   // want to flip them as well.
+  Span.restart("flipEmptyThen");
   revng_log(BeautifyLogger,
             "Performing IFs with empty then branches flipping\n");
   flipEmptyThen(CombedAST, RootNode);
   Dumper.log("after-if-flip");
 
   // Match switch node.
+  Span.restart("matchSwitch");
   revng_log(BeautifyLogger, "Performing switch nodes matching\n");
   RootNode = matchSwitch(CombedAST, RootNode);
   Dumper.log("after-switch-match");
 
   // Perform the `SwitchBreak` simplification
+  Span.restart("simplifySwitchBreak");
   revng_log(BeautifyLogger, "Performing SwitchBreak simplification");
   RootNode = simplifySwitchBreak(CombedAST);
   Dumper.log("After-switchbreak-simplify");
 
   // Perform the dispatcher `switch` inlining
+  Span.restart("inlineDispatcherSwitch");
   revng_log(BeautifyLogger, "Performing dispatcher switch inlining\n");
   RootNode = inlineDispatcherSwitch(CombedAST);
   Dumper.log("after-dispatcher-switch-inlining");
+  if (IsExhausted())
+    return false;
+
+  // The fallthrough analysis is run by multiple passes, share the results on
+  // the `CodeNode`s among them
+  CodeFallThroughCache FallThroughCache;
 
   // Perform the dead code simplification.
   // We invoke this pass here because the dispatcher case inlining may have
   // moved around some non local control flow statements like `return`, in such
   // a way that a dead code simplification step is needed.
+  Span.restart("removeDeadCode");
   revng_log(BeautifyLogger, "Performing dead code simplification\n");
-  RootNode = removeDeadCode(Model, CombedAST);
+  RootNode = removeDeadCode(Model, CombedAST, FallThroughCache);
   Dumper.log("after-dead-code-simplify");
 
   // Perform the simplification of `switch` with two entries in a `if`
+  Span.restart("simplifyDualSwitch");
   revng_log(BeautifyLogger, "Performing the dual switch simplification\n");
   RootNode = simplifyDualSwitch(CombedAST, RootNode);
   Dumper.log("after-dual-switch-simplify");
 
   // Remove empty sequences.
+  Span.restart("simplifyAtomicSequence");
   revng_log(BeautifyLogger, "Removing empty sequence nodes\n");
   RootNode = simplifyAtomicSequence(CombedAST, RootNode);
   Dumper.log("after-empty-sequences-removal");
 
   // Match dowhile.
+  Span.restart("matchDoWhile");
   revng_log(BeautifyLogger, "Matching do-while\n");
   matchDoWhile(RootNode, CombedAST);
   Dumper.log("after-match-do-while");
 
   // Match while.
+  Span.restart("matchWhile");
   revng_log(BeautifyLogger, "Matching while\n");
   matchWhile(RootNode, CombedAST);
   Dumper.log("after-match-while");
 
   // Remove unnecessary scopes under the fallthrough analysis.
+  Span.restart("promoteNoFallthroughIf");
   revng_log(BeautifyLogger, "Analyzing fallthrough scopes\n");
-  RootNode = promoteNoFallthroughIf(Model, RootNode, CombedAST);
+  RootNode = promoteNoFallthroughIf(Model,
+                                    RootNode,
+                                    CombedAST,
+                                    FallThroughCache);
   Dumper.log("after-fallthrough-scope-analysis");
 
   // Flip IFs with empty then branches.
   // We need to do it here again, after the promotion due to the `nofallthroguh`
   // analysis run before.
+  Span.restart("flipEmptyThen");
   revng_log(BeautifyLogger,
             "Performing IFs with empty then branches flipping\n");
   flipEmptyThen(CombedAST, RootNode);
   Dumper.log("after-if-flip");
 
   // Run the `promoteCallNoReturn` analysis.
+  Span.restart("promoteCallNoReturn");
   revng_log(BeautifyLogger, "Perform the CallNoReturn promotion\n");
-  RootNode = promoteCallNoReturn(Model, CombedAST, RootNode);
+  RootNode = promoteCallNoReturn(Model, CombedAST, RootNode, FallThroughCache);
   Dumper.log("after-callnoreturn-promotion");
+  if (IsExhausted())
+    return false;
 
   // Perform the double `not` simplification (`not` on the GHAST and `not` in
   // the IR).
+  Span.restart("simplifyHybridNot");
   revng_log(BeautifyLogger, "Performing the double not simplification\n");
   RootNode = simplifyHybridNot(CombedAST, RootNode);
   Dumper.log("after-double-not-simplify");
@@ -1080,30 +1123,39 @@ void beautifyAST(const model::Binary &Model, Function &F, ASTTree &CombedAST) {
   // Perform the `CompareNode` simplification. A `CompareNode` preceded by a
   // `not` is transformed in the `CompareNode` itself with the flipped
   // comparison predicate
+  Span.restart("simplifyCompareNode");
   revng_log(BeautifyLogger, "Performing the compare node simplification\n");
   simplifyCompareNode(CombedAST, RootNode);
   Dumper.log("after-compare-node-simplify");
 
   // Remove useless continues.
+  Span.restart("simplifyImplicitContinue");
   revng_log(BeautifyLogger, "Removing useless continue nodes\n");
   simplifyImplicitContinue(CombedAST);
   Dumper.log("after-continue-removal");
 
   // Perform the simplification of the implicit `return`, i.e., a `return` of
   // type `void`, which lies on a path followed by no other statements.
+  Span.restart("simplifyImplicitReturn");
   revng_log(BeautifyLogger, "Performing the implicit return simplification\n");
   simplifyImplicitReturn(CombedAST, RootNode);
   Dumper.log("after-implicit-return-simplify");
 
   // Fix loop breaks from within switches
+  Span.restart("SwitchBreaksFixer");
   revng_log(BeautifyLogger, "Fixing loop breaks inside switches\n");
   SwitchBreaksFixer().run(RootNode, CombedAST);
   Dumper.log("after-fix-switch-breaks");
 
-  // Serialize the collected metrics in the statistics file if necessary
-  if (StatsFileStream) {
-    *StatsFileStream << "function,short-circuit,trivial-short-circuit\n"
-                     << F.getName().data() << "," << ShortCircuitCounter << ","
-                     << TrivialShortCircuitCounter << "\n";
+  // Serialize the collected metrics in the metrics stream, if necessary
+  if (isRestructureMetricsEnabled()) {
+    emitRestructureMetrics(F.getName(),
+                           "beautify",
+                           json::Object{
+                             { "short_circuits", ShortCircuitCounter },
+                             { "trivial_short_circuits",
+                               TrivialShortCircuitCounter } });
   }
+
+  return true;
 }
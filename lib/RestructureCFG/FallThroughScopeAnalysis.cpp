@@ -57,10 +57,78 @@ static FallThroughScopeType combineTypes(FallThroughScopeType First,
   return FallThroughScopeType::MixedNoFallThrough;
 }
 
+/// Compute the `FallThroughScopeType` of the code in \a BB
+static FallThroughScopeType
+codeFallThroughScope(const model::Binary &Model, llvm::BasicBlock &BB) {
+  llvm::Instruction &I = BB.back();
+
+  if (auto *ReturnI = llvm::dyn_cast<ReturnInst>(&I)) {
+
+    // A return instruction make the current scope `NonLocalCF`
+    return FallThroughScopeType::Return;
+  } else if (auto *UnreachableI = llvm::dyn_cast<UnreachableInst>(&I)) {
+
+    // In place of an `UnreachableInst`, we should check if we have a call to
+    // a `noreturn` function as previous instruction We may not have a
+    // previous instruction
+    // TODO: confirm the assumption that the call to a `NoReturn` is always
+    //       exactly before an `UnreachableInst`, and in case relax this
+    //       assumption
+    if (Instruction *PrevI = UnreachableI->getPrevNode()) {
+
+      if (const CallInst *Call = getCallToTagged(PrevI,
+                                                 FunctionTags::Isolated)) {
+
+        // The called function may be an isolated function. In this case we
+        // use the `llvmToModelFunction` helper in order to retrieve the
+        // corresponding `model::Function` to check for the `NoReturn`
+        // attribute.
+        const Function *CalleeFunction = Call->getCalledFunction();
+        const model::Function
+          *CalleeFunctionModel = llvmToModelFunction(Model, *CalleeFunction);
+        if (isNoReturn(*CalleeFunctionModel)) {
+          return FallThroughScopeType::CallNoReturn;
+        }
+      } else if (const CallInst
+                   *Call = getCallToTagged(PrevI,
+                                           FunctionTags::DynamicFunction)) {
+
+        // The called function may be a dynamic function. In this case, we use
+        // the name of the dyamic symbol in order to retrieve the
+        // `model::DynamicFunction` and check for the `NoReturn` attribute.
+        const Function *CalleeFunction = Call->getCalledFunction();
+        llvm::StringRef SymbolName = CalleeFunction->getName()
+                                       .drop_front(strlen("dynamic_"));
+        const model::DynamicFunction
+          &CalleeFunctionModel = getDynamicFunction(Model, SymbolName);
+        if (isNoReturn(CalleeFunctionModel)) {
+          return FallThroughScopeType::CallNoReturn;
+        }
+      }
+    }
+  }
+
+  return FallThroughScopeType::FallThrough;
+}
+
+/// Compute the `FallThroughScopeType` of \a Node, recording the one of each of
+/// its descendants in \a ResultMap, if not null.
+///
+/// If \a RemoveDeadCode is set, all the nodes following a nofallthrough node
+/// in a `SequenceNode` are removed on the way back from the recursion, so that
+/// the dead code removal doesn't need a visit of its own. The results always
+/// refer to the AST as it was before the removal.
 static RecursiveCoroutine<FallThroughScopeType>
 fallThroughScopeImpl(const model::Binary &Model,
                      ASTNode *Node,
-                     FallThroughScopeTypeMap &ResultMap) {
+                     FallThroughScopeTypeMap *ResultMap,
+                     CodeFallThroughCache &CodeCache,
+                     bool RemoveDeadCode) {
+  auto Record = [ResultMap](const ASTNode *N, FallThroughScopeType Type) {
+    if (ResultMap != nullptr)
+      (*ResultMap)[N] = Type;
+  };
+
   switch (Node->getKind()) {
   case ASTNode::NK_List: {
     SequenceNode *Seq = llvm::cast<SequenceNode>(Node);
@@ -71,16 +139,32 @@ fallThroughScopeImpl(const model::Binary &Model,
     // routine on all the nodes in the sequence, since in part of the sub-tree
     // other portions of the AST benefiting from this analysis and
     // transformation could exist.
-    for (ASTNode *N : Seq->nodes()) {
-      FallThroughScopeType NFallThrough = rc_recur
-        fallThroughScopeImpl(Model, N, ResultMap);
-      ResultMap[N] = NFallThrough;
+    FallThroughScopeType LastFallThrough = FallThroughScopeType::FallThrough;
+    bool IsDead = false;
+    for (ASTNode *&N : Seq->nodes()) {
+      LastFallThrough = rc_recur fallThroughScopeImpl(Model,
+                                                      N,
+                                                      ResultMap,
+                                                      CodeCache,
+                                                      RemoveDeadCode);
+      Record(N, LastFallThrough);
+
+      if (RemoveDeadCode and IsDead)
+        N = nullptr;
+      else if (not fallsThrough(LastFallThrough))
+        IsDead = true;
+    }
+
+    if (RemoveDeadCode) {
+      Seq->removeNode(nullptr);
+
+      // At the very least, the node not performing fallthrough is kept alive
+      revng_assert(not Seq->empty());
     }
 
     // The current sequence node is nofallthrough only if the last node of the
     // sequence node is nofallthrough.
-    ASTNode *Last = Seq->getNodeN(Seq->length() - 1);
-    rc_return ResultMap.at(Last);
+    rc_return LastFallThrough;
   } break;
   case ASTNode::NK_Scs: {
     ScsNode *Loop = llvm::cast<ScsNode>(Node);
@@ -89,8 +173,8 @@ fallThroughScopeImpl(const model::Binary &Model,
     if (Loop->hasBody()) {
       ASTNode *Body = Loop->getBody();
       FallThroughScopeType BFallThrough = rc_recur
-        fallThroughScopeImpl(Model, Body, ResultMap);
-      ResultMap[Body] = BFallThrough;
+        fallThroughScopeImpl(Model, Body, ResultMap, CodeCache, RemoveDeadCode);
+      Record(Body, BFallThrough);
     }
 
     // Without a semantic analysis we cannot conclude anything about the
@@ -107,15 +191,23 @@ fallThroughScopeImpl(const model::Binary &Model,
     FallThroughScopeType ThenFallThrough = FallThroughScopeType::FallThrough;
     if (If->hasThen()) {
       ASTNode *Then = If->getThen();
-      ThenFallThrough = rc_recur fallThroughScopeImpl(Model, Then, ResultMap);
-      ResultMap[Then] = ThenFallThrough;
+      ThenFallThrough = rc_recur fallThroughScopeImpl(Model,
+                                                     Then,
+                                                     ResultMap,
+                                                     CodeCache,
+                                                     RemoveDeadCode);
+      Record(Then, ThenFallThrough);
     }
 
     FallThroughScopeType ElseFallThrough = FallThroughScopeType::FallThrough;
     if (If->hasElse()) {
       ASTNode *Else = If->getElse();
-      ElseFallThrough = rc_recur fallThroughScopeImpl(Model, Else, ResultMap);
-      ResultMap[Else] = ElseFallThrough;
+      ElseFallThrough = rc_recur fallThroughScopeImpl(Model,
+                                                     Else,
+                                                     ResultMap,
+                                                     CodeCache,
+                                                     RemoveDeadCode);
+      Record(Else, ElseFallThrough);
     }
 
     rc_return combineTypes(ThenFallThrough, ElseFallThrough);
@@ -132,8 +224,8 @@ fallThroughScopeImpl(const model::Binary &Model,
     for (auto &LabelCasePair : Switch->cases()) {
       ASTNode *Case = LabelCasePair.second;
       FallThroughScopeType CaseFallThrough = rc_recur
-        fallThroughScopeImpl(Model, Case, ResultMap);
-      ResultMap[Case] = CaseFallThrough;
+        fallThroughScopeImpl(Model, Case, ResultMap, CodeCache, RemoveDeadCode);
+      Record(Case, CaseFallThrough);
 
       // We need to special case the first iteration over the `case`s, so that
       // we initialize the `AllFallThrough` variable with the state that is
@@ -168,60 +260,18 @@ fallThroughScopeImpl(const model::Binary &Model,
   case ASTNode::NK_Code: {
     CodeNode *Code = llvm::cast<CodeNode>(Node);
     llvm::BasicBlock *BB = Code->getBB();
-    llvm::Instruction &I = BB->back();
-
-    if (auto *ReturnI = llvm::dyn_cast<ReturnInst>(&I)) {
-
-      // Save the motivation
-      ResultMap[Code] = FallThroughScopeType::Return;
-
-      // A return instruction make the current scope `NonLocalCF`
-      rc_return FallThroughScopeType::Return;
-    } else if (auto *UnreachableI = llvm::dyn_cast<UnreachableInst>(&I)) {
-
-      // In place of an `UnreachableInst`, we should check if we have a call to
-      // a `noreturn` function as previous instruction We may not have a
-      // previous instruction
-      // TODO: confirm the assumption that the call to a `NoReturn` is always
-      //       exactly before an `UnreachableInst`, and in case relax this
-      //       assumption
-      if (Instruction *PrevI = UnreachableI->getPrevNode()) {
-
-        if (const CallInst *Call = getCallToTagged(PrevI,
-                                                   FunctionTags::Isolated)) {
-
-          // The called function may be an isolated function. In this case we
-          // use the `llvmToModelFunction` helper in order to retrieve the
-          // corresponding `model::Function` to check for the `NoReturn`
-          // attribute.
-          const Function *CalleeFunction = Call->getCalledFunction();
-          const model::Function
-            *CalleeFunctionModel = llvmToModelFunction(Model, *CalleeFunction);
-          if (isNoReturn(*CalleeFunctionModel)) {
-            ResultMap[Code] = FallThroughScopeType::CallNoReturn;
-            rc_return FallThroughScopeType::CallNoReturn;
-          }
-        } else if (const CallInst
-                     *Call = getCallToTagged(PrevI,
-                                             FunctionTags::DynamicFunction)) {
-
-          // The called function may be a dynamic function. In this case, we use
-          // the name of the dyamic symbol in order to retrieve the
-          // `model::DynamicFunction` and check for the `NoReturn` attribute.
-          const Function *CalleeFunction = Call->getCalledFunction();
-          llvm::StringRef SymbolName = CalleeFunction->getName()
-                                         .drop_front(strlen("dynamic_"));
-          const model::DynamicFunction
-            &CalleeFunctionModel = getDynamicFunction(Model, SymbolName);
-          if (isNoReturn(CalleeFunctionModel)) {
-            ResultMap[Code] = FallThroughScopeType::CallNoReturn;
-            rc_return FallThroughScopeType::CallNoReturn;
-          }
-        }
-      }
+
+    auto It = CodeCache.find(BB);
+    if (It == CodeCache.end()) {
+      FallThroughScopeType BBFallThrough = codeFallThroughScope(Model, *BB);
+      It = CodeCache.insert({ BB, BBFallThrough }).first;
     }
 
-    rc_return FallThroughScopeType::FallThrough;
+    // Save the motivation
+    if (not fallsThrough(It->second))
+      Record(Code, It->second);
+
+    rc_return It->second;
   } break;
   case ASTNode::NK_Set: {
     rc_return FallThroughScopeType::FallThrough;
@@ -246,11 +296,26 @@ fallThroughScopeImpl(const model::Binary &Model,
 }
 
 FallThroughScopeTypeMap computeFallThroughScope(const model::Binary &Model,
-                                                ASTNode *RootNode) {
+                                                ASTNode *RootNode,
+                                                CodeFallThroughCache &Cache) {
   FallThroughScopeTypeMap ResultMap;
-  FallThroughScopeType Result = fallThroughScopeImpl(Model,
-                                                     RootNode,
-                                                     ResultMap);
+  FallThroughScopeType
+    Result = fallThroughScopeImpl(Model,
+                                  RootNode,
+                                  &ResultMap,
+                                  Cache,
+                                  /* RemoveDeadCode */ false);
   ResultMap[RootNode] = Result;
   return ResultMap;
 }
+
+FallThroughScopeType
+computeFallThroughScopeRemovingDeadCode(const model::Binary &Model,
+                                        ASTNode *RootNode,
+                                        CodeFallThroughCache &Cache) {
+  return fallThroughScopeImpl(Model,
+                              RootNode,
+                              /* ResultMap */ nullptr,
+                              Cache,
+                              /* RemoveDeadCode */ true);
+}
@@ -4,9 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
+
 #include "revng/Model/IRHelpers.h"
 
 // Forward declarations
+namespace llvm {
+class BasicBlock;
+} // namespace llvm
+
 class ASTNode;
 class ASTTree;
 
@@ -25,7 +31,22 @@ enum class FallThroughScopeType {
 
 using FallThroughScopeTypeMap = std::map<const ASTNode *, FallThroughScopeType>;
 
+// The beautification never changes the `BasicBlock`s of the `CodeNode`s, so the
+// `FallThroughScopeType` of each of them, which may require to look up the
+// callee in the model, can be shared among all the runs of the analysis
+using CodeFallThroughCache = llvm::DenseMap<const llvm::BasicBlock *,
+                                            FallThroughScopeType>;
+
 bool fallsThrough(FallThroughScopeType Element);
 
 extern FallThroughScopeTypeMap
-computeFallThroughScope(const model::Binary &Model, ASTNode *RootNode);
+computeFallThroughScope(const model::Binary &Model,
+                        ASTNode *RootNode,
+                        CodeFallThroughCache &Cache);
+
+/// Compute the `FallThroughScopeType` of \a RootNode and, in the same visit,
+/// remove from each `SequenceNode` all the nodes following a nofallthrough one
+extern FallThroughScopeType
+computeFallThroughScopeRemovingDeadCode(const model::Binary &Model,
+                                        ASTNode *RootNode,
+                                        CodeFallThroughCache &Cache);
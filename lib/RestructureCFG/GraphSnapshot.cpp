@@ -0,0 +1,192 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+
+#include "revng-c/RestructureCFG/GraphSnapshot.h"
+
+using namespace llvm;
+
+static cl::opt<bool> BinarySnapshots("restructure-binary-snapshots",
+                                     cl::desc("Write the restructuring debug "
+                                              "graphs as binary snapshots "
+                                              "instead of GraphViz files"),
+                                     cl::init(false),
+                                     cl::cat(MainCategory));
+
+static constexpr StringRef Magic = "RVNGSNP1";
+
+bool dumpBinarySnapshots() {
+  return BinarySnapshots;
+}
+
+void GraphSnapshot::write(raw_ostream &OS) const {
+  support::endian::Writer W(OS, support::little);
+  OS << Magic;
+  W.write<uint8_t>(static_cast<uint8_t>(Kind));
+  W.write<uint64_t>(Entry);
+  W.write<uint64_t>(Nodes.size());
+  for (const Node &N : Nodes) {
+    W.write<uint64_t>(N.ID);
+    W.write<uint8_t>(N.Kind);
+    W.write<uint32_t>(N.Name.size());
+    OS << N.Name;
+    W.write<uint32_t>(N.Edges.size());
+    for (const Edge &E : N.Edges) {
+      W.write<uint64_t>(E.Target);
+      W.write<uint8_t>(E.Label);
+    }
+  }
+}
+
+void GraphSnapshot::writeToFile(const std::string &FileName) const {
+  std::error_code EC;
+  raw_fd_ostream File(FileName, EC);
+  revng_check(not EC, "Could not open file for writing a graph snapshot");
+  write(File);
+}
+
+/// Reads little-endian values from a buffer, failing at the first read past
+/// its end
+class SnapshotReader {
+private:
+  StringRef Buffer;
+  bool Truncated = false;
+
+public:
+  SnapshotReader(StringRef Buffer) : Buffer(Buffer) {}
+
+public:
+  bool truncated() const { return Truncated; }
+
+  template<typename T>
+  T read() {
+    if (Buffer.size() < sizeof(T)) {
+      Truncated = true;
+      Buffer = {};
+      return T{};
+    }
+
+    using namespace support;
+    T Result = endian::read<T, little, unaligned>(Buffer.data());
+    Buffer = Buffer.drop_front(sizeof(T));
+    return Result;
+  }
+
+  StringRef readBytes(uint64_t Size) {
+    if (Buffer.size() < Size) {
+      Truncated = true;
+      Buffer = {};
+      return {};
+    }
+
+    StringRef Result = Buffer.take_front(Size);
+    Buffer = Buffer.drop_front(Size);
+    return Result;
+  }
+};
+
+Expected<GraphSnapshot> GraphSnapshot::read(StringRef Buffer) {
+  if (not Buffer.consume_front(Magic))
+    return createStringError(inconvertibleErrorCode(),
+                             "Not a graph snapshot");
+
+  SnapshotReader Reader(Buffer);
+  GraphSnapshot Result;
+  auto Kind = Reader.read<uint8_t>();
+  if (Kind > static_cast<uint8_t>(GraphKind::GHAST))
+    return createStringError(inconvertibleErrorCode(),
+                             "Unknown graph snapshot kind");
+  Result.Kind = static_cast<GraphKind>(Kind);
+  Result.Entry = Reader.read<uint64_t>();
+
+  // Each node takes at least 17 bytes: don't trust the count of a truncated or
+  // corrupted snapshot for reserving memory
+  auto NodeCount = Reader.read<uint64_t>();
+  Result.Nodes.reserve(std::min<uint64_t>(NodeCount, Buffer.size() / 17));
+  for (uint64_t I = 0; I < NodeCount and not Reader.truncated(); ++I) {
+    Node &N = Result.Nodes.emplace_back();
+    N.ID = Reader.read<uint64_t>();
+    N.Kind = Reader.read<uint8_t>();
+    N.Name = Reader.readBytes(Reader.read<uint32_t>()).str();
+    auto EdgeCount = Reader.read<uint32_t>();
+    for (uint32_t J = 0; J < EdgeCount and not Reader.truncated(); ++J) {
+      Edge &E = N.Edges.emplace_back();
+      E.Target = Reader.read<uint64_t>();
+      E.Label = Reader.read<uint8_t>();
+    }
+  }
+
+  if (Reader.truncated())
+    return createStringError(inconvertibleErrorCode(),
+                             "Truncated graph snapshot");
+
+  return Result;
+}
+
+Expected<GraphSnapshot> GraphSnapshot::readFromFile(StringRef FileName) {
+  auto MaybeBuffer = MemoryBuffer::getFile(FileName);
+  if (not MaybeBuffer)
+    return errorCodeToError(MaybeBuffer.getError());
+
+  return read((*MaybeBuffer)->getBuffer());
+}
+
+static StringRef getEdgeLabel(GraphSnapshot::ASTEdgeKind Kind) {
+  using ASTEdgeKind = GraphSnapshot::ASTEdgeKind;
+  switch (Kind) {
+  case ASTEdgeKind::Then:
+    return "then";
+  case ASTEdgeKind::Else:
+    return "else";
+  case ASTEdgeKind::Body:
+    return "body";
+  case ASTEdgeKind::Element:
+    return "elem";
+  case ASTEdgeKind::Case:
+    return "case";
+  case ASTEdgeKind::Default:
+    return "default";
+  case ASTEdgeKind::Successor:
+    return "successor";
+  }
+  return "unknown";
+}
+
+void GraphSnapshot::dumpDot(raw_ostream &OS) const {
+  OS << "digraph CFGFunction {\n";
+
+  for (const Node &N : Nodes) {
+    OS << "\"" << N.ID << "\" [label=\"ID: " << N.ID
+       << " Kind: " << unsigned(N.Kind) << " Name: " << N.Name << "\"";
+    if (N.ID == Entry)
+      OS << ",fillcolor=green,style=filled";
+    OS << "];\n";
+  }
+
+  for (const Node &N : Nodes) {
+    unsigned Counter = 0;
+    for (const Edge &E : N.Edges) {
+      OS << "\"" << N.ID << "\" -> \"" << E.Target << "\"";
+      if (Kind == GraphKind::RegionCFG) {
+        StringRef Color = E.Label != 0 ? "purple" : "green";
+        OS << " [color=" << Color << ", label=" << Counter << "];\n";
+      } else {
+        auto EdgeKind = static_cast<ASTEdgeKind>(E.Label);
+        OS << " [color=green,label=\"" << getEdgeLabel(EdgeKind) << "\"];\n";
+      }
+      ++Counter;
+    }
+  }
+
+  OS << "}\n";
+}
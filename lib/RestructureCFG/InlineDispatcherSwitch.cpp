@@ -9,6 +9,8 @@
 
 #include <algorithm>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SetOperations.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
@@ -98,11 +100,16 @@ countSetNodeInLoop(ASTNode *Node, SetNodeCounterMap &CounterMap) {
   rc_return;
 }
 
-static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
-                                                        ASTNode *Node,
-                                                        ASTNode *InlinedBody,
-                                                        ASTNode *InlinedSet,
-                                                        bool RemoveSetNode) {
+// This map associates each `SetNode` to the body that has to be inlined in
+// place of it, so that all the cases of a dispatcher can be inlined in a single
+// visit of the loop body
+using InliningMap = llvm::DenseMap<const ASTNode *, ASTNode *>;
+
+static RecursiveCoroutine<ASTNode *>
+addToDispatcherSet(ASTTree &AST,
+                   ASTNode *Node,
+                   const InliningMap &Inlinings,
+                   bool RemoveSetNode) {
   switch (Node->getKind()) {
   case ASTNode::NK_List: {
     SequenceNode *Seq = llvm::cast<SequenceNode>(Node);
@@ -112,8 +119,7 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
     for (ASTNode *&N : Seq->nodes()) {
       N = rc_recur addToDispatcherSet(AST,
                                       N,
-                                      InlinedBody,
-                                      InlinedSet,
+                                      Inlinings,
                                       RemoveSetNode);
     }
 
@@ -133,8 +139,7 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
       ASTNode *Then = If->getThen();
       ASTNode *NewThen = rc_recur addToDispatcherSet(AST,
                                                      Then,
-                                                     InlinedBody,
-                                                     InlinedSet,
+                                                     Inlinings,
                                                      RemoveSetNode);
       If->setThen(NewThen);
     }
@@ -142,8 +147,7 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
       ASTNode *Else = If->getElse();
       ASTNode *NewElse = rc_recur addToDispatcherSet(AST,
                                                      Else,
-                                                     InlinedBody,
-                                                     InlinedSet,
+                                                     Inlinings,
                                                      RemoveSetNode);
       If->setElse(NewElse);
     }
@@ -158,8 +162,7 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
       auto &LabelCasePair = Group.value();
       LabelCasePair.second = rc_recur addToDispatcherSet(AST,
                                                          LabelCasePair.second,
-                                                         InlinedBody,
-                                                         InlinedSet,
+                                                         Inlinings,
                                                          RemoveSetNode);
 
       if (LabelCasePair.second == nullptr) {
@@ -177,8 +180,10 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
   case ASTNode::NK_Set: {
     auto *Set = llvm::cast<SetNode>(Node);
 
-    // We have reached the `SetNode` marked for the inlining
-    if (Set == InlinedSet) {
+    // We have reached a `SetNode` marked for the inlining
+    auto It = Inlinings.find(Set);
+    if (It != Inlinings.end()) {
+      ASTNode *InlinedBody = It->second;
 
       // The `SwitchBreakNode` should not reach this point, but handled in the
       // previous branch
@@ -221,13 +226,18 @@ static RecursiveCoroutine<ASTNode *> addToDispatcherSet(ASTTree &AST,
   rc_return Node;
 }
 
-/// Wrapper helper used to remove a specific `SetNode` from the body of a loop,
+/// Wrapper helper used to remove some `SetNode`s from the body of a loop,
 /// reusing the code of the `addToDispatcherSet` helper
-static void removeDispatcherSet(ASTTree &AST, ASTNode *Node, ASTNode *Set) {
+static void removeDispatcherSets(ASTTree &AST,
+                                 ASTNode *Node,
+                                 llvm::ArrayRef<ASTNode *> Sets) {
 
   // We perform the `SetNode` by instructing `addToDispatcherSet` to inline a
   // `nullptr`, and to remove the original `SetNode`
-  addToDispatcherSet(AST, Node, nullptr, Set, true);
+  InliningMap Removals;
+  for (ASTNode *Set : Sets)
+    Removals[Set] = nullptr;
+  addToDispatcherSet(AST, Node, Removals, true);
 }
 
 static bool isDispatcherIf(ASTNode *If) {
@@ -697,6 +707,7 @@ inlineDispatcherSwitchImpl(ASTTree &AST,
       //    the cases of the switch, we can additionally remove entirely the
       //    dispatcher switch.
       std::set<size_t> ToRemoveCaseIndex;
+      InliningMap Inlinings;
       for (auto &Group : llvm::enumerate(Switch->cases())) {
         unsigned Index = Group.index();
         auto &[LabelSet, Case] = Group.value();
@@ -730,16 +741,20 @@ inlineDispatcherSwitchImpl(ASTTree &AST,
             // `continue` statements. If that was the case, we would be moving
             // such statements from an external loop to a more nested one,
             // breaking the semantics.
-            addToDispatcherSet(AST,
-                               RelatedLoop->getBody(),
-                               Case,
-                               *Sets.begin(),
-                               RemoveSetNode);
+            Inlinings[*Sets.begin()] = Case;
             ToRemoveCaseIndex.insert(Index);
           }
         }
       }
 
+      // Each case is inlined in place of a different `SetNode`, therefore we
+      // can inline all of them in a single visit of the loop body
+      if (not Inlinings.empty())
+        addToDispatcherSet(AST,
+                           RelatedLoop->getBody(),
+                           Inlinings,
+                           RemoveSetNode);
+
       // We remove the cases from the last to the first (we avoid invalidating
       // the elements in the underlying `llvm::SmallVector`)
       for (auto ToRemoveCase : llvm::reverse(ToRemoveCaseIndex)) {
@@ -914,12 +929,13 @@ simplifySwitchBreakImpl(ASTTree &AST,
         countSetNodeInLoop(RelatedLoop->getBody(), SetCounterMap);
 
         // Remove the `SetNode`s associated to the removed `Label`s
+        llvm::SmallVector<ASTNode *> ToRemoveSets;
         for (auto &Label : RemovedLabels) {
           auto &Sets = SetCounterMap.at(Label);
-          for (auto *Set : Sets) {
-            removeDispatcherSet(AST, RelatedLoop->getBody(), Set);
-          }
+          ToRemoveSets.append(Sets.begin(), Sets.end());
         }
+        if (not ToRemoveSets.empty())
+          removeDispatcherSets(AST, RelatedLoop->getBody(), ToRemoveSets);
       }
     }
 
@@ -178,11 +178,12 @@ promoteCallNoReturnImpl(ASTTree &AST,
 
 ASTNode *promoteCallNoReturn(const model::Binary &Model,
                              ASTTree &AST,
-                             ASTNode *RootNode) {
+                             ASTNode *RootNode,
+                             CodeFallThroughCache &Cache) {
 
   // Perform the computation of fallthrough scopes type
   FallThroughScopeTypeMap
-    FallThroughScopeMap = computeFallThroughScope(Model, RootNode);
+    FallThroughScopeMap = computeFallThroughScope(Model, RootNode, Cache);
 
   // Run the `PromoteCallNoReturn` transformation
   RootNode = promoteCallNoReturnImpl(AST, RootNode, FallThroughScopeMap);
@@ -12,4 +12,5 @@ class ASTTree;
 
 extern ASTNode *promoteCallNoReturn(const model::Binary &Model,
                                     ASTTree &AST,
-                                    ASTNode *RootNode);
+                                    ASTNode *RootNode,
+                                    CodeFallThroughCache &Cache);
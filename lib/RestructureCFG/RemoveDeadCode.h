@@ -10,4 +10,6 @@
 class ASTNode;
 class ASTTree;
 
-extern ASTNode *removeDeadCode(const model::Binary &Model, ASTTree &AST);
+extern ASTNode *removeDeadCode(const model::Binary &Model,
+                               ASTTree &AST,
+                               CodeFallThroughCache &Cache);
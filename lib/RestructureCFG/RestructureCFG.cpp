@@ -2,12 +2,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <functional>
 #include <iterator>
 #include <limits>
+#include <queue>
 #include <sstream>
 #include <utility>
 
 #include "llvm/ADT/BreadthFirstIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
@@ -17,6 +20,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/Support/CommandLine.h"
@@ -31,7 +35,9 @@
 #include "revng-c/RestructureCFG/MetaRegionBB.h"
 #include "revng-c/RestructureCFG/RegionCFGTreeBB.h"
 #include "revng-c/RestructureCFG/RestructureCFG.h"
+#include "revng-c/RestructureCFG/RestructureMetrics.h"
 #include "revng-c/RestructureCFG/Utils.h"
+#include "revng-c/Support/TraceSpan.h"
 
 using namespace llvm;
 using namespace llvm::cl;
@@ -63,11 +69,13 @@ static bool mergeSCSStep(MetaRegionBBVect &MetaRegions) {
     for (auto RegionIt2 = std::next(RegionIt1); RegionIt2 != MetaRegions.end();
          RegionIt2++) {
       bool Intersects = (*RegionIt1).intersectsWith(*RegionIt2);
+      if (not Intersects)
+        continue;
+
       bool IsIncluded = (*RegionIt1).isSubSet(*RegionIt2);
       bool IsIncludedReverse = (*RegionIt2).isSubSet(*RegionIt1);
       bool AreEquivalent = (*RegionIt1).nodesEquality(*RegionIt2);
-      if (Intersects
-          and (((!IsIncluded) and (!IsIncludedReverse)) or AreEquivalent)) {
+      if (((!IsIncluded) and (!IsIncludedReverse)) or AreEquivalent) {
         (*RegionIt1).mergeWith(*RegionIt2);
         MetaRegions.erase(RegionIt2);
         return true;
@@ -223,30 +231,32 @@ static void computeParents(MetaRegionBBVect &MetaRegions) {
 
 static MetaRegionBBPtrVect applyPartialOrder(MetaRegionBBVect &V) {
   MetaRegionBBPtrVect OrderedVector;
-  std::set<MetaRegionBB *> Processed;
-
-  while (V.size() != Processed.size()) {
-    for (auto RegionIt1 = V.begin(); RegionIt1 != V.end(); RegionIt1++) {
-      if (!Processed.contains(&*RegionIt1)) {
-        bool FoundParent = false;
-        for (auto RegionIt2 = V.begin(); RegionIt2 != V.end(); RegionIt2++) {
-          if ((RegionIt1 != RegionIt2) and !Processed.contains(&*RegionIt2)) {
-            if ((*RegionIt1).getParent() == &*RegionIt2) {
-              FoundParent = true;
-              break;
-            }
-          }
-        }
 
-        if (FoundParent == false) {
-          OrderedVector.push_back(&*RegionIt1);
-          Processed.insert(&*RegionIt1);
-          break;
-        }
-      }
-    }
+  // A metaregion can be emitted as soon as its parent has been emitted. Among
+  // the ones that can be emitted, we always pick the first one in V.
+  llvm::DenseMap<MetaRegionBB *, size_t> Indices;
+  for (size_t I = 0; I < V.size(); ++I)
+    Indices[&V[I]] = I;
+
+  std::vector<std::vector<size_t>> Children(V.size());
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> Ready;
+  for (size_t I = 0; I < V.size(); ++I) {
+    auto It = Indices.find(V[I].getParent());
+    if (It == Indices.end() or It->second == I)
+      Ready.push(I);
+    else
+      Children[It->second].push_back(I);
   }
 
+  while (not Ready.empty()) {
+    size_t Index = Ready.top();
+    Ready.pop();
+    OrderedVector.push_back(&V[Index]);
+    for (size_t Child : Children[Index])
+      Ready.push(Child);
+  }
+  revng_assert(OrderedVector.size() == V.size());
+
   std::reverse(OrderedVector.begin(), OrderedVector.end());
   return OrderedVector;
 }
@@ -322,10 +332,14 @@ createMetaRegions(const llvm::SmallDenseSet<EdgeDescriptor> &Backedges) {
   return MetaRegions;
 }
 
-static cl::opt<std::string> MetricsOutputPath("restructure-metrics-output-dir",
-                                              desc("Restructure metrics dir"),
-                                              value_desc("restructure-dir"),
-                                              cat(MainCategory));
+static cl::opt<unsigned> RestructureThreads("restructure-threads",
+                                            desc("Number of threads inflating "
+                                                 "the regions of a function "
+                                                 "(0 means one per core, 1 "
+                                                 "disables parallel "
+                                                 "inflation)"),
+                                            init(1),
+                                            cat(MainCategory));
 
 static void LogMetaRegions(const MetaRegionBBPtrVect &MetaRegions,
                            const std::string &HeaderMsg) {
@@ -458,13 +472,70 @@ static MetaRegionBB *computePredecessorsParent(MetaRegionBBPtrVect &MetaRegions,
   return mostNestedRegion(PredecessorMetaRegions);
 }
 
-bool restructureCFG(Function &F, ASTTree &AST) {
+/// Run RegionCFG::weaveAndInflate on \a RootCFG and on all the regions nested
+/// in it, in parallel.
+///
+/// The regions are independent, except for the untangle weight of the nested
+/// regions, which their parent reads while untangling. In a sequential run it
+/// is computed before the nested region is inflated, so we precompute it here.
+static void inflateRegionsInParallel(RegionCFG<BasicBlock *> &RootCFG,
+                                     const RestructureBudget &Budget) {
+  std::vector<RegionCFG<BasicBlock *> *> Regions = { &RootCFG };
+  std::set<RegionCFG<BasicBlock *> *> Visited = { &RootCFG };
+  for (size_t I = 0; I < Regions.size(); ++I) {
+    for (BasicBlockNodeBB *Node : Regions[I]->nodes()) {
+      if (not Node->isCollapsed())
+        continue;
+
+      RegionCFG<BasicBlock *> *Collapsed = Node->getCollapsedCFG();
+      if (Visited.insert(Collapsed).second)
+        Regions.push_back(Collapsed);
+    }
+  }
+
+  if (Regions.size() < 2)
+    return;
+
+  for (RegionCFG<BasicBlock *> *Region : llvm::drop_begin(Regions))
+    Region->computeUntangleWeight();
+
+  unsigned NumThreads = RestructureThreads;
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  for (RegionCFG<BasicBlock *> *Region : Regions) {
+    Pool.async([Region, &Budget]() {
+      // Once the budget is exhausted, the sequential path discards everything
+      if (not Budget.isExhausted())
+        Region->weaveAndInflate(&Budget);
+    });
+  }
+  Pool.wait();
+}
+
+bool RestructureBudget::isExhausted() const {
+  if (Deadline.has_value() and Clock::now() >= *Deadline)
+    return true;
+
+  if (MaxDuplicatedWeight.has_value()
+      and DuplicatedWeightCounter > *MaxDuplicatedWeight)
+    return true;
+
+  return MaxInflatedNodes.has_value()
+         and InflatedNodesCounter > *MaxInflatedNodes;
+}
+
+bool restructureCFG(Function &F,
+                    ASTTree &AST,
+                    const RestructureBudget &Budget) {
+  TraceSpan Span("restructureCFG", "restructure", F.getName());
   revng_log(CombLogger, "restructuring Function: " << F.getName());
   revng_log(CombLogger, "Num basic blocks: " << F.size());
 
   DuplicationCounter = 0;
   UntangleTentativeCounter = 0;
   UntanglePerformedCounter = 0;
+  InflatedNodesCounter = 0;
+  DuplicatedWeightCounter = 0;
+  unsigned DispatcherCounter = 0;
 
   // Clear graph object from the previous pass.
   RegionCFG<BasicBlock *> RootCFG;
@@ -544,6 +615,7 @@ bool restructureCFG(Function &F, ASTTree &AST) {
 
   // Print metaregions after ordering.
   LogMetaRegions(OrderedMetaRegions, "Metaregions after partial ordering:");
+  size_t MetaRegionCount = OrderedMetaRegions.size();
 
   // Create a std::vector from the reverse post order. We cannot just use the
   // regular ReversePostOrderTraversal because later we'll need the removal
@@ -592,6 +664,12 @@ bool restructureCFG(Function &F, ASTTree &AST) {
   std::vector<RegionCFG<BasicBlock *>> Regions(OrderedMetaRegions.size());
 
   for (MetaRegionBB *Meta : OrderedMetaRegions) {
+    TraceSpan MetaRegionSpan("meta-region", "restructure", F.getName());
+    if (Budget.isExhausted()) {
+      revng_log(CombLogger, "Budget exhausted for " << F.getName());
+      return false;
+    }
+
     if (CombLogger.isEnabled()) {
       CombLogger << "\nAnalyzing region: " << Meta->getIndex() << "\n";
 
@@ -702,6 +780,7 @@ bool restructureCFG(Function &F, ASTTree &AST) {
     if (NewHeadNeeded) {
       // Create the dispatcher.
       Head = RootCFG.addEntryDispatcher();
+      ++DispatcherCounter;
       Meta->insertNode(Head);
 
       // For each target of the dispatcher add the edge and add it in the map.
@@ -1194,6 +1273,7 @@ bool restructureCFG(Function &F, ASTTree &AST) {
 
       // Create the dispatcher.
       ExitDispatcher = RootCFG.addExitDispatcher();
+      ++DispatcherCounter;
 
       // For each target of the dispatcher add the edge and add it in the map.
       std::map<BasicBlockNodeBB *, unsigned> SuccessorsIdxMap;
@@ -1233,7 +1313,7 @@ bool restructureCFG(Function &F, ASTTree &AST) {
     // populate it with the internal nodes.
     Regions.push_back(RegionCFG<BasicBlock *>());
     RegionCFG<BasicBlock *> &CollapsedGraph = Regions.back();
-    RegionCFG<BasicBlock *>::BBNodeMap SubstitutionMap{};
+    RegionCFG<BasicBlock *>::SubstitutionMap SubstitutionMap{};
     CollapsedGraph.setFunctionName(F.getName().str());
     CollapsedGraph.setRegionName(std::to_string(Meta->getIndex()));
     revng_assert(Head != nullptr);
@@ -1391,17 +1471,25 @@ bool restructureCFG(Function &F, ASTTree &AST) {
 
   // Collect statistics
   unsigned InitialWeight = 0;
-  if (MetricsOutputPath.getNumOccurrences()) {
-    revng_assert(MetricsOutputPath.getNumOccurrences() == 1);
+  if (isRestructureMetricsEnabled()) {
     // Compute the initial weight of the CFG.
     for (BasicBlockNodeBB *BBNode : RootCFG.nodes()) {
       InitialWeight += BBNode->getWeight();
     }
   }
 
+  // Weave and inflate all the regions in parallel, then let generateAst build
+  // the AST from them.
+  if (RestructureThreads != 1 and not CombLogger.isEnabled())
+    inflateRegionsInParallel(RootCFG, Budget);
+
   // Invoke the AST generation for the root region.
   std::map<RegionCFG<llvm::BasicBlock *> *, ASTTree> CollapsedMap;
-  generateAst(RootCFG, AST, CollapsedMap);
+  Span.restart("generateAst");
+  if (not generateAst(RootCFG, AST, CollapsedMap, Budget)) {
+    revng_log(CombLogger, "Budget exhausted for " << F.getName());
+    return false;
+  }
 
   // Scorporated this part which was previously inside the `generateAst` to
   // avoid having it run twice or more (it was run inside the recursive step
@@ -1409,8 +1497,8 @@ bool restructureCFG(Function &F, ASTTree &AST) {
   // now is directly the entire AST, since there's no flattening anymore).
   normalize(AST, F);
 
-  // Serialize the collected metrics in the outputfile.
-  if (MetricsOutputPath.getNumOccurrences()) {
+  // Serialize the collected metrics in the metrics stream.
+  if (isRestructureMetricsEnabled()) {
     // Compute the increase in weight, on the AST
     unsigned FinalWeight = 0;
     for (ASTNode *N : AST.nodes()) {
@@ -1450,17 +1538,20 @@ bool restructureCFG(Function &F, ASTTree &AST) {
 
     float Increase = float(FinalWeight) / float(InitialWeight);
 
-    std::ofstream Output;
-    const char *FunctionName = F.getName().data();
-    std::ostream &OutputStream = pathToStream(MetricsOutputPath + "/"
-                                                + FunctionName,
-                                              Output);
-    OutputStream << "function,"
-                    "duplications,percentage,tuntangle,puntangle,iweight\n";
-    OutputStream << F.getName().data() << "," << DuplicationCounter << ","
-                 << Increase << "," << UntangleTentativeCounter << ","
-                 << UntanglePerformedCounter << "," << InitialWeight << "\n";
+    emitRestructureMetrics(F.getName(),
+                           "restructure",
+                           json::Object{
+                             { "duplications", DuplicationCounter.load() },
+                             { "duplication_factor", Increase },
+                             { "untangle_tentative",
+                               UntangleTentativeCounter.load() },
+                             { "untangle_performed",
+                               UntanglePerformedCounter.load() },
+                             { "initial_weight", InitialWeight },
+                             { "final_weight", FinalWeight },
+                             { "metaregions", MetaRegionCount },
+                             { "dispatchers", DispatcherCounter } });
   }
 
-  return false;
+  return true;
 }
@@ -0,0 +1,41 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+
+#include "revng-c/RestructureCFG/RestructureMetrics.h"
+#include "revng-c/Support/MetricsOutput.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> MetricsOutputPath("restructure-metrics-output",
+                                              cl::desc("Path of a file where "
+                                                       "the restructuring "
+                                                       "metrics of each "
+                                                       "function are appended, "
+                                                       "one JSON object per "
+                                                       "line"),
+                                              cl::value_desc("path"),
+                                              cl::cat(MainCategory));
+
+static MetricsOutput Metrics(MetricsOutputPath, sys::fs::OF_Append);
+
+bool isRestructureMetricsEnabled() {
+  return Metrics.isEnabled();
+}
+
+void emitRestructureMetrics(StringRef FunctionName,
+                            StringRef Phase,
+                            json::Object &&Record) {
+  revng_assert(isRestructureMetricsEnabled());
+
+  Record["function"] = FunctionName;
+  Record["phase"] = Phase;
+
+  Metrics.write(std::move(Record));
+}
@@ -0,0 +1,77 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng-c/Support/ContentAddressedStore.h"
+
+std::string ContentAddressedStore::computeKey(llvm::StringRef Inputs) {
+  return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(Inputs)),
+                     /*LowerCase=*/true);
+}
+
+std::string ContentAddressedStore::getPath(llvm::StringRef Key) const {
+  llvm::SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Key + Extension);
+  return Path.str().str();
+}
+
+std::optional<std::string>
+ContentAddressedStore::lookup(llvm::StringRef Key) const {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(getPath(Key));
+  if (not MaybeBuffer)
+    return std::nullopt;
+
+  revng_log(Log, "Hit for " << Key);
+  return (*MaybeBuffer)->getBuffer().str();
+}
+
+void ContentAddressedStore::store(llvm::StringRef Key,
+                                  llvm::StringRef Content) const {
+  if (std::error_code EC = llvm::sys::fs::create_directories(Directory)) {
+    revng_log(Log, "Cannot create " << Directory << ": " << EC.message());
+    return;
+  }
+
+  // Write to a temporary file first, so that concurrent readers never observe
+  // a partially written entry.
+  int FD = -1;
+  llvm::SmallString<128> TemporaryPath;
+  llvm::SmallString<128> TemporaryPattern(Directory);
+  llvm::sys::path::append(TemporaryPattern, Key + "-%%%%%%.tmp");
+  using llvm::sys::fs::createUniqueFile;
+  if (std::error_code EC = createUniqueFile(TemporaryPattern,
+                                            FD,
+                                            TemporaryPath)) {
+    revng_log(Log, "Cannot create " << TemporaryPath << ": " << EC.message());
+    return;
+  }
+
+  {
+    llvm::raw_fd_ostream Stream(FD, /*shouldClose=*/true);
+    Stream << Content;
+    Stream.close();
+
+    // Clear the error, otherwise the destructor reports a fatal one
+    if (Stream.has_error()) {
+      revng_log(Log,
+                "Cannot write " << TemporaryPath << ": "
+                                << Stream.error().message());
+      Stream.clear_error();
+      llvm::sys::fs::remove(TemporaryPath);
+      return;
+    }
+  }
+
+  if (std::error_code EC = llvm::sys::fs::rename(TemporaryPath, getPath(Key))) {
+    revng_log(Log, "Cannot store " << Key << ": " << EC.message());
+    llvm::sys::fs::remove(TemporaryPath);
+  }
+}
@@ -0,0 +1,75 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+
+#include "revng/Support/CommandLine.h"
+
+#include "revng-c/Support/MemoryMetrics.h"
+#include "revng-c/Support/MetricsOutput.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> MetricsOutputPath("memory-metrics-output",
+                                              cl::desc("Path of a file where "
+                                                       "the memory usage of "
+                                                       "each pipe and "
+                                                       "analysis is appended, "
+                                                       "one JSON object per "
+                                                       "line"),
+                                              cl::value_desc("path"),
+                                              cl::cat(MainCategory));
+
+static MetricsOutput Metrics(MetricsOutputPath, sys::fs::OF_Append);
+
+bool isMemoryMetricsEnabled() {
+  return Metrics.isEnabled();
+}
+
+MemoryMetrics::MemoryMetrics(StringRef Name, StringRef FunctionName) :
+  Enabled(isMemoryMetricsEnabled()) {
+  if (not Enabled)
+    return;
+
+  this->Name = Name.str();
+  this->FunctionName = FunctionName.str();
+  InitialMallocUsage = sys::Process::GetMallocUsage();
+  PeakMallocUsage = InitialMallocUsage;
+}
+
+void MemoryMetrics::sample() {
+  if (Enabled)
+    PeakMallocUsage = std::max(PeakMallocUsage, sys::Process::GetMallocUsage());
+}
+
+void MemoryMetrics::recordSize(StringRef What, uint64_t Size) {
+  if (not Enabled)
+    return;
+
+  Sizes[What] = Size;
+  sample();
+}
+
+MemoryMetrics::~MemoryMetrics() {
+  if (not Enabled)
+    return;
+
+  sample();
+
+  json::Object Record{ { "name", Name },
+                       { "malloc_initial", uint64_t(InitialMallocUsage) },
+                       { "malloc_final",
+                         uint64_t(sys::Process::GetMallocUsage()) },
+                       { "malloc_peak", uint64_t(PeakMallocUsage) },
+                       { "peak_rss_kib", getPeakRSSKiB() },
+                       { "sizes", std::move(Sizes) } };
+  if (not FunctionName.empty())
+    Record["function"] = FunctionName;
+
+  Metrics.write(std::move(Record));
+}
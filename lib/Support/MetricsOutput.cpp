@@ -0,0 +1,33 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <sys/resource.h>
+
+#include "revng/Support/Assert.h"
+
+#include "revng-c/Support/MetricsOutput.h"
+
+using namespace llvm;
+
+uint64_t getPeakRSSKiB() {
+  struct rusage Usage;
+  revng_check(getrusage(RUSAGE_SELF, &Usage) == 0);
+  return Usage.ru_maxrss;
+}
+
+void MetricsOutput::write(json::Value &&Record) {
+  revng_assert(isEnabled());
+
+  std::lock_guard Lock(Mutex);
+  if (not Stream) {
+    std::error_code Error;
+    Stream = std::make_unique<raw_fd_ostream>(Path, Error, Flags);
+    if (Error)
+      revng_abort(Error.message().c_str());
+    *Stream << Prologue;
+  }
+
+  *Stream << Record << Terminator;
+  Stream->flush();
+}
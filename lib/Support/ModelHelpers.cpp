@@ -45,33 +45,46 @@ using model::TypedefType;
 
 constexpr const size_t ModelGEPBaseArgIndex = 1;
 
-static RecursiveCoroutine<model::QualifiedType>
-peelConstAndTypedefsImpl(const model::QualifiedType &QT) {
-  // First look for non-const qualifiers
-  const auto &NonConst = std::not_fn(model::Qualifier::isConst);
-  auto QIt = llvm::find_if(QT.Qualifiers(), NonConst);
-  auto QEnd = QT.Qualifiers().end();
+model::QualifiedType peelConstAndTypedefs(const model::QualifiedType &QT) {
+  const model::QualifiedType *Current = &QT;
+  while (true) {
+    // First look for non-const qualifiers
+    const auto &NonConst = std::not_fn(model::Qualifier::isConst);
+    auto QIt = llvm::find_if(Current->Qualifiers(), NonConst);
+    auto QEnd = Current->Qualifiers().end();
 
-  // If we find a non-const qualifier we're done unwrapping
-  if (QIt != QEnd)
-    rc_return model::QualifiedType(QT.UnqualifiedType(), { QIt, QEnd });
+    // If we find a non-const qualifier we're done unwrapping
+    if (QIt != QEnd)
+      return model::QualifiedType(Current->UnqualifiedType(), { QIt, QEnd });
 
-  // Here we have only const qualifiers
+    // Here we have only const qualifiers
 
-  auto *TD = dyn_cast<TypedefType>(QT.UnqualifiedType().getConst());
+    auto *TD = dyn_cast<TypedefType>(Current->UnqualifiedType().getConst());
 
-  // If it's not a typedef, we're done. Just throw away the remaining const
-  // qualifiers.
-  if (not TD)
-    rc_return model::QualifiedType(QT.UnqualifiedType(), {});
+    // If it's not a typedef, we're done. Just throw away the remaining const
+    // qualifiers.
+    if (not TD)
+      return model::QualifiedType(Current->UnqualifiedType(), {});
 
-  // If it's a typedef, unwrap it and recur.
-  // Also in this case we can ignore
-  rc_return rc_recur peelConstAndTypedefsImpl(TD->UnderlyingType());
+    // If it's a typedef, unwrap it and go on, ignoring the const qualifiers.
+    Current = &TD->UnderlyingType();
+  }
 }
 
-model::QualifiedType peelConstAndTypedefs(const model::QualifiedType &QT) {
-  return peelConstAndTypedefsImpl(QT);
+model::QualifiedType
+PeelConstAndTypedefsCache::peel(const model::QualifiedType &QT) {
+  // Peeling stops at the first non-const qualifier, so the typedef chain is
+  // walked only if there are none.
+  auto *TD = dyn_cast<TypedefType>(QT.UnqualifiedType().getConst());
+  if (not TD or not llvm::all_of(QT.Qualifiers(), model::Qualifier::isConst))
+    return peelConstAndTypedefs(QT);
+
+  auto It = Peeled.find(TD);
+  if (It == Peeled.end())
+    It = Peeled.try_emplace(TD, peelConstAndTypedefs(TD->UnderlyingType()))
+           .first;
+
+  return It->second;
 }
 
 static RecursiveCoroutine<model::QualifiedType>
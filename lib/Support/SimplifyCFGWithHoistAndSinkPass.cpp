@@ -2,11 +2,113 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
 
 using namespace llvm;
 
+/// Name of the metadata attached to the functions this pass has simplified,
+/// holding the fingerprint of their body right after the simplification
+static const char *SimplifiedCFGHashMDName = "revng.simplified_cfg_hash";
+
+/// Fingerprint of the instructions and of the CFG of \a F.
+///
+/// It has to be the same after the module is serialized and loaded again,
+/// hence values are identified by their position in F, or by their content,
+/// and never by their address. Types and constants are identified by their
+/// textual form, which is what gets serialized. A collision only makes the
+/// pass skip a function that could have been simplified further, never
+/// produces wrong code.
+static uint64_t fingerprint(const Function &F) {
+  DenseMap<const Value *, uint64_t> Positions;
+  uint64_t NextPosition = 0;
+  for (const BasicBlock &BB : F) {
+    Positions[&BB] = NextPosition++;
+    for (const Instruction &I : BB)
+      Positions[&I] = NextPosition++;
+  }
+
+  // The same types and constants are used over and over in a function
+  DenseMap<const void *, uint64_t> Printed;
+  auto HashPrinted = [&Printed](const auto *Object) -> uint64_t {
+    auto [It, New] = Printed.try_emplace(Object, 0);
+    if (New) {
+      std::string Text;
+      raw_string_ostream Stream(Text);
+      Object->print(Stream);
+      It->second = xxHash64(Stream.str());
+    }
+    return It->second;
+  };
+
+  enum OperandKind : uint64_t {
+    LocalOperand,
+    ArgumentOperand,
+    ConstantOperand,
+    OtherOperand
+  };
+
+  SmallVector<uint64_t, 256> Words = { F.arg_size() };
+  auto PushOperand = [&](const Value *V) {
+    if (auto It = Positions.find(V); It != Positions.end()) {
+      Words.append({ LocalOperand, It->second });
+    } else if (auto *Argument = dyn_cast<llvm::Argument>(V)) {
+      Words.append({ ArgumentOperand, Argument->getArgNo() });
+    } else if (auto *GV = dyn_cast<GlobalValue>(V)) {
+      Words.append({ ConstantOperand, xxHash64(GV->getName()) });
+    } else if (auto *C = dyn_cast<Constant>(V)) {
+      Words.append({ ConstantOperand, HashPrinted(C) });
+    } else {
+      Words.append({ OtherOperand, V->getValueID() });
+    }
+  };
+
+  for (const BasicBlock &BB : F) {
+    Words.push_back(BB.size());
+    for (const Instruction &I : BB) {
+      Words.push_back(I.getOpcode());
+      Words.push_back(HashPrinted(I.getType()));
+      if (auto *Cmp = dyn_cast<CmpInst>(&I))
+        Words.push_back(Cmp->getPredicate());
+
+      Words.push_back(I.getNumOperands());
+      for (const Value *Operand : I.operand_values())
+        PushOperand(Operand);
+    }
+  }
+
+  StringRef Bytes(reinterpret_cast<const char *>(Words.data()),
+                  Words.size() * sizeof(uint64_t));
+  return xxHash64(Bytes);
+}
+
+static std::optional<uint64_t> getSimplifiedFingerprint(const Function &F) {
+  auto *Node = F.getMetadata(SimplifiedCFGHashMDName);
+  if (Node == nullptr)
+    return std::nullopt;
+
+  auto *Hash = mdconst::extract<ConstantInt>(Node->getOperand(0));
+  return Hash->getZExtValue();
+}
+
+static void setSimplifiedFingerprint(Function &F, uint64_t Fingerprint) {
+  LLVMContext &Context = F.getContext();
+  auto *Hash = ConstantInt::get(Type::getInt64Ty(Context), Fingerprint);
+  F.setMetadata(SimplifiedCFGHashMDName,
+                MDNode::get(Context, { ConstantAsMetadata::get(Hash) }));
+}
+
 class SimplifyCFGWithHoistAndSinkPass : public FunctionPass {
 public:
   static char ID;
@@ -15,6 +117,12 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override {}
 
   bool runOnFunction(Function &F) override {
+    // This pass runs several times in the pipeline: skip the functions that
+    // have not changed since the last time they have been simplified
+    uint64_t Before = fingerprint(F);
+    if (getSimplifiedFingerprint(F) == Before)
+      return false;
+
     FunctionPassManager FPM;
     FPM.addPass(SimplifyCFGPass(SimplifyCFGOptions()
                                   .convertSwitchRangeToICmp(true)
@@ -27,6 +135,8 @@ public:
     PB.registerFunctionAnalyses(FAM);
 
     FPM.run(F, FAM);
+
+    setSimplifiedFingerprint(F, fingerprint(F));
     return true;
   }
 };
@@ -35,3 +145,28 @@ char SimplifyCFGWithHoistAndSinkPass::ID;
 
 using Register = RegisterPass<SimplifyCFGWithHoistAndSinkPass>;
 static Register R("simplify-cfg-with-hoist-and-sink", "", false, false);
+
+/// Drops the fingerprints left by simplify-cfg-with-hoist-and-sink, to be run
+/// after its last run in a pipe, so that they don't end up in the output
+class StripSimplifiedCFGHashPass : public FunctionPass {
+public:
+  static char ID;
+  StripSimplifiedCFGHashPass() : FunctionPass(ID) {}
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (F.getMetadata(SimplifiedCFGHashMDName) == nullptr)
+      return false;
+
+    F.setMetadata(SimplifiedCFGHashMDName, nullptr);
+    return true;
+  }
+};
+
+char StripSimplifiedCFGHashPass::ID;
+
+using StripRegister = RegisterPass<StripSimplifiedCFGHashPass>;
+static StripRegister S("strip-simplified-cfg-hash", "", false, false);
@@ -0,0 +1,80 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
+
+#include "revng/Support/CommandLine.h"
+
+#include "revng-c/Support/MetricsOutput.h"
+#include "revng-c/Support/TraceSpan.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> TraceOutputPath("trace-output",
+                                            cl::desc("Path of a file where "
+                                                     "the duration of passes "
+                                                     "and of their phases is "
+                                                     "written, in the Chrome "
+                                                     "trace event format"),
+                                            cl::value_desc("path"),
+                                            cl::cat(MainCategory));
+
+/// The closing bracket of the array of events is never written: the format
+/// explicitly allows it, and this way the trace is valid even if the process
+/// crashes.
+static MetricsOutput Trace(TraceOutputPath, sys::fs::OF_None, "[\n", ",\n");
+
+bool isTracingEnabled() {
+  return Trace.isEnabled();
+}
+
+TraceSpan::TraceSpan(StringRef Name,
+                     StringRef Category,
+                     StringRef FunctionName) :
+  Enabled(isTracingEnabled()) {
+  if (not Enabled)
+    return;
+
+  this->Name = Name.str();
+  this->Category = Category.str();
+  this->FunctionName = FunctionName.str();
+  Start = Clock::now();
+}
+
+void TraceSpan::restart(StringRef NewName) {
+  if (not Enabled)
+    return;
+
+  emit();
+  Name = NewName.str();
+  Start = Clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+  if (Enabled)
+    emit();
+}
+
+void TraceSpan::emit() {
+  using Microseconds = std::chrono::duration<double, std::micro>;
+  Clock::time_point End = Clock::now();
+  double Timestamp = Microseconds(Start.time_since_epoch()).count();
+  double Duration = Microseconds(End - Start).count();
+
+  json::Object Event{ { "name", Name },
+                      { "cat", Category },
+                      { "ph", "X" },
+                      { "ts", Timestamp },
+                      { "dur", Duration },
+                      { "pid", int64_t(sys::Process::getProcessId()) },
+                      { "tid", int64_t(get_threadid()) } };
+  if (not FunctionName.empty())
+    Event["args"] = json::Object{ { "function", FunctionName } };
+
+  Trace.write(std::move(Event));
+}
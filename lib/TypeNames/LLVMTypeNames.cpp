@@ -2,6 +2,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+#include <iterator>
+#include <string>
+
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -31,101 +35,122 @@ namespace tokens = ptml::c::tokens;
 namespace tags = ptml::tags;
 namespace attributes = ptml::attributes;
 
-bool isScalarCType(const llvm::Type *LLVMType) {
+/// Position of the C spelling of each scalar type in ScalarCTypeNames, with
+/// pointers last, since their spelling is made of two tokens
+enum ScalarCTypeIndex : unsigned {
+  Float16,
+  Float32,
+  Float64,
+  Float96,
+  Float128,
+  Void,
+  Bool,
+  UInt8,
+  UInt16,
+  UInt32,
+  UInt64,
+  UInt128,
+  VoidPointer,
+  ScalarCTypesCount,
+  NotScalar = ScalarCTypesCount
+};
+
+static constexpr const char *const ScalarCTypeNames[] = {
+  "float16_t",
+  "float32_t",
+  "float64_t",
+  // TODO: 80-bit float have 96 bit storage, how should we call them?
+  "float96_t",
+  "float128_t",
+  "void",
+  "bool",
+  "uint8_t",
+  "uint16_t",
+  "uint32_t",
+  "uint64_t",
+  "uint128_t",
+};
+static_assert(std::size(ScalarCTypeNames) == VoidPointer);
+
+static ScalarCTypeIndex getScalarCTypeIndex(const llvm::Type *LLVMType) {
   switch (LLVMType->getTypeID()) {
   case llvm::Type::HalfTyID:
   case llvm::Type::BFloatTyID:
+    return Float16;
   case llvm::Type::FloatTyID:
+    return Float32;
   case llvm::Type::DoubleTyID:
+    return Float64;
   case llvm::Type::X86_FP80TyID:
+    return Float96;
   case llvm::Type::FP128TyID:
   case llvm::Type::PPC_FP128TyID:
+    return Float128;
   case llvm::Type::VoidTyID:
+    return Void;
   case llvm::Type::PointerTyID:
-    return true;
+    return VoidPointer;
 
   case llvm::Type::IntegerTyID: {
     auto *IntType = cast<llvm::IntegerType>(LLVMType);
     switch (IntType->getIntegerBitWidth()) {
     case 1:
+      return Bool;
     case 8:
+      return UInt8;
     case 16:
+      return UInt16;
     case 32:
+      return UInt32;
     case 64:
+      return UInt64;
     case 128:
-      return true;
+      return UInt128;
     default:
-      return false;
+      return NotScalar;
     }
   } break;
 
   default:
-    return false;
+    return NotScalar;
   }
-  return false;
+  return NotScalar;
 }
 
-std::string getScalarCType(const llvm::Type *LLVMType, const PTMLCBuilder &B) {
-  revng_assert(isScalarCType(LLVMType));
-  using Operator = PTMLCBuilder::Operator;
-  switch (LLVMType->getTypeID()) {
-  case llvm::Type::HalfTyID:
-  case llvm::Type::BFloatTyID:
-    return B.tokenTag("float16_t", ptml::c::tokens::Type).serialize();
-    break;
-  case llvm::Type::FloatTyID:
-    return B.tokenTag("float32_t", ptml::c::tokens::Type).serialize();
-    break;
-  case llvm::Type::DoubleTyID:
-    return B.tokenTag("float64_t", ptml::c::tokens::Type).serialize();
-    break;
-  case llvm::Type::X86_FP80TyID:
-    // TODO: 80-bit float have 96 bit storage, how should we call them?
-    return B.tokenTag("float96_t", ptml::c::tokens::Type).serialize();
-    break;
-  case llvm::Type::FP128TyID:
-  case llvm::Type::PPC_FP128TyID:
-    return B.tokenTag("float128_t", ptml::c::tokens::Type).serialize();
-    break;
-
-  case llvm::Type::VoidTyID: {
-    return B.tokenTag("void", ptml::c::tokens::Type).serialize();
-    break;
+bool isScalarCType(const llvm::Type *LLVMType) {
+  return getScalarCTypeIndex(LLVMType) != NotScalar;
+}
 
-  case llvm::Type::IntegerTyID: {
-    auto *IntType = cast<llvm::IntegerType>(LLVMType);
-    switch (IntType->getIntegerBitWidth()) {
-    case 1:
-      return B.tokenTag("bool", ptml::c::tokens::Type).serialize();
-    case 8:
-      return B.tokenTag("uint8_t", ptml::c::tokens::Type).serialize();
-    case 16:
-      return B.tokenTag("uint16_t", ptml::c::tokens::Type).serialize();
-      break;
-    case 32:
-      return B.tokenTag("uint32_t", ptml::c::tokens::Type).serialize();
-      break;
-    case 64:
-      return B.tokenTag("uint64_t", ptml::c::tokens::Type).serialize();
-      break;
-    case 128:
-      return B.tokenTag("uint128_t", ptml::c::tokens::Type).serialize();
-      break;
-    default:
-      revng_abort("Found an LLVM integer with a size that is not a power of "
-                  "two");
-    }
-  } break;
+using ScalarCTypes = std::array<std::string, ScalarCTypesCount>;
 
-  case llvm::Type::PointerTyID: {
-    return B.tokenTag("void", ptml::c::tokens::Type) + " "
-           + B.getOperator(Operator::PointerDereference);
-  } break;
+static ScalarCTypes makeScalarCTypes(const PTMLCBuilder &B) {
+  using Operator = PTMLCBuilder::Operator;
+  ScalarCTypes Result;
+  for (unsigned I = 0; I < VoidPointer; ++I)
+    Result[I] = B.tokenTag(ScalarCTypeNames[I], tokens::Type).serialize();
+  Result[VoidPointer] = B.tokenTag("void", tokens::Type) + " "
+                        + B.getOperator(Operator::PointerDereference);
+  return Result;
+}
 
-  default:
-    revng_abort("Cannot convert this type directly to a C type.");
-  }
+/// The spellings only depend on whether \a B emits tags, hence they are
+/// computed once for each of its two modes
+static const ScalarCTypes &getScalarCTypes(const PTMLCBuilder &B) {
+  if (B.isGenerateTagLessPTML()) {
+    static const ScalarCTypes TagLess = makeScalarCTypes(PTMLCBuilder(true));
+    return TagLess;
   }
+
+  static const ScalarCTypes WithTags = makeScalarCTypes(PTMLCBuilder(false));
+  return WithTags;
+}
+
+const std::string &getScalarCType(const llvm::Type *LLVMType,
+                                  const PTMLCBuilder &B) {
+  ScalarCTypeIndex Index = getScalarCTypeIndex(LLVMType);
+  revng_assert(Index != NotScalar,
+               "Cannot convert this type directly to a C type.");
+  return getScalarCTypes(B)[Index];
 }
 
 static std::string getHelperFunctionIdentifier(const llvm::Function *F) {
@@ -2,7 +2,14 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -36,14 +43,70 @@ using TypeSet = std::set<const model::Type *>;
 using TypeToNumOfRefsMap = std::unordered_map<const model::Type *, unsigned>;
 using GraphInfo = TypeInlineHelper::GraphInfo;
 using Node = TypeInlineHelper::Node;
-using StackTypesMap = std::unordered_map<const model::Function *,
-                                         std::set<const model::Type *>>;
+using StackTypesMap = TypeInlineHelper::StackTypesMap;
 
 TypeInlineHelper::TypeInlineHelper(const model::Binary &Model) {
   // Create graph that represents type system.
   TypeGraph = buildTypeGraph(Model);
   TypeToNumOfRefs = calculateNumOfOccurences(Model);
   TypesToInline = findTypesToInline(Model, TypeGraph);
+  StackTypesPerFunction = findStackTypesPerFunction(Model);
+}
+
+/// Everything the result of TypeInlineHelper depends upon: the identity of the
+/// types and of the functions, the kind of the types, the edges among them,
+/// and the stack frame of each function.
+static std::vector<uint64_t> getTypeInlineFingerprint(const model::Binary &M) {
+  const auto Address = [](const void *Pointer) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Pointer));
+  };
+
+  std::vector<uint64_t> Result;
+  Result.push_back(Address(&M));
+  Result.push_back(M.Types().size());
+  for (const UpcastablePointer<model::Type> &T : M.Types()) {
+    Result.push_back(Address(T.get()));
+    Result.push_back(T->ID());
+    Result.push_back(static_cast<uint64_t>(T->Kind()));
+
+    // Record the number of edges before them, to keep the encoding unambiguous
+    size_t EdgeCountIndex = Result.size();
+    Result.push_back(0);
+    for (const model::QualifiedType &QT : T->edges()) {
+      Result.push_back(Address(QT.UnqualifiedType().getConst()));
+      Result.push_back(QT.Qualifiers().size());
+      Result.push_back(QT.isPointer());
+      ++Result[EdgeCountIndex];
+    }
+  }
+
+  Result.push_back(M.Functions().size());
+  for (const model::Function &Function : M.Functions()) {
+    Result.push_back(Address(&Function));
+    if (Function.StackFrameType().empty())
+      Result.push_back(0);
+    else
+      Result.push_back(Address(Function.StackFrameType().getConst()));
+  }
+
+  return Result;
+}
+
+std::shared_ptr<const TypeInlineHelper>
+TypeInlineHelper::get(const model::Binary &Model) {
+  static std::mutex Mutex;
+  static std::vector<uint64_t> LastFingerprint;
+  static std::shared_ptr<const TypeInlineHelper> Last;
+
+  std::vector<uint64_t> Fingerprint = getTypeInlineFingerprint(Model);
+
+  std::lock_guard Lock(Mutex);
+  if (Last == nullptr or Fingerprint != LastFingerprint) {
+    Last = std::make_shared<const TypeInlineHelper>(Model);
+    LastFingerprint = std::move(Fingerprint);
+  }
+
+  return Last;
 }
 
 const GraphInfo &TypeInlineHelper::getTypeGraph() const {
@@ -56,12 +119,89 @@ const TypeToNumOfRefsMap &TypeInlineHelper::getTypeToNumOfRefs() const {
   return TypeToNumOfRefs;
 }
 
+/// Assign to each type the index of its strongly connected component in
+/// \a TypeGraph, using an iterative version of Tarjan's algorithm.
+static std::unordered_map<const model::Type *, unsigned>
+computeComponents(const GraphInfo &TypeGraph) {
+  using SuccessorIterator = decltype(std::declval<Node &>()
+                                       .successors()
+                                       .begin());
+  struct Frame {
+    Node *N;
+    SuccessorIterator Next;
+    SuccessorIterator End;
+  };
+
+  std::unordered_map<const model::Type *, unsigned> Result;
+  std::unordered_map<const Node *, unsigned> Index;
+  std::unordered_map<const Node *, unsigned> LowLink;
+  std::unordered_set<const Node *> OnStack;
+  std::vector<Node *> Stack;
+  std::vector<Frame> Frames;
+  unsigned NextIndex = 0;
+  unsigned NextComponent = 0;
+
+  const auto Visit = [&](Node *N) {
+    Index[N] = LowLink[N] = NextIndex++;
+    Stack.push_back(N);
+    OnStack.insert(N);
+    Frames.push_back({ N, N->successors().begin(), N->successors().end() });
+  };
+
+  for (const auto &[Type, Root] : TypeGraph.TypeToNode) {
+    if (Index.count(Root) != 0)
+      continue;
+
+    Visit(Root);
+    while (not Frames.empty()) {
+      Frame &Current = Frames.back();
+      if (Current.Next != Current.End) {
+        Node *Successor = *Current.Next;
+        ++Current.Next;
+
+        auto It = Index.find(Successor);
+        if (It == Index.end())
+          Visit(Successor);
+        else if (OnStack.count(Successor) != 0)
+          LowLink[Current.N] = std::min(LowLink[Current.N], It->second);
+        continue;
+      }
+
+      Node *N = Current.N;
+      Frames.pop_back();
+      if (not Frames.empty()) {
+        unsigned &ParentLowLink = LowLink[Frames.back().N];
+        ParentLowLink = std::min(ParentLowLink, LowLink[N]);
+      }
+
+      if (LowLink[N] != Index[N])
+        continue;
+
+      // N is the root of a component, pop it from the stack
+      Node *Member = nullptr;
+      do {
+        Member = Stack.back();
+        Stack.pop_back();
+        OnStack.erase(Member);
+        Result[Member->data().T] = NextComponent;
+      } while (Member != N);
+      ++NextComponent;
+    }
+  }
+
+  return Result;
+}
+
 /// Collect candidates for emitting inline types.
 TypeSet TypeInlineHelper::findTypesToInline(const model::Binary &Model,
                                             const GraphInfo &TypeGraph) {
   std::unordered_map<const model::Type *, uint64_t> Candidates;
   std::set<const model::Type *> ShouldIgnore;
 
+  // A type can reach itself through one of its fields iff they belong to the
+  // same strongly connected component.
+  auto Components = computeComponents(TypeGraph);
+
   // We may find a struct that represents stack type that is being used exactly
   // once somewhere else in Types:, but we do not want to inline it if that is
   // the case.
@@ -92,7 +232,7 @@ TypeSet TypeInlineHelper::findTypesToInline(const model::Binary &Model,
         // pointing to itself.
         if (QT.isPointer() or T.get()->key() == DependantType->key()) {
           ShouldIgnore.insert(DependantType);
-        } else if (isReachableFromRootType(T.get(), DependantType, TypeGraph)) {
+        } else if (Components.at(T.get()) == Components.at(DependantType)) {
           // Or the type could point to itself on a nested level.
           ShouldIgnore.insert(T.get());
           ShouldIgnore.insert(DependantType);
@@ -160,7 +300,7 @@ TypeInlineHelper::findStackTypesPerFunction(const model::Binary &Model) const {
 
       revng_assert(StackT->Kind() == model::TypeKind::StructType);
       Result[&Function].insert(StackT);
-      auto AllNestedTypes = getTypesToInlineInTypeTy(Model, StackT);
+      auto AllNestedTypes = getTypesToInlineInTypeTy(StackT);
       Result[&Function].merge(AllNestedTypes);
     }
   }
@@ -168,25 +308,10 @@ TypeInlineHelper::findStackTypesPerFunction(const model::Binary &Model) const {
   return Result;
 }
 
-TypeSet TypeInlineHelper::collectStackTypes(const model::Binary &Model) const {
+TypeSet TypeInlineHelper::collectStackTypes() const {
   TypeSet Result;
-  for (auto &Function : Model.Functions()) {
-    if (not Function.StackFrameType().empty()) {
-      const model::Type *StackT = Function.StackFrameType().getConst();
-      revng_assert(StackT->Kind() == model::TypeKind::StructType);
-
-      // Do not inline stack types that are being used somewhere else.
-      auto TheTypeToNumOfRefs = TypeToNumOfRefs.find(StackT);
-      if (TheTypeToNumOfRefs != TypeToNumOfRefs.end()
-          and TheTypeToNumOfRefs->second != 0)
-        continue;
-
-      revng_assert(StackT != nullptr);
-      Result.insert(StackT);
-      auto AllNestedTypes = getTypesToInlineInTypeTy(Model, StackT);
-      Result.merge(AllNestedTypes);
-    }
-  }
+  for (const auto &[Function, StackTypes] : StackTypesPerFunction)
+    Result.insert(StackTypes.begin(), StackTypes.end());
 
   return Result;
 }
@@ -674,24 +799,9 @@ bool isCandidateForInline(const model::Type *T) {
          or llvm::isa<model::EnumType>(T);
 }
 
-bool TypeInlineHelper::isReachableFromRootType(const model::Type *Type,
-                                               const model::Type *RootType,
-                                               const GraphInfo &TypeGraph) {
-  auto TheTypeToNode = TypeGraph.TypeToNode;
-
-  // Visit all the nodes reachable from RootType.
-  llvm::df_iterator_default_set<Node *> Visited;
-  for ([[maybe_unused]] Node *N :
-       depth_first_ext(TheTypeToNode.at(RootType), Visited))
-    ;
-
-  return Visited.contains(TheTypeToNode.at(Type));
-}
-
-using UPtrTy = UpcastablePointer<model::Type>;
 TypeSet TypeInlineHelper::getNestedTypesToInline(const model::Type *RootType,
-                                                 const UPtrTy &NestedTy) const {
-  model::Type *CurrentTy = NestedTy.get();
+                                                 model::Type *NestedTy) const {
+  model::Type *CurrentTy = NestedTy;
   TypeSet Result;
   do {
     Result.insert(CurrentTy);
@@ -710,25 +820,20 @@ TypeSet TypeInlineHelper::getNestedTypesToInline(const model::Type *RootType,
 }
 
 TypeSet
-TypeInlineHelper::getTypesToInlineInTypeTy(const model::Binary &Model,
-                                           const model::Type *RootType) const {
+TypeInlineHelper::getTypesToInlineInTypeTy(const model::Type *RootType) const {
   TypeSet Result;
-  auto TheTypeToNode = TypeGraph.TypeToNode;
-
-  // Visit all the nodes reachable from RootType.
-  llvm::df_iterator_default_set<Node *> Visited;
-  for ([[maybe_unused]] Node *N :
-       depth_first_ext(TheTypeToNode.at(RootType), Visited))
-    ;
-
-  for (auto &Type : Model.Types()) {
-    if (Visited.contains(TheTypeToNode.at(Type.get()))
-        and TypesToInline.contains(Type.get())
-        and TheTypeToNode.at(Type.get())->predecessorCount() == 1) {
-      auto ParentNode = TheTypeToNode.at(Type.get())->predecessors().begin();
+  const auto &TheTypeToNode = TypeGraph.TypeToNode;
+
+  // Only look at the nodes reachable from RootType, instead of going through
+  // all the types of the model for each root: this is called for each struct
+  // and union being printed.
+  for (Node *N : llvm::depth_first(TheTypeToNode.at(RootType))) {
+    model::Type *Type = N->data().T;
+    if (TypesToInline.contains(Type) and N->predecessorCount() == 1) {
+      auto ParentNode = N->predecessors().begin();
       // In the case the parent is stack type itself, just insert the type.
       if ((*ParentNode)->data().T == RootType) {
-        Result.insert(Type.get());
+        Result.insert(Type);
       } else if (TypesToInline.contains((*ParentNode)->data().T)) {
         // In the case the parent type is not the type RootType itself, make
         // sure that the parent is inlinable into the type RootType. NOTE: This
@@ -2,6 +2,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <unordered_map>
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
@@ -140,20 +143,31 @@ TypeString getNamedCInstance(const model::QualifiedType &QT,
   return getNamedCInstance(TypeName, QT.Qualifiers(), InstanceName, B);
 }
 
-TypeString getNamedCInstance(StringRef TypeName,
-                             const std::vector<model::Qualifier> &Qualifiers,
-                             StringRef InstanceName,
-                             const ptml::PTMLCBuilder &B) {
+namespace {
+
+/// The C spelling of a list of qualifiers, split around the instance name
+struct QualifiersSpelling {
+  std::string Prefix;
+  std::string Suffix;
+};
+
+} // namespace
+
+static QualifiersSpelling
+spellQualifiers(const std::vector<model::Qualifier> &Qualifiers,
+                bool HasInstanceName,
+                const ptml::PTMLCBuilder &B) {
   constexpr auto &isConst = model::Qualifier::isConst;
   constexpr auto &isPointer = model::Qualifier::isPointer;
 
   bool IsUnqualified = Qualifiers.empty();
   bool FirstQualifierIsPointer = IsUnqualified or isPointer(Qualifiers.front());
-  bool PrependWhitespaceToInstanceName = not InstanceName.empty()
+  bool PrependWhitespaceToInstanceName = HasInstanceName
                                          and (IsUnqualified
                                               or not FirstQualifierIsPointer);
 
-  TypeString Result;
+  // The instance name goes between Prefix and Suffix
+  QualifiersSpelling Result;
 
   // Here we have a bunch of pointers, const, and array qualifiers.
   // Because of arrays, we have to emit the types with C infamous clockwise
@@ -164,7 +178,7 @@ TypeString getNamedCInstance(StringRef TypeName,
   auto QEnd = Qualifiers.end();
   do {
     // Accumulate the result that are outside the array.
-    TypeString Partial;
+    std::string Partial;
 
     // Find the first qualifier that is an array.
     auto QArrayIt = std::find_if(QIt, QEnd, model::Qualifier::isArray);
@@ -207,18 +221,15 @@ TypeString getNamedCInstance(StringRef TypeName,
       }
     }
 
-    // Print the actual instance name.
-    if (QIt == Qualifiers.begin()) {
-      if (PrependWhitespaceToInstanceName)
-        Partial.append(" ");
-      Result.append(InstanceName.str());
-    }
+    // Leave room for the actual instance name.
+    if (QIt == Qualifiers.begin() and PrependWhitespaceToInstanceName)
+      Partial.append(" ");
 
     // Now we can prepend the qualifiers that are outside the array to the
     // Result string. This always work because at this point Result holds
     // whatever is left from previous iteration, so it's either empty, or it
     // starts with '(' because we're using the clockwise spiral rule.
-    Result = (Twine(Partial) + Twine(Result)).str();
+    Result.Prefix = Partial + Result.Prefix;
 
     // After this point we'll only be emitting parenthesis for the clockwise
     // spiral rule, or append square brackets at the end of Result for arrays.
@@ -242,8 +253,10 @@ TypeString getNamedCInstance(StringRef TypeName,
       // clockwise spiral rule
       auto ReverseQArrayIt = std::make_reverse_iterator(QArrayIt);
       bool LastWasPointer = QArrayIt != QIt and isPointer(*ReverseQArrayIt);
-      if (LastWasPointer)
-        Result = (Twine("(") + Twine(Result) + Twine(")")).str();
+      if (LastWasPointer) {
+        Result.Prefix = "(" + Result.Prefix;
+        Result.Suffix.append(")");
+      }
 
       const auto &ArrayOrConstRange = llvm::make_range(QArrayIt, QPointerIt);
       bool ConstQualifiedArray = llvm::any_of(ArrayOrConstRange, isConst);
@@ -263,22 +276,86 @@ TypeString getNamedCInstance(StringRef TypeName,
 
           const auto &Const = B.getKeyword(ptml::PTMLCBuilder::Keyword::Const)
                                 .serialize();
-          Result = (Twine(" ") + Twine(Const) + Twine(" ") + Twine(Result))
-                     .str();
+          Result.Prefix = (Twine(" ") + Twine(Const) + Twine(" ")
+                           + Twine(Result.Prefix))
+                            .str();
         }
       }
 
       for (const model::Qualifier &ArrayQ :
            llvm::reverse(llvm::make_filter_range(ArrayOrConstRange,
                                                  model::Qualifier::isArray)))
-        Result.append((Twine("[") + Twine(ArrayQ.Size()) + Twine("]")).str());
+        Result.Suffix.append((Twine("[") + Twine(ArrayQ.Size()) + Twine("]"))
+                               .str());
     }
 
     QIt = QPointerIt;
   } while (QIt != QEnd);
 
-  Result = (Twine(TypeName) + Twine(Result)).str();
+  return Result;
+}
+
+/// Memoized spellQualifiers: the same few lists of qualifiers are spelled
+/// over and over while printing headers and function bodies.
+static const QualifiersSpelling &
+getQualifiersSpelling(const std::vector<model::Qualifier> &Qualifiers,
+                      bool HasInstanceName,
+                      const ptml::PTMLCBuilder &B) {
+  // Each thread emitting C code gets its own cache
+  static thread_local std::unordered_map<std::string, QualifiersSpelling>
+    Cache;
+
+  std::string Key;
+  Key += B.isGenerateTagLessPTML() ? 'c' : 't';
+  Key += HasInstanceName ? 'n' : '-';
+  for (const model::Qualifier &Q : Qualifiers) {
+    switch (Q.Kind()) {
+    case model::QualifierKind::Const:
+      Key += 'c';
+      break;
+    case model::QualifierKind::Pointer:
+      Key += 'p';
+      break;
+    case model::QualifierKind::Array:
+      Key += 'a' + std::to_string(Q.Size());
+      break;
+    default:
+      revng_abort();
+    }
+  }
+
+  auto It = Cache.find(Key);
+  if (It == Cache.end()) {
+    QualifiersSpelling Spelling = spellQualifiers(Qualifiers,
+                                                  HasInstanceName,
+                                                  B);
+    It = Cache.emplace(std::move(Key), std::move(Spelling)).first;
+  }
+
+  return It->second;
+}
+
+TypeString getNamedCInstance(StringRef TypeName,
+                             const std::vector<model::Qualifier> &Qualifiers,
+                             StringRef InstanceName,
+                             const ptml::PTMLCBuilder &B) {
+  TypeString Result;
+  Result.append(TypeName.str());
+
+  // Unqualified types are by far the most common, and need no spelling
+  if (Qualifiers.empty()) {
+    if (not InstanceName.empty())
+      Result.append((Twine(" ") + InstanceName).str());
+    return Result;
+  }
 
+  bool HasInstanceName = not InstanceName.empty();
+  const QualifiersSpelling &Spelling = getQualifiersSpelling(Qualifiers,
+                                                             HasInstanceName,
+                                                             B);
+  Result.append(Spelling.Prefix);
+  Result.append(InstanceName.str());
+  Result.append(Spelling.Suffix);
   return Result;
 }
 
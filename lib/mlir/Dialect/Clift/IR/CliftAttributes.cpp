@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
 #include <set>
 
 #include "llvm/ADT/ScopeExit.h"
@@ -365,6 +366,66 @@ mlir::clift::StructType::verify(function_ref<InFlightDiagnostic()> emitError,
   return mlir::success();
 }
 
+namespace {
+
+struct ByteSize {
+  uint64_t Size = 0;
+  /// False if the size depends on a struct or a union that has not been
+  /// defined yet, and hence might still change
+  bool IsFinal = true;
+};
+
+} // namespace
+
+/// \return the size of \a Type, along with whether it is final.
+static ByteSize computeByteSize(mlir::Type Type) {
+  using namespace mlir::clift;
+  if (auto Array = Type.dyn_cast<ArrayType>()) {
+    ByteSize Result = computeByteSize(Array.getElementType());
+    Result.Size *= Array.getElementsCount();
+    return Result;
+  }
+
+  if (auto Defined = Type.dyn_cast<DefinedType>()) {
+    mlir::Attribute Definition = Defined.getElementType();
+    if (auto Struct = Definition.dyn_cast<StructType>())
+      return { Struct.getByteSize(), Struct.isDefinition() };
+
+    if (auto Union = Definition.dyn_cast<UnionType>()) {
+      // Computing the size memoizes it, if it's final
+      uint64_t Size = Union.getByteSize();
+      return { Size, Union.getImpl()->getFinalSize().has_value() };
+    }
+
+    if (auto Typedef = Definition.dyn_cast<TypedefAttr>())
+      return computeByteSize(Typedef.getUnderlyingType());
+  }
+
+  // Pointers, primitives, enums and functions don't depend on definitions
+  return { Type.cast<ValueType>().getByteSize(), true };
+}
+
+uint64_t mlir::clift::UnionType::getByteSize() {
+  if (std::optional<uint64_t> Size = getImpl()->getFinalSize())
+    return *Size;
+
+  if (not isDefinition())
+    return 0;
+
+  uint64_t Max = 0;
+  bool IsFinal = true;
+  for (auto Field : getFields()) {
+    ByteSize Size = computeByteSize(Field.getType());
+    IsFinal = IsFinal and Size.IsFinal;
+    Max = Size.Size > Max ? Size.Size : Max;
+  }
+
+  if (IsFinal)
+    getImpl()->setFinalSize(Max);
+
+  return Max;
+}
+
 mlir::LogicalResult
 mlir::clift::UnionType::verify(function_ref<InFlightDiagnostic()> EmitError,
                                uint64_t ID,
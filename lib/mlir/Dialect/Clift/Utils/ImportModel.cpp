@@ -0,0 +1,304 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+
+#include "revng-c/mlir/Dialect/Clift/IR/CliftAttributes.h"
+#include "revng-c/mlir/Dialect/Clift/IR/CliftTypes.h"
+#include "revng-c/mlir/Dialect/Clift/Utils/ImportModel.h"
+
+using namespace mlir::clift;
+
+static PrimitiveKind getPrimitiveKind(model::PrimitiveTypeKind::Values Kind) {
+  switch (Kind) {
+  case model::PrimitiveTypeKind::Void:
+    return PrimitiveKind::VoidKind;
+  case model::PrimitiveTypeKind::Generic:
+    return PrimitiveKind::GenericKind;
+  case model::PrimitiveTypeKind::PointerOrNumber:
+    return PrimitiveKind::PointerOrNumberKind;
+  case model::PrimitiveTypeKind::Number:
+    return PrimitiveKind::NumberKind;
+  case model::PrimitiveTypeKind::Unsigned:
+    return PrimitiveKind::UnsignedKind;
+  case model::PrimitiveTypeKind::Signed:
+    return PrimitiveKind::SignedKind;
+  case model::PrimitiveTypeKind::Float:
+    return PrimitiveKind::FloatKind;
+  default:
+    revng_abort("Unexpected primitive type kind");
+  }
+}
+
+/// \return true if the size of the unqualified type of \a QT is needed to
+///         build the Clift type of \a QT, i.e., if it's held by value, or in
+///         an array, rather than through a pointer.
+static bool needsSize(const model::QualifiedType &QT) {
+  // Qualifiers go from the outermost to the innermost
+  for (const model::Qualifier &Qualifier : llvm::reverse(QT.Qualifiers())) {
+    if (model::Qualifier::isPointer(Qualifier))
+      return false;
+    if (model::Qualifier::isArray(Qualifier))
+      return true;
+  }
+
+  return true;
+}
+
+namespace {
+
+/// Builds the Clift types of a set of model types. Struct and union types are
+/// only referenced by ID, so that the importer never visits their bodies.
+class TypeImporter {
+private:
+  mlir::MLIRContext &Context;
+  llvm::DenseMap<std::pair<const model::Type *, bool>, ValueType> Imported;
+
+public:
+  TypeImporter(mlir::MLIRContext &Context) : Context(Context) {}
+
+public:
+  ValueType import(const model::Type &T, bool IsConst) {
+    auto It = Imported.find({ &T, IsConst });
+    if (It != Imported.end())
+      return It->second;
+
+    ValueType Result = importImpl(T, IsConst);
+    Imported[{ &T, IsConst }] = Result;
+    return Result;
+  }
+
+  ValueType import(const model::QualifiedType &QT) {
+    const std::vector<model::Qualifier> &Qualifiers = QT.Qualifiers();
+
+    // Qualifiers go from the outermost to the innermost, and a const qualifier
+    // applies to what follows it: build the type inside out.
+    size_t Index = Qualifiers.size();
+    auto TakeConst = [&]() {
+      if (Index > 0 and model::Qualifier::isConst(Qualifiers[Index - 1])) {
+        --Index;
+        return true;
+      }
+      return false;
+    };
+
+    bool IsConst = TakeConst();
+    ValueType Result = import(*QT.UnqualifiedType().getConst(), IsConst);
+    while (Index > 0) {
+      const model::Qualifier &Qualifier = Qualifiers[--Index];
+      switch (Qualifier.Kind()) {
+      case model::QualifierKind::Pointer:
+        IsConst = TakeConst();
+        Result = PointerType::get(&Context,
+                                  Result,
+                                  Qualifier.Size(),
+                                  getBool(IsConst));
+        break;
+
+      case model::QualifierKind::Array:
+        IsConst = TakeConst();
+        Result = ArrayType::get(&Context,
+                                Result,
+                                Qualifier.Size(),
+                                getBool(IsConst));
+        break;
+
+      case model::QualifierKind::Const:
+        // A repeated const qualifier
+        break;
+
+      default:
+        revng_abort();
+      }
+    }
+
+    return Result;
+  }
+
+  llvm::SmallVector<FieldAttr, 8> importFields(const model::StructType &S) {
+    llvm::SmallVector<FieldAttr, 8> Result;
+    for (const model::StructField &Field : S.Fields()) {
+      Result.push_back(FieldAttr::get(&Context,
+                                      Field.Offset(),
+                                      import(Field.Type()),
+                                      Field.name()));
+    }
+    return Result;
+  }
+
+  llvm::SmallVector<FieldAttr, 8> importFields(const model::UnionType &U) {
+    llvm::SmallVector<FieldAttr, 8> Result;
+    for (const model::UnionField &Field : U.Fields())
+      Result.push_back(FieldAttr::get(&Context,
+                                      0,
+                                      import(Field.Type()),
+                                      Field.name()));
+    return Result;
+  }
+
+private:
+  mlir::BoolAttr getBool(bool Value) {
+    return mlir::BoolAttr::get(&Context, Value);
+  }
+
+  ValueType getDefined(TypeDefinition Definition, bool IsConst) {
+    return DefinedType::get(&Context, Definition, getBool(IsConst));
+  }
+
+  ValueType importImpl(const model::Type &T, bool IsConst) {
+    if (auto *Primitive = llvm::dyn_cast<model::PrimitiveType>(&T)) {
+      return PrimitiveType::get(&Context,
+                                getPrimitiveKind(Primitive->PrimitiveKind()),
+                                Primitive->Size(),
+                                getBool(IsConst));
+    }
+
+    if (auto *Struct = llvm::dyn_cast<model::StructType>(&T))
+      return getDefined(StructType::get(&Context, Struct->ID()), IsConst);
+
+    if (auto *Union = llvm::dyn_cast<model::UnionType>(&T))
+      return getDefined(UnionType::get(&Context, Union->ID()), IsConst);
+
+    if (auto *Enum = llvm::dyn_cast<model::EnumType>(&T)) {
+      llvm::SmallVector<EnumFieldAttr, 8> Fields;
+      for (const model::EnumEntry &Entry : Enum->Entries())
+        Fields.push_back(EnumFieldAttr::get(&Context,
+                                            Entry.Value(),
+                                            Enum->entryName(Entry)));
+      auto Definition = EnumAttr::get(&Context,
+                                      Enum->ID(),
+                                      Enum->name(),
+                                      import(Enum->UnderlyingType()),
+                                      Fields);
+      return getDefined(Definition, IsConst);
+    }
+
+    if (auto *Typedef = llvm::dyn_cast<model::TypedefType>(&T)) {
+      auto Definition = TypedefAttr::get(&Context,
+                                         Typedef->ID(),
+                                         Typedef->name(),
+                                         import(Typedef->UnderlyingType()));
+      return getDefined(Definition, IsConst);
+    }
+
+    llvm::SmallVector<FunctionArgumentAttr, 8> Arguments;
+    if (auto *CABI = llvm::dyn_cast<model::CABIFunctionType>(&T)) {
+      for (const model::Argument &Argument : CABI->Arguments())
+        Arguments.push_back(FunctionArgumentAttr::get(&Context,
+                                                      import(Argument.Type()),
+                                                      Argument.name()));
+      auto Definition = FunctionAttr::get(&Context,
+                                          CABI->ID(),
+                                          CABI->name(),
+                                          import(CABI->ReturnType()),
+                                          Arguments);
+      return getDefined(Definition, IsConst);
+    }
+
+    auto *Raw = llvm::cast<model::RawFunctionType>(&T);
+    for (const model::NamedTypedRegister &Argument : Raw->Arguments())
+      Arguments.push_back(FunctionArgumentAttr::get(&Context,
+                                                    import(Argument.Type()),
+                                                    Argument.name()));
+
+    // The stack arguments are passed as a last argument, as in C
+    if (not Raw->StackArgumentsType().empty()) {
+      const model::Type &Stack = *Raw->StackArgumentsType().getConst();
+      Arguments.push_back(FunctionArgumentAttr::get(&Context,
+                                                    import(Stack, false),
+                                                    "_stack_arguments"));
+    }
+
+    ValueType ReturnType;
+    const auto &ReturnValues = Raw->ReturnValues();
+    if (ReturnValues.empty()) {
+      ReturnType = PrimitiveType::getVoid(&Context, 0);
+    } else if (ReturnValues.size() == 1) {
+      ReturnType = import(ReturnValues.begin()->Type());
+    } else {
+      uint64_t Size = 0;
+      for (const model::NamedTypedRegister &ReturnValue : ReturnValues)
+        Size += *ReturnValue.Type().size();
+      ReturnType = PrimitiveType::get(&Context,
+                                      PrimitiveKind::GenericKind,
+                                      Size,
+                                      getBool(false));
+    }
+
+    auto Definition = FunctionAttr::get(&Context,
+                                        Raw->ID(),
+                                        Raw->name(),
+                                        ReturnType,
+                                        Arguments);
+    return getDefined(Definition, IsConst);
+  }
+};
+
+/// Sorts types so that each of them comes after the types whose size is needed
+/// to import it. Types referencing each other only through pointers can come
+/// in any order, which is what makes recursive types possible.
+struct DefinitionOrder {
+  llvm::DenseSet<const model::Type *> Visited;
+  std::vector<const model::Type *> Result;
+
+  void visit(const model::Type *T) {
+    if (not Visited.insert(T).second)
+      return;
+
+    // The model holds no type by value in itself, hence the recursion ends
+    for (const model::QualifiedType &Edge : T->edges())
+      if (needsSize(Edge))
+        visit(Edge.UnqualifiedType().getConst());
+
+    Result.push_back(T);
+  }
+};
+
+} // namespace
+
+ModelTypeMap mlir::clift::importModelTypes(MLIRContext &Context,
+                                           const model::Binary &Model) {
+  std::vector<const model::Type *> Types;
+  Types.reserve(Model.Types().size());
+  for (const UpcastablePointer<model::Type> &T : Model.Types())
+    Types.push_back(T.get());
+
+  DefinitionOrder Order;
+  for (const model::Type *T : Types)
+    Order.visit(T);
+
+  // The body of a struct or union is set before importing any type holding it
+  // by value, since the verifiers of the fields, of the arrays and of the
+  // function arguments need its size.
+  TypeImporter Importer(Context);
+  for (const model::Type *T : Order.Result) {
+    Importer.import(*T, false);
+
+    if (auto *Struct = llvm::dyn_cast<model::StructType>(T)) {
+      auto Fields = Importer.importFields(*Struct);
+      StructType::get(&Context, Struct->ID())
+        .setBody(Struct->name(), Struct->Size(), Fields);
+    } else if (auto *Union = llvm::dyn_cast<model::UnionType>(T)) {
+      auto Fields = Importer.importFields(*Union);
+      UnionType::get(&Context, Union->ID()).setBody(Union->name(), Fields);
+    }
+  }
+
+  ModelTypeMap Result;
+  Result.reserve(Types.size());
+  for (const model::Type *T : Types)
+    Result[T] = Importer.import(*T, false);
+
+  return Result;
+}
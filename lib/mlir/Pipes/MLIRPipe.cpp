@@ -2,10 +2,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 #include <string>
+#include <type_traits>
 
 #include "llvm/Transforms/Utils/Cloning.h"
-#include "llvm/Transforms/Utils/ValueMapper.h"
 
+#include "mlir/Bytecode/BytecodeWriter.h"
 #include "mlir/Dialect/DLTI/DLTI.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -36,9 +37,33 @@ using MLIRFileContainer = FileContainer<&kinds::MLIRLLVMModule,
 
 static pipeline::RegisterDefaultConstructibleContainer<MLIRFileContainer> X;
 
+// The same module, encoded as MLIR bytecode. Unlike the textual format, it's
+// cheap to parse and it lets readers load the bodies of the functions (which
+// are isolated from above) lazily, only when they need them.
+static constexpr char MLIRBytecodeModuleMime[] = "application/x-mlir-bytecode";
+static constexpr char MLIRBytecodeModuleName[] = "mlir-bytecode-module";
+static constexpr char MLIRBytecodeModuleSuffix[] = ".mlirbc";
+using MLIRBytecodeFileContainer = FileContainer<&kinds::MLIRLLVMModule,
+                                                MLIRBytecodeModuleName,
+                                                MLIRBytecodeModuleMime,
+                                                MLIRBytecodeModuleSuffix>;
+
+using BytecodeContainerFactory = pipeline::
+  RegisterDefaultConstructibleContainer<MLIRBytecodeFileContainer>;
+static BytecodeContainerFactory XBytecode;
+
+static constexpr char ImportLLVMToMLIRName[] = "import-llvm-to-mlir";
+static constexpr char ImportLLVMToMLIRBytecodeName[] = "import-llvm-to-mlir-"
+                                                       "bytecode";
+
+template<const char *PipeName, typename MLIRContainer>
 class ImportLLVMToMLIRPipe {
+private:
+  static constexpr bool
+    EmitBytecode = std::is_same_v<MLIRContainer, MLIRBytecodeFileContainer>;
+
 public:
-  static constexpr auto Name = "import-llvm-to-mlir";
+  static constexpr auto Name = PipeName;
 
   std::array<pipeline::ContractGroup, 1> getContract() const {
     using namespace pipeline;
@@ -53,7 +78,7 @@ public:
 
   void run(const pipeline::ExecutionContext &Ctx,
            pipeline::LLVMContainer &IRContainer,
-           MLIRFileContainer &DecompiledFunctionsContainer) {
+           MLIRContainer &DecompiledFunctionsContainer) {
     mlir::MLIRContext Context;
     mlir::DialectRegistry Registry;
 
@@ -66,9 +91,9 @@ public:
     Context.loadAllAvailableDialects();
 
     // Let's do the MLIR import on a cloned Module, so we can save the old one
-    // untouched.
-    llvm::ValueToValueMapTy Map;
-    auto ClonedModule = llvm::CloneModule(IRContainer.getModule(), Map);
+    // untouched: the import takes ownership of the module it translates, and
+    // the input container is preserved.
+    auto ClonedModule = llvm::CloneModule(IRContainer.getModule());
 
     // Import LLVM Dialect.
     auto ModuleOp = translateLLVMIRToModule(std::move(ClonedModule), &Context);
@@ -77,16 +102,35 @@ public:
     std::error_code EC;
     llvm::raw_fd_ostream OS(DecompiledFunctionsContainer.getOrCreatePath(), EC);
     revng_check(not EC);
-    ModuleOp->print(OS, mlir::OpPrintingFlags().enableDebugInfo());
+
+    if constexpr (EmitBytecode) {
+      revng_check(mlir::writeBytecodeToFile(*ModuleOp, OS).succeeded());
+    } else {
+      // We have just verified the module, don't let the printer do it again.
+      auto Flags = mlir::OpPrintingFlags().enableDebugInfo().assumeVerified();
+      ModuleOp->print(OS, Flags);
+    }
   }
 
   void print(const pipeline::Context &Ctx,
              llvm::raw_ostream &OS,
              llvm::ArrayRef<std::string> ContainerNames) const {
-    OS << "mlir-translate -import-llvm -mlir-print-debuginfo module.ll -o "
-          "module.mlir\n";
+    if constexpr (EmitBytecode) {
+      OS << "mlir-translate -import-llvm module.ll | mlir-opt -emit-bytecode "
+            "-o module.mlirbc\n";
+    } else {
+      OS << "mlir-translate -import-llvm -mlir-print-debuginfo module.ll -o "
+            "module.mlir\n";
+    }
   }
 };
 
-static pipeline::RegisterPipe<ImportLLVMToMLIRPipe> Y;
+using ImportLLVMToMLIRTextPipe = ImportLLVMToMLIRPipe<ImportLLVMToMLIRName,
+                                                      MLIRFileContainer>;
+static pipeline::RegisterPipe<ImportLLVMToMLIRTextPipe> Y;
+
+using ImportLLVMToMLIRBytecodePipe = ImportLLVMToMLIRPipe<
+  ImportLLVMToMLIRBytecodeName,
+  MLIRBytecodeFileContainer>;
+static pipeline::RegisterPipe<ImportLLVMToMLIRBytecodePipe> YBytecode;
 } // namespace revng::pipes
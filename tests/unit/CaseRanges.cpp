@@ -0,0 +1,58 @@
+/// \file CaseRanges.cpp
+/// Tests for the grouping of case labels into case ranges
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#define BOOST_TEST_MODULE CaseRanges
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/Support/Assert.h"
+
+#include "lib/Backend/CaseRanges.h"
+
+using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+static Ranges group(llvm::SmallVector<uint64_t, 8> Labels, unsigned BitWidth) {
+  Ranges Result;
+  for (const CaseRange &Range : groupCaseLabels(Labels, BitWidth, 3))
+    Result.emplace_back(Range.First, Range.Last);
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(ShortRunsAreNotGrouped) {
+  Ranges Expected = { { 1, 1 }, { 2, 2 }, { 7, 7 } };
+  revng_check(group({ 7, 1, 2 }, 32) == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(LongRunsAreGrouped) {
+  Ranges Expected = { { 1, 4 }, { 6, 6 }, { 10, 12 } };
+  revng_check(group({ 12, 3, 1, 10, 4, 11, 2, 6 }, 32) == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(RangesStopAtTheSignedBoundary) {
+  // 0x7d ... 0x82 goes from the positive to the negative 8-bit values
+  Ranges Expected = { { 0x7d, 0x7f }, { 0x80, 0x82 } };
+  revng_check(group({ 0x7d, 0x7e, 0x7f, 0x80, 0x81, 0x82 }, 8) == Expected);
+
+  Expected = { { 0x7fffffff, 0x7fffffff }, { 0x80000000, 0x80000002 } };
+  revng_check(group({ 0x7fffffff, 0x80000000, 0x80000001, 0x80000002 }, 32)
+              == Expected);
+
+  // The same labels are a single range in a wider condition
+  Expected = { { 0x7fffffff, 0x80000002 } };
+  revng_check(group({ 0x7fffffff, 0x80000000, 0x80000001, 0x80000002 }, 64)
+              == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(RangesStopAtTheUnsignedBoundary) {
+  const uint64_t Max = UINT64_MAX;
+  Ranges Expected = { { 0, 2 }, { Max - 2, Max } };
+  revng_check(group({ Max, 0, Max - 1, 1, Max - 2, 2 }, 64) == Expected);
+}
@@ -18,11 +18,13 @@ bool init_unit_test();
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Transforms/Passes.h"
 
+#include "revng/Model/Binary.h"
 #include "revng/UnitTestHelpers/UnitTestHelpers.h"
 
 #include "revng-c/mlir/Dialect/Clift/IR/Clift.h"
 #include "revng-c/mlir/Dialect/Clift/IR/CliftAttributes.h"
 #include "revng-c/mlir/Dialect/Clift/IR/CliftOps.h"
+#include "revng-c/mlir/Dialect/Clift/Utils/ImportModel.h"
 
 class CliftTest {
 public:
@@ -201,4 +203,88 @@ BOOST_AUTO_TEST_CASE(CanWalkPointerTypes) {
   BOOST_TEST(Count == 1);
 }
 
+BOOST_AUTO_TEST_CASE(ImportRecursiveModelStruct) {
+  TupleTree<model::Binary> Model;
+  auto Int = Model->getPrimitiveType(model::PrimitiveTypeKind::Signed, 4);
+  auto List = Model->recordNewType(model::makeType<model::StructType>());
+  auto *ListStruct = llvm::cast<model::StructType>(List.get());
+  ListStruct->Size() = 16;
+  ListStruct->Fields()[0].Type() = { Int, {} };
+  ListStruct->Fields()[8].Type() = { List,
+                                     { model::Qualifier::createPointer(8) } };
+
+  ModelTypeMap Types = importModelTypes(context, *Model);
+  BOOST_TEST(Types.size() == Model->Types().size());
+
+  auto Defined = Types.lookup(ListStruct).cast<DefinedType>();
+  auto Struct = Defined.getElementType().cast<StructType>();
+  BOOST_TEST(Struct.getId() == ListStruct->ID());
+  BOOST_TEST(Struct.getByteSize() == 16);
+  BOOST_TEST(Struct.getFields().size() == 2);
+  BOOST_TEST((Struct.getFields()[0].getType() == Types.lookup(Int.get())));
+
+  auto Next = Struct.getFields()[1].getType().cast<mlir::clift::PointerType>();
+  BOOST_TEST(Next.getPointerSize() == 8);
+  BOOST_TEST((Next.getPointeeType() == Defined));
+}
+
+BOOST_AUTO_TEST_CASE(ImportModelUnionHeldByValue) {
+  TupleTree<model::Binary> Model;
+  auto Int = Model->getPrimitiveType(model::PrimitiveTypeKind::Signed, 4);
+  auto Long = Model->getPrimitiveType(model::PrimitiveTypeKind::Signed, 8);
+
+  auto Union = Model->recordNewType(model::makeType<model::UnionType>());
+  auto *ModelUnion = llvm::cast<model::UnionType>(Union.get());
+  ModelUnion->Fields()[0].Type() = { Int, {} };
+  ModelUnion->Fields()[1].Type() = { Long, {} };
+
+  auto Outer = Model->recordNewType(model::makeType<model::StructType>());
+  auto *OuterStruct = llvm::cast<model::StructType>(Outer.get());
+  OuterStruct->Size() = 16;
+  OuterStruct->Fields()[0].Type() = { Int, {} };
+  OuterStruct->Fields()[8].Type() = { Union, {} };
+
+  ModelTypeMap Types = importModelTypes(context, *Model);
+  BOOST_TEST(Types.size() == Model->Types().size());
+
+  auto Defined = Types.lookup(OuterStruct).cast<DefinedType>();
+  auto Struct = Defined.getElementType().cast<StructType>();
+  BOOST_TEST(Struct.getByteSize() == 16);
+  BOOST_TEST(Struct.getFields().size() == 2);
+
+  auto Held = Struct.getFields()[1].getType().cast<DefinedType>();
+  BOOST_TEST((Held == Types.lookup(ModelUnion)));
+  BOOST_TEST(Held.getByteSize() == 8);
+}
+
+BOOST_AUTO_TEST_CASE(ImportModelArrayOfStructs) {
+  TupleTree<model::Binary> Model;
+  auto Long = Model->getPrimitiveType(model::PrimitiveTypeKind::Signed, 8);
+
+  auto Element = Model->recordNewType(model::makeType<model::StructType>());
+  auto *ElementStruct = llvm::cast<model::StructType>(Element.get());
+  ElementStruct->Size() = 16;
+  ElementStruct->Fields()[0].Type() = { Long, {} };
+  ElementStruct->Fields()[8].Type() = { Long, {} };
+
+  auto Outer = Model->recordNewType(model::makeType<model::StructType>());
+  auto *OuterStruct = llvm::cast<model::StructType>(Outer.get());
+  OuterStruct->Size() = 64;
+  OuterStruct->Fields()[0].Type() = { Element,
+                                      { model::Qualifier::createArray(4) } };
+
+  ModelTypeMap Types = importModelTypes(context, *Model);
+  BOOST_TEST(Types.size() == Model->Types().size());
+
+  auto Defined = Types.lookup(OuterStruct).cast<DefinedType>();
+  auto Struct = Defined.getElementType().cast<StructType>();
+  BOOST_TEST(Struct.getByteSize() == 64);
+  BOOST_TEST(Struct.getFields().size() == 1);
+
+  auto Array = Struct.getFields()[0].getType().cast<ArrayType>();
+  BOOST_TEST(Array.getElementsCount() == 4);
+  BOOST_TEST((Array.getElementType() == Types.lookup(ElementStruct)));
+  BOOST_TEST(Array.getByteSize() == 64);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
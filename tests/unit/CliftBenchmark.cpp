@@ -0,0 +1,168 @@
+/// \file CliftBenchmark.cpp
+/// Benchmark of the uniquing of recursive Clift types
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/MLIRContext.h"
+
+#include "revng/Support/Assert.h"
+
+#include "revng-c/mlir/Dialect/Clift/IR/Clift.h"
+#include "revng-c/mlir/Dialect/Clift/IR/CliftAttributes.h"
+#include "revng-c/mlir/Dialect/Clift/IR/CliftTypes.h"
+#include "revng-c/Support/MetricsOutput.h"
+
+using namespace llvm::cl;
+
+static OptionCategory BenchmarkCategory("Clift benchmark options");
+
+static opt<unsigned> Types("types",
+                           desc("Number of struct and union types to create"),
+                           init(200000),
+                           cat(BenchmarkCategory));
+
+static opt<unsigned> Fields("fields",
+                            desc("Number of fields of each type"),
+                            init(8),
+                            cat(BenchmarkCategory));
+
+static opt<unsigned> PointerPercent("pointer-percent",
+                                    desc("Percentage of fields pointing to a "
+                                         "random type, possibly forming "
+                                         "cycles"),
+                                    init(30),
+                                    cat(BenchmarkCategory));
+
+static opt<unsigned> UnionPercent("union-percent",
+                                  desc("Percentage of unions among the types"),
+                                  init(10),
+                                  cat(BenchmarkCategory));
+
+static opt<unsigned> Seed("seed",
+                          desc("Seed of the synthetic types generator"),
+                          init(0),
+                          cat(BenchmarkCategory));
+
+static opt<bool> DisableThreading("disable-threading",
+                                  desc("Disable multithreading in the MLIR "
+                                       "context, and the locking of the "
+                                       "storage uniquer"),
+                                  init(false),
+                                  cat(BenchmarkCategory));
+
+static constexpr uint64_t PointerSize = 8;
+static constexpr uint64_t FieldSize = 8;
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point Start) {
+  std::chrono::duration<double, std::milli> Elapsed = Clock::now() - Start;
+  return Elapsed.count();
+}
+
+static void printResult(llvm::StringRef Phase, double Milliseconds) {
+  llvm::outs() << Phase << "," << llvm::format("%.3f", Milliseconds) << ","
+               << getPeakRSSKiB() << "\n";
+}
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &BenchmarkCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Measures the time and the memory spent creating "
+                          "and uniquing recursive Clift struct and union "
+                          "types, the way an import of a large model does.\n");
+
+  using namespace mlir::clift;
+
+  mlir::MLIRContext Context;
+  if (DisableThreading)
+    Context.disableMultithreading();
+  Context.getOrLoadDialect<CliftDialect>();
+
+  std::mt19937_64 Generator(Seed);
+  auto Percent = [&Generator](unsigned P) { return Generator() % 100 < P; };
+  std::vector<bool> IsUnion(Types);
+  for (unsigned I = 0; I < Types; ++I)
+    IsUnion[I] = Percent(UnionPercent);
+
+  auto False = mlir::BoolAttr::get(&Context, false);
+  auto Field = PrimitiveType::get(&Context,
+                                  PrimitiveKind::GenericKind,
+                                  FieldSize,
+                                  False);
+
+  // peak_rss_kib is the peak of the whole process so far
+  llvm::outs() << "phase,ms,peak_rss_kib\n";
+
+  // Declare all the types first, so that fields can point to any of them
+  auto Start = Clock::now();
+  std::vector<DefinedType> Declarations;
+  Declarations.reserve(Types);
+  for (unsigned I = 0; I < Types; ++I) {
+    TypeDefinition Definition;
+    if (IsUnion[I])
+      Definition = UnionType::get(&Context, I);
+    else
+      Definition = StructType::get(&Context, I);
+    Declarations.push_back(DefinedType::get(&Context, Definition, False));
+  }
+  printResult("declare", millisecondsSince(Start));
+
+  Start = Clock::now();
+  llvm::SmallVector<FieldAttr, 16> Body;
+  std::string Name;
+  for (unsigned I = 0; I < Types; ++I) {
+    Body.clear();
+    for (unsigned F = 0; F < Fields; ++F) {
+      mlir::Type Type = Field;
+      if (Percent(PointerPercent)) {
+        DefinedType Pointee = Declarations[Generator() % Types];
+        Type = PointerType::get(&Context, Pointee, PointerSize, False);
+      }
+
+      uint64_t Offset = IsUnion[I] ? 0 : F * FieldSize;
+      Body.push_back(FieldAttr::get(&Context,
+                                    Offset,
+                                    Type,
+                                    "field_" + std::to_string(F)));
+    }
+
+    Name = "type_" + std::to_string(I);
+    if (IsUnion[I])
+      UnionType::get(&Context, I).setBody(Name, Body);
+    else
+      StructType::get(&Context, I).setBody(Name, Fields * FieldSize, Body);
+  }
+  printResult("define", millisecondsSince(Start));
+
+  // Look up all the types again, as any user of the types does
+  Start = Clock::now();
+  uint64_t Checksum = 0;
+  for (unsigned I = 0; I < Types; ++I) {
+    if (IsUnion[I])
+      Checksum += UnionType::get(&Context, I).getFields().size();
+    else
+      Checksum += StructType::get(&Context, I).getFields().size();
+  }
+  printResult("lookup", millisecondsSince(Start));
+
+  revng_check(Checksum == uint64_t(Types) * Fields);
+
+  return EXIT_SUCCESS;
+}
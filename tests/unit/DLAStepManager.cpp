@@ -93,6 +93,40 @@ public:
 
 const char StepInvalidateNoDeps::ID = 0;
 
+class CountingStep : public Step {
+  static const char ID;
+  unsigned &Runs;
+
+public:
+  static const constexpr void *getID() { return &ID; }
+
+  CountingStep(unsigned &Runs) : Step(ID), Runs(Runs) {}
+
+  virtual ~CountingStep() override = default;
+
+  virtual bool runOnTypeSystem(LayoutTypeSystem &TS) override {
+    ++Runs;
+    return false;
+  }
+};
+
+const char CountingStep::ID = 0;
+
+class ChangingStep : public Step {
+  static const char ID;
+
+public:
+  static const constexpr void *getID() { return &ID; }
+
+  ChangingStep() : Step(ID) {}
+
+  virtual ~ChangingStep() override = default;
+
+  virtual bool runOnTypeSystem(LayoutTypeSystem &TS) override { return true; }
+};
+
+const char ChangingStep::ID = 0;
+
 } // end namespace dla
 
 using namespace dla;
@@ -232,3 +266,21 @@ BOOST_AUTO_TEST_CASE(SimpleInvalidate) {
   BOOST_TEST(SM.getNumSteps() == 5);
   BOOST_TEST(SM.hasValidSchedule());
 }
+
+BOOST_AUTO_TEST_CASE(SkipRedundantRuns) {
+  StepManager SM;
+  unsigned Runs = 0;
+
+  BOOST_TEST(SM.addStep<CountingStep>(Runs));
+  BOOST_TEST(SM.addStep<StepWithNoDeps>());
+  // Nothing changed since the previous run, this is skipped
+  BOOST_TEST(SM.addStep<CountingStep>(Runs));
+  BOOST_TEST(SM.addStep<ChangingStep>());
+  // The type system changed, this runs again
+  BOOST_TEST(SM.addStep<CountingStep>(Runs));
+  BOOST_TEST(SM.hasValidSchedule());
+
+  LayoutTypeSystem TS;
+  SM.run(TS);
+  BOOST_TEST(Runs == 2);
+}
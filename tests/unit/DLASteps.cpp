@@ -5,6 +5,8 @@
 #define BOOST_TEST_MODULE DLASteps
 bool init_unit_test();
 
+#include <string>
+
 #include "boost/test/unit_test.hpp"
 
 #include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
@@ -112,6 +114,28 @@ BOOST_AUTO_TEST_CASE(CollapseEquality) {
   checkNode(TS, PtrNode, 0, InterferingChildrenInfo::Unknown, { 4 });
 }
 
+/// Test that equality loops created after a run are collapsed by the next one
+BOOST_AUTO_TEST_CASE(CollapseEqualityIncremental) {
+  dla::LayoutTypeSystem TS;
+  dla::CollapseEqualitySCC Step;
+
+  LTSN *Root = createRoot(TS);
+  addEquality(TS, Root);
+  revng_check(Step.runOnTypeSystem(TS));
+  revng_check(TS.getNumLayouts() == 1);
+
+  // Nothing changed since the previous run
+  revng_check(not Step.runOnTypeSystem(TS));
+
+  LTSN *Survivor = *TS.getLayoutsRange().begin();
+  addEquality(TS, Survivor);
+  LTSN *Other = createRoot(TS);
+  addEquality(TS, Other);
+  revng_check(Step.runOnTypeSystem(TS));
+  revng_check(TS.getNumLayouts() == 2);
+  revng_check(TS.verifyNoEquality());
+}
+
 /// Test an instance-at-offset-0 loop with a pointer edge
 BOOST_AUTO_TEST_CASE(CollapseInstanceAtOffset0SCC_instance0) {
   dla::LayoutTypeSystem TS;
@@ -807,3 +831,67 @@ BOOST_AUTO_TEST_CASE(DeduplicateFields_commonNodeAsymmetricCollapse) {
   checkNode(TS, NodeC, 10, AllChildrenAreNonInterfering, { 3 });
   checkNode(TS, NodeA1, 8, AllChildrenAreNonInterfering, { 4, 5, 6, 7 });
 }
+
+static std::string takeSnapshot(const LayoutTypeSystem &TS) {
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  TS.writeSnapshot(OS);
+  OS.flush();
+  return Buffer;
+}
+
+/// Test that a snapshot loads back to the same graph, on which steps behave
+/// the same as on the original one
+BOOST_AUTO_TEST_CASE(SnapshotRoundTrip) {
+  dla::LayoutTypeSystem TS;
+
+  // Build TS, with an equality cycle, a strided instance and a pointer
+  LTSN *Root = createRoot(TS);
+  LTSN *Node1 = addEquality(TS, Root);
+  LTSN *Node2 = addEquality(TS, Node1);
+  TS.addEqualityLink(Node2, Root);
+
+  LTSN *Child = createRoot(TS, 8U);
+  OffsetExpression StridedOE;
+  StridedOE.Offset = 8U;
+  StridedOE.Strides = { 8U };
+  StridedOE.TripCounts = { std::nullopt };
+  TS.addInstanceLink(Node1, Child, std::move(StridedOE));
+  addInstanceAtOffset(TS, Node2, /*offset=*/0, /*size=*/8);
+
+  LTSN *Root2 = createRoot(TS);
+  LTSN *PtrNode = addInstanceAtOffset(TS, Root2, /*offset=*/0, /*size=*/8);
+  TS.addPointerLink(PtrNode, Root);
+
+  // Leave some holes in the IDs and some equivalence classes
+  {
+    dla::StepManager SM;
+    revng_check(SM.addStep<CollapseEqualitySCC>());
+    SM.run(TS);
+  }
+
+  const std::string Snapshot = takeSnapshot(TS);
+
+  dla::LayoutTypeSystem Loaded;
+  revng_check(Loaded.readSnapshot(Snapshot));
+  revng_check(Loaded.getNumLayouts() == TS.getNumLayouts());
+  revng_check(Loaded.countEdges() == TS.countEdges());
+  revng_check(takeSnapshot(Loaded) == Snapshot);
+
+  // Replay the same steps on both
+  for (LayoutTypeSystem *T : { &TS, &Loaded }) {
+    dla::StepManager SM;
+    revng_check(SM.addStep<CollapseInstanceAtOffset0SCC>());
+    revng_check(SM.addStep<PruneLayoutNodesWithoutLayout>());
+    revng_check(SM.addStep<ComputeUpperMemberAccesses>());
+    SM.run(*T);
+  }
+  revng_check(takeSnapshot(Loaded) == takeSnapshot(TS));
+
+  // Truncated or corrupted snapshots are rejected
+  dla::LayoutTypeSystem Truncated;
+  revng_check(not Truncated.readSnapshot(Snapshot.substr(0,
+                                                         Snapshot.size() - 1)));
+  dla::LayoutTypeSystem Corrupted;
+  revng_check(not Corrupted.readSnapshot("DLATS\x7f"));
+}
@@ -0,0 +1,135 @@
+/// \file DecompilationCache.cpp
+/// Tests for DecompilationCache
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <set>
+#include <string>
+
+#define BOOST_TEST_MODULE DecompilationCache
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/MetaAddress.h"
+
+#include "lib/Backend/DecompilationCache.h"
+
+using namespace llvm;
+
+/// The function whose key is computed, alone in its module
+static const char *Alone = R"LLVM(
+declare void @helper()
+
+define void @local_function(i32 %Argument) #0 !revng.function.entry !0 {
+  %Sum = add i32 %Argument, 1, !revng.tags !1
+  call void @helper() #1
+  ret void
+}
+
+attributes #0 = { noinline }
+attributes #1 = { nounwind }
+
+!0 = !{!"0x1000:Code_x86_64"}
+!1 = !{!"tag", !2}
+!2 = !{!"nested"}
+)LLVM";
+
+/// The same function, preceded by an unrelated function and global, which take
+/// the first metadata slots and attribute groups
+static const char *Crowded = R"LLVM(
+@unrelated_global = global i32 0, !unrelated !5
+
+define void @local_unrelated() #2 !revng.function.entry !3 {
+  ret void, !unrelated !4
+}
+
+declare void @helper()
+
+define void @local_function(i32 %Argument) #0 !revng.function.entry !0 {
+  %Sum = add i32 %Argument, 1, !revng.tags !1
+  call void @helper() #1
+  ret void
+}
+
+attributes #2 = { cold }
+attributes #0 = { noinline }
+attributes #1 = { nounwind }
+
+!named = !{!4, !5}
+
+!3 = !{!"0x2000:Code_x86_64"}
+!4 = !{!"unrelated"}
+!5 = !{!"unrelated global"}
+!0 = !{!"0x1000:Code_x86_64"}
+!1 = !{!"tag", !2}
+!2 = !{!"nested"}
+)LLVM";
+
+/// The same function, whose attached metadata has a different content
+static const char *Changed = R"LLVM(
+declare void @helper()
+
+define void @local_function(i32 %Argument) #0 !revng.function.entry !0 {
+  %Sum = add i32 %Argument, 1, !revng.tags !1
+  call void @helper() #1
+  ret void
+}
+
+attributes #0 = { noinline }
+attributes #1 = { nounwind }
+
+!0 = !{!"0x1000:Code_x86_64"}
+!1 = !{!"tag", !2}
+!2 = !{!"changed"}
+)LLVM";
+
+struct Fixture {
+  TupleTree<model::Binary> Model;
+
+  Fixture() {
+    Model->Architecture() = model::Architecture::x86_64;
+
+    auto Prototype = model::makeType<model::CABIFunctionType>();
+    auto *CABI = llvm::cast<model::CABIFunctionType>(Prototype.get());
+    CABI->ABI() = model::ABI::SystemV_x86_64;
+    auto PrototypePath = Model->recordNewType(std::move(Prototype));
+
+    for (const char *Entry : { "0x1000:Code_x86_64", "0x2000:Code_x86_64" }) {
+      auto &Function = Model->Functions()[MetaAddress::fromString(Entry)];
+      Function.Prototype() = PrototypePath;
+    }
+  }
+
+  std::string computeKey(const char *IR) {
+    LLVMContext Context;
+    SMDiagnostic Error;
+    std::unique_ptr<Module> M = parseAssemblyString(IR, Error, Context);
+    revng_check(M != nullptr);
+
+    FunctionMetadataCache Cache;
+    DecompilationCache OutputCache(*Model, "", 0, false, "");
+    const Function *F = M->getFunction("local_function");
+    return OutputCache.computeKey(Cache, *F, {});
+  }
+};
+
+BOOST_AUTO_TEST_CASE(KeyDoesNotDependOnTheRestOfTheModule) {
+  Fixture Test;
+  revng_check(Test.computeKey(Alone) == Test.computeKey(Crowded));
+}
+
+BOOST_AUTO_TEST_CASE(KeyDependsOnTheAttachedMetadata) {
+  Fixture Test;
+  revng_check(Test.computeKey(Alone) != Test.computeKey(Changed));
+}
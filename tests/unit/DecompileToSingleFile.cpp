@@ -0,0 +1,117 @@
+/// \file DecompileToSingleFile.cpp
+/// Tests for the partition of the decompiled functions in shards
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE DecompileToSingleFile
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/MetaAddress.h"
+
+#include "revng-c/Backend/DecompileToSingleFile.h"
+
+using revng::pipes::DecompileName;
+using revng::pipes::DecompileStringMap;
+using Shards = std::vector<std::vector<MetaAddress>>;
+
+static MetaAddress entry(unsigned Index) {
+  return MetaAddress::fromPC(llvm::Triple::x86_64, 0x1000 + 0x100 * Index);
+}
+
+/// Add a function for each size, at increasing addresses
+static void addFunctions(DecompileStringMap &Functions,
+                         const std::vector<size_t> &Sizes) {
+  for (size_t I = 0; I < Sizes.size(); ++I)
+    Functions.insert_or_assign(entry(I), std::string(Sizes[I], 'x'));
+}
+
+static size_t totalSize(const DecompileStringMap &Functions,
+                        const std::vector<MetaAddress> &Shard) {
+  size_t Result = 0;
+  for (const MetaAddress &Entry : Shard)
+    Result += Functions.find(Entry)->second.size();
+  return Result;
+}
+
+/// Check that each function is in exactly one shard, and that each shard is
+/// sorted and not empty
+static void checkPartition(const DecompileStringMap &Functions,
+                           const Shards &Result) {
+  std::map<MetaAddress, unsigned> Occurrences;
+  for (const std::vector<MetaAddress> &Shard : Result) {
+    revng_check(not Shard.empty());
+    revng_check(llvm::is_sorted(Shard));
+    for (const MetaAddress &Entry : Shard)
+      ++Occurrences[Entry];
+  }
+
+  size_t Count = 0;
+  for (const auto &[Entry, CFunction] : Functions) {
+    revng_check(Occurrences[Entry] == 1);
+    ++Count;
+  }
+  revng_check(Occurrences.size() == Count);
+}
+
+BOOST_AUTO_TEST_CASE(BalancesTheShards) {
+  DecompileStringMap Functions(DecompileName);
+  addFunctions(Functions, { 10, 100, 40, 60, 50 });
+  Shards Result = partitionCFunctions(Functions, 2);
+  revng_check(Result.size() == 2);
+  checkPartition(Functions, Result);
+
+  // From the largest function, each one goes in the smallest shard so far
+  Shards Expected = { { entry(1), entry(2) },
+                      { entry(0), entry(3), entry(4) } };
+  revng_check(Result == Expected);
+  revng_check(totalSize(Functions, Result[0]) == 140);
+  revng_check(totalSize(Functions, Result[1]) == 120);
+}
+
+BOOST_AUTO_TEST_CASE(NoMoreShardsThanFunctions) {
+  DecompileStringMap Functions(DecompileName);
+  addFunctions(Functions, { 5, 3 });
+  Shards Result = partitionCFunctions(Functions, 8);
+  revng_check(Result.size() == 2);
+  checkPartition(Functions, Result);
+
+  DecompileStringMap Empty(DecompileName);
+  revng_check(partitionCFunctions(Empty, 8).empty());
+}
+
+BOOST_AUTO_TEST_CASE(SingleShard) {
+  DecompileStringMap Functions(DecompileName);
+  addFunctions(Functions, { 7, 1, 7, 3 });
+  Shards Result = partitionCFunctions(Functions, 1);
+  Shards Expected = { { entry(0), entry(1), entry(2), entry(3) } };
+  revng_check(Result == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(DependsOnlyOnTheContent) {
+  // Functions of the same size are placed in the order of their addresses,
+  // whatever the order of insertion
+  std::vector<size_t> Sizes = { 8, 8, 8, 8, 8, 8, 8 };
+  DecompileStringMap Functions(DecompileName);
+  addFunctions(Functions, Sizes);
+
+  DecompileStringMap Reversed(DecompileName);
+  for (size_t I = Sizes.size(); I > 0; --I)
+    Reversed.insert_or_assign(entry(I - 1), std::string(Sizes[I - 1], 'x'));
+
+  Shards Result = partitionCFunctions(Functions, 3);
+  checkPartition(Functions, Result);
+  revng_check(Result == partitionCFunctions(Reversed, 3));
+  revng_check(Result == partitionCFunctions(Functions, 3));
+}
@@ -0,0 +1,253 @@
+/// \file FunctionDeduplicator.cpp
+/// Tests for FunctionDeduplicator
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#define BOOST_TEST_MODULE FunctionDeduplicator
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadataCache.h"
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/MetaAddress.h"
+
+#include "lib/Backend/DecompilationCache.h"
+#include "lib/Backend/FunctionDeduplicator.h"
+
+using namespace llvm;
+
+static const char *IR = R"LLVM(
+define void @local_first() !revng.function.entry !0 {
+  ret void
+}
+
+define void @local_second() !revng.function.entry !1 {
+  ret void
+}
+
+define void @local_third() !revng.function.entry !2 {
+  ret void
+}
+
+define void @local_other() !revng.function.entry !3 {
+  ret void
+}
+
+!0 = !{!"0x1000:Code_x86_64"}
+!1 = !{!"0x2000:Code_x86_64"}
+!2 = !{!"0x3000:Code_x86_64"}
+!3 = !{!"0x4000:Code_x86_64"}
+)LLVM";
+
+/// The first three functions are copies of the same function, the last one is
+/// different. The inputs of each function mention its names and its entry.
+struct Fixture {
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  model::Binary Model;
+  std::vector<const Function *> Functions;
+  std::map<const Function *, std::string> Inputs;
+
+  Fixture() {
+    SMDiagnostic Error;
+    M = parseAssemblyString(IR, Error, Context);
+    revng_check(M != nullptr);
+
+    const std::tuple<const char *, const char *, const char *> Names[] = {
+      { "0x1000:Code_x86_64", "first", "return 0" },
+      { "0x2000:Code_x86_64", "second", "return 0" },
+      { "0x3000:Code_x86_64", "third", "return 0" },
+      { "0x4000:Code_x86_64", "other", "return 1" },
+    };
+    for (const auto &[Entry, Name, Body] : Names) {
+      auto &Function = Model.Functions()[MetaAddress::fromString(Entry)];
+      Function.CustomName() = llvm::StringRef(Name);
+
+      const llvm::Function *F = M->getFunction(std::string("local_") + Name);
+      Functions.push_back(F);
+
+      Inputs[F] = std::string("calls local_") + Name + " from " + Entry
+                  + " named " + Name + ": " + Body;
+    }
+  }
+
+  FunctionDeduplicator makeDeduplicator() {
+    const auto SerializeInputs = [this](const llvm::Function &F) {
+      return Inputs.at(&F);
+    };
+    return FunctionDeduplicator(Model, Functions, SerializeInputs);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(Groups) {
+  Fixture Test;
+  FunctionDeduplicator Deduplicator = Test.makeDeduplicator();
+  const Function *First = Test.Functions[0];
+  const Function *Second = Test.Functions[1];
+  const Function *Third = Test.Functions[2];
+  const Function *Other = Test.Functions[3];
+
+  revng_check(not Deduplicator.isDuplicate(*First));
+  revng_check(Deduplicator.hasDuplicates(*First));
+  revng_check(Deduplicator.getRepresentative(*First) == nullptr);
+
+  revng_check(Deduplicator.isDuplicate(*Second));
+  revng_check(Deduplicator.getRepresentative(*Second) == First);
+  revng_check(Deduplicator.isDuplicate(*Third));
+  revng_check(Deduplicator.getRepresentative(*Third) == First);
+
+  revng_check(not Deduplicator.isDuplicate(*Other));
+  revng_check(not Deduplicator.hasDuplicates(*Other));
+}
+
+BOOST_AUTO_TEST_CASE(RewritesNameAndAddresses) {
+  Fixture Test;
+  FunctionDeduplicator Deduplicator = Test.makeDeduplicator();
+  const Function *First = Test.Functions[0];
+  const Function *Second = Test.Functions[1];
+  const Function *Third = Test.Functions[2];
+
+  Deduplicator.record(*First, "int first(void) { /* 0x1000:Code_x86_64 */ }");
+
+  auto CCode = Deduplicator.getDuplicateCCode(*Second);
+  revng_check(CCode.has_value());
+  revng_check(*CCode == "int second(void) { /* 0x2000:Code_x86_64 */ }");
+
+  CCode = Deduplicator.getDuplicateCCode(*Third);
+  revng_check(CCode.has_value());
+  revng_check(*CCode == "int third(void) { /* 0x3000:Code_x86_64 */ }");
+
+  // All the duplicates got their C code, the one of First has been dropped
+  revng_check(not Deduplicator.hasDuplicates(*First));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsAddressesAsLiterals) {
+  Fixture Test;
+  FunctionDeduplicator Deduplicator = Test.makeDeduplicator();
+  const Function *First = Test.Functions[0];
+  const Function *Second = Test.Functions[1];
+
+  Deduplicator.record(*First, "int first(void) { return 0x1000; }");
+  revng_check(not Deduplicator.getDuplicateCCode(*Second).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(SkippedDuplicatesRelease) {
+  Fixture Test;
+  FunctionDeduplicator Deduplicator = Test.makeDeduplicator();
+  const Function *First = Test.Functions[0];
+  const Function *Second = Test.Functions[1];
+  const Function *Third = Test.Functions[2];
+
+  // Second is served otherwise, e.g., from the cache: the C code of First is
+  // still needed by Third
+  Deduplicator.record(*First, "int first(void) { /* 0x1000:Code_x86_64 */ }");
+  Deduplicator.skip(*Second);
+  revng_check(Deduplicator.hasDuplicates(*First));
+  revng_check(Deduplicator.getDuplicateCCode(*Third).has_value());
+  revng_check(not Deduplicator.hasDuplicates(*First));
+
+  // If all the duplicates are skipped, the C code of First is dropped too
+  FunctionDeduplicator AllSkipped = Test.makeDeduplicator();
+  AllSkipped.record(*First, "int first(void) { /* 0x1000:Code_x86_64 */ }");
+  AllSkipped.skip(*Second);
+  AllSkipped.skip(*Third);
+  revng_check(not AllSkipped.hasDuplicates(*First));
+}
+
+static const char *CopiesIR = R"LLVM(
+define i32 @local_first(i32 %Argument) !revng.function.entry !0 {
+  %Sum = add i32 %Argument, 1
+  ret i32 %Sum
+}
+
+define i32 @local_second(i32 %Argument) !revng.function.entry !1 {
+  %Sum = add i32 %Argument, 1
+  ret i32 %Sum
+}
+
+!0 = !{!"0x1000:Code_x86_64"}
+!1 = !{!"0x2000:Code_x86_64"}
+)LLVM";
+
+/// Two copies of the same function, each with its own prototype, which are
+/// structurally equal but have distinct IDs and names, as the ones produced by
+/// the analysis of a function statically linked twice.
+struct CopiesFixture {
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  TupleTree<model::Binary> Model;
+  std::vector<const Function *> Functions;
+  std::vector<std::string> PrototypeIDs;
+
+  CopiesFixture() {
+    SMDiagnostic Error;
+    M = parseAssemblyString(CopiesIR, Error, Context);
+    revng_check(M != nullptr);
+
+    Model->Architecture() = model::Architecture::x86_64;
+    auto Int = Model->getPrimitiveType(model::PrimitiveTypeKind::Signed, 4);
+
+    const std::pair<const char *, const char *> Names[] = {
+      { "0x1000:Code_x86_64", "first" },
+      { "0x2000:Code_x86_64", "second" },
+    };
+    for (const auto &[Entry, Name] : Names) {
+      auto Prototype = model::makeType<model::CABIFunctionType>();
+      auto *CABI = llvm::cast<model::CABIFunctionType>(Prototype.get());
+      CABI->ABI() = model::ABI::SystemV_x86_64;
+      CABI->ReturnType() = { Int, {} };
+      CABI->Arguments()[0].Type() = { Int, {} };
+      PrototypeIDs.push_back(std::to_string(CABI->ID()));
+
+      auto &Function = Model->Functions()[MetaAddress::fromString(Entry)];
+      Function.CustomName() = llvm::StringRef(Name);
+      Function.Prototype() = Model->recordNewType(std::move(Prototype));
+
+      Functions.push_back(M->getFunction(std::string("local_") + Name));
+    }
+    revng_check(PrototypeIDs[0] != PrototypeIDs[1]);
+  }
+
+  FunctionDeduplicator makeDeduplicator() {
+    FunctionMetadataCache Cache;
+    DecompilationCache OutputCache(*Model, "", 0, false, "");
+    const auto SerializeInputs = [&](const llvm::Function &F) {
+      return OutputCache.serializeInputs(Cache, F, {});
+    };
+    return FunctionDeduplicator(*Model, Functions, SerializeInputs);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GroupsCopiesWithDistinctPrototypes) {
+  CopiesFixture Test;
+  FunctionDeduplicator Deduplicator = Test.makeDeduplicator();
+  const Function *First = Test.Functions[0];
+  const Function *Second = Test.Functions[1];
+
+  revng_check(Deduplicator.isDuplicate(*Second));
+  revng_check(Deduplicator.getRepresentative(*Second) == First);
+
+  // The location references to the prototype follow the function
+  Deduplicator.record(*First,
+                      "int first(int x) { /* /type/" + Test.PrototypeIDs[0]
+                        + "-CABIFunctionType */ }");
+  auto CCode = Deduplicator.getDuplicateCCode(*Second);
+  revng_check(CCode.has_value());
+  revng_check(*CCode
+              == "int second(int x) { /* /type/" + Test.PrototypeIDs[1]
+                   + "-CABIFunctionType */ }");
+}
@@ -0,0 +1,121 @@
+/// \file GraphSnapshot.cpp
+/// Tests for the binary snapshots of the restructuring graphs
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#define BOOST_TEST_MODULE GraphSnapshot
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+
+#include "revng-c/RestructureCFG/GraphSnapshot.h"
+
+using namespace llvm;
+
+using ASTEdgeKind = GraphSnapshot::ASTEdgeKind;
+
+static GraphSnapshot makeSnapshot() {
+  GraphSnapshot Result;
+  Result.Kind = GraphSnapshot::GraphKind::GHAST;
+  Result.Entry = 3;
+
+  auto AddNode = [&Result](uint64_t ID, uint8_t Kind, const char *Name) {
+    GraphSnapshot::Node &N = Result.Nodes.emplace_back();
+    N.ID = ID;
+    N.Kind = Kind;
+    N.Name = Name;
+    return &N;
+  };
+
+  GraphSnapshot::Node *Root = AddNode(3, 1, "if");
+  Root->Edges.push_back({ 7, uint8_t(ASTEdgeKind::Then) });
+  Root->Edges.push_back({ 1ULL << 40, uint8_t(ASTEdgeKind::Else) });
+  AddNode(7, 0, "then block");
+  AddNode(1ULL << 40, 0, "");
+  return Result;
+}
+
+static std::string write(const GraphSnapshot &Snapshot) {
+  std::string Result;
+  raw_string_ostream Stream(Result);
+  Snapshot.write(Stream);
+  Stream.flush();
+  return Result;
+}
+
+static bool isEqual(const GraphSnapshot &LHS, const GraphSnapshot &RHS) {
+  if (LHS.Kind != RHS.Kind or LHS.Entry != RHS.Entry
+      or LHS.Nodes.size() != RHS.Nodes.size())
+    return false;
+
+  for (size_t I = 0; I < LHS.Nodes.size(); ++I) {
+    const GraphSnapshot::Node &L = LHS.Nodes[I];
+    const GraphSnapshot::Node &R = RHS.Nodes[I];
+    if (L.ID != R.ID or L.Kind != R.Kind or L.Name != R.Name
+        or L.Edges.size() != R.Edges.size())
+      return false;
+
+    for (size_t J = 0; J < L.Edges.size(); ++J)
+      if (L.Edges[J].Target != R.Edges[J].Target
+          or L.Edges[J].Label != R.Edges[J].Label)
+        return false;
+  }
+
+  return true;
+}
+
+/// \return true if reading \a Buffer fails, consuming the error
+static bool failsToRead(StringRef Buffer) {
+  Expected<GraphSnapshot> Result = GraphSnapshot::read(Buffer);
+  if (Result)
+    return false;
+
+  consumeError(Result.takeError());
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip) {
+  GraphSnapshot Snapshot = makeSnapshot();
+  std::string Buffer = write(Snapshot);
+
+  Expected<GraphSnapshot> Read = GraphSnapshot::read(Buffer);
+  revng_check(static_cast<bool>(Read));
+  revng_check(isEqual(*Read, Snapshot));
+
+  // Writing what has been read gives back the same bytes
+  revng_check(write(*Read) == Buffer);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyGraph) {
+  GraphSnapshot Snapshot;
+  Expected<GraphSnapshot> Read = GraphSnapshot::read(write(Snapshot));
+  revng_check(static_cast<bool>(Read));
+  revng_check(isEqual(*Read, Snapshot));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsTruncatedSnapshots) {
+  std::string Buffer = write(makeSnapshot());
+  for (size_t Size = 0; Size < Buffer.size(); ++Size)
+    revng_check(failsToRead(StringRef(Buffer).take_front(Size)));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsOtherFiles) {
+  std::string Buffer = write(makeSnapshot());
+
+  std::string WrongMagic = Buffer;
+  WrongMagic[0] = 'X';
+  revng_check(failsToRead(WrongMagic));
+
+  // The kind comes right after the 8 bytes of the magic
+  std::string WrongKind = Buffer;
+  WrongKind[8] = 0x7f;
+  revng_check(failsToRead(WrongKind));
+}
@@ -0,0 +1,344 @@
+/// \file Performance.cpp
+/// Performance regression tests, comparing time and memory usage of DLA,
+/// combing and header generation against a stored baseline
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+
+#define BOOST_TEST_MODULE Performance
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+#include "revng/UnitTestHelpers/DotGraphObject.h"
+
+#include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
+#include "revng-c/HeadersGeneration/ModelToHeader.h"
+#include "revng-c/RestructureCFG/BasicBlockNode.h"
+#include "revng-c/RestructureCFG/BasicBlockNodeImpl.h"
+#include "revng-c/RestructureCFG/RegionCFGTree.h"
+#include "revng-c/RestructureCFG/RegionCFGTreeImpl.h"
+
+#include "lib/DataLayoutAnalysis/Middleend/DLAStep.h"
+
+using namespace llvm;
+
+template<>
+struct WeightTraits<DotNode *> {
+  static inline size_t getWeight(DotNode *) { return 1; }
+};
+
+/// Each workload runs this many times, and the fastest run is compared
+/// against the baseline, to filter out the noise of a busy machine
+static constexpr unsigned Repetitions = 3;
+
+/// Takes note of the highest amount of malloc'd bytes since its construction
+class MemoryProbe {
+private:
+  size_t Initial = sys::Process::GetMallocUsage();
+  size_t Peak = 0;
+
+public:
+  void sample() {
+    size_t Current = sys::Process::GetMallocUsage();
+    if (Current > Initial)
+      Peak = std::max(Peak, Current - Initial);
+  }
+
+  size_t peak() const { return Peak; }
+};
+
+/// The baseline passed on the command line, i.e., for each workload, the
+/// milliseconds it takes and the bytes it allocates.
+///
+/// Usage: test_performance -- BASELINE [--update-baseline]
+///
+/// With --update-baseline, instead of checking the measurements, they are
+/// written to BASELINE, to be committed after a change that is expected to
+/// affect performance, or to calibrate the baseline to a new machine. Without
+/// it, a workload that has no entry in BASELINE is a failure: a new workload
+/// must come with its baseline.
+class Baseline {
+private:
+  std::string Path;
+  bool Update = false;
+  json::Object Data;
+  double Tolerance = 0.0;
+
+public:
+  Baseline() {
+    auto &Suite = boost::unit_test::framework::master_test_suite();
+    revng_check(Suite.argc >= 2);
+    Path = Suite.argv[1];
+    Update = Suite.argc >= 3
+             and StringRef(Suite.argv[2]) == "--update-baseline";
+
+    auto MaybeBuffer = MemoryBuffer::getFile(Path);
+    revng_check(MaybeBuffer);
+    Expected<json::Value> Parsed = json::parse((*MaybeBuffer)->getBuffer());
+    revng_check(Parsed and Parsed->getAsObject() != nullptr);
+    Data = std::move(*Parsed->getAsObject());
+
+    // The tolerance is relative, e.g., 0.5 fails on a 50% regression
+    std::optional<double> MaybeTolerance = Data.getNumber("tolerance");
+    revng_check(MaybeTolerance);
+    Tolerance = *MaybeTolerance;
+  }
+
+  ~Baseline() {
+    if (not Update)
+      return;
+
+    std::error_code EC;
+    raw_fd_ostream Out(Path, EC);
+    revng_check(not EC);
+    Out << formatv("{0:2}", json::Value(std::move(Data))) << '\n';
+  }
+
+public:
+  void check(StringRef Name, double Milliseconds, size_t Bytes) {
+    BOOST_TEST_MESSAGE(Name.str() << ": " << Milliseconds << " ms, " << Bytes
+                                  << " bytes");
+
+    if (Update) {
+      Data[Name] = json::Object{ { "ms", Milliseconds },
+                                 { "bytes", uint64_t(Bytes) } };
+      return;
+    }
+
+    const json::Object *Expected = Data.getObject(Name);
+    if (Expected == nullptr) {
+      BOOST_ERROR("No baseline for " << Name.str()
+                                     << ": record it with the "
+                                        "update-performance-baseline target");
+      return;
+    }
+
+    double MaxMilliseconds = *Expected->getNumber("ms") * (1 + Tolerance);
+    double MaxBytes = *Expected->getNumber("bytes") * (1 + Tolerance);
+    BOOST_TEST(Milliseconds <= MaxMilliseconds,
+               Name.str() << " takes " << Milliseconds << " ms, the limit is "
+                          << MaxMilliseconds);
+    BOOST_TEST(Bytes <= MaxBytes,
+               Name.str() << " allocates " << Bytes << " bytes, the limit is "
+                          << MaxBytes);
+  }
+};
+
+static Baseline &getBaseline() {
+  static Baseline TheBaseline;
+  return TheBaseline;
+}
+
+/// Run \a Workload, which has to call MemoryProbe::sample() when its data
+/// structures are the largest, and check it against the baseline
+template<typename CallableT>
+static void measure(StringRef Name, CallableT &&Workload) {
+  using Clock = std::chrono::steady_clock;
+  double Fastest = std::numeric_limits<double>::max();
+  size_t Peak = 0;
+  for (unsigned I = 0; I < Repetitions; ++I) {
+    MemoryProbe Probe;
+    auto Start = Clock::now();
+    Workload(Probe);
+    std::chrono::duration<double, std::milli> Elapsed = Clock::now() - Start;
+    Fastest = std::min(Fastest, Elapsed.count());
+    Peak = std::max(Peak, Probe.peak());
+  }
+
+  getBaseline().check(Name, Fastest, Peak);
+}
+
+//
+// DLA
+//
+
+using LTSN = dla::LayoutTypeSystemNode;
+
+/// A type system resembling the one of a binary with \a Count functions, each
+/// accessing a struct through a cycle of equal values, with a strided
+/// array, nested structs and a pointer to the struct of the previous function
+static std::string makeTypeSystemSnapshot(unsigned Count) {
+  dla::LayoutTypeSystem TS;
+  LTSN *Previous = nullptr;
+  for (unsigned I = 0; I < Count; ++I) {
+    LTSN *Root = TS.createArtificialLayoutType();
+    LTSN *Alias1 = TS.createArtificialLayoutType();
+    LTSN *Alias2 = TS.createArtificialLayoutType();
+    TS.addEqualityLink(Root, Alias1);
+    TS.addEqualityLink(Alias1, Alias2);
+    TS.addEqualityLink(Alias2, Root);
+
+    for (unsigned Field = 0; Field < 8; ++Field) {
+      LTSN *Child = TS.createArtificialLayoutType();
+      Child->Size = 8;
+      dla::OffsetExpression OE;
+      OE.Offset = Field * 8;
+      TS.addInstanceLink(Field % 2 ? Alias1 : Root, Child, std::move(OE));
+    }
+
+    LTSN *Element = TS.createArtificialLayoutType();
+    Element->Size = 16;
+    dla::OffsetExpression Strided;
+    Strided.Offset = 64;
+    Strided.Strides = { 16 };
+    Strided.TripCounts = { 32 };
+    TS.addInstanceLink(Alias2, Element, std::move(Strided));
+
+    if (Previous != nullptr) {
+      LTSN *Pointer = TS.createArtificialLayoutType();
+      Pointer->Size = 8;
+      dla::OffsetExpression OE;
+      OE.Offset = 576;
+      TS.addInstanceLink(Root, Pointer, std::move(OE));
+      TS.addPointerLink(Pointer, Previous);
+    }
+
+    Previous = Root;
+  }
+
+  std::string Buffer;
+  raw_string_ostream OS(Buffer);
+  TS.writeSnapshot(OS);
+  OS.flush();
+  return Buffer;
+}
+
+BOOST_AUTO_TEST_CASE(DLADefaultSchedule) {
+  const std::string Snapshot = makeTypeSystemSnapshot(2000);
+  measure("dla-default-schedule", [&Snapshot](MemoryProbe &Probe) {
+    dla::LayoutTypeSystem TS;
+    revng_check(TS.readSnapshot(Snapshot));
+
+    dla::StepManager SM;
+    dla::populateDefaultSchedule(SM, /* PtrSize */ 8);
+    SM.run(TS);
+    Probe.sample();
+  });
+}
+
+//
+// Combing
+//
+
+/// A DOT graph where each of \a Size cases either goes to the next one or to
+/// the exit, which combing has to untangle with many duplications
+static std::string makeFallthroughGraph(unsigned Size) {
+  std::string Buffer = "digraph TestGraph {\n";
+  raw_string_ostream OS(Buffer);
+  for (unsigned I = 0; I < Size; ++I) {
+    OS << "entry -> case" << I << ";\n";
+    OS << "case" << I << " -> exit;\n";
+    if (I + 1 < Size)
+      OS << "case" << I << " -> case" << I + 1 << ";\n";
+  }
+  OS << "}\n";
+  OS.flush();
+  return Buffer;
+}
+
+BOOST_AUTO_TEST_CASE(CombingFallthrough) {
+  SmallString<128> Path;
+  int FD = -1;
+  revng_check(not sys::fs::createTemporaryFile("combing", "dot", FD, Path));
+  {
+    raw_fd_ostream Out(FD, /* shouldClose */ true);
+    Out << makeFallthroughGraph(48);
+  }
+
+  measure("combing-fallthrough", [&Path](MemoryProbe &Probe) {
+    DotGraph Dot;
+    Dot.parseDotFromFile(Path.str().str(), "entry");
+    RegionCFG<DotNode *> CFG;
+    CFG.initialize(&Dot);
+    CFG.inflate();
+    revng_check(CFG.isDAG());
+    Probe.sample();
+  });
+
+  sys::fs::remove(Path);
+}
+
+//
+// Header generation
+//
+
+/// A model with \a Count structs, each with a few integers, a pointer to the
+/// previous one, the one before it by value, and a typedef.
+///
+/// Each struct only embeds a single other struct, hence sizes grow linearly
+/// with \a Count, while definitions still have to be ordered.
+static TupleTree<model::Binary> makeModel(unsigned Count) {
+  using model::PrimitiveTypeKind::Signed;
+
+  TupleTree<model::Binary> Model;
+  Model->Architecture() = model::Architecture::x86_64;
+  model::QualifiedType Int64 = { Model->getPrimitiveType(Signed, 8), {} };
+
+  llvm::SmallVector<model::TypePath, 2> Previous;
+  for (unsigned I = 0; I < Count; ++I) {
+    auto Path = Model->recordNewType(model::makeType<model::StructType>());
+    auto *Struct = llvm::cast<model::StructType>(Path.get());
+    for (unsigned Field = 0; Field < 4; ++Field)
+      Struct->Fields()[Field * 8].Type() = Int64;
+    uint64_t Size = 32;
+
+    if (Previous.size() >= 1) {
+      auto Pointer = model::Qualifier::createPointer(8);
+      Struct->Fields()[Size].Type() = { Previous.back(), { Pointer } };
+      Size += 8;
+    }
+
+    if (Previous.size() >= 2) {
+      model::QualifiedType Embedded = { Previous.front(), {} };
+      Struct->Fields()[Size].Type() = Embedded;
+      Size += *Embedded.size();
+    }
+    Struct->Size() = Size;
+
+    auto TypedefType = model::makeType<model::TypedefType>();
+    auto TypedefPath = Model->recordNewType(std::move(TypedefType));
+    auto *Typedef = llvm::cast<model::TypedefType>(TypedefPath.get());
+    Typedef->UnderlyingType() = { Path, {} };
+
+    if (Previous.size() == 2)
+      Previous.erase(Previous.begin());
+    Previous.push_back(Path);
+  }
+
+  revng_check(Model->verify(true));
+  return Model;
+}
+
+BOOST_AUTO_TEST_CASE(HeaderGeneration) {
+  TupleTree<model::Binary> Model = makeModel(5000);
+  measure("model-to-header", [&Model](MemoryProbe &Probe) {
+    std::string Header;
+    raw_string_ostream Out(Header);
+    ModelToHeaderOptions Options;
+    Options.GeneratePlainC = true;
+    revng_check(dumpModelToHeader(*Model, Out, Options));
+    Out.flush();
+    Probe.sample();
+  });
+}
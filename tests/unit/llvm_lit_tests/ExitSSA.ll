@@ -0,0 +1,57 @@
+;
+; This file is distributed under the MIT License. See LICENSE.md for details.
+;
+
+; RUN: %revngopt %s -exit-ssa -S -o - | FileCheck %s
+;
+; Ensures that `exit-ssa` assigns a PHINode and its PHINode users to the same
+; local variable, unless they receive different values along the same edge
+
+; %p and %q never receive a value along the same edge, so they share a variable
+define i32 @compatible(i1 %c, i1 %d, i32 %x, i32 %y) {
+; CHECK-LABEL: define i32 @compatible
+; CHECK: alloca i32
+; CHECK-NOT: alloca
+; CHECK-NOT: phi
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  br label %mid
+
+right:
+  br label %mid
+
+mid:
+  %p = phi i32 [ %x, %left ], [ %y, %right ]
+  br i1 %d, label %exit, label %other
+
+other:
+  br label %exit
+
+exit:
+  %q = phi i32 [ %p, %mid ], [ 0, %other ]
+  ret i32 %q
+}
+
+; %a and %b are swapped at each iteration, hence they receive different values
+; along the backedge and need a variable each
+define i32 @swap(i1 %c, i32 %x, i32 %y) {
+; CHECK-LABEL: define i32 @swap
+; CHECK-COUNT-2: alloca i32
+; CHECK-NOT: alloca
+; CHECK-NOT: phi
+entry:
+  br label %loop
+
+loop:
+  %a = phi i32 [ %x, %entry ], [ %b, %loop ]
+  %b = phi i32 [ %y, %entry ], [ %a, %loop ]
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %ra = phi i32 [ %a, %loop ]
+  %rb = phi i32 [ %b, %loop ]
+  %r = sub i32 %ra, %rb
+  ret i32 %r
+}
@@ -0,0 +1,161 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdlib>
+#include <string>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/MetaAddress.h"
+
+#include "revng-c/Backend/DecompilePipe.h"
+#include "revng-c/Backend/DecompileToSingleFile.h"
+#include "revng-c/Support/PTMLC.h"
+
+using namespace llvm::cl;
+
+static OptionCategory MergeCategory("Decompiled merge options");
+
+static list<std::string> Shards(Positional,
+                                OneOrMore,
+                                desc("<shard archives>"),
+                                cat(MergeCategory));
+
+static opt<std::string> OutputArchive("o",
+                                      desc("Merged archive of decompiled "
+                                           "functions"),
+                                      value_desc("path"),
+                                      init("decompiled.tar.gz"),
+                                      cat(MergeCategory));
+
+static opt<std::string> OutputCFile("c",
+                                    desc("Single C file with all the merged "
+                                         "functions, not written if empty"),
+                                    value_desc("path"),
+                                    init(""),
+                                    cat(MergeCategory));
+
+static opt<unsigned> CShardCount("c-shard-count",
+                                 desc("Also split the merged functions into "
+                                      "this many C files of similar size, "
+                                      "to be compiled in parallel"),
+                                 value_desc("count"),
+                                 init(0),
+                                 cat(MergeCategory));
+
+static opt<std::string> CShardDirectory("c-shard-dir",
+                                        desc("Directory where the C files "
+                                             "requested with -c-shard-count "
+                                             "and their manifest.yml are "
+                                             "written"),
+                                        value_desc("path"),
+                                        init("decompiled"),
+                                        cat(MergeCategory));
+
+using revng::pipes::DecompileStringMap;
+
+static int reportError(llvm::Error Error) {
+  llvm::logAllUnhandledErrors(std::move(Error), llvm::errs());
+  return EXIT_FAILURE;
+}
+
+static int reportOpenError(llvm::StringRef Path, std::error_code EC) {
+  llvm::errs() << "Cannot open " << Path << ": " << EC.message() << "\n";
+  return EXIT_FAILURE;
+}
+
+/// Write the functions of \a Functions as CShardCount translation units, each
+/// including the shared headers, and a manifest.yml listing the functions of
+/// each of them
+static int writeCShards(const DecompileStringMap &Functions) {
+  if (std::error_code EC = llvm::sys::fs::create_directories(CShardDirectory))
+    return reportOpenError(CShardDirectory, EC);
+
+  llvm::SmallString<128> ManifestPath(CShardDirectory.getValue());
+  llvm::sys::path::append(ManifestPath, "manifest.yml");
+  std::error_code EC;
+  llvm::raw_fd_ostream Manifest(ManifestPath, EC);
+  if (EC)
+    return reportOpenError(ManifestPath, EC);
+
+  Manifest << "Shards:\n";
+  auto Shards = partitionCFunctions(Functions, CShardCount);
+  for (const auto &[Index, Shard] : llvm::enumerate(Shards)) {
+    std::string FileName = llvm::formatv("decompiled-{0}.c", Index);
+    llvm::SmallString<128> Path(CShardDirectory.getValue());
+    llvm::sys::path::append(Path, FileName);
+
+    llvm::raw_fd_ostream Out(Path, EC);
+    if (EC)
+      return reportOpenError(Path, EC);
+
+    ptml::PTMLCBuilder B;
+    printCFileShard(Out, B, Functions, Shard);
+
+    Manifest << "  - File: " << FileName << "\n";
+    Manifest << "    Functions:\n";
+    for (const MetaAddress &Entry : Shard)
+      Manifest << "      - \"" << Entry.toString() << "\"\n";
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &MergeCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Combines the archives of decompiled functions "
+                          "produced by nodes that have been requested "
+                          "disjoint sets of functions, into the same archive "
+                          "and C file a run on a single node would "
+                          "produce.\n");
+
+  DecompileStringMap Merged(revng::pipes::DecompileName);
+  for (const std::string &Path : Shards) {
+    DecompileStringMap Shard(revng::pipes::DecompileName);
+    if (llvm::Error Error = Shard.loadFromDisk(Path))
+      return reportError(std::move(Error));
+
+    for (const auto &[Entry, CCode] : Shard) {
+      // Shards are disjoint, unless the same shard has been passed twice or
+      // the same function has been requested to more than one node
+      if (Merged.find(Entry) != Merged.end()) {
+        llvm::errs() << "Function " << Entry.toString()
+                     << " appears in more than one shard, the last one being "
+                     << Path << "\n";
+        return EXIT_FAILURE;
+      }
+
+      Merged.insert_or_assign(Entry, CCode);
+    }
+  }
+
+  // Functions are kept sorted by entry address, hence the result doesn't
+  // depend on the order of the shards
+  if (llvm::Error Error = Merged.storeToDisk(OutputArchive))
+    return reportError(std::move(Error));
+
+  if (not OutputCFile.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream Out(OutputCFile, EC);
+    if (EC)
+      return reportOpenError(OutputCFile, EC);
+
+    // No targets means all the functions, as decompile-to-single-file
+    // does when all of them have been requested
+    ptml::PTMLCBuilder B;
+    printSingleCFile(Out, B, Merged, {});
+  }
+
+  if (CShardCount > 0)
+    return writeCShards(Merged);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+
+#include "revng-c/DataLayoutAnalysis/DLATypeSystem.h"
+#include "revng-c/Support/MetricsOutput.h"
+
+#include "lib/DataLayoutAnalysis/Middleend/DLAStep.h"
+
+using namespace llvm::cl;
+
+using LTSN = dla::LayoutTypeSystemNode;
+
+static OptionCategory BenchmarkCategory("DLA benchmark options");
+
+static list<std::string> Snapshots(Positional,
+                                   desc("<snapshot files to replay>"),
+                                   ZeroOrMore,
+                                   cat(BenchmarkCategory));
+
+static opt<unsigned> Roots("roots",
+                           desc("Number of trees in the synthetic graph"),
+                           init(64),
+                           cat(BenchmarkCategory));
+
+static opt<unsigned> Depth("depth",
+                           desc("Depth of each synthetic tree"),
+                           init(4),
+                           cat(BenchmarkCategory));
+
+static opt<unsigned> FanOut("fan-out",
+                            desc("Number of children of each non-leaf node "
+                                 "of the synthetic trees"),
+                            init(4),
+                            cat(BenchmarkCategory));
+
+static opt<unsigned> StridePercent("stride-percent",
+                                   desc("Percentage of strided instance edges "
+                                        "in the synthetic graph"),
+                                   init(20),
+                                   cat(BenchmarkCategory));
+
+static opt<unsigned> PointerPercent("pointer-percent",
+                                    desc("Percentage of leaves of the "
+                                         "synthetic graph pointing to a "
+                                         "random root, possibly forming "
+                                         "cycles"),
+                                    init(10),
+                                    cat(BenchmarkCategory));
+
+static opt<unsigned> EqualityPercent("equality-percent",
+                                     desc("Percentage of leaves of the "
+                                          "synthetic graph made equal to "
+                                          "another random leaf"),
+                                     init(5),
+                                     cat(BenchmarkCategory));
+
+static opt<unsigned> Seed("seed",
+                          desc("Seed of the synthetic graph generator"),
+                          init(0),
+                          cat(BenchmarkCategory));
+
+static opt<unsigned> Repetitions("repetitions",
+                                 desc("Number of times each graph goes "
+                                      "through the schedule"),
+                                 init(1),
+                                 cat(BenchmarkCategory));
+
+static opt<unsigned> PtrSize("pointer-size",
+                             desc("Size of pointers, in bytes"),
+                             init(8),
+                             cat(BenchmarkCategory));
+
+static constexpr uint64_t LeafSize = 8;
+
+/// Builds a forest of trees of instance edges, with some pointer edges from the
+/// leaves to the roots and some equality edges among the leaves, mimicking
+/// the shape of the graphs built by the DLA frontend.
+static void buildSyntheticGraph(dla::LayoutTypeSystem &TS) {
+  std::mt19937_64 Generator(Seed);
+  auto Percent = [&Generator](unsigned P) { return Generator() % 100 < P; };
+
+  std::vector<LTSN *> RootNodes;
+  std::vector<LTSN *> Leaves;
+  for (unsigned R = 0; R < Roots; ++R) {
+    LTSN *Root = TS.createArtificialLayoutType();
+    RootNodes.push_back(Root);
+
+    // Each level splits the span of its nodes among FanOut children
+    uint64_t Span = LeafSize;
+    for (unsigned D = 0; D < Depth; ++D)
+      Span *= FanOut;
+
+    llvm::SmallVector<LTSN *, 16> Level = { Root };
+    for (unsigned D = 0; D < Depth; ++D) {
+      Span /= FanOut;
+      bool IsLeafLevel = (D + 1 == Depth);
+      llvm::SmallVector<LTSN *, 16> NextLevel;
+      for (LTSN *Parent : Level) {
+        for (unsigned I = 0; I < FanOut; ++I) {
+          LTSN *Child = TS.createArtificialLayoutType();
+          if (IsLeafLevel) {
+            Child->Size = LeafSize;
+            Leaves.push_back(Child);
+          }
+
+          dla::OffsetExpression OE{ I * Span };
+          if (Percent(StridePercent)) {
+            // The array ends where its parent does
+            OE.Strides.push_back(Span);
+            OE.TripCounts.push_back(FanOut - I);
+          }
+          TS.addInstanceLink(Parent, Child, std::move(OE));
+          NextLevel.push_back(Child);
+        }
+      }
+      Level = std::move(NextLevel);
+    }
+  }
+
+  for (LTSN *Leaf : Leaves) {
+    if (Percent(PointerPercent)) {
+      Leaf->Size = PtrSize;
+      TS.addPointerLink(Leaf, RootNodes[Generator() % RootNodes.size()]);
+    } else if (Percent(EqualityPercent)) {
+      LTSN *Other = Leaves[Generator() % Leaves.size()];
+      if (Other->Size == Leaf->Size)
+        TS.addEqualityLink(Leaf, Other);
+    }
+  }
+}
+
+/// Runs the default schedule on the graph described by \a Snapshot, and prints
+/// a line of CSV with the results
+static void runBenchmark(llvm::StringRef Name, llvm::StringRef Snapshot) {
+  for (unsigned R = 0; R < Repetitions; ++R) {
+    dla::LayoutTypeSystem TS;
+    if (not TS.readSnapshot(Snapshot)) {
+      llvm::errs() << Name << ": invalid snapshot\n";
+      return;
+    }
+
+    size_t NodesBefore = TS.getNumLayouts();
+    size_t EdgesBefore = TS.countEdges();
+
+    dla::StepManager SM;
+    dla::populateDefaultSchedule(SM, PtrSize);
+
+    auto Start = std::chrono::steady_clock::now();
+    SM.run(TS);
+    std::chrono::duration<double, std::milli>
+      Elapsed = std::chrono::steady_clock::now() - Start;
+
+    llvm::outs() << Name << "," << R << "," << NodesBefore << ","
+                 << TS.getNumLayouts() << "," << EdgesBefore << ","
+                 << TS.countEdges() << ","
+                 << llvm::format("%.3f", Elapsed.count()) << ","
+                 << getPeakRSSKiB() << "\n";
+  }
+}
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &BenchmarkCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Runs the DLA middle-end on synthetic graphs and on "
+                          "snapshots captured with -dla-step-dump-snapshot.\n"
+                          "Use -dla-step-profile-output to get the time spent "
+                          "in each step.\n");
+
+  if (FanOut == 0) {
+    llvm::errs() << "-fan-out must be at least 1\n";
+    return EXIT_FAILURE;
+  }
+
+  // peak_rss_kib is the peak of the whole process so far
+  llvm::outs() << "graph,repetition,nodes_before,nodes_after,edges_before,"
+                  "edges_after,ms,peak_rss_kib\n";
+
+  if (Snapshots.empty()) {
+    // Build the synthetic graph once, and start each repetition from a copy
+    std::string Snapshot;
+    {
+      dla::LayoutTypeSystem TS;
+      buildSyntheticGraph(TS);
+      llvm::raw_string_ostream OS(Snapshot);
+      TS.writeSnapshot(OS);
+    }
+    runBenchmark("synthetic", Snapshot);
+    return EXIT_SUCCESS;
+  }
+
+  for (const std::string &Path : Snapshots) {
+    auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
+    if (not MaybeBuffer) {
+      llvm::errs() << Path << ": " << MaybeBuffer.getError().message() << "\n";
+      return EXIT_FAILURE;
+    }
+    runBenchmark(Path, (*MaybeBuffer)->getBuffer());
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/MetaAddress.h"
+#include "revng/Support/YAMLTraits.h"
+
+using namespace llvm::cl;
+
+static OptionCategory GeneratorCategory("Model generator options");
+
+static opt<unsigned> Structs("structs",
+                             desc("Number of structs"),
+                             init(1000),
+                             cat(GeneratorCategory));
+
+static opt<unsigned> Unions("unions",
+                            desc("Number of unions"),
+                            init(100),
+                            cat(GeneratorCategory));
+
+static opt<unsigned> Enums("enums",
+                           desc("Number of enums"),
+                           init(100),
+                           cat(GeneratorCategory));
+
+static opt<unsigned> TypedefDepth("typedef-depth",
+                                  desc("Length of the chain of typedefs "
+                                       "around each struct, union and enum"),
+                                  init(1),
+                                  cat(GeneratorCategory));
+
+static opt<unsigned> Functions("functions",
+                               desc("Number of functions, each with its own "
+                                    "prototype"),
+                               init(1000),
+                               cat(GeneratorCategory));
+
+static opt<unsigned> StackTypePercent("stack-type-percent",
+                                      desc("Percentage of the functions with "
+                                           "a stack frame type"),
+                                      init(50),
+                                      cat(GeneratorCategory));
+
+static opt<unsigned> Seed("seed",
+                          desc("Seed of the random generator"),
+                          init(0),
+                          cat(GeneratorCategory));
+
+static opt<std::string> OutputPath("o",
+                                   desc("Output file"),
+                                   value_desc("path"),
+                                   init("-"),
+                                   cat(GeneratorCategory));
+
+static constexpr uint64_t PointerSize = 8;
+
+/// Builds a random, but valid and deterministic, model.
+///
+/// Structs can contain, by value, only structs and unions created before them,
+/// so that there are no cycles of values, while pointers can point to any
+/// struct, so that there are cycles through pointers, as in real programs.
+class ModelGenerator {
+private:
+  model::Binary &Model;
+  std::mt19937_64 Random;
+  std::vector<model::TypePath> Primitives;
+  std::vector<model::TypePath> Aggregates;
+  std::vector<model::TypePath> Pointees;
+  std::vector<model::TypePath> Named;
+
+public:
+  ModelGenerator(model::Binary &Model, uint64_t Seed) :
+    Model(Model), Random(Seed) {
+    using namespace model::PrimitiveTypeKind;
+    for (uint64_t Size : { 1, 2, 4, 8 }) {
+      Primitives.push_back(Model.getPrimitiveType(Signed, Size));
+      Primitives.push_back(Model.getPrimitiveType(Unsigned, Size));
+    }
+  }
+
+public:
+  void run() {
+    // Create all the structs first, so that pointers can refer to any of them
+    std::vector<model::StructType *> NewStructs;
+    for (unsigned I = 0; I < Structs; ++I) {
+      auto Path = Model.recordNewType(model::makeType<model::StructType>());
+      NewStructs.push_back(llvm::cast<model::StructType>(Path.get()));
+      Pointees.push_back(Path);
+    }
+
+    for (unsigned I = 0; I < Enums; ++I)
+      makeEnum();
+
+    // Interleave structs and unions, so that they contain each other
+    unsigned UnionCount = 0;
+    for (unsigned I = 0; I < Structs; ++I) {
+      fillStruct(*NewStructs[I], 2 + below(7));
+      Aggregates.push_back(Pointees[I]);
+      Named.push_back(Pointees[I]);
+
+      while (UnionCount < Unions and UnionCount * Structs <= I * Unions) {
+        makeUnion();
+        ++UnionCount;
+      }
+    }
+    while (UnionCount++ < Unions)
+      makeUnion();
+
+    for (const model::TypePath &Path : std::vector(Named))
+      makeTypedefChain(Path);
+
+    for (unsigned I = 0; I < Functions; ++I)
+      makeFunction(I);
+  }
+
+private:
+  uint64_t below(uint64_t Bound) { return Random() % Bound; }
+
+  template<typename T>
+  const T &pick(const std::vector<T> &Candidates) {
+    revng_assert(not Candidates.empty());
+    return Candidates[below(Candidates.size())];
+  }
+
+  model::QualifiedType makeFieldType() {
+    uint64_t Choice = below(10);
+    if (Choice < 2 and not Pointees.empty()) {
+      auto Pointer = model::Qualifier::createPointer(PointerSize);
+      return { pick(Pointees), { Pointer } };
+    }
+
+    if (Choice < 4 and not Aggregates.empty())
+      return { pick(Aggregates), {} };
+
+    if (Choice < 5) {
+      auto Array = model::Qualifier::createArray(1 + below(16));
+      return { pick(Primitives), { Array } };
+    }
+
+    if (Choice < 6 and not Named.empty())
+      return { pick(Named), {} };
+
+    return { pick(Primitives), {} };
+  }
+
+  void fillStruct(model::StructType &Struct, unsigned FieldCount) {
+    uint64_t Offset = 0;
+    for (unsigned I = 0; I < FieldCount; ++I) {
+      model::QualifiedType Type = makeFieldType();
+      uint64_t Size = *Type.size();
+
+      // Leave some padding, as in real structs
+      Offset = (Offset + 7) / 8 * 8 + (below(4) == 0 ? 8 : 0);
+      Struct.Fields()[Offset].Type() = Type;
+      Offset += Size;
+    }
+    Struct.Size() = Offset;
+  }
+
+  void makeUnion() {
+    auto Path = Model.recordNewType(model::makeType<model::UnionType>());
+    auto *Union = llvm::cast<model::UnionType>(Path.get());
+    unsigned FieldCount = 2 + below(5);
+    for (unsigned I = 0; I < FieldCount; ++I)
+      Union->Fields()[I].Type() = makeFieldType();
+
+    Aggregates.push_back(Path);
+    Named.push_back(Path);
+  }
+
+  void makeEnum() {
+    auto Path = Model.recordNewType(model::makeType<model::EnumType>());
+    auto *Enum = llvm::cast<model::EnumType>(Path.get());
+    using model::PrimitiveTypeKind::Unsigned;
+    Enum->UnderlyingType() = { Model.getPrimitiveType(Unsigned, 4), {} };
+
+    unsigned EntryCount = 4 + below(29);
+    uint64_t Value = 0;
+    for (unsigned I = 0; I < EntryCount; ++I) {
+      Value += 1 + below(4);
+      // Entries are global identifiers in C, hence they must be unique
+      auto Name = llvm::formatv("enum_{0}_entry_{1}", Enum->ID(), I).str();
+      Enum->Entries()[Value].CustomName() = Name;
+    }
+
+    Named.push_back(Path);
+  }
+
+  void makeTypedefChain(model::TypePath Path) {
+    for (unsigned I = 0; I < TypedefDepth; ++I) {
+      auto Typedef = model::makeType<model::TypedefType>();
+      auto TypedefPath = Model.recordNewType(std::move(Typedef));
+      auto *NewTypedef = llvm::cast<model::TypedefType>(TypedefPath.get());
+      NewTypedef->UnderlyingType() = { Path, {} };
+      Path = TypedefPath;
+    }
+
+    if (TypedefDepth != 0)
+      Named.push_back(Path);
+  }
+
+  model::QualifiedType makeArgumentType() {
+    if (below(3) == 0 and not Pointees.empty()) {
+      auto Pointer = model::Qualifier::createPointer(PointerSize);
+      return { pick(Pointees), { Pointer } };
+    }
+
+    return { pick(Primitives), {} };
+  }
+
+  void makeFunction(unsigned Index) {
+    auto Prototype = model::makeType<model::CABIFunctionType>();
+    auto PrototypePath = Model.recordNewType(std::move(Prototype));
+    auto *Type = llvm::cast<model::CABIFunctionType>(PrototypePath.get());
+    Type->ABI() = model::ABI::SystemV_x86_64;
+    if (below(4) != 0)
+      Type->ReturnType() = makeArgumentType();
+
+    unsigned ArgumentCount = below(7);
+    for (unsigned I = 0; I < ArgumentCount; ++I)
+      Type->Arguments()[I].Type() = makeArgumentType();
+
+    std::string Entry = llvm::formatv("{0:x}:Code_x86_64",
+                                      0x400000 + 0x40 * Index)
+                          .str();
+    model::Function &Function = Model
+                                  .Functions()[MetaAddress::fromString(Entry)];
+    Function.Prototype() = PrototypePath;
+
+    if (below(100) < StackTypePercent) {
+      auto Path = Model.recordNewType(model::makeType<model::StructType>());
+      auto *Stack = llvm::cast<model::StructType>(Path.get());
+      fillStruct(*Stack, 1 + below(8));
+      Function.StackFrameType() = Path;
+    }
+  }
+};
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &GeneratorCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Generates a large random model, to be used as "
+                          "input of header generation benchmarks.\n");
+
+  if (StackTypePercent > 100) {
+    llvm::errs() << "-stack-type-percent must be at most 100\n";
+    return EXIT_FAILURE;
+  }
+
+  TupleTree<model::Binary> Model;
+  Model->Architecture() = model::Architecture::x86_64;
+  Model->DefaultABI() = model::ABI::SystemV_x86_64;
+  ModelGenerator(*Model, Seed).run();
+  revng_check(Model->verify(true));
+
+  std::error_code EC;
+  llvm::raw_fd_ostream Output(OutputPath, EC);
+  if (EC) {
+    llvm::errs() << "Cannot open " << OutputPath << ": " << EC.message()
+                 << "\n";
+    return EXIT_FAILURE;
+  }
+
+  llvm::yaml::Output YAMLOutput(Output);
+  YAMLOutput << *Model;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Model/Binary.h"
+#include "revng/Model/VerifyHelper.h"
+#include "revng/Support/Assert.h"
+
+#include "lib/Canonicalize/MakeModelGEP.h"
+
+using namespace llvm::cl;
+
+static OptionCategory BenchmarkCategory("ModelGEP benchmark options");
+
+static opt<unsigned> MaxDepth("max-depth",
+                              desc("Deepest nesting of the synthetic "
+                                   "structs"),
+                              init(8),
+                              cat(BenchmarkCategory));
+
+static opt<unsigned> MaxUnionFields("max-union-fields",
+                                    desc("Largest number of fields of the "
+                                         "synthetic unions of arrays of "
+                                         "structs"),
+                                    init(64),
+                                    cat(BenchmarkCategory));
+
+static opt<unsigned> MaxTypedefs("max-typedefs",
+                                 desc("Longest chain of typedefs around the "
+                                      "synthetic structs"),
+                                 init(64),
+                                 cat(BenchmarkCategory));
+
+static opt<unsigned> MaxAccesses("max-accesses",
+                                 desc("Largest number of constant offsets "
+                                      "accessed in each synthetic type"),
+                                 init(512),
+                                 cat(BenchmarkCategory));
+
+static opt<unsigned> Repetitions("repetitions",
+                                 desc("Number of times the accesses to each "
+                                      "type are computed"),
+                                 init(1),
+                                 cat(BenchmarkCategory));
+
+using model::PrimitiveTypeKind::Signed;
+
+static constexpr uint64_t PointerSize = 8;
+
+static model::QualifiedType getInt64(model::Binary &Model) {
+  return { Model.getPrimitiveType(Signed, 8), {} };
+}
+
+/// A struct containing two copies of a struct of depth \a Depth - 1 and an
+/// integer, down to a struct of two integers at depth 0
+static model::QualifiedType makeNestedStruct(model::Binary &Model,
+                                             unsigned Depth) {
+  auto Path = Model.recordNewType(model::makeType<model::StructType>());
+  auto *Struct = llvm::cast<model::StructType>(Path.get());
+
+  model::QualifiedType Int64 = getInt64(Model);
+  if (Depth == 0) {
+    Struct->Fields()[0].Type() = Int64;
+    Struct->Fields()[8].Type() = Int64;
+    Struct->Size() = 16;
+    return { Path, {} };
+  }
+
+  model::QualifiedType Inner = makeNestedStruct(Model, Depth - 1);
+  uint64_t InnerSize = *Inner.size();
+  Struct->Fields()[0].Type() = Inner;
+  Struct->Fields()[InnerSize].Type() = Inner;
+  Struct->Fields()[2 * InnerSize].Type() = Int64;
+  Struct->Size() = 2 * InnerSize + 8;
+  return { Path, {} };
+}
+
+/// A union with \a Fields fields, the I-th of which is an array of 16 structs
+/// with I + 1 integers
+static model::QualifiedType makeUnionOfArrays(model::Binary &Model,
+                                              unsigned Fields) {
+  auto Path = Model.recordNewType(model::makeType<model::UnionType>());
+  auto *Union = llvm::cast<model::UnionType>(Path.get());
+
+  for (unsigned I = 0; I < Fields; ++I) {
+    auto ElementType = model::makeType<model::StructType>();
+    auto ElementPath = Model.recordNewType(std::move(ElementType));
+    auto *Element = llvm::cast<model::StructType>(ElementPath.get());
+    for (unsigned J = 0; J <= I; ++J)
+      Element->Fields()[J * 8].Type() = getInt64(Model);
+    Element->Size() = (I + 1) * 8;
+
+    Union->Fields()[I].Type() = { ElementPath,
+                                  { model::Qualifier::createArray(16) } };
+  }
+
+  return { Path, {} };
+}
+
+/// \a Length typedefs, each one of the previous one, around an array of
+/// nested structs
+static model::QualifiedType makeTypedefChain(model::Binary &Model,
+                                             unsigned Length) {
+  model::QualifiedType Result = makeNestedStruct(Model, 2);
+  Result.Qualifiers().push_back(model::Qualifier::createArray(8));
+  for (unsigned I = 0; I < Length; ++I) {
+    auto Path = Model.recordNewType(model::makeType<model::TypedefType>());
+    auto *Typedef = llvm::cast<model::TypedefType>(Path.get());
+    Typedef->UnderlyingType() = Result;
+    Result = { Path, {} };
+  }
+
+  return Result;
+}
+
+/// Loads of integers at evenly spaced offsets in \a Type, plus the same
+/// offsets in an array of \a Type indexed by \a Index, mimicking the
+/// addressing patterns of a loop
+static std::vector<ModelGEPAccess>
+makeAccesses(model::Binary &Model,
+             const model::QualifiedType &Type,
+             llvm::Value *Index) {
+  uint64_t Size = *Type.size();
+  uint64_t Step = std::max<uint64_t>(PointerSize,
+                                     Size / MaxAccesses / PointerSize
+                                       * PointerSize);
+
+  std::vector<ModelGEPAccess> Result;
+  for (uint64_t Offset = 0; Offset + PointerSize <= Size; Offset += Step) {
+    Result.push_back({ Offset, {}, getInt64(Model) });
+    Result.push_back({ Offset, { { Size, Index } }, getInt64(Model) });
+  }
+
+  return Result;
+}
+
+static void runBenchmark(llvm::StringRef Name,
+                         unsigned Parameter,
+                         model::Binary &Model,
+                         const model::QualifiedType &Type,
+                         llvm::Value *Index) {
+  revng_check(Type.verify(true));
+  std::vector<ModelGEPAccess> Accesses = makeAccesses(Model, Type, Index);
+
+  for (unsigned R = 0; R < Repetitions; ++R) {
+    // The sizes memoized by the VerifyHelper are part of what is measured
+    model::VerifyHelper VH;
+
+    auto Start = std::chrono::steady_clock::now();
+    size_t Indices = computeBestModelGEPs(Type,
+                                          Accesses,
+                                          Model.Architecture(),
+                                          VH);
+    std::chrono::duration<double, std::milli>
+      Elapsed = std::chrono::steady_clock::now() - Start;
+
+    llvm::outs() << Name << "," << Parameter << "," << *Type.size() << ","
+                 << Accesses.size() << "," << R << "," << Indices << ","
+                 << llvm::format("%.3f", Elapsed.count()) << "\n";
+  }
+}
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &BenchmarkCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Times the selection of the best ModelGEP for "
+                          "accesses to synthetic model types.\n");
+
+  if (MaxAccesses == 0) {
+    llvm::errs() << "-max-accesses must be at least 1\n";
+    return EXIT_FAILURE;
+  }
+
+  TupleTree<model::Binary> Model;
+  Model->Architecture() = model::Architecture::x86_64;
+
+  // The non-constant index of strided accesses
+  llvm::LLVMContext Context;
+  llvm::Module M("model-gep-benchmark", Context);
+  auto *Int64 = llvm::Type::getInt64Ty(Context);
+  auto *FunctionType = llvm::FunctionType::get(llvm::Type::getVoidTy(Context),
+                                               { Int64 },
+                                               false);
+  auto *F = llvm::Function::Create(FunctionType,
+                                   llvm::GlobalValue::ExternalLinkage,
+                                   "index",
+                                   M);
+  llvm::Value *Index = F->getArg(0);
+
+  llvm::outs() << "model,parameter,type_bytes,accesses,repetition,indices,"
+                  "ms\n";
+
+  for (unsigned Depth = 1; Depth <= MaxDepth; Depth *= 2)
+    runBenchmark("nested-structs",
+                 Depth,
+                 *Model,
+                 makeNestedStruct(*Model, Depth),
+                 Index);
+
+  for (unsigned Fields = 1; Fields <= MaxUnionFields; Fields *= 2)
+    runBenchmark("union-of-arrays",
+                 Fields,
+                 *Model,
+                 makeUnionOfArrays(*Model, Fields),
+                 Index);
+
+  for (unsigned Length = 1; Length <= MaxTypedefs; Length *= 2)
+    runBenchmark("typedef-chain",
+                 Length,
+                 *Model,
+                 makeTypedefChain(*Model, Length),
+                 Index);
+
+  return EXIT_SUCCESS;
+}
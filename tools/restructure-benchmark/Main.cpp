@@ -0,0 +1,308 @@
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+
+#include "revng-c/RestructureCFG/ASTNode.h"
+#include "revng-c/RestructureCFG/ASTTree.h"
+#include "revng-c/RestructureCFG/GraphSnapshot.h"
+#include "revng-c/RestructureCFG/RegionCFGTree.h"
+#include "revng-c/RestructureCFG/RestructureCFG.h"
+#include "revng-c/Support/MetricsOutput.h"
+
+using namespace llvm::cl;
+
+static OptionCategory BenchmarkCategory("Restructure benchmark options");
+
+static list<std::string> Generators("generators",
+                                    desc("Comma-separated list of CFG "
+                                         "generators to run: irreducible, "
+                                         "switch, loop-nest, dag (default: "
+                                         "all of them)"),
+                                    CommaSeparated,
+                                    cat(BenchmarkCategory));
+
+static list<unsigned> Sizes("sizes",
+                            desc("Comma-separated list of sizes of the "
+                                 "generated CFGs (default: 8,16,32,64,128)"),
+                            CommaSeparated,
+                            cat(BenchmarkCategory));
+
+static opt<unsigned> Seed("seed",
+                          desc("Seed of the random CFG generators"),
+                          init(0),
+                          cat(BenchmarkCategory));
+
+static opt<unsigned> Repetitions("repetitions",
+                                 desc("Number of times each CFG is "
+                                      "restructured"),
+                                 init(1),
+                                 cat(BenchmarkCategory));
+
+static opt<std::string> PrintSnapshot("print-snapshot",
+                                      desc("Print the graph snapshot written "
+                                           "with -restructure-binary-snapshots "
+                                           "at the given path as a GraphViz "
+                                           "file, instead of running the "
+                                           "benchmark"),
+                                      value_desc("path"),
+                                      cat(BenchmarkCategory));
+
+using Generator = void (*)(llvm::Function &F, unsigned Size, std::mt19937_64 &);
+
+/// Holds the blocks of a generated function, and the condition used by all the
+/// branches, i.e., the only argument of the function
+class CFGBuilder {
+private:
+  llvm::Function &F;
+  llvm::IRBuilder<> Builder;
+  unsigned NextConstant = 0;
+
+public:
+  CFGBuilder(llvm::Function &F) : F(F), Builder(F.getContext()) {}
+
+public:
+  llvm::BasicBlock *block(const llvm::Twine &Name) {
+    return llvm::BasicBlock::Create(F.getContext(), Name, &F);
+  }
+
+  /// Terminate \a From with a conditional branch, on a condition that is
+  /// different from all the others
+  void branch(llvm::BasicBlock *From,
+              llvm::BasicBlock *Then,
+              llvm::BasicBlock *Else) {
+    Builder.SetInsertPoint(From);
+    llvm::Value *Condition = Builder.CreateICmpEQ(F.getArg(0),
+                                                  constant(NextConstant++));
+    Builder.CreateCondBr(Condition, Then, Else);
+  }
+
+  void jump(llvm::BasicBlock *From, llvm::BasicBlock *To) {
+    Builder.SetInsertPoint(From);
+    Builder.CreateBr(To);
+  }
+
+  void ret(llvm::BasicBlock *From) {
+    Builder.SetInsertPoint(From);
+    Builder.CreateRetVoid();
+  }
+
+  llvm::SwitchInst *
+  switchOn(llvm::BasicBlock *From, llvm::BasicBlock *Default, unsigned Cases) {
+    Builder.SetInsertPoint(From);
+    return Builder.CreateSwitch(F.getArg(0), Default, Cases);
+  }
+
+  llvm::ConstantInt *constant(uint64_t Value) {
+    return Builder.getInt32(Value);
+  }
+};
+
+/// A cycle of \a Size blocks, each one of which can be reached straight from
+/// the entry block
+static void
+buildIrreducible(llvm::Function &F, unsigned Size, std::mt19937_64 &) {
+  CFGBuilder B(F);
+  llvm::BasicBlock *Entry = B.block("entry");
+  llvm::SmallVector<llvm::BasicBlock *, 16> Cycle;
+  for (unsigned I = 0; I < Size; ++I)
+    Cycle.push_back(B.block("cycle"));
+  llvm::BasicBlock *Exit = B.block("exit");
+
+  llvm::SwitchInst *Switch = B.switchOn(Entry, Cycle[0], Size - 1);
+  for (unsigned I = 1; I < Size; ++I)
+    Switch->addCase(B.constant(I), Cycle[I]);
+
+  for (unsigned I = 0; I < Size; ++I)
+    B.branch(Cycle[I], Exit, Cycle[(I + 1) % Size]);
+  B.ret(Exit);
+}
+
+/// A switch with \a Size cases, each one of which either goes to the exit or
+/// falls through to a later case
+static void
+buildSwitch(llvm::Function &F, unsigned Size, std::mt19937_64 &Random) {
+  CFGBuilder B(F);
+  llvm::BasicBlock *Entry = B.block("entry");
+  llvm::SmallVector<llvm::BasicBlock *, 16> Cases;
+  for (unsigned I = 0; I < Size; ++I)
+    Cases.push_back(B.block("case"));
+  llvm::BasicBlock *Exit = B.block("exit");
+
+  llvm::SwitchInst *Switch = B.switchOn(Entry, Exit, Size);
+  for (unsigned I = 0; I < Size; ++I)
+    Switch->addCase(B.constant(I), Cases[I]);
+
+  for (unsigned I = 0; I < Size; ++I) {
+    unsigned Later = I + 1 + Random() % (Size - I);
+    B.branch(Cases[I], Later < Size ? Cases[Later] : Exit, Exit);
+  }
+  B.ret(Exit);
+}
+
+/// \a Size nested loops, with a break from the innermost one straight out of
+/// the outermost one
+static void buildLoopNest(llvm::Function &F, unsigned Size, std::mt19937_64 &) {
+  CFGBuilder B(F);
+  llvm::BasicBlock *Entry = B.block("entry");
+  llvm::SmallVector<llvm::BasicBlock *, 16> Headers;
+  llvm::SmallVector<llvm::BasicBlock *, 16> Latches;
+  llvm::SmallVector<llvm::BasicBlock *, 16> Exits;
+  for (unsigned I = 0; I < Size; ++I) {
+    Headers.push_back(B.block("header"));
+    Latches.push_back(B.block("latch"));
+    Exits.push_back(B.block("loop_exit"));
+  }
+  llvm::BasicBlock *Body = B.block("body");
+  llvm::BasicBlock *Exit = B.block("exit");
+
+  B.jump(Entry, Headers[0]);
+  for (unsigned I = 0; I < Size; ++I) {
+    bool IsInnermost = I + 1 == Size;
+    B.branch(Headers[I], IsInnermost ? Body : Headers[I + 1], Exits[I]);
+    B.jump(Latches[I], Headers[I]);
+    B.jump(Exits[I], I == 0 ? Exit : Latches[I - 1]);
+  }
+  B.branch(Body, Latches[Size - 1], Exit);
+  B.ret(Exit);
+}
+
+/// A random DAG of \a Size blocks, where each block goes either to the next
+/// one or to a random later one, so that most paths merge late
+static void
+buildDAG(llvm::Function &F, unsigned Size, std::mt19937_64 &Random) {
+  CFGBuilder B(F);
+  llvm::SmallVector<llvm::BasicBlock *, 16> Blocks;
+  for (unsigned I = 0; I < Size; ++I)
+    Blocks.push_back(B.block(I == 0 ? "entry" : "block"));
+
+  for (unsigned I = 0; I + 1 < Size; ++I) {
+    unsigned Far = I + 1 + Random() % (Size - I - 1);
+    B.branch(Blocks[I], Blocks[I + 1], Blocks[Far]);
+  }
+  B.ret(Blocks[Size - 1]);
+}
+
+static const std::pair<const char *, Generator> AllGenerators[] = {
+  { "irreducible", buildIrreducible },
+  { "switch", buildSwitch },
+  { "loop-nest", buildLoopNest },
+  { "dag", buildDAG },
+};
+
+/// Restructures the CFGs built by \a Build, and prints a line of CSV with the
+/// results for each repetition
+static void runBenchmark(llvm::StringRef Name, Generator Build, unsigned Size) {
+  for (unsigned R = 0; R < Repetitions; ++R) {
+    llvm::LLVMContext Context;
+    llvm::Module M("restructure-benchmark", Context);
+    auto *Int32 = llvm::Type::getInt32Ty(Context);
+    auto *FunctionType = llvm::FunctionType::get(llvm::Type::getVoidTy(Context),
+                                                { Int32 },
+                                                false);
+    auto *F = llvm::Function::Create(FunctionType,
+                                     llvm::GlobalValue::ExternalLinkage,
+                                     Name,
+                                     M);
+
+    // Each repetition restructures exactly the same CFG
+    std::mt19937_64 RandomGenerator(Seed);
+    Build(*F, Size, RandomGenerator);
+    size_t Blocks = F->size();
+
+    ASTTree AST;
+    auto Start = std::chrono::steady_clock::now();
+    bool Success = restructureCFG(*F, AST);
+    std::chrono::duration<double, std::milli>
+      Elapsed = std::chrono::steady_clock::now() - Start;
+    revng_check(Success);
+
+    size_t CodeNodes = llvm::count_if(AST.nodes(), [](ASTNode *N) {
+      return llvm::isa<CodeNode>(N);
+    });
+
+    llvm::outs() << Name << "," << Size << "," << R << "," << Blocks << ","
+                 << AST.size() << "," << CodeNodes << ","
+                 << DuplicationCounter.load() << ","
+                 << llvm::format("%.3f", double(CodeNodes) / Blocks) << ","
+                 << llvm::format("%.3f", Elapsed.count()) << ","
+                 << getPeakRSSKiB() << "\n";
+  }
+}
+
+int main(int Argc, char *Argv[]) {
+  HideUnrelatedOptions({ &BenchmarkCategory });
+  ParseCommandLineOptions(Argc,
+                          Argv,
+                          "Restructures generated CFGs of increasing size.\n"
+                          "Use -restructure-metrics-output to get the "
+                          "details of each run.\n");
+
+  if (not PrintSnapshot.empty()) {
+    auto MaybeSnapshot = GraphSnapshot::readFromFile(PrintSnapshot);
+    if (not MaybeSnapshot) {
+      llvm::errs() << "Cannot load " << PrintSnapshot << ": "
+                   << llvm::toString(MaybeSnapshot.takeError()) << "\n";
+      return EXIT_FAILURE;
+    }
+
+    MaybeSnapshot->dumpDot(llvm::outs());
+    return EXIT_SUCCESS;
+  }
+
+  std::vector<unsigned> SizesToRun(Sizes.begin(), Sizes.end());
+  if (SizesToRun.empty())
+    SizesToRun = { 8, 16, 32, 64, 128 };
+
+  for (unsigned Size : SizesToRun) {
+    if (Size < 2) {
+      llvm::errs() << "-sizes must be at least 2\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (const std::string &Name : Generators) {
+    auto IsNamed = [&Name](const auto &Pair) { return Name == Pair.first; };
+    if (llvm::none_of(AllGenerators, IsNamed)) {
+      llvm::errs() << "Unknown generator: " << Name << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // peak_rss_kib is the peak of the whole process so far, while
+  // duplication_factor is the number of code nodes in the GHAST over the
+  // number of blocks in the CFG
+  llvm::outs() << "generator,size,repetition,blocks,ast_nodes,code_nodes,"
+                  "duplications,duplication_factor,ms,peak_rss_kib\n";
+
+  for (const auto &[Name, Build] : AllGenerators) {
+    if (not Generators.empty() and not llvm::is_contained(Generators, Name))
+      continue;
+
+    for (unsigned Size : SizesToRun)
+      runBenchmark(Name, Build, Size);
+  }
+
+  return EXIT_SUCCESS;
+}